@@ -21,12 +21,15 @@
 //---------------------------------------------------------------------------
 
 #include "addon.h"
+#include "dabmuxscanner.h"
 #include "dabstream.h"
 #include "dbtypes.h"
+#include "devicesession.h"
 #include "filedevice.h"
 #include "fmstream.h"
 #include "hdstream.h"
 #include "tcpdevice.h"
+#include "timeshiftstream.h"
 #ifdef USB_DEVICE_SUPPORT
 #include "usbdevice.h"
 #endif
@@ -37,12 +40,17 @@
 #include "gui/channelsettings.h"
 #include "utils/value_size_defines.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <iomanip>
+#include <iterator>
 #include <kodi/Filesystem.h>
 #include <kodi/General.h>
 #include <kodi/gui/dialogs/FileBrowser.h>
 #include <kodi/gui/dialogs/OK.h>
+#include <kodi/gui/dialogs/Progress.h>
 #include <kodi/gui/dialogs/Select.h>
+#include <kodi/gui/dialogs/TextViewer.h>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <rapidjson/prettywriter.h>
@@ -68,6 +76,31 @@
 //
 ADDONCREATOR(addon)
 
+// addon::DABSCAN_SAMPLE_RATE
+//
+// Fixed device sample rate required for a DAB band scan
+uint32_t const addon::DABSCAN_SAMPLE_RATE = (2048 KHz);
+
+// addon::DABSCAN_SETTLE_TIME
+//
+// Time the multiplex data must be unchanged for a DAB band scan to move on
+std::chrono::milliseconds const addon::DABSCAN_SETTLE_TIME = std::chrono::seconds(3);
+
+// addon::DABSCAN_SYNC_TIMEOUT
+//
+// Time a DAB band scan waits for an ensemble to be synchronised
+std::chrono::milliseconds const addon::DABSCAN_SYNC_TIMEOUT = std::chrono::seconds(3);
+
+// addon::DABSCAN_TIMEOUT
+//
+// Maximum time a DAB band scan spends on a single ensemble
+std::chrono::milliseconds const addon::DABSCAN_TIMEOUT = std::chrono::seconds(15);
+
+// addon::STREAMSTATS_INTERVAL
+//
+// Interval at which the stream performance counters are written to disk
+std::chrono::seconds const addon::STREAMSTATS_INTERVAL = std::chrono::seconds(10);
+
 //---------------------------------------------------------------------------
 // addon Instance Constructor
 //
@@ -160,7 +193,8 @@ bool addon::channeladd_dab(struct settings const& settings, struct channelprops&
 
   // Create and initialize a channel settings dialog instance to allow the user to fine-tune the channel
   std::unique_ptr<channelsettings> settingsdialog =
-      channelsettings::create(create_device(settings), tunerprops, channelprops, true);
+      channelsettings::create(create_device(settings, channelprops.frequency), tunerprops,
+                              channelprops, true);
   settingsdialog->DoModal();
 
   if (settingsdialog->get_dialog_result())
@@ -269,7 +303,8 @@ bool addon::channeladd_fm(struct settings const& settings, struct channelprops&
 
     // Create and initialize the dialog box against a new signal meter instance
     std::unique_ptr<channelsettings> settingsdialog =
-        channelsettings::create(create_device(settings), tunerprops, channelprops, true);
+        channelsettings::create(create_device(settings, channelprops.frequency), tunerprops,
+                              channelprops, true);
     settingsdialog->DoModal();
 
     if (settingsdialog->get_dialog_result())
@@ -335,7 +370,8 @@ bool addon::channeladd_hd(struct settings const& settings, struct channelprops&
 
     // Create and initialize a channel settings dialog instance to allow the user to fine-tune the channel
     std::unique_ptr<channelsettings> settingsdialog =
-        channelsettings::create(create_device(settings), tunerprops, channelprops, true);
+        channelsettings::create(create_device(settings, channelprops.frequency), tunerprops,
+                              channelprops, true);
     settingsdialog->DoModal();
 
     if (settingsdialog->get_dialog_result())
@@ -473,7 +509,8 @@ bool addon::channeladd_wx(struct settings const& settings, struct channelprops&
 
   // Create and initialize a channel settings dialog instance to allow the user to fine-tune the channel
   std::unique_ptr<channelsettings> settingsdialog =
-      channelsettings::create(create_device(settings), tunerprops, channelprops, true);
+      channelsettings::create(create_device(settings, channelprops.frequency), tunerprops,
+                              channelprops, true);
   settingsdialog->DoModal();
 
   if (settingsdialog->get_dialog_result() == true)
@@ -517,8 +554,10 @@ inline struct settings addon::copy_settings(void) const
 // Arguments:
 //
 //	settings		- Current addon settings structure
+//	frequency		- Frequency the device will be tuned to
 
-std::unique_ptr<rtldevice> addon::create_device(struct settings const& settings) const
+std::unique_ptr<rtldevice> addon::create_device(struct settings const& settings,
+                                                uint32_t frequency) const
 {
   // Pull a database handle out of the connection pool
   connectionpool::handle dbhandle(m_connpool);
@@ -554,19 +593,406 @@ std::unique_ptr<rtldevice> addon::create_device(struct settings const& settings)
     }
   }
 
+  // USB and network devices are acquired from the device session, which prefers a free device
+  // that is already open and tuned nearby over opening another one
+  return m_devicesession->acquire(device_candidates(settings), frequency);
+}
+
+//---------------------------------------------------------------------------
+// addon::create_stream (private)
+//
+// Creates the PVR stream instance for a channel; this may open a device so the
+// m_pvrstream_lock mutex should not be held unless the stream is the playing one
+//
+// Arguments:
+//
+//	settings		- Current addon settings structure
+//	channeluid		- Unique identifier of the channel
+//	channelprops	- Channel tuning properties
+
+std::unique_ptr<pvrstream> addon::create_stream(struct settings const& settings,
+                                                unsigned int channeluid,
+                                                struct channelprops const& channelprops)
+{
+  // Set up the tuner device properties
+  struct tunerprops tunerprops = {};
+  tunerprops.freqcorrection = settings.device_frequency_correction;
+
+  channelid channelid(channeluid); // Convert UniqueID back into a channelid
+
+  // FM Radio
+  //
+  if (channelprops.modulation == modulation::fm)
+  {
+
+    // Set up the FM digital signal processor properties
+    struct fmprops fmprops = {};
+    fmprops.decoderds = settings.fmradio_enable_rds;
+    fmprops.isnorthamerica = is_region_northamerica(settings);
+    fmprops.samplerate = settings.fmradio_sample_rate;
+    fmprops.downsamplequality = static_cast<int>(settings.fmradio_downsample_quality);
+    fmprops.outputrate = settings.fmradio_output_samplerate;
+    fmprops.outputgain = settings.fmradio_output_gain;
+
+    // Log information about the stream for diagnostic purposes
+    log_info(__func__, ": Creating fmstream for channel \"", channelprops.name, "\"");
+    log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
+    log_info(__func__, ": fmprops.decoderds = ", (fmprops.decoderds) ? "true" : "false");
+    log_info(__func__,
+             ": fmprops.isnorthamerica = ", (fmprops.isnorthamerica) ? "true" : "false");
+    log_info(__func__, ": fmrops.samplerate = ", fmprops.samplerate, " Hz");
+    log_info(__func__, ": fmprops.downsamplequality = ",
+             downsample_quality_to_string(
+                 static_cast<enum downsample_quality>(fmprops.downsamplequality)));
+    log_info(__func__, ": fmprops.outputgain = ", fmprops.outputgain, " dB");
+    log_info(__func__, ": fmprops.outputrate = ", fmprops.outputrate, " Hz");
+    log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
+    log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
+    log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
+    log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
+
+    // Create the FM Radio stream
+    return fmstream::create(create_device(settings, channelprops.frequency), tunerprops,
+                                   channelprops, fmprops);
+  }
+
+  // HD Radio
+  //
+  else if (channelprops.modulation == modulation::hd)
+  {
+
+    // Set up the HD Radio digital signal processor properties
+    struct hdprops hdprops = {};
+    hdprops.outputgain = settings.hdradio_output_gain;
+    hdprops.analogblend = settings.hdradio_analog_blend;
+    hdprops.analogquality = static_cast<int>(settings.fmradio_downsample_quality);
+
+    // Log information about the stream for diagnostic purposes
+    log_info(__func__, ": Creating hdstream for channel \"", channelprops.name, "\"");
+    log_info(__func__, ": subchannel = ", channelid.subchannel());
+    log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
+    log_info(__func__, ": hdprops.outputgain = ", hdprops.outputgain, " dB");
+    log_info(__func__, ": hdprops.analogblend = ", (hdprops.analogblend) ? "true" : "false");
+    log_info(__func__, ": hdprops.analogquality = ",
+             downsample_quality_to_string(
+                 static_cast<enum downsample_quality>(hdprops.analogquality)));
+    log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
+    log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
+    log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
+    log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
+
+    // If there is an active receiver already tuned to the multiplex, attach the new stream to
+    // it rather than opening another device; the multiplex only needs to be demodulated once
+    std::unique_lock<std::mutex> lock(m_receiver_lock);
+    for (auto it = m_hdreceivers.begin(); it != m_hdreceivers.end();)
+      it = (it->second.expired()) ? m_hdreceivers.erase(it) : std::next(it);
+
+    std::shared_ptr<hdreceiver> receiver = m_hdreceivers[channelprops.frequency].lock();
+    if ((!receiver) || (receiver->stopped()))
+    {
+
+      receiver.reset(); // Release the previous receiver and its device first
+      receiver = hdreceiver::create(create_device(settings, channelprops.frequency), tunerprops,
+                                    channelprops, hdprops);
+      m_hdreceivers[channelprops.frequency] = receiver;
+    }
+
+    else
+      log_info(__func__, ": attaching to existing HD Radio receiver on ", receiver->devicename());
+
+    // Create the HD Radio stream
+    return hdstream::create(receiver, hdprops, channelid.subchannel());
+  }
+
+  // DAB
+  //
+  else if (channelprops.modulation == modulation::dab)
+  {
+
+    // Set up the DAB digital signal processor properties
+    struct dabprops dabprops = {};
+    dabprops.outputgain = settings.dabradio_output_gain;
+    dabprops.coarse_corrector = settings.dabradio_coarse_corrector;
+    dabprops.coarse_corrector_type = settings.dabradio_coarse_corrector_type;
+    dabprops.tii = settings.dabradio_tii;
+
+    // Log information about the stream for diagnostic purposes
+    log_info(__func__, ": Creating dabstream for channel \"", channelprops.name, "\"");
+    log_info(__func__, ": subchannel = ", channelid.subchannel());
+    log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
+    log_info(__func__, ": dabrops.outputgain = ", dabprops.outputgain, " dB");
+    log_info(__func__, ": dabrops.coarse_corrector = ", dabprops.coarse_corrector);
+    log_info(__func__, ": dabrops.coarse_corrector_type = ", dabprops.coarse_corrector_type);
+    log_info(__func__, ": dabrops.tii = ", (dabprops.tii) ? "true" : "false");
+    log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
+    log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
+    log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
+    log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
+
+    // If there is an active receiver already tuned to the ensemble, attach the new stream to
+    // it rather than opening another device; the ensemble only needs to be demodulated once
+    std::unique_lock<std::mutex> lock(m_receiver_lock);
+    for (auto it = m_dabreceivers.begin(); it != m_dabreceivers.end();)
+      it = (it->second.expired()) ? m_dabreceivers.erase(it) : std::next(it);
+
+    std::shared_ptr<dabreceiver> receiver = m_dabreceivers[channelprops.frequency].lock();
+    if ((!receiver) || (receiver->stopped()))
+    {
+
+      receiver.reset(); // Release the previous receiver and its device first
+
+      // Load the cached ensemble organisation, if available, so that decoding can begin
+      // without waiting for the FIC to describe the subchannels
+      std::vector<struct dabsubchannelprops> ensemble;
+      if (get_dabsubchannel_properties(connectionpool::handle(m_connpool), channelprops.frequency,
+                                       ensemble))
+        log_info(__func__, ": using cached DAB ensemble organisation (", ensemble.size(),
+                 " subchannels)");
+
+      // The ensemble callback persists any detected changes to the organisation; it is invoked
+      // on the receiver ensemble thread so the connection pool is captured by value
+      std::shared_ptr<connectionpool> connpool = m_connpool;
+      auto ensemblecallback =
+          [connpool](uint32_t frequency,
+                     std::vector<struct dabsubchannelprops> const& subchannels) -> void
+      {
+        try
+        {
+          update_dabsubchannel_properties(connectionpool::handle(connpool), frequency,
+                                          subchannels);
+        }
+        catch (std::exception& ex)
+        {
+          log_error(__func__, ": unable to update cached DAB ensemble organisation: ", ex.what());
+        }
+      };
+
+      // Load the OFDM synchronisation properties from a previous lock of this ensemble with
+      // this device, if available, to warm-start the synchronisation
+      std::unique_ptr<rtldevice> device = create_device(settings, channelprops.frequency);
+      int freqcorrection = tunerprops.freqcorrection + channelprops.freqcorrection;
+      dabprops.warmstart =
+          get_dabsync_properties(connectionpool::handle(m_connpool), channelprops.frequency,
+                                 device->get_device_name(), freqcorrection, dabprops.syncprops);
+      if (dabprops.warmstart)
+        log_info(__func__, ": using stored DAB synchronisation (coarse = ",
+                 dabprops.syncprops.coarsecorrector,
+                 " Hz, fine = ", dabprops.syncprops.finecorrector, " Hz)");
+
+      // The synchronisation callback persists the frequency correctors when the receiver is
+      // closed; the device frequency correction is stored since the offsets depend on it
+      auto synccallback = [connpool, freqcorrection](uint32_t frequency, char const* device,
+                                                     struct dabsyncprops const& syncprops) -> void
+      {
+        try
+        {
+          update_dabsync_properties(connectionpool::handle(connpool), frequency, device,
+                                    freqcorrection, syncprops);
+        }
+        catch (std::exception& ex)
+        {
+          log_error(__func__, ": unable to update stored DAB synchronisation: ", ex.what());
+        }
+      };
+
+      receiver = dabreceiver::create(std::move(device), tunerprops, channelprops, dabprops,
+                                     ensemble, ensemblecallback, synccallback);
+      m_dabreceivers[channelprops.frequency] = receiver;
+    }
+
+    else
+      log_info(__func__, ": attaching to existing DAB receiver on ", receiver->devicename());
+
+    // Create the DAB stream
+    return dabstream::create(receiver, dabprops, channelid.subchannel());
+  }
+
+  // Weather Radio
+  //
+  else if (channelprops.modulation == modulation::wx)
+  {
+
+    // Set up the FM digital signal processor properties
+    struct wxprops wxprops = {};
+    wxprops.samplerate = settings.wxradio_sample_rate;
+    wxprops.outputrate = settings.wxradio_output_samplerate;
+    wxprops.outputgain = settings.wxradio_output_gain;
+
+    // Log information about the stream for diagnostic purposes
+    log_info(__func__, ": Creating wxstream for channel \"", channelprops.name, "\"");
+    log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
+    log_info(__func__, ": wxprops.samplerate = ", wxprops.samplerate, " Hz");
+    log_info(__func__, ": wxprops.outputgain = ", wxprops.outputgain, " dB");
+    log_info(__func__, ": wxprops.outputrate = ", wxprops.outputrate, " Hz");
+    log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
+    log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
+    log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
+    log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
+
+    // Create the Weather Radio stream
+    return wxstream::create(create_device(settings, channelprops.frequency), tunerprops,
+                                   channelprops, wxprops);
+  }
+
+  throw string_exception("channel ", channeluid, " (", channelprops.name.c_str(),
+                         ") has an unknown modulation type");
+}
+
+//---------------------------------------------------------------------------
+// addon::detach_recording (private)
+//
+// Detaches the recording of the channel that is playing from the stream; the
+// caller is expected to hold the m_pvrstream_lock mutex
+//
+// Arguments:
+//
+//	NONE
+
+std::unique_ptr<addon::recording_t> addon::detach_recording(void)
+{
+  // The active recording is only changed with both locks held, so it can be read
+  // by anything that holds either of them
+  std::unique_lock<std::mutex> lock(m_recordings_lock);
+
+  if ((m_recording) && (m_pvrstream))
+    m_pvrstream->record(nullptr);
+
+  return std::move(m_recording);
+}
+
+//---------------------------------------------------------------------------
+// addon::device_available (private)
+//
+// Determines if a device is free for use alongside the active stream
+//
+// Arguments:
+//
+//	settings		- Current addon settings structure
+
+bool addon::device_available(struct settings const& settings) const
+{
+  try
+  {
+
+    // File devices can be opened any number of times
+    if (has_rawfiles(connectionpool::handle(m_connpool)))
+      return true;
+
+    return m_devicesession->available(device_candidates(settings));
+  }
+
+  // Any problem with the devices is reported when an attempt is made to acquire one
+  catch (...)
+  {
+    return true;
+  }
+}
+
+//---------------------------------------------------------------------------
+// addon::device_candidates (private)
+//
+// Gets the USB and network devices that can be acquired from the device session
+//
+// Arguments:
+//
+//	settings		- Current addon settings structure
+
+std::vector<devicesession::candidate> addon::device_candidates(
+    struct settings const& settings) const
+{
+  std::vector<devicesession::candidate> candidates; // Candidate devices
+
+  // add (local)
+  //
+  // Adds a candidate device unless the connection is already present
+  auto add = [&](std::string const& connection,
+                 devicesession::device_factory const& factory) -> void
+  {
+    if (std::none_of(candidates.begin(), candidates.end(),
+                     [&](devicesession::candidate const& item) -> bool
+                     { return item.connection == connection; }))
+      candidates.push_back({connection, factory});
+  };
+
+  // addtcp (local)
+  //
+  // Adds a network device candidate
+  auto addtcp = [&](std::string const& host, uint16_t port) -> void
+  {
+    add("tcp:" + host + ":" + std::to_string(port), [=]() -> std::unique_ptr<rtldevice>
+        { return tcpdevice::create(host.c_str(), port); });
+  };
+
 #ifdef USB_DEVICE_SUPPORT
-  // USB device
+  // addusb (local)
+  //
+  // Adds a USB device candidate
+  auto addusb = [&](uint32_t index) -> void
+  {
+    add("usb:" + std::to_string(index),
+        [=]() -> std::unique_ptr<rtldevice> { return usbdevice::create(index); });
+  };
+
+  // The configured device is always the preferred candidate
   if (settings.device_connection == device_connection::usb)
-    return usbdevice::create(settings.device_connection_usb_index);
+    addusb(static_cast<uint32_t>(settings.device_connection_usb_index));
+
+  else
 #endif
 
-  // Network device
   if (settings.device_connection == device_connection::rtltcp)
-    return tcpdevice::create(settings.device_connection_tcp_host.c_str(),
-                             static_cast<uint16_t>(settings.device_connection_tcp_port));
+    addtcp(settings.device_connection_tcp_host,
+           static_cast<uint16_t>(settings.device_connection_tcp_port));
 
   // Unknown device type
-  throw string_exception("invalid device_connection type specified");
+  else
+    throw string_exception("invalid device_connection type specified");
+
+  if (!settings.device_pool_enable)
+    return candidates;
+
+#ifdef USB_DEVICE_SUPPORT
+  // Every other connected USB device
+  uint32_t const devicecount = usbdevice::device_count();
+  for (uint32_t index = 0; index < devicecount; index++)
+    addusb(index);
+#endif
+
+  // Additional rtl_tcp servers are specified as a comma separated list of host[:port]
+  std::string const& endpoints = settings.device_pool_tcp_endpoints;
+  size_t pos = 0;
+  while (pos < endpoints.size())
+  {
+
+    size_t next = endpoints.find(',', pos);
+    if (next == std::string::npos)
+      next = endpoints.size();
+
+    std::string endpoint = endpoints.substr(pos, next - pos);
+    pos = next + 1;
+
+    // Remove any leading and trailing whitespace from the endpoint
+    size_t const first = endpoint.find_first_not_of(" \t");
+    if (first == std::string::npos)
+      continue;
+    endpoint = endpoint.substr(first, endpoint.find_last_not_of(" \t") - first + 1);
+
+    unsigned long port = 1234;
+    size_t const colon = endpoint.rfind(':');
+    if (colon != std::string::npos)
+    {
+
+      port = strtoul(endpoint.c_str() + colon + 1, nullptr, 10);
+      endpoint.erase(colon);
+    }
+
+    if ((endpoint.empty()) || (port == 0) || (port > UINT16_MAX))
+      log_warning(__func__, ": ignoring invalid rtl_tcp server \"", endpoint.c_str(), "\"");
+    else
+      addtcp(endpoint, static_cast<uint16_t>(port));
+  }
+
+  return candidates;
 }
 
 //---------------------------------------------------------------------------
@@ -649,6 +1075,64 @@ bool addon::is_region_northamerica(struct settings const& settings) const
   return (settings.region_regioncode == regioncode::northamerica);
 }
 
+//---------------------------------------------------------------------------
+// addon::finish_recording (private)
+//
+// Stops a recording and registers it in the database; this waits for the queued
+// audio to be written so the caller should not hold any of the addon locks.  The
+// recording of the playing channel must have already been detached from the stream
+//
+// Arguments:
+//
+//	recording	- Recording to be stopped
+
+void addon::finish_recording(std::unique_ptr<recording_t> recording)
+{
+  assert(recording);
+
+  // Stop the dedicated stream of the recording, if there is one
+  if (recording->stream)
+  {
+
+    recording->stop = true;
+    if (recording->worker.joinable())
+      recording->worker.join();
+    recording->stream->close();
+    recording->stream.reset();
+  }
+
+  try
+  {
+
+    // Wait for the queued audio to be written
+    recording->sink->close();
+
+    int const duration = static_cast<int>(recording->sink->duration());
+    std::string const filename = recording->sink->filename();
+
+    log_info(__func__, ": recording of channel \"", recording->channelname.c_str(),
+             "\" stopped (", duration, " seconds)");
+
+    // Register the recording if any audio was captured, otherwise remove the empty file
+    if ((duration > 0) && (!filename.empty()))
+      add_recording(connectionpool::handle(m_connpool), recording->channelid,
+                    recording->channelname.c_str(), recording->title.c_str(), recording->starttime,
+                    duration, filename.c_str());
+
+    else if (!filename.empty())
+      kodi::vfs::DeleteFile(filename);
+  }
+
+  catch (std::exception& ex)
+  {
+    handle_stdexception(__func__, ex);
+  }
+  catch (...)
+  {
+    handle_generalexception(__func__);
+  }
+}
+
 //---------------------------------------------------------------------------
 // addon::handle_generalexception (private)
 //
@@ -714,7 +1198,7 @@ _result addon::handle_stdexception(char const* function, std::exception const& e
 }
 
 //---------------------------------------------------------------------------
-// addon::log_debug (private)
+// addon::log_debug (private, static)
 //
 // Variadic method of writing a LOG_DEBUG entry into the Kodi application log
 //
@@ -723,13 +1207,13 @@ _result addon::handle_stdexception(char const* function, std::exception const& e
 //	args	- Variadic argument list
 
 template<typename... _args>
-void addon::log_debug(_args&&... args) const
+void addon::log_debug(_args&&... args)
 {
   log_message(ADDON_LOG::ADDON_LOG_DEBUG, std::forward<_args>(args)...);
 }
 
 //---------------------------------------------------------------------------
-// addon::log_error (private)
+// addon::log_error (private, static)
 //
 // Variadic method of writing a LOG_ERROR entry into the Kodi application log
 //
@@ -738,13 +1222,13 @@ void addon::log_debug(_args&&... args) const
 //	args	- Variadic argument list
 
 template<typename... _args>
-void addon::log_error(_args&&... args) const
+void addon::log_error(_args&&... args)
 {
   log_message(ADDON_LOG::ADDON_LOG_ERROR, std::forward<_args>(args)...);
 }
 
 //---------------------------------------------------------------------------
-// addon::log_info (private)
+// addon::log_info (private, static)
 //
 // Variadic method of writing a LOG_INFO entry into the Kodi application log
 //
@@ -753,13 +1237,13 @@ void addon::log_error(_args&&... args) const
 //	args	- Variadic argument list
 
 template<typename... _args>
-void addon::log_info(_args&&... args) const
+void addon::log_info(_args&&... args)
 {
   log_message(ADDON_LOG::ADDON_LOG_INFO, std::forward<_args>(args)...);
 }
 
 //---------------------------------------------------------------------------
-// addon::log_message (private)
+// addon::log_message (private, static)
 //
 // Variadic method of writing a log entry into the Kodi application log
 //
@@ -768,7 +1252,7 @@ void addon::log_info(_args&&... args) const
 //	args	- Variadic argument list
 
 template<typename... _args>
-void addon::log_message(ADDON_LOG level, _args&&... args) const
+void addon::log_message(ADDON_LOG level, _args&&... args)
 {
   std::ostringstream stream;
   int unpack[] = {0, (static_cast<void>(stream << args), 0)...};
@@ -792,7 +1276,7 @@ void addon::log_message(ADDON_LOG level, _args&&... args) const
 }
 
 //---------------------------------------------------------------------------
-// addon::log_warning (private)
+// addon::log_warning (private, static)
 //
 // Variadic method of writing a LOG_WARNING entry into the Kodi application log
 //
@@ -801,7 +1285,7 @@ void addon::log_message(ADDON_LOG level, _args&&... args) const
 //	args	- Variadic argument list
 
 template<typename... _args>
-void addon::log_warning(_args&&... args) const
+void addon::log_warning(_args&&... args)
 {
   log_message(ADDON_LOG::ADDON_LOG_WARNING, std::forward<_args>(args)...);
 }
@@ -1003,110 +1487,403 @@ void addon::menuhook_importchannels(void)
 }
 
 //---------------------------------------------------------------------------
-// addon::regioncode_to_string (private, static)
+// addon::menuhook_showperformance (private)
 //
-// Converts a regioncode enumeration value into a string
+// Menu hook to show the performance counters of the active stream
 //
 // Arguments:
 //
-//	code		- Region code value to be converted into a string
+//	NONE
 
-std::string addon::regioncode_to_string(enum regioncode code)
+void addon::menuhook_showperformance(void)
 {
-  switch (code)
+  perfcounters_t perfcounters = std::atomic_load(&m_perfcounters);
+  signalstatus_t signalstatus = std::atomic_load(&m_signalstatus);
+
+  // The performance counters are only available while a stream is active
+  if ((!perfcounters) || (!signalstatus))
   {
 
-    case regioncode::notset:
-      return kodi::addon::GetLocalizedString(30219);
-    case regioncode::world:
-      return kodi::addon::GetLocalizedString(30220);
-    case regioncode::northamerica:
-      return kodi::addon::GetLocalizedString(30221);
-    case regioncode::europe:
-      return kodi::addon::GetLocalizedString(30222);
+    kodi::gui::dialogs::OK::ShowAndGetInput(kodi::addon::GetLocalizedString(30419),
+                                            "There is no active stream");
+    return;
   }
 
-  return "Unknown";
+  struct perfcounterprops const counters = perfcounters->snapshot();
+  struct signalstatusprops const status = signalstatus->load();
+
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(2);
+  text << "Device: " << status.devicename << "\n";
+  text << "Mux: " << status.muxname << "\n";
+  text << "Service: " << status.servicename << "\n";
+  text << "Elapsed time: " << counters.elapsedtime << " s\n";
+  text << "\n";
+  text << "Realtime factor: " << counters.realtimefactor << "\n";
+  text << "Audio generated: " << counters.signaltime << " s\n";
+  text << "Demodulate time: " << counters.demodulatetime << " s\n";
+  text << "Decode time: " << counters.decodetime << " s\n";
+  text << "Resample time: " << counters.resampletime << " s\n";
+  text << "Encode time: " << counters.encodetime << " s\n";
+  text << "\n";
+  text << "Buffers received: " << counters.buffersreceived << "\n";
+  text << "Buffers dropped: " << counters.buffersdropped << "\n";
+  text << "Sample queue high-water mark: " << counters.samplequeuehighwater << "\n";
+  text << "Packets queued: " << counters.packetsqueued << "\n";
+  text << "Packets dropped: " << counters.packetsdropped << "\n";
+  text << "Packet queue high-water mark: " << counters.packetqueuehighwater << "\n";
+  text << "Underruns: " << counters.underruns << "\n";
+  text << "Degradation level: " << counters.degradation << "\n";
+  if (counters.clockdriftcontrol)
+    text << "Clock drift correction: " << counters.clockdrift << " ppm\n";
+  else
+    text << "Clock drift correction: disabled (not played in real time)\n";
+  text << "Encoder buffers dropped: " << counters.encodedropped << "\n";
+
+  kodi::gui::dialogs::TextViewer::Show(kodi::addon::GetLocalizedString(30419), text.str());
 }
 
 //---------------------------------------------------------------------------
-// addon::update_regioncode (private)
+// addon::reap_recordings (private)
 //
-// Updates the addon region code
+// Finishes the recordings whose dedicated stream has stopped; the caller should
+// not hold the m_recordings_lock mutex
 //
 // Arguments:
 //
-//	code		- The updated region code
+//	NONE
 
-void addon::update_regioncode(enum regioncode code) const
+void addon::reap_recordings(void)
 {
-  std::string region = regioncode_to_string(code);
+  std::vector<std::unique_ptr<recording_t>> reaped;
 
-  // NORTH AMERICA
-  //
-  if (code == regioncode::northamerica)
+  // Remove the finished recordings from the collection under the lock, but finish them
+  // after it has been released since that waits for the audio to be written
+  std::unique_lock<std::mutex> lock(m_recordings_lock);
+  for (auto it = m_recordings.begin(); it != m_recordings.end();)
   {
 
-    kodi::addon::SetSettingBoolean("fmradio_enable", true);
-    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
-
-    kodi::addon::SetSettingBoolean("hdradio_enable", true);
-    log_info(__func__, ": setting hdradio_enable systemically changed to true for region ", region);
+    if ((*it)->finished.load())
+    {
 
-    kodi::addon::SetSettingBoolean("dabradio_enable", false);
-    log_info(__func__, ": setting dabradio_enable systemically changed to false for region ",
-             region);
+      reaped.push_back(std::move(*it));
+      it = m_recordings.erase(it);
+    }
 
-    kodi::addon::SetSettingBoolean("wxradio_enable", true);
-    log_info(__func__, ": setting wxradio_enable systemically changed to true for region ", region);
+    else
+      ++it;
   }
 
-  // EUROPE/AUSTRALIA
-  //
-  else if (code == regioncode::europe)
-  {
+  lock.unlock();
 
-    kodi::addon::SetSettingBoolean("fmradio_enable", true);
-    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
+  for (auto& recording : reaped)
+    finish_recording(std::move(recording));
 
-    kodi::addon::SetSettingBoolean("hdradio_enable", false);
-    log_info(__func__, ": setting hdradio_enable systemically changed to false for region ",
-             region);
+  if (!reaped.empty())
+    TriggerRecordingUpdate();
+}
 
-    kodi::addon::SetSettingBoolean("dabradio_enable", true);
-    log_info(__func__, ": setting dabradio_enable systemically changed to true for region ",
-             region);
+//---------------------------------------------------------------------------
+// addon::recordworker (private)
+//
+// Worker thread procedure used to read the dedicated stream of a recording
+//
+// Arguments:
+//
+//	recording	- Recording to be read
 
-    kodi::addon::SetSettingBoolean("wxradio_enable", false);
-    log_info(__func__, ": setting wxradio_enable systemically changed to false for region ",
-             region);
-  }
+void addon::recordworker(recording_t* recording)
+{
+  assert((recording != nullptr) && (recording->stream));
 
-  // WORLD
+  DEMUX_PACKET demuxpacket = {}; // Packet provided to the stream
+  std::vector<uint8_t> data; // Data buffer for the packet
+
+  // allocator (local)
   //
-  else
+  // Allocates the packet to be filled in by the stream; the audio is written into the
+  // recording sink by the stream itself so the packets are discarded
+  auto allocator = [&](int size) -> DEMUX_PACKET*
   {
+    data.resize(std::max(size, 0));
 
-    kodi::addon::SetSettingBoolean("fmradio_enable", true);
-    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
+    demuxpacket = {};
+    demuxpacket.pData = data.data();
+    demuxpacket.iSize = size;
+    demuxpacket.iStreamId = -1;
+    return &demuxpacket;
+  };
 
-    kodi::addon::SetSettingBoolean("hdradio_enable", false);
-    log_info(__func__, ": setting hdradio_enable systemically changed to false for region ",
-             region);
+  try
+  {
 
-    kodi::addon::SetSettingBoolean("dabradio_enable", false);
-    log_info(__func__, ": setting dabradio_enable systemically changed to false for region ",
-             region);
+    while ((recording->stop.test(true) == false) && (!recording->sink->completed()))
+    {
 
-    kodi::addon::SetSettingBoolean("wxradio_enable", false);
-    log_info(__func__, ": setting wxradio_enable systemically changed to false for region ",
-             region);
+      // Empty packets are returned when no data is available, or when the stream
+      // has stopped and won't produce any more packets
+      DEMUX_PACKET* packet = recording->stream->demuxread(allocator);
+      if (((packet == nullptr) || (packet->iSize == 0)) && (recording->stream->stopped()))
+        break;
+    }
   }
-}
+
+  catch (std::exception& ex)
+  {
+    log_error(__func__, ": recording of channel \"", recording->channelname.c_str(),
+              "\" failed: ", ex.what());
+  }
+
+  // Kodi reads the timers back after being notified, which finishes the recording
+  recording->finished = true;
+  if (recording->stop.test(true) == false)
+    TriggerTimerUpdate();
+}
+
+//---------------------------------------------------------------------------
+// addon::regioncode_to_string (private, static)
+//
+// Converts a regioncode enumeration value into a string
+//
+// Arguments:
+//
+//	code		- Region code value to be converted into a string
+
+std::string addon::regioncode_to_string(enum regioncode code)
+{
+  switch (code)
+  {
+
+    case regioncode::notset:
+      return kodi::addon::GetLocalizedString(30219);
+    case regioncode::world:
+      return kodi::addon::GetLocalizedString(30220);
+    case regioncode::northamerica:
+      return kodi::addon::GetLocalizedString(30221);
+    case regioncode::europe:
+      return kodi::addon::GetLocalizedString(30222);
+  }
+
+  return "Unknown";
+}
+
+//---------------------------------------------------------------------------
+// addon::statsworker (private)
+//
+// Worker thread procedure used to write the stream performance counters to disk
+//
+// Arguments:
+//
+//	NONE
+
+void addon::statsworker(void)
+{
+  std::string const filepath = UserPath() + "/streamstats.json";
+  std::string const temppath = filepath + ".tmp";
+
+  uint32_t const intervalms = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(STREAMSTATS_INTERVAL).count());
+
+  // Periodically write the counters of the active stream until the addon is unloaded
+  while (m_statsstop.wait_until_equals(true, intervalms) == false)
+  {
+
+    perfcounters_t perfcounters = std::atomic_load(&m_perfcounters);
+    signalstatus_t signalstatus = std::atomic_load(&m_signalstatus);
+    if ((!perfcounters) || (!signalstatus))
+      continue;
+
+    try
+    {
+
+      std::string json = streamstats_to_json(perfcounters->snapshot(), signalstatus->load());
+
+      // Write the counters into a temporary file and move that over the existing file,
+      // anything that monitors the file should never see a partially written snapshot
+      kodi::vfs::CFile jsonfile;
+      if (!jsonfile.OpenFileForWrite(temppath, true))
+        throw string_exception("unable to open file ", temppath.c_str(), " for write access");
+
+      ssize_t written = jsonfile.Write(json.data(), json.size());
+      jsonfile.Close();
+
+      if (written != static_cast<ssize_t>(json.size()))
+        throw string_exception("short write occurred generating file ", temppath.c_str());
+
+      if (!kodi::vfs::RenameFile(temppath, filepath))
+        throw string_exception("unable to rename file ", temppath.c_str(), " to ", filepath.c_str());
+    }
+
+    catch (std::exception& ex)
+    {
+      handle_stdexception(__func__, ex);
+    }
+    catch (...)
+    {
+      handle_generalexception(__func__);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// addon::streamstats_to_json (private, static)
+//
+// Converts the performance counters of a stream into a JSON document
+//
+// Arguments:
+//
+//	counters	- Performance counters snapshot
+//	status		- Signal status snapshot
+
+std::string addon::streamstats_to_json(struct perfcounterprops const& counters,
+                                       struct signalstatusprops const& status)
+{
+  rapidjson::StringBuffer sb;
+  rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+
+  writer.StartObject();
+
+  writer.Key("timestamp");
+  writer.Int64(static_cast<int64_t>(time(nullptr)));
+  writer.Key("device");
+  writer.String(status.devicename);
+  writer.Key("mux");
+  writer.String(status.muxname);
+  writer.Key("service");
+  writer.String(status.servicename);
+  writer.Key("elapsedtime");
+  writer.Double(counters.elapsedtime);
+  writer.Key("signaltime");
+  writer.Double(counters.signaltime);
+  writer.Key("realtimefactor");
+  writer.Double(counters.realtimefactor);
+
+  writer.Key("dsptime");
+  writer.StartObject();
+  writer.Key("demodulate");
+  writer.Double(counters.demodulatetime);
+  writer.Key("decode");
+  writer.Double(counters.decodetime);
+  writer.Key("resample");
+  writer.Double(counters.resampletime);
+  writer.Key("encode");
+  writer.Double(counters.encodetime);
+  writer.EndObject();
+
+  writer.Key("buffers");
+  writer.StartObject();
+  writer.Key("received");
+  writer.Uint64(counters.buffersreceived);
+  writer.Key("dropped");
+  writer.Uint64(counters.buffersdropped);
+  writer.Key("highwater");
+  writer.Uint64(counters.samplequeuehighwater);
+  writer.EndObject();
+
+  writer.Key("packets");
+  writer.StartObject();
+  writer.Key("queued");
+  writer.Uint64(counters.packetsqueued);
+  writer.Key("dropped");
+  writer.Uint64(counters.packetsdropped);
+  writer.Key("highwater");
+  writer.Uint64(counters.packetqueuehighwater);
+  writer.EndObject();
+
+  writer.Key("underruns");
+  writer.Uint64(counters.underruns);
+  writer.Key("degradation");
+  writer.Int(counters.degradation);
+  writer.Key("clockdrift");
+  writer.Int(counters.clockdrift);
+  writer.Key("clockdriftcontrol");
+  writer.Bool(counters.clockdriftcontrol);
+  writer.Key("encodedropped");
+  writer.Uint64(counters.encodedropped);
+
+  writer.EndObject();
+
+  return std::string(sb.GetString(), sb.GetSize());
+}
+
+//---------------------------------------------------------------------------
+// addon::update_regioncode (private)
+//
+// Updates the addon region code
+//
+// Arguments:
+//
+//	code		- The updated region code
+
+void addon::update_regioncode(enum regioncode code) const
+{
+  std::string region = regioncode_to_string(code);
+
+  // NORTH AMERICA
+  //
+  if (code == regioncode::northamerica)
+  {
+
+    kodi::addon::SetSettingBoolean("fmradio_enable", true);
+    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
+
+    kodi::addon::SetSettingBoolean("hdradio_enable", true);
+    log_info(__func__, ": setting hdradio_enable systemically changed to true for region ", region);
+
+    kodi::addon::SetSettingBoolean("dabradio_enable", false);
+    log_info(__func__, ": setting dabradio_enable systemically changed to false for region ",
+             region);
+
+    kodi::addon::SetSettingBoolean("wxradio_enable", true);
+    log_info(__func__, ": setting wxradio_enable systemically changed to true for region ", region);
+  }
+
+  // EUROPE/AUSTRALIA
+  //
+  else if (code == regioncode::europe)
+  {
+
+    kodi::addon::SetSettingBoolean("fmradio_enable", true);
+    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
+
+    kodi::addon::SetSettingBoolean("hdradio_enable", false);
+    log_info(__func__, ": setting hdradio_enable systemically changed to false for region ",
+             region);
+
+    kodi::addon::SetSettingBoolean("dabradio_enable", true);
+    log_info(__func__, ": setting dabradio_enable systemically changed to true for region ",
+             region);
+
+    kodi::addon::SetSettingBoolean("wxradio_enable", false);
+    log_info(__func__, ": setting wxradio_enable systemically changed to false for region ",
+             region);
+  }
+
+  // WORLD
+  //
+  else
+  {
+
+    kodi::addon::SetSettingBoolean("fmradio_enable", true);
+    log_info(__func__, ": setting fmradio_enable systemically changed to true for region ", region);
+
+    kodi::addon::SetSettingBoolean("hdradio_enable", false);
+    log_info(__func__, ": setting hdradio_enable systemically changed to false for region ",
+             region);
+
+    kodi::addon::SetSettingBoolean("dabradio_enable", false);
+    log_info(__func__, ": setting dabradio_enable systemically changed to false for region ",
+             region);
+
+    kodi::addon::SetSettingBoolean("wxradio_enable", false);
+    log_info(__func__, ": setting wxradio_enable systemically changed to false for region ",
+             region);
+  }
+}
 
 //---------------------------------------------------------------------------
-// CADDONBASE IMPLEMENTATION
-//---------------------------------------------------------------------------
+// CADDONBASE IMPLEMENTATION
+//---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
 // addon::Create (CAddonBase)
@@ -1168,6 +1945,9 @@ ADDON_STATUS addon::Create(void)
           kodi::addon::GetSettingInt("device_connection_tcp_port", 1234);
       m_settings.device_frequency_correction =
           kodi::addon::GetSettingInt("device_frequency_correction", 0);
+      m_settings.device_pool_enable = kodi::addon::GetSettingBoolean("device_pool_enable", false);
+      m_settings.device_pool_tcp_endpoints =
+          kodi::addon::GetSettingString("device_pool_tcp_endpoints");
 
       // Load the region settings
       m_settings.region_regioncode =
@@ -1190,12 +1970,15 @@ ADDON_STATUS addon::Create(void)
       m_settings.hdradio_prepend_channel_numbers =
           kodi::addon::GetSettingBoolean("hdradio_prepend_channel_numbers", false);
       m_settings.hdradio_output_gain = kodi::addon::GetSettingFloat("hdradio_output_gain", -3.0f);
+      m_settings.hdradio_analog_blend =
+          kodi::addon::GetSettingBoolean("hdradio_analog_blend", false);
 
       // Load the DAB settings
       m_settings.dabradio_enable = kodi::addon::GetSettingBoolean("dabradio_enable", false);
       m_settings.dabradio_output_gain = kodi::addon::GetSettingFloat("dabradio_output_gain", -3.0f);
       m_settings.dabradio_coarse_corrector = kodi::addon::GetSettingBoolean("dabradio_coarse_corrector", true);
       m_settings.dabradio_coarse_corrector_type = kodi::addon::GetSettingInt("dabradio_coarse_corrector_type", 1);
+      m_settings.dabradio_tii = kodi::addon::GetSettingBoolean("dabradio_tii", false);
 
       // Load the Weather Radio settings
       m_settings.wxradio_enable = kodi::addon::GetSettingBoolean("wxradio_enable", false);
@@ -1205,6 +1988,10 @@ ADDON_STATUS addon::Create(void)
           kodi::addon::GetSettingInt("wxradio_output_samplerate", 48000);
       m_settings.wxradio_output_gain = kodi::addon::GetSettingFloat("wxradio_output_gain", -3.0f);
 
+      // Load the timeshift settings
+      m_settings.timeshift_enable = kodi::addon::GetSettingBoolean("timeshift_enable", false);
+      m_settings.timeshift_buffer_size = kodi::addon::GetSettingInt("timeshift_buffer_size", 256);
+
       // Log the setting values
       log_info(__func__,
                ": m_settings.dabradio_enable                   = ", m_settings.dabradio_enable);
@@ -1214,6 +2001,8 @@ ADDON_STATUS addon::Create(void)
                m_settings.dabradio_coarse_corrector);
       log_info(__func__, ": m_settings.dabradio_coarse_corrector_type    = ",
                m_settings.dabradio_coarse_corrector_type);
+      log_info(__func__,
+               ": m_settings.dabradio_tii                      = ", m_settings.dabradio_tii);
       log_info(__func__, ": m_settings.device_connection                 = ",
                device_connection_to_string(m_settings.device_connection));
       log_info(__func__, ": m_settings.device_connection_tcp_host        = ",
@@ -1224,6 +2013,10 @@ ADDON_STATUS addon::Create(void)
                m_settings.device_connection_usb_index);
       log_info(__func__, ": m_settings.device_frequency_correction       = ",
                m_settings.device_frequency_correction);
+      log_info(__func__,
+               ": m_settings.device_pool_enable                = ", m_settings.device_pool_enable);
+      log_info(__func__, ": m_settings.device_pool_tcp_endpoints         = ",
+               m_settings.device_pool_tcp_endpoints);
       log_info(__func__, ": m_settings.fmradio_downsample_quality        = ",
                downsample_quality_to_string(m_settings.fmradio_downsample_quality));
       log_info(__func__,
@@ -1236,6 +2029,8 @@ ADDON_STATUS addon::Create(void)
                m_settings.fmradio_output_samplerate);
       log_info(__func__,
                ": m_settings.fmradio_sample_rate               = ", m_settings.fmradio_sample_rate);
+      log_info(__func__,
+               ": m_settings.hdradio_analog_blend              = ", m_settings.hdradio_analog_blend);
       log_info(__func__,
                ": m_settings.hdradio_enable                    = ", m_settings.hdradio_enable);
       log_info(__func__,
@@ -1244,6 +2039,10 @@ ADDON_STATUS addon::Create(void)
                m_settings.hdradio_prepend_channel_numbers);
       log_info(__func__, ": m_settings.region_regioncode                 = ",
                regioncode_to_string(m_settings.region_regioncode));
+      log_info(__func__, ": m_settings.timeshift_buffer_size             = ",
+               m_settings.timeshift_buffer_size);
+      log_info(__func__,
+               ": m_settings.timeshift_enable                  = ", m_settings.timeshift_enable);
       log_info(__func__,
                ": m_settings.wxradio_enable                    = ", m_settings.wxradio_enable);
       log_info(__func__,
@@ -1260,6 +2059,8 @@ ADDON_STATUS addon::Create(void)
           kodi::addon::PVRMenuhook(MENUHOOK_SETTING_EXPORTCHANNELS, 30401, PVR_MENUHOOK_SETTING));
       AddMenuHook(
           kodi::addon::PVRMenuhook(MENUHOOK_SETTING_CLEARCHANNELS, 30402, PVR_MENUHOOK_SETTING));
+      AddMenuHook(
+          kodi::addon::PVRMenuhook(MENUHOOK_SETTING_SHOWPERFORMANCE, 30419, PVR_MENUHOOK_SETTING));
 
       // Generate the local file system and URL-based file names for the channels database
       std::string databasefile = UserPath() + "/channels.db";
@@ -1335,6 +2136,12 @@ ADDON_STATUS addon::Create(void)
     return ADDON_STATUS::ADDON_STATUS_PERMANENT_FAILURE;
   }
 
+  // Create the device session that keeps the tuner device open between streams
+  m_devicesession = devicesession::create();
+
+  // Start the thread that periodically writes the stream performance counters
+  m_statsworker = std::thread(&addon::statsworker, this);
+
   // Throw a simple banner out to the Kodi log indicating that the add-on has been loaded
   log_info(__func__, ": ", VERSION_PRODUCTNAME_ANSI, " v", VERSION_VERSION3_ANSI, " loaded");
 
@@ -1358,7 +2165,21 @@ void addon::Destroy(void) noexcept
     // Throw a message out to the Kodi log indicating that the add-on is being unloaded
     log_info(__func__, ": ", VERSION_PRODUCTNAME_ANSI, " v", VERSION_VERSION3_ANSI, " unloading");
 
+    // Stop the performance counter writer thread
+    m_statsstop = true;
+    if (m_statsworker.joinable())
+      m_statsworker.join();
+
+    std::unique_ptr<recording_t> recording = detach_recording();
+    if (recording)
+      finish_recording(std::move(recording)); // Stop any active recording
+    for (auto& item : m_recordings)
+      finish_recording(std::move(item)); // Stop any recordings on other devices
+    m_recordings.clear();
+    std::atomic_store(&m_signalstatus, signalstatus_t()); // Release signal status
+    std::atomic_store(&m_perfcounters, perfcounters_t()); // Release performance counters
     m_pvrstream.reset(); // Destroy any active stream instance
+    m_devicesession.reset(); // Close any idle device
 
     // Check for more than just the global connection pool reference during shutdown
     long poolrefs = m_connpool.use_count();
@@ -1483,6 +2304,34 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName,
     }
   }
 
+  // device_pool_enable
+  //
+  else if (settingName == "device_pool_enable")
+  {
+
+    bool bvalue = settingValue.GetBoolean();
+    if (bvalue != m_settings.device_pool_enable)
+    {
+
+      m_settings.device_pool_enable = bvalue;
+      log_info(__func__, ": setting device_pool_enable changed to ", bvalue);
+    }
+  }
+
+  // device_pool_tcp_endpoints
+  //
+  else if (settingName == "device_pool_tcp_endpoints")
+  {
+
+    std::string strvalue = settingValue.GetString();
+    if (strvalue != m_settings.device_pool_tcp_endpoints)
+    {
+
+      m_settings.device_pool_tcp_endpoints = strvalue;
+      log_info(__func__, ": setting device_pool_tcp_endpoints changed to ", strvalue.c_str());
+    }
+  }
+
   // fmradio_enable_rds
   //
   else if (settingName == "fmradio_enable_rds")
@@ -1620,6 +2469,20 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName,
     }
   }
 
+  // hdradio_analog_blend
+  //
+  else if (settingName == "hdradio_analog_blend")
+  {
+
+    bool bvalue = settingValue.GetBoolean();
+    if (bvalue != m_settings.hdradio_analog_blend)
+    {
+
+      m_settings.hdradio_analog_blend = bvalue;
+      log_info(__func__, ": setting hdradio_analog_blend changed to ", bvalue);
+    }
+  }
+
   // dabradio_enable
   //
   else if (settingName == "dabradio_enable")
@@ -1679,6 +2542,20 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName,
     }
   }
 
+  // dabradio_tii
+  //
+  else if (settingName == "dabradio_tii")
+  {
+
+    bool bvalue = settingValue.GetBoolean();
+    if (bvalue != m_settings.dabradio_tii)
+    {
+
+      m_settings.dabradio_tii = bvalue;
+      log_info(__func__, ": setting dabradio_tii changed to ", bvalue);
+    }
+  }
+
   // region_regioncode
   //
   if (settingName == "region_regioncode")
@@ -1757,6 +2634,34 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName,
     }
   }
 
+  // timeshift_enable
+  //
+  else if (settingName == "timeshift_enable")
+  {
+
+    bool bvalue = settingValue.GetBoolean();
+    if (bvalue != m_settings.timeshift_enable)
+    {
+
+      m_settings.timeshift_enable = bvalue;
+      log_info(__func__, ": setting timeshift_enable changed to ", bvalue);
+    }
+  }
+
+  // timeshift_buffer_size
+  //
+  else if (settingName == "timeshift_buffer_size")
+  {
+
+    int nvalue = settingValue.GetInt();
+    if (nvalue != m_settings.timeshift_buffer_size)
+    {
+
+      m_settings.timeshift_buffer_size = nvalue;
+      log_info(__func__, ": setting timeshift_buffer_size changed to ", nvalue, "MB");
+    }
+  }
+
   return ADDON_STATUS::ADDON_STATUS_OK;
 }
 
@@ -1765,54 +2670,242 @@ ADDON_STATUS addon::SetSetting(std::string const& settingName,
 //---------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// addon::CallSettingsMenuHook (CInstancePVRClient)
+// addon::AddTimer (CInstancePVRClient)
 //
-// Call one of the settings related menu hooks
+// Add a timer on the backend
 //
 // Arguments:
 //
-//	menuhook	- The hook being invoked
+//	timer		- Timer to be added
 
-PVR_ERROR addon::CallSettingsMenuHook(kodi::addon::PVRMenuhook const& menuhook)
+PVR_ERROR addon::AddTimer(kodi::addon::PVRTimer const& timer)
 {
+  // Create a copy of the current addon settings structure
+  struct settings settings = copy_settings();
+
   try
   {
 
-    // Invoke the proper helper function to handle the settings menu hook implementation
-    if (menuhook.GetHookId() == MENUHOOK_SETTING_IMPORTCHANNELS)
-      menuhook_importchannels();
-    else if (menuhook.GetHookId() == MENUHOOK_SETTING_EXPORTCHANNELS)
-      menuhook_exportchannels();
-    else if (menuhook.GetHookId() == MENUHOOK_SETTING_CLEARCHANNELS)
-      menuhook_clearchannels();
-  }
+    unsigned int const channeluid = static_cast<unsigned int>(timer.GetClientChannelUid());
 
-  catch (std::exception& ex)
-  {
-    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
-  }
-  catch (...)
-  {
-    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
-  }
+    // Recordings cannot be scheduled for the future
+    time_t const now = time(nullptr);
+    if (timer.GetStartTime() > (now + 60))
+    {
 
-  return PVR_ERROR::PVR_ERROR_NO_ERROR;
-}
+      kodi::QueueNotification(QueueMsg::QUEUE_WARNING, "",
+                              "Scheduled recordings are not supported");
+      return PVR_ERROR::PVR_ERROR_REJECTED;
+    }
 
-//-----------------------------------------------------------------------------
-// addon::CanSeekStream (CInstancePVRClient)
-//
-// Check if the backend supports seeking for the currently playing stream
-//
-// Arguments:
-//
-//	NONE
+    // The channel that is playing is recorded from the active stream, which requires the
+    // lock; any other channel is recorded from a dedicated stream and the lock is released
+    // so that acquiring a device for it doesn't stall the active stream
+    reap_recordings();
+    std::unique_lock<std::mutex> lock(m_pvrstream_lock);
+    bool const playing = ((m_pvrstream) && (channeluid == m_pvrchannelid));
+    if (!playing)
+      lock.unlock();
 
-bool addon::CanSeekStream(void)
-{
-  try
-  {
-    return (m_pvrstream) ? m_pvrstream->canseek() : false;
+    // recorded (local)
+    //
+    // Determines if the channel is already being recorded; requires m_recordings_lock
+    auto recorded = [&]() -> bool
+    {
+      return (((playing) && (m_recording)) ||
+              std::any_of(m_recordings.begin(), m_recordings.end(),
+                          [&](std::unique_ptr<recording_t> const& item) -> bool
+                          { return item->channelid == channeluid; }));
+    };
+
+    // A channel can only be recorded once at a time
+    std::unique_lock<std::mutex> recordingslock(m_recordings_lock);
+    if (recorded())
+      return PVR_ERROR::PVR_ERROR_ALREADY_PRESENT;
+    recordingslock.unlock();
+
+    // Recordings are written into a dedicated folder under the addon user data directory
+    std::string const folder = UserPath() + "/recordings";
+    if (!kodi::vfs::DirectoryExists(folder) && !kodi::vfs::CreateDirectory(folder))
+      throw string_exception(__func__, ": unable to create recordings directory");
+
+    std::unique_ptr<recording_t> recording = std::make_unique<recording_t>();
+    recording->channelid = channeluid;
+    recording->starttime = now;
+    recording->endtime = timer.GetEndTime();
+
+    // The channel that is playing is recorded from the active stream, any other channel
+    // is recorded from a dedicated stream that has to be able to acquire a free device
+    if (playing)
+      recording->channelname = m_pvrchannelname;
+
+    else
+    {
+
+      channelid channelid(channeluid); // Convert UniqueID back into a channelid
+
+      // Retrieve the tuning properties and the name of the channel from the database
+      struct channelprops channelprops = {};
+      std::vector<struct subchannelprops> subchannelprops;
+      if (!get_channel_properties(connectionpool::handle(m_connpool), channelid.frequency(),
+                                  channelid.modulation(), channelprops, subchannelprops))
+        throw string_exception("channel ", channeluid, " was not found in the database");
+
+      recording->channelname = channelprops.name;
+      for (auto const& subchannel : subchannelprops)
+        if ((static_cast<int>(subchannel.number) == channelid.subchannel()) &&
+            (!subchannel.name.empty()))
+          recording->channelname = subchannel.name;
+
+      try
+      {
+        // The recording worker reads the stream as fast as it can, there is no real-time
+        // consumer for the clock drift controller to steer towards
+        recording->stream = create_stream(settings, channeluid, channelprops);
+        recording->stream->realtimeconsumer(false);
+      }
+
+      catch (std::exception& ex)
+      {
+
+        kodi::QueueFormattedNotification(QueueMsg::QUEUE_WARNING,
+                                         "Unable to record channel (%s).", ex.what());
+        return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_REJECTED);
+      }
+    }
+
+    recording->title = timer.GetTitle().empty() ? recording->channelname : timer.GetTitle();
+
+    // A timer without an end time records until it is deleted or the stream is closed
+    double const maxduration =
+        (recording->endtime > now) ? static_cast<double>(recording->endtime - now) : 0.0;
+
+    std::string const basename = folder + "/" + std::to_string(recording->channelid) + "-" +
+                                 std::to_string(static_cast<long long>(now));
+
+    std::unique_ptr<pvrstream> const& stream = (playing) ? m_pvrstream : recording->stream;
+    recording->sink = recordingsink::create(basename, maxduration, stream->counters());
+
+    log_info(__func__, ": recording channel \"", recording->channelname.c_str(), "\" to ",
+             basename.c_str());
+
+    stream->record(recording->sink);
+
+    recordingslock.lock();
+    recording->timerid = m_nexttimerid++;
+
+    if (playing)
+      m_recording = std::move(recording);
+
+    // Another timer may have started recording the channel while the dedicated stream
+    // was being created, discard this recording if that happened
+    else if (recorded())
+    {
+
+      recordingslock.unlock();
+      finish_recording(std::move(recording));
+      return PVR_ERROR::PVR_ERROR_ALREADY_PRESENT;
+    }
+
+    else
+    {
+
+      // The dedicated stream has to be read continuously for the audio to be recorded
+      recording->worker = std::thread(&addon::recordworker, this, recording.get());
+      m_recordings.push_back(std::move(recording));
+    }
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  TriggerTimerUpdate();
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::CallSettingsMenuHook (CInstancePVRClient)
+//
+// Call one of the settings related menu hooks
+//
+// Arguments:
+//
+//	menuhook	- The hook being invoked
+
+PVR_ERROR addon::CallSettingsMenuHook(kodi::addon::PVRMenuhook const& menuhook)
+{
+  try
+  {
+
+    // Invoke the proper helper function to handle the settings menu hook implementation
+    if (menuhook.GetHookId() == MENUHOOK_SETTING_IMPORTCHANNELS)
+      menuhook_importchannels();
+    else if (menuhook.GetHookId() == MENUHOOK_SETTING_EXPORTCHANNELS)
+      menuhook_exportchannels();
+    else if (menuhook.GetHookId() == MENUHOOK_SETTING_CLEARCHANNELS)
+      menuhook_clearchannels();
+    else if (menuhook.GetHookId() == MENUHOOK_SETTING_SHOWPERFORMANCE)
+      menuhook_showperformance();
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::CanPauseStream (CInstancePVRClient)
+//
+// Check if the backend supports pausing the currently playing stream
+//
+// Arguments:
+//
+//	NONE
+
+bool addon::CanPauseStream(void)
+{
+  try
+  {
+    return (m_pvrstream) ? m_pvrstream->canseek() : false;
+  }
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, false);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, false);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// addon::CanSeekStream (CInstancePVRClient)
+//
+// Check if the backend supports seeking for the currently playing stream
+//
+// Arguments:
+//
+//	NONE
+
+bool addon::CanSeekStream(void)
+{
+  try
+  {
+    return (m_pvrstream) ? m_pvrstream->canseek() : false;
   }
   catch (std::exception& ex)
   {
@@ -1840,7 +2933,30 @@ void addon::CloseLiveStream(void)
 
   try
   {
+    std::unique_ptr<recording_t> recording = detach_recording();
+    std::atomic_store(&m_signalstatus, signalstatus_t());
+    std::atomic_store(&m_perfcounters, perfcounters_t());
+
+    // Keep any shared HD Radio or DAB receiver alive for a short time after the stream
+    // is closed; changing to another program in the same multiplex reattaches to it
+    std::shared_ptr<void> receiver = (m_pvrstream) ? m_pvrstream->receiver() : nullptr;
+
     m_pvrstream.reset();
+    if (receiver)
+      m_devicesession->linger(std::move(receiver));
+
+    m_pvrchannelid = 0;
+    m_pvrchannelname.clear();
+    lock.unlock();
+
+    // Stop any active recording once the lock has been released
+    if (recording)
+    {
+
+      finish_recording(std::move(recording));
+      TriggerTimerUpdate();
+      TriggerRecordingUpdate();
+    }
   }
   catch (std::exception& ex)
   {
@@ -1895,6 +3011,108 @@ PVR_ERROR addon::DeleteChannel(kodi::addon::PVRChannel const& channel)
   return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
 
+//-----------------------------------------------------------------------------
+// addon::DeleteRecording (CInstancePVRClient)
+//
+// Delete a recording on the backend
+//
+// Arguments:
+//
+//	recording	- Recording to be deleted
+
+PVR_ERROR addon::DeleteRecording(kodi::addon::PVRRecording const& recording)
+{
+  try
+  {
+
+    connectionpool::handle dbhandle(m_connpool);
+
+    unsigned int const id = static_cast<unsigned int>(std::stoul(recording.GetRecordingId()));
+
+    // Remove the recorded audio file before the database entry
+    std::string const filename = get_recording_filename(dbhandle, id);
+    if ((!filename.empty()) && (kodi::vfs::FileExists(filename)))
+      kodi::vfs::DeleteFile(filename);
+
+    delete_recording(dbhandle, id);
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  TriggerRecordingUpdate();
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::DeleteTimer (CInstancePVRClient)
+//
+// Delete a timer on the backend
+//
+// Arguments:
+//
+//	timer		- Timer to be deleted
+//	forceDelete	- Flag to delete the timer even if it is recording
+
+PVR_ERROR addon::DeleteTimer(kodi::addon::PVRTimer const& timer, bool /*forceDelete*/)
+{
+  std::unique_ptr<recording_t> recording; // Recording associated with the timer
+
+  try
+  {
+
+    // Deleting the timer stops the recording; the audio recorded so far is kept.  A recording
+    // on another device is removed without involving the stream that is playing
+    std::unique_lock<std::mutex> recordingslock(m_recordings_lock);
+    auto found = std::find_if(m_recordings.begin(), m_recordings.end(),
+                              [&](std::unique_ptr<recording_t> const& item) -> bool
+                              { return item->timerid == timer.GetClientIndex(); });
+    if (found != m_recordings.end())
+    {
+
+      recording = std::move(*found);
+      m_recordings.erase(found);
+    }
+
+    recordingslock.unlock();
+
+    // The recording of the channel that is playing has to be detached from the stream
+    if (!recording)
+    {
+
+      std::unique_lock<std::mutex> lock(m_pvrstream_lock);
+      if ((m_recording) && (timer.GetClientIndex() == m_recording->timerid))
+        recording = detach_recording();
+    }
+
+    if (!recording)
+      return PVR_ERROR::PVR_ERROR_INVALID_PARAMETERS;
+
+    finish_recording(std::move(recording));
+
+    TriggerTimerUpdate();
+    TriggerRecordingUpdate();
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
 //-----------------------------------------------------------------------------
 // addon::DemuxAbort (CInstancePVRClient)
 //
@@ -1971,10 +3189,43 @@ DEMUX_PACKET* addon::DemuxRead(void)
     DEMUX_PACKET* packet = m_pvrstream->demuxread([&](int size) -> DEMUX_PACKET*
                                                   { return AllocateDemuxPacket(size); });
 
+    // Track the playout of the audio delivered to Kodi to detect underruns; this is done here
+    // rather than by the stream since a timeshift buffer or a recording reads the underlying
+    // stream as fast as it can, only the packets read by Kodi are played out in real time
+    if (packet != nullptr)
+    {
+
+      if (packet->iStreamId == DEMUX_SPECIALID_STREAMCHANGE)
+        m_pvrstream->counters()->discontinuity();
+      else if (packet->duration > 0)
+        m_pvrstream->counters()->packetread(packet->duration / STREAM_TIME_BASE);
+    }
+
+    // Detach the active recording once the requested duration has been captured
+    std::unique_ptr<recording_t> recording;
+    if ((m_recording) && (m_recording->sink->completed()))
+      recording = detach_recording();
+
     // Log a warning if a stream change packet was detected; this means the application isn't keeping up with the device
     if ((packet != nullptr) && (packet->iStreamId == DEMUX_SPECIALID_STREAMCHANGE))
-      log_warning(__func__,
-                  ": stream buffer has been flushed; device sample rate may need to be reduced");
+    {
+
+      struct perfcounterprops const counters = m_pvrstream->counters()->snapshot();
+      log_warning(__func__, ": stream buffer has been flushed (", counters.buffersdropped,
+                  " buffers dropped, ", counters.packetsdropped, " packets dropped, realtime factor ",
+                  counters.realtimefactor, "); device sample rate may need to be reduced");
+    }
+
+    // Stop the detached recording once the lock has been released; this waits for the
+    // queued audio to be written and registers the recording in the database
+    if (recording)
+    {
+
+      lock.unlock();
+      finish_recording(std::move(recording));
+      TriggerTimerUpdate();
+      TriggerRecordingUpdate();
+    }
 
     return packet;
   }
@@ -1987,7 +3238,22 @@ DEMUX_PACKET* addon::DemuxRead(void)
     kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Unable to read from stream: %s",
                                      ex.what());
 
+    std::unique_ptr<recording_t> recording = detach_recording();
+    std::atomic_store(&m_signalstatus, signalstatus_t()); // Release signal status
+    std::atomic_store(&m_perfcounters, perfcounters_t()); // Release performance counters
     m_pvrstream.reset(); // Close the stream
+    m_devicesession->reset(); // Don't reuse a device that may have failed
+    lock.unlock();
+
+    // Stop any active recording once the lock has been released
+    if (recording)
+    {
+
+      finish_recording(std::move(recording));
+      TriggerTimerUpdate();
+      TriggerRecordingUpdate();
+    }
+
     return nullptr; // Return a null demultiplexer packet
   }
 
@@ -2069,9 +3335,13 @@ PVR_ERROR addon::GetCapabilities(kodi::addon::PVRCapabilities& capabilities)
   capabilities.SetSupportsRadio(true);
   capabilities.SetSupportsChannelGroups(true);
   capabilities.SetSupportsChannelSettings(true);
+  capabilities.SetSupportsChannelScan(true);
   capabilities.SetHandlesInputStream(true);
   capabilities.SetHandlesDemuxing(true);
   capabilities.SetSupportsEPG(true);
+  capabilities.SetSupportsTimers(true);
+  capabilities.SetSupportsRecordings(true);
+  capabilities.SetSupportsRecordingsDelete(true);
 
   return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
@@ -2352,43 +3622,71 @@ PVR_ERROR addon::GetEPGForChannel(int /*channelUid*/,
 }
 
 //-----------------------------------------------------------------------------
-// addon::GetSignalStatus (CInstancePVRClient)
+// addon::GetRecordings (CInstancePVRClient)
 //
-// Get the signal status of the stream that's currently open
+// Retrieve the recordings stored on the backend
 //
 // Arguments:
 //
-//	channelUid		- Channel identifier
-//	signalStatus	- Structure to set with the signal status information
+//	deleted		- Flag to return deleted recordings
+//	results		- Recordings result set
 
-PVR_ERROR addon::GetSignalStatus(int /*channelUid*/, kodi::addon::PVRSignalStatus& signalStatus)
+PVR_ERROR addon::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results)
 {
-  // Prevent race condition with functions that modify m_pvrstream
-  std::unique_lock<std::mutex> lock(m_pvrstream_lock);
-
-  // Kodi may call this function before the stream is open, avoid the error log
-  if (!m_pvrstream)
+  // Deleted recordings are removed immediately
+  if (deleted)
     return PVR_ERROR::PVR_ERROR_NO_ERROR;
 
   try
   {
 
-    int quality = 0; // Quality as a percentage
-    int snr = 0; // SNR as a percentage
+    enumerate_recordings(connectionpool::handle(m_connpool),
+                         [&](struct recording const& item) -> void
+                         {
+                           kodi::addon::PVRRecording pvrrecording;
+
+                           pvrrecording.SetRecordingId(std::to_string(item.id));
+                           pvrrecording.SetChannelUid(static_cast<int>(item.channelid));
+                           pvrrecording.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_RADIO);
+                           if (item.channelname != nullptr)
+                             pvrrecording.SetChannelName(item.channelname);
+                           if (item.title != nullptr)
+                             pvrrecording.SetTitle(item.title);
+                           pvrrecording.SetRecordingTime(item.starttime);
+                           pvrrecording.SetDuration(item.duration);
+
+                           results.Add(pvrrecording);
+                         });
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
 
-    // Retrieve the quality metrics from the stream instance
-    m_pvrstream->signalquality(quality, snr);
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
 
-    signalStatus.SetAdapterName(m_pvrstream->devicename());
-    signalStatus.SetAdapterStatus("Active");
-    signalStatus.SetServiceName(m_pvrstream->servicename());
-    signalStatus.SetProviderName("RTL-SDR");
-    signalStatus.SetMuxName(m_pvrstream->muxname());
+//-----------------------------------------------------------------------------
+// addon::GetRecordingsAmount (CInstancePVRClient)
+//
+// Get the total amount of recordings on the backend
+//
+// Arguments:
+//
+//	deleted		- Flag to count deleted recordings
+//	amount		- Set to the number of available recordings
 
-    signalStatus.SetSignal(quality * 655); // Range: 0-65535
-    signalStatus.SetSNR(snr * 655); // Range: 0-65535
+PVR_ERROR addon::GetRecordingsAmount(bool deleted, int& amount)
+{
+  try
+  {
+    amount = (deleted) ? 0 : get_recording_count(connectionpool::handle(m_connpool));
   }
-
   catch (std::exception& ex)
   {
     return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
@@ -2402,20 +3700,124 @@ PVR_ERROR addon::GetSignalStatus(int /*channelUid*/, kodi::addon::PVRSignalStatu
 }
 
 //-----------------------------------------------------------------------------
-// addon::GetStreamProperties (CInstancePVRClient)
+// addon::GetRecordingStreamProperties (CInstancePVRClient)
 //
-// Get the stream properties of the stream that's currently being read
+// Get the stream properties for a recording from the backend
 //
 // Arguments:
 //
-//	properties		- Stream properties to be set
+//	recording	- Recording to get the stream properties for
+//	properties	- Properties required to play the recording
 
-PVR_ERROR addon::GetStreamProperties(std::vector<kodi::addon::PVRStreamProperties>& properties)
+PVR_ERROR addon::GetRecordingStreamProperties(
+    kodi::addon::PVRRecording const& recording,
+    std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  if (!m_pvrstream)
-    return PVR_ERROR::PVR_ERROR_FAILED;
+  try
+  {
 
-  // Enumerate the stream properties as specified by the PVR stream instance
+    unsigned int const id = static_cast<unsigned int>(std::stoul(recording.GetRecordingId()));
+
+    // Recordings are regular audio files that Kodi can play directly
+    std::string const filename = get_recording_filename(connectionpool::handle(m_connpool), id);
+    if (filename.empty())
+      return PVR_ERROR::PVR_ERROR_INVALID_PARAMETERS;
+
+    properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, filename);
+    properties.emplace_back(PVR_STREAM_PROPERTY_ISREALTIMESTREAM, "false");
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::GetSignalStatus (CInstancePVRClient)
+//
+// Get the signal status of the stream that's currently open
+//
+// Arguments:
+//
+//	channelUid		- Channel identifier
+//	signalStatus	- Structure to set with the signal status information
+
+PVR_ERROR addon::GetSignalStatus(int /*channelUid*/, kodi::addon::PVRSignalStatus& signalStatus)
+{
+  // The signal status is read from the snapshot published by the stream rather than
+  // the stream itself; this must not take m_pvrstream_lock as DemuxRead() can hold
+  // it for as long as the stream is waiting for data to become available
+  signalstatus_t signalstatus = std::atomic_load(&m_signalstatus);
+  perfcounters_t perfcounters = std::atomic_load(&m_perfcounters);
+
+  // Kodi may call this function before the stream is open, avoid the error log
+  if (!signalstatus)
+    return PVR_ERROR::PVR_ERROR_NO_ERROR;
+
+  try
+  {
+
+    // Retrieve a consistent copy of the quality metrics from the snapshot
+    struct signalstatusprops const status = signalstatus->load();
+
+    signalStatus.SetAdapterName(status.devicename);
+    signalStatus.SetAdapterStatus("Active");
+
+    // Summarize the performance counters in the adapter status, if available
+    if (perfcounters)
+    {
+
+      struct perfcounterprops const counters = perfcounters->snapshot();
+
+      char adapterstatus[128] = {};
+      snprintf(adapterstatus, std::extent<decltype(adapterstatus)>::value,
+               "Active (RTF %.2f, %llu dropped, %llu underruns)", counters.realtimefactor,
+               static_cast<unsigned long long>(counters.buffersdropped + counters.packetsdropped),
+               static_cast<unsigned long long>(counters.underruns));
+      signalStatus.SetAdapterStatus(adapterstatus);
+    }
+    signalStatus.SetServiceName(status.servicename);
+    signalStatus.SetProviderName("RTL-SDR");
+    signalStatus.SetMuxName(status.muxname);
+
+    signalStatus.SetSignal(status.quality * 655); // Range: 0-65535
+    signalStatus.SetSNR(status.snr * 655); // Range: 0-65535
+  }
+
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::GetStreamProperties (CInstancePVRClient)
+//
+// Get the stream properties of the stream that's currently being read
+//
+// Arguments:
+//
+//	properties		- Stream properties to be set
+
+PVR_ERROR addon::GetStreamProperties(std::vector<kodi::addon::PVRStreamProperties>& properties)
+{
+  if (!m_pvrstream)
+    return PVR_ERROR::PVR_ERROR_FAILED;
+
+  // Enumerate the stream properties as specified by the PVR stream instance
   m_pvrstream->enumproperties(
       [&](struct streamprops const& props) -> void
       {
@@ -2440,6 +3842,138 @@ PVR_ERROR addon::GetStreamProperties(std::vector<kodi::addon::PVRStreamPropertie
   return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
 
+//-----------------------------------------------------------------------------
+// addon::GetStreamTimes (CInstancePVRClient)
+//
+// Get stream times for the currently playing stream
+//
+// Arguments:
+//
+//	times		- Structure to receive the stream times
+
+PVR_ERROR addon::GetStreamTimes(kodi::addon::PVRStreamTimes& times)
+{
+  try
+  {
+
+    struct streamtimeprops streamtimes = {};
+    if ((!m_pvrstream) || (!m_pvrstream->streamtimes(streamtimes)))
+      return PVR_ERROR::PVR_ERROR_NOT_IMPLEMENTED;
+
+    times.SetStartTime(streamtimes.starttime);
+    times.SetPTSStart(static_cast<int64_t>(streamtimes.ptsstart));
+    times.SetPTSBegin(static_cast<int64_t>(streamtimes.ptsbegin));
+    times.SetPTSEnd(static_cast<int64_t>(streamtimes.ptsend));
+  }
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::GetTimers (CInstancePVRClient)
+//
+// Request the list of all timers from the backend
+//
+// Arguments:
+//
+//	results		- Timers result set
+
+PVR_ERROR addon::GetTimers(kodi::addon::PVRTimersResultSet& results)
+{
+  try
+  {
+    reap_recordings();
+  }
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  // addtimer (local)
+  //
+  // Adds the timer associated with an active recording to the result set
+  auto addtimer = [&](recording_t const& recording) -> void
+  {
+    kodi::addon::PVRTimer timer;
+
+    timer.SetClientIndex(recording.timerid);
+    timer.SetClientChannelUid(static_cast<int>(recording.channelid));
+    timer.SetTimerType(1);
+    timer.SetState(PVR_TIMER_STATE_RECORDING);
+    timer.SetTitle(recording.title);
+    timer.SetStartTime(recording.starttime);
+    timer.SetEndTime(recording.endtime);
+
+    results.Add(timer);
+  };
+
+  // The only timers are the ones associated with the active recordings
+  std::unique_lock<std::mutex> lock(m_recordings_lock);
+  if (m_recording)
+    addtimer(*m_recording);
+  for (auto const& recording : m_recordings)
+    addtimer(*recording);
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::GetTimersAmount (CInstancePVRClient)
+//
+// Get the total amount of timers on the backend
+//
+// Arguments:
+//
+//	amount		- Set to the number of active timers
+
+PVR_ERROR addon::GetTimersAmount(int& amount)
+{
+  try
+  {
+    reap_recordings();
+  }
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  std::unique_lock<std::mutex> lock(m_recordings_lock);
+  amount = static_cast<int>(m_recordings.size()) + ((m_recording) ? 1 : 0);
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
+//-----------------------------------------------------------------------------
+// addon::GetTimerTypes (CInstancePVRClient)
+//
+// Retrieve the timer types supported by the backend
+//
+// Arguments:
+//
+//	types		- Vector to receive the supported timer types
+
+PVR_ERROR addon::GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& types)
+{
+  // Only a manual recording that starts immediately is supported
+  kodi::addon::PVRTimerType type;
+  type.SetId(1);
+  type.SetAttributes(PVR_TIMER_TYPE_IS_MANUAL | PVR_TIMER_TYPE_SUPPORTS_CHANNELS |
+                     PVR_TIMER_TYPE_SUPPORTS_START_TIME | PVR_TIMER_TYPE_SUPPORTS_END_TIME);
+  type.SetDescription(kodi::addon::GetLocalizedString(30420));
+
+  types.emplace_back(std::move(type));
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
+}
+
 //-----------------------------------------------------------------------------
 // addon::GetConnectionString (CInstancePVRClient)
 //
@@ -2576,15 +4110,15 @@ PVR_ERROR addon::OpenDialogChannelAdd(kodi::addon::PVRChannel const& /*channel*/
     modulationtype = modulationtypes[selected];
   }
 
-  // TODO: see if there is a better way we can work with this
-  if (m_pvrstream)
+  // The channel add dialog can't be shown when all of the devices are in use
+  if ((m_pvrstream) && (!device_available(settings)))
   {
 
     // TODO: This message is terrible
     kodi::gui::dialogs::OK::ShowAndGetInput(
         kodi::addon::GetLocalizedString(30405),
         "Modifying PVR Radio channel settings requires "
-        "exclusive access to the connected RTL-SDR tuner device.",
+        "exclusive access to an RTL-SDR tuner device.",
         "", "Active playback of PVR Radio streams must be stopped before continuing.");
 
     return PVR_ERROR::PVR_ERROR_NO_ERROR;
@@ -2639,7 +4173,279 @@ PVR_ERROR addon::OpenDialogChannelAdd(kodi::addon::PVRChannel const& /*channel*/
 
 PVR_ERROR addon::OpenDialogChannelScan(void)
 {
-  return PVR_ERROR::PVR_ERROR_NOT_IMPLEMENTED;
+  // Create a copy of the current addon settings structure
+  struct settings settings = copy_settings();
+
+  // Only DAB ensembles can be detected without the user selecting a frequency
+  if (!settings.dabradio_enable)
+    return PVR_ERROR::PVR_ERROR_NOT_IMPLEMENTED;
+
+  // The band scan can't be run when all of the devices are in use
+  std::unique_lock<std::mutex> lock(m_pvrstream_lock);
+  bool const available = ((!m_pvrstream) || (device_available(settings)));
+  lock.unlock();
+
+  if (!available)
+  {
+
+    // TODO: This message is terrible
+    kodi::gui::dialogs::OK::ShowAndGetInput(
+        kodi::addon::GetLocalizedString(30405),
+        "Scanning for PVR Radio channels requires "
+        "exclusive access to an RTL-SDR tuner device.",
+        "", "Active playback of PVR Radio streams must be stopped before continuing.");
+
+    return PVR_ERROR::PVR_ERROR_NO_ERROR;
+  }
+
+  try
+  {
+
+    std::vector<std::string> channelnames; // Channel names
+    std::vector<std::string> channellabels; // Channel labels
+    std::vector<uint32_t> channelfrequencies; // Channel frequencies
+    size_t found = 0; // Number of ensembles found
+
+    // Pull a database handle out of the connection pool
+    connectionpool::handle dbhandle(m_connpool);
+
+    // Enumerate the named channels available for the specified modulation (DAB)
+    enumerate_namedchannels(dbhandle, modulation::dab,
+                            [&](struct namedchannel const& item) -> void
+                            {
+                              if ((item.frequency > 0) && (item.name != nullptr))
+                              {
+
+                                // Append the frequency of the channel in megahertz to the label
+                                char label[256]{};
+                                unsigned int mhz = item.frequency / 1000000;
+                                unsigned int khz = (item.frequency % 1000000) / 1000;
+                                snprintf(label, std::extent<decltype(label)>::value,
+                                         "%s (%u.%u MHz)", item.name, mhz, khz);
+
+                                channelnames.emplace_back(item.name);
+                                channellabels.emplace_back(label);
+                                channelfrequencies.emplace_back(item.frequency);
+                              }
+                            });
+
+    if (channelfrequencies.empty())
+      throw string_exception("No DAB ensembles were enumerated from the database");
+
+    std::unique_ptr<muxscanner> scanner; // Multiplex scanner for the current ensemble
+    std::mutex scannerlock; // Synchronization object
+    struct muxscanner::multiplex muxdata = {}; // Multiplex data for the current ensemble
+    std::mutex muxdatalock; // Synchronization object
+    std::exception_ptr exception; // Exception during the scan
+    std::exception_ptr worker_exception; // Exception on the device thread
+    std::atomic<bool> stopped{false}; // Device thread stopped flag
+
+    // read_callback_func (local)
+    //
+    // Asynchronous read callback function for the RTL-SDR device
+    auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
+    {
+      std::unique_lock<std::mutex> scanlock(scannerlock);
+      if (scanner)
+        scanner->inputsamples(buffer, count);
+    };
+
+    // mux_data_func (local)
+    //
+    // Updates the multiplex data of the current ensemble
+    auto mux_data_func = [&](struct muxscanner::multiplex const& multiplex) -> void
+    {
+      std::unique_lock<std::mutex> muxlock(muxdatalock);
+      muxdata = multiplex;
+    };
+
+    kodi::gui::dialogs::CProgress progress;
+    progress.SetHeading(kodi::addon::GetLocalizedString(30421));
+    progress.SetCanCancel(true);
+    progress.ShowProgressBar(true);
+    progress.Open();
+
+    // A single device is used for the entire band and retuned for each ensemble rather than
+    // being reopened; it streams continuously into the multiplex scanner for that ensemble
+    std::unique_ptr<rtldevice> device = create_device(settings, channelfrequencies[0]);
+    device->set_sample_rate(DABSCAN_SAMPLE_RATE);
+    device->set_center_frequency(channelfrequencies[0]);
+    device->begin_stream();
+
+    std::thread worker(
+        [&]() -> void
+        {
+          try
+          {
+            device->read_async(read_callback_func, static_cast<uint32_t>(32 KiB));
+          }
+          catch (...)
+          {
+            worker_exception = std::current_exception();
+          }
+
+          stopped.store(true);
+        });
+
+    try
+    {
+
+      for (size_t index = 0;
+           (index < channelfrequencies.size()) && (!progress.IsCanceled()) && (!stopped.load());
+           index++)
+      {
+
+        progress.SetLine(0, channellabels[index]);
+        progress.SetLine(1, kodi::addon::GetLocalizedString(30422)
+                                .append(" ")
+                                .append(std::to_string(found)));
+        progress.SetPercentage(static_cast<int>((index * 100) / channelfrequencies.size()));
+
+        // Initialize enough properties for a new channel to be added
+        struct channelprops channelprops = {};
+        channelprops.frequency = channelfrequencies[index];
+        channelprops.modulation = modulation::dab;
+        channelprops.name =
+            kodi::addon::GetLocalizedString(30322).append(" ").append(channelnames[index]);
+        channelprops.autogain = true;
+
+        // If the channel already exists in the database, scan it with the previously set
+        // properties and keep the logos of the existing subchannels
+        std::vector<struct subchannelprops> subchannelprops; // Existing subchannels
+        bool exists = channel_exists(dbhandle, channelprops);
+        if (exists)
+          get_channel_properties(dbhandle, channelprops.frequency, channelprops.modulation,
+                                 channelprops, subchannelprops);
+
+        // Retune the device to the ensemble
+        device->set_frequency_correction(settings.device_frequency_correction +
+                                         channelprops.freqcorrection);
+        device->set_center_frequency(channelprops.frequency);
+        device->set_automatic_gain_control(channelprops.autogain);
+        if (channelprops.autogain == false)
+          device->set_gain(channelprops.manualgain);
+
+        // Replace the multiplex scanner; the previous instance is destroyed first so
+        // that it can't report data for the previous ensemble
+        std::unique_lock<std::mutex> scanlock(scannerlock);
+        scanner.reset();
+        std::unique_lock<std::mutex> muxlock(muxdatalock);
+        muxdata = {};
+        muxlock.unlock();
+        scanner = dabmuxscanner::create(DABSCAN_SAMPLE_RATE, mux_data_func);
+        scanlock.unlock();
+
+        // Wait for the ensemble to be detected and for the multiplex data to settle
+        struct muxscanner::multiplex current = {};
+        auto const start = std::chrono::steady_clock::now();
+        auto changed = start;
+
+        while ((!progress.IsCanceled()) && (!stopped.load()))
+        {
+
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          auto const now = std::chrono::steady_clock::now();
+
+          muxlock.lock();
+          if ((muxdata.sync != current.sync) || (muxdata.name != current.name) ||
+              (muxdata.subchannels.size() != current.subchannels.size()))
+          {
+
+            current = muxdata;
+            changed = now;
+          }
+          muxlock.unlock();
+
+          if ((!current.sync) && (now - start >= DABSCAN_SYNC_TIMEOUT))
+            break;
+
+          if ((current.sync) && (!current.subchannels.empty()) &&
+              (now - changed >= DABSCAN_SETTLE_TIME))
+            break;
+
+          if (now - start >= DABSCAN_TIMEOUT)
+            break;
+        }
+
+        if ((progress.IsCanceled()) || (!current.sync) || (current.subchannels.empty()))
+          continue;
+
+        // Generate the subchannels for the ensemble from the multiplex data
+        std::vector<struct subchannelprops> subchannels;
+        for (auto const& item : current.subchannels)
+        {
+
+          struct subchannelprops subchannel = {};
+          subchannel.number = item.number;
+          subchannel.name = item.name;
+
+          auto existing =
+              std::find_if(subchannelprops.begin(), subchannelprops.end(),
+                           [&](auto const& val) -> bool { return val.number == item.number; });
+          if (existing != subchannelprops.end())
+            subchannel.logourl = existing->logourl;
+
+          subchannels.emplace_back(std::move(subchannel));
+        }
+
+        // Add or update the channel/subchannels in the database; a new channel is named
+        // after the ensemble label if it has been detected
+        if (!exists)
+        {
+
+          if (!current.name.empty())
+            channelprops.name = current.name;
+          add_channel(dbhandle, channelprops, subchannels);
+        }
+
+        else
+          update_channel(dbhandle, channelprops, subchannels);
+
+        found++;
+      }
+    }
+
+    catch (...)
+    {
+      exception = std::current_exception();
+    }
+
+    device->cancel_async(); // Cancel any async read operations
+    worker.join(); // Wait for thread to exit
+    if (!exception)
+      exception = worker_exception;
+
+    std::unique_lock<std::mutex> scanlock(scannerlock);
+    scanner.reset(); // Release the multiplex scanner
+    scanlock.unlock();
+
+    if (found > 0)
+    {
+
+      TriggerChannelUpdate();
+      TriggerChannelGroupsUpdate();
+    }
+
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+
+  catch (std::exception& ex)
+  {
+
+    // Log the error and inform the user that the operation failed, do not return an error code
+    handle_stdexception(__func__, ex);
+    kodi::gui::dialogs::OK::ShowAndGetInput(kodi::addon::GetLocalizedString(30407),
+                                            "An error occurred scanning for channels:", "",
+                                            ex.what());
+  }
+
+  catch (...)
+  {
+    return handle_generalexception(__func__, PVR_ERROR::PVR_ERROR_FAILED);
+  }
+
+  return PVR_ERROR::PVR_ERROR_NO_ERROR;
 }
 
 //-----------------------------------------------------------------------------
@@ -2653,26 +4459,33 @@ PVR_ERROR addon::OpenDialogChannelScan(void)
 
 PVR_ERROR addon::OpenDialogChannelSettings(kodi::addon::PVRChannel const& channel)
 {
-  // Prevent manipulation of the PVR stream (OpenLiveStream/CloseLiveStream)
+  // Create a copy of the current addon settings structure
+  struct settings settings = copy_settings();
+
+  // The signal meter of the channel that is playing is fed from the I/Q samples of the
+  // stream rather than another device; for any other channel the dialog can't be shown
+  // when all of the devices are in use.  The lock isn't held while the dialog is shown
+  // since it would stall the active stream
   std::unique_lock<std::mutex> lock(m_pvrstream_lock);
+  std::shared_ptr<iqfanout> iqsamples;
+  if ((m_pvrstream) && (static_cast<unsigned int>(channel.GetUniqueId()) == m_pvrchannelid))
+    iqsamples = m_pvrstream->iqsamples();
+  bool const available = ((!m_pvrstream) || (iqsamples) || (device_available(settings)));
+  lock.unlock();
 
-  // The channel settings dialog can't be shown when there is an active stream
-  if (m_pvrstream)
+  if (!available)
   {
 
     // TODO: This message is terrible
     kodi::gui::dialogs::OK::ShowAndGetInput(
         kodi::addon::GetLocalizedString(30405),
         "Modifying PVR Radio channel settings requires "
-        "exclusive access to the connected RTL-SDR tuner device.",
+        "exclusive access to an RTL-SDR tuner device.",
         "", "Active playback of PVR Radio streams must be stopped before continuing.");
 
     return PVR_ERROR::PVR_ERROR_NO_ERROR;
   }
 
-  // Create a copy of the current addon settings structure
-  struct settings settings = copy_settings();
-
   try
   {
 
@@ -2689,9 +4502,19 @@ PVR_ERROR addon::OpenDialogChannelSettings(kodi::addon::PVRChannel const& channe
       throw string_exception("Unable to retrieve properties for channel ",
                              channel.GetChannelName().c_str());
 
+    // The analog streams sample the device at the configured rate, the digital streams
+    // use the same fixed rate as the dialog box
+    uint32_t samplerate = 0;
+    if (channelprops.modulation == modulation::fm)
+      samplerate = static_cast<uint32_t>(settings.fmradio_sample_rate);
+    else if (channelprops.modulation == modulation::wx)
+      samplerate = static_cast<uint32_t>(settings.wxradio_sample_rate);
+
     // Create and initialize the dialog box against a new signal meter instance
     std::unique_ptr<channelsettings> dialog =
-        channelsettings::create(create_device(settings), tunerprops, channelprops, false);
+        (iqsamples) ? channelsettings::create(iqsamples, samplerate, tunerprops, channelprops)
+                    : channelsettings::create(create_device(settings, channelprops.frequency),
+                                              tunerprops, channelprops, false);
     dialog->DoModal();
 
     if (dialog->get_dialog_result())
@@ -2742,9 +4565,21 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
   try
   {
 
-    // Set up the tuner device properties
-    struct tunerprops tunerprops = {};
-    tunerprops.freqcorrection = settings.device_frequency_correction;
+    // Any recording of the previous channel is stopped when a new stream is opened; the
+    // recording is finished without the lock since that waits for the audio to be written
+    std::unique_ptr<recording_t> recording = detach_recording();
+    if (recording)
+    {
+
+      lock.unlock();
+      finish_recording(std::move(recording));
+      TriggerTimerUpdate();
+      TriggerRecordingUpdate();
+      lock.lock();
+    }
+
+    m_pvrchannelid = 0;
+    m_pvrchannelname.clear();
 
     channelid channelid(channel.GetUniqueId()); // Convert UniqueID back into a channelid
 
@@ -2755,122 +4590,36 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
       throw string_exception("channel ", channel.GetUniqueId(), " (",
                              channel.GetChannelName().c_str(), ") was not found in the database");
 
-    // FM Radio
-    //
-    if (channelprops.modulation == modulation::fm)
-    {
-
-      // Set up the FM digital signal processor properties
-      struct fmprops fmprops = {};
-      fmprops.decoderds = settings.fmradio_enable_rds;
-      fmprops.isnorthamerica = is_region_northamerica(settings);
-      fmprops.samplerate = settings.fmradio_sample_rate;
-      fmprops.downsamplequality = static_cast<int>(settings.fmradio_downsample_quality);
-      fmprops.outputrate = settings.fmradio_output_samplerate;
-      fmprops.outputgain = settings.fmradio_output_gain;
+    // Create the stream for the channel
+    m_pvrstream = create_stream(settings, channel.GetUniqueId(), channelprops);
 
-      // Log information about the stream for diagnostic purposes
-      log_info(__func__, ": Creating fmstream for channel \"", channelprops.name, "\"");
-      log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
-      log_info(__func__, ": fmprops.decoderds = ", (fmprops.decoderds) ? "true" : "false");
-      log_info(__func__,
-               ": fmprops.isnorthamerica = ", (fmprops.isnorthamerica) ? "true" : "false");
-      log_info(__func__, ": fmrops.samplerate = ", fmprops.samplerate, " Hz");
-      log_info(__func__, ": fmprops.downsamplequality = ",
-               downsample_quality_to_string(
-                   static_cast<enum downsample_quality>(fmprops.downsamplequality)));
-      log_info(__func__, ": fmprops.outputgain = ", fmprops.outputgain, " dB");
-      log_info(__func__, ": fmprops.outputrate = ", fmprops.outputrate, " Hz");
-      log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
-      log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
-      log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
-      log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
-
-      // Create the FM Radio stream
-      m_pvrstream = fmstream::create(create_device(settings), tunerprops, channelprops, fmprops);
-    }
-
-    // HD Radio
-    //
-    else if (channelprops.modulation == modulation::hd)
+    // Wrap the stream in a timeshift buffer if enabled; the buffer segments are created
+    // in a dedicated folder under the addon user data directory
+    if (settings.timeshift_enable)
     {
 
-      // Set up the HD Radio digital signal processor properties
-      struct hdprops hdprops = {};
-      hdprops.outputgain = settings.hdradio_output_gain;
-
-      // Log information about the stream for diagnostic purposes
-      log_info(__func__, ": Creating hdstream for channel \"", channelprops.name, "\"");
-      log_info(__func__, ": subchannel = ", channelid.subchannel());
-      log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
-      log_info(__func__, ": hdprops.outputgain = ", hdprops.outputgain, " dB");
-      log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
-      log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
-      log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
-      log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
-
-      // Create the HD Radio stream
-      m_pvrstream = hdstream::create(create_device(settings), tunerprops, channelprops, hdprops,
-                                     channelid.subchannel());
-    }
-
-    // DAB
-    //
-    else if (channelprops.modulation == modulation::dab)
-    {
+      struct timeshiftprops timeshiftprops = {};
+      timeshiftprops.folder = UserPath() + "/timeshift";
+      timeshiftprops.buffersize = static_cast<size_t>(settings.timeshift_buffer_size) MiB;
 
-      // Set up the DAB digital signal processor properties
-      struct dabprops dabprops = {};
-      dabprops.outputgain = settings.dabradio_output_gain;
-      dabprops.coarse_corrector = settings.dabradio_coarse_corrector;
-      dabprops.coarse_corrector_type = settings.dabradio_coarse_corrector_type;
+      if (!kodi::vfs::DirectoryExists(timeshiftprops.folder) &&
+          !kodi::vfs::CreateDirectory(timeshiftprops.folder))
+        throw string_exception(__func__, ": unable to create timeshift buffer directory");
 
-      // Log information about the stream for diagnostic purposes
-      log_info(__func__, ": Creating dabstream for channel \"", channelprops.name, "\"");
-      log_info(__func__, ": subchannel = ", channelid.subchannel());
-      log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
-      log_info(__func__, ": dabrops.outputgain = ", dabprops.outputgain, " dB");
-      log_info(__func__, ": dabrops.coarse_corrector = ", dabprops.coarse_corrector);
-      log_info(__func__, ": dabrops.coarse_corrector_type = ", dabprops.coarse_corrector_type);
-      log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
-      log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
-      log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
-      log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
+      log_info(__func__, ": Creating timeshiftstream");
+      log_info(__func__, ": timeshiftprops.folder = ", timeshiftprops.folder.c_str());
+      log_info(__func__, ": timeshiftprops.buffersize = ", settings.timeshift_buffer_size, " MB");
 
-      // Create the DAB stream
-      m_pvrstream = dabstream::create(create_device(settings), tunerprops, channelprops, dabprops,
-                                      channelid.subchannel());
+      m_pvrstream = timeshiftstream::create(std::move(m_pvrstream), timeshiftprops);
     }
 
-    // Weather Radio
-    //
-    else if (channelprops.modulation == modulation::wx)
-    {
-
-      // Set up the FM digital signal processor properties
-      struct wxprops wxprops = {};
-      wxprops.samplerate = settings.wxradio_sample_rate;
-      wxprops.outputrate = settings.wxradio_output_samplerate;
-      wxprops.outputgain = settings.wxradio_output_gain;
+    // Expose the signal status snapshot and performance counters of the stream
+    std::atomic_store(&m_signalstatus, signalstatus_t(m_pvrstream->signalstatus()));
+    std::atomic_store(&m_perfcounters, perfcounters_t(m_pvrstream->counters()));
 
-      // Log information about the stream for diagnostic purposes
-      log_info(__func__, ": Creating wxstream for channel \"", channelprops.name, "\"");
-      log_info(__func__, ": tunerprops.freqcorrection = ", tunerprops.freqcorrection, " PPM");
-      log_info(__func__, ": wxprops.samplerate = ", wxprops.samplerate, " Hz");
-      log_info(__func__, ": wxprops.outputgain = ", wxprops.outputgain, " dB");
-      log_info(__func__, ": wxprops.outputrate = ", wxprops.outputrate, " Hz");
-      log_info(__func__, ": channelprops.frequency = ", channelprops.frequency, " Hz");
-      log_info(__func__, ": channelprops.autogain = ", (channelprops.autogain) ? "true" : "false");
-      log_info(__func__, ": channelprops.manualgain = ", channelprops.manualgain / 10, " dB");
-      log_info(__func__, ": channelprops.freqcorrection = ", channelprops.freqcorrection, " PPM");
-
-      // Create the Weather Radio stream
-      m_pvrstream = wxstream::create(create_device(settings), tunerprops, channelprops, wxprops);
-    }
-
-    else
-      throw string_exception("channel ", channel.GetUniqueId(), " (",
-                             channel.GetChannelName().c_str(), ") has an unknown modulation type");
+    // Track the channel associated with the stream for recordings
+    m_pvrchannelid = static_cast<unsigned int>(channel.GetUniqueId());
+    m_pvrchannelname = channel.GetChannelName();
   }
 
   // Queue a notification for the user when a live stream cannot be opened, don't just silently log it
@@ -2879,6 +4628,7 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
 
     kodi::QueueFormattedNotification(QueueMsg::QUEUE_ERROR, "Live Stream creation failed (%s).",
                                      ex.what());
+    m_devicesession->reset(); // Don't reuse a device that may have failed
     return handle_stdexception(__func__, ex, false);
   }
 
@@ -2890,6 +4640,25 @@ bool addon::OpenLiveStream(kodi::addon::PVRChannel const& channel)
   return true;
 }
 
+//-----------------------------------------------------------------------------
+// addon::PauseStream (CInstancePVRClient)
+//
+// Notify the pvr addon that Kodi (un)paused the currently playing stream
+//
+// Arguments:
+//
+//	paused		- Flag indicating if the stream has been paused or resumed
+
+void addon::PauseStream(bool /*paused*/)
+{
+  // The timeshift buffer continues to be filled while the stream is paused; the playout
+  // clock is reset so that resuming playback isn't counted as an underrun. This must not
+  // take m_pvrstream_lock as DemuxRead() can hold it while waiting for data
+  perfcounters_t perfcounters = std::atomic_load(&m_perfcounters);
+  if (perfcounters)
+    perfcounters->discontinuity();
+}
+
 //-----------------------------------------------------------------------------
 // addon::ReadLiveStream (CInstancePVRClient)
 //
@@ -2961,6 +4730,33 @@ int64_t addon::SeekLiveStream(int64_t position, int whence)
   }
 }
 
+//-----------------------------------------------------------------------------
+// addon::SeekTime (CInstancePVRClient)
+//
+// Notify the pvr addon/demuxer that Kodi wishes to seek the stream by time
+//
+// Arguments:
+//
+//	time		- The absolute time since stream start, in milliseconds
+//	backwards	- True to seek to keyframe BEFORE time, else AFTER
+//	startpts	- Can be updated to point to where display should start
+
+bool addon::SeekTime(double time, bool backwards, double& startpts)
+{
+  try
+  {
+    return (m_pvrstream) ? m_pvrstream->seektime(time, backwards, startpts) : false;
+  }
+  catch (std::exception& ex)
+  {
+    return handle_stdexception(__func__, ex, false);
+  }
+  catch (...)
+  {
+    return handle_generalexception(__func__, false);
+  }
+}
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
@@ -24,15 +24,26 @@
 #define __ADDON_H_
 #pragma once
 
+#include "dabreceiver.h"
 #include "database.h"
+#include "devicesession.h"
+#include "hdreceiver.h"
 #include "props.h"
 #include "pvrstream.h"
 #include "pvrtypes.h"
+#include "recordingsink.h"
 #include "rtldevice.h"
+#include "utils/scalar_condition.h"
 
 #include <kodi/addon-instance/PVR.h>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #pragma warning(push, 4)
 
@@ -76,6 +87,16 @@ public:
   // Call one of the settings related menu hooks
   PVR_ERROR CallSettingsMenuHook(kodi::addon::PVRMenuhook const& menuhook) override;
 
+  // AddTimer
+  //
+  // Add a timer on the backend
+  PVR_ERROR AddTimer(kodi::addon::PVRTimer const& timer) override;
+
+  // CanPauseStream
+  //
+  // Check if the backend supports pausing the currently playing stream
+  bool CanPauseStream(void) override;
+
   // CanSeekStream
   //
   // Check if the backend supports seeking for the currently playing stream
@@ -91,6 +112,16 @@ public:
   // Deletes a channel from the backend
   PVR_ERROR DeleteChannel(kodi::addon::PVRChannel const& channel) override;
 
+  // DeleteRecording
+  //
+  // Delete a recording on the backend
+  PVR_ERROR DeleteRecording(kodi::addon::PVRRecording const& recording) override;
+
+  // DeleteTimer
+  //
+  // Delete a timer on the backend
+  PVR_ERROR DeleteTimer(kodi::addon::PVRTimer const& timer, bool forceDelete) override;
+
   // DemuxAbort
   //
   // Abort the demultiplexer thread in the add-on
@@ -167,6 +198,23 @@ public:
                              time_t end,
                              kodi::addon::PVREPGTagsResultSet& results) override;
 
+  // GetRecordings
+  //
+  // Retrieve the recordings stored on the backend
+  PVR_ERROR GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results) override;
+
+  // GetRecordingsAmount
+  //
+  // Get the total amount of recordings on the backend
+  PVR_ERROR GetRecordingsAmount(bool deleted, int& amount) override;
+
+  // GetRecordingStreamProperties
+  //
+  // Get the stream properties for a recording from the backend
+  PVR_ERROR GetRecordingStreamProperties(
+      kodi::addon::PVRRecording const& recording,
+      std::vector<kodi::addon::PVRStreamProperty>& properties) override;
+
   // GetSignalStatus
   //
   // Get the signal status of the stream that's currently open
@@ -177,6 +225,26 @@ public:
   // Get the stream properties of the stream that's currently being read
   PVR_ERROR GetStreamProperties(std::vector<kodi::addon::PVRStreamProperties>& properties) override;
 
+  // GetStreamTimes
+  //
+  // Get stream times for the currently playing stream
+  PVR_ERROR GetStreamTimes(kodi::addon::PVRStreamTimes& times) override;
+
+  // GetTimers
+  //
+  // Request the list of all timers from the backend
+  PVR_ERROR GetTimers(kodi::addon::PVRTimersResultSet& results) override;
+
+  // GetTimersAmount
+  //
+  // Get the total amount of timers on the backend
+  PVR_ERROR GetTimersAmount(int& amount) override;
+
+  // GetTimerTypes
+  //
+  // Retrieve the timer types supported by the backend
+  PVR_ERROR GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& types) override;
+
   // GetConnectionString
   //
   // Gets the connection string reported by the backend
@@ -212,6 +280,11 @@ public:
   // Open a live stream on the backend
   bool OpenLiveStream(kodi::addon::PVRChannel const& channel) override;
 
+  // PauseStream
+  //
+  // Notify the pvr addon that Kodi (un)paused the currently playing stream
+  void PauseStream(bool paused) override;
+
   // ReadLiveStream
   //
   // Read from an open live stream
@@ -227,10 +300,72 @@ public:
   // Seek in a live stream on a backend that supports timeshifting
   int64_t SeekLiveStream(int64_t position, int whence) override;
 
+  // SeekTime
+  //
+  // Notify the pvr addon/demuxer that Kodi wishes to seek the stream by time
+  bool SeekTime(double time, bool backwards, double& startpts) override;
+
 private:
   addon(addon const&) = delete;
   addon& operator=(addon const&) = delete;
 
+  // DABSCAN_SAMPLE_RATE
+  //
+  // Fixed device sample rate required for a DAB band scan
+  static uint32_t const DABSCAN_SAMPLE_RATE;
+
+  // DABSCAN_SETTLE_TIME
+  //
+  // Time the multiplex data must be unchanged for a DAB band scan to move on
+  static std::chrono::milliseconds const DABSCAN_SETTLE_TIME;
+
+  // DABSCAN_SYNC_TIMEOUT
+  //
+  // Time a DAB band scan waits for an ensemble to be synchronised
+  static std::chrono::milliseconds const DABSCAN_SYNC_TIMEOUT;
+
+  // DABSCAN_TIMEOUT
+  //
+  // Maximum time a DAB band scan spends on a single ensemble
+  static std::chrono::milliseconds const DABSCAN_TIMEOUT;
+
+  // STREAMSTATS_INTERVAL
+  //
+  // Interval at which the stream performance counters are written to disk
+  static std::chrono::seconds const STREAMSTATS_INTERVAL;
+
+  //-------------------------------------------------------------------------
+  // Private Type Declarations
+
+  // perfcounters_t
+  //
+  // Defines the type of a shared PVR stream performance counters instance
+  using perfcounters_t = std::shared_ptr<perfcounters>;
+
+  // signalstatus_t
+  //
+  // Defines the type of a shared PVR stream signal status snapshot
+  using signalstatus_t = std::shared_ptr<pvrstream::signalstatus_t const>;
+
+  // recording_t
+  //
+  // Defines the state of an active recording
+  struct recording_t
+  {
+
+    unsigned int timerid = 0; // Timer identifier
+    unsigned int channelid = 0; // Recorded channel identifier
+    std::string channelname; // Recorded channel name
+    std::string title; // Recording title
+    time_t starttime = 0; // Recording start time
+    time_t endtime = 0; // Recording end time
+    std::shared_ptr<recordingsink> sink; // Recording sink instance
+    std::unique_ptr<pvrstream> stream; // Dedicated stream on another device
+    std::thread worker; // Dedicated stream worker thread
+    scalar_condition<bool> stop{false}; // Condition to stop the worker
+    std::atomic<bool> finished{false}; // Flag indicating the worker has stopped
+  };
+
   //-------------------------------------------------------------------------
   // Private Member Functions
 
@@ -248,7 +383,13 @@ private:
 
   // Device Helpers
   //
-  std::unique_ptr<rtldevice> create_device(struct settings const& settings) const;
+  std::unique_ptr<rtldevice> create_device(struct settings const& settings,
+                                           uint32_t frequency) const;
+  std::unique_ptr<pvrstream> create_stream(struct settings const& settings,
+                                           unsigned int channeluid,
+                                           struct channelprops const& channelprops);
+  bool device_available(struct settings const& settings) const;
+  std::vector<devicesession::candidate> device_candidates(struct settings const& settings) const;
 
   // Exception Helpers
   //
@@ -262,21 +403,35 @@ private:
   // Log Helpers
   //
   template<typename... _args>
-  void log_debug(_args&&... args) const;
+  static void log_debug(_args&&... args);
   template<typename... _args>
-  void log_error(_args&&... args) const;
+  static void log_error(_args&&... args);
   template<typename... _args>
-  void log_info(_args&&... args) const;
+  static void log_info(_args&&... args);
   template<typename... _args>
-  void log_message(ADDON_LOG level, _args&&... args) const;
+  static void log_message(ADDON_LOG level, _args&&... args);
   template<typename... _args>
-  void log_warning(_args&&... args) const;
+  static void log_warning(_args&&... args);
 
   // Menu Hook Helpers
   //
   void menuhook_clearchannels(void);
   void menuhook_exportchannels(void);
   void menuhook_importchannels(void);
+  void menuhook_showperformance(void);
+
+  // Performance Counter Helpers
+  //
+  void statsworker(void);
+  static std::string streamstats_to_json(struct perfcounterprops const& counters,
+                                         struct signalstatusprops const& status);
+
+  // Recording Helpers
+  //
+  std::unique_ptr<recording_t> detach_recording(void);
+  void finish_recording(std::unique_ptr<recording_t> recording);
+  void reap_recordings(void);
+  void recordworker(recording_t* recording);
 
   // Regional Helpers
   //
@@ -294,10 +449,24 @@ private:
   // Member Variables
 
   std::shared_ptr<connectionpool> m_connpool; // Database connection pool
+  std::map<uint32_t, std::weak_ptr<dabreceiver>> m_dabreceivers; // Shared DAB receivers
+  std::shared_ptr<devicesession> m_devicesession; // Tuner device session
+  std::map<uint32_t, std::weak_ptr<hdreceiver>> m_hdreceivers; // Shared HD Radio receivers
+  std::mutex m_receiver_lock; // Synchronization object
   std::unique_ptr<pvrstream> m_pvrstream; // Active PVR stream instance
   mutable std::mutex m_pvrstream_lock; // Synchronization object
+  unsigned int m_pvrchannelid = 0; // Active PVR stream channel identifier
+  std::string m_pvrchannelname; // Active PVR stream channel name
+  std::unique_ptr<recording_t> m_recording; // Active recording of the playing channel
+  std::vector<std::unique_ptr<recording_t>> m_recordings; // Active recordings on other devices
+  unsigned int m_nexttimerid = 1; // Next recording timer identifier
+  mutable std::mutex m_recordings_lock; // Synchronization object
+  signalstatus_t m_signalstatus; // Active PVR stream signal status
+  perfcounters_t m_perfcounters; // Active PVR stream performance counters
   struct settings m_settings; // Custom addon settings
   mutable std::recursive_mutex m_settings_lock; // Synchronization object
+  std::thread m_statsworker; // Performance counter writer thread
+  scalar_condition<bool> m_statsstop{false}; // Condition to stop the writer
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,1267 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "dabreceiver.h"
+
+#include "exception_control/string_exception.h"
+#include "utils/value_size_defines.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+
+#pragma warning(push, 4)
+
+// FUNCTION PROTOTYPES
+//
+static bool same_ensemble(std::vector<struct dabsubchannelprops> const& lhs,
+                          std::vector<struct dabsubchannelprops> const& rhs);
+static bool same_organisation(Subchannel const& lhs, Subchannel const& rhs);
+static Subchannel to_subchannel(struct dabsubchannelprops const& props);
+static struct dabsubchannelprops to_subchannelprops(Subchannel const& subchannel,
+                                                    uint32_t serviceid,
+                                                    bool dabplus);
+
+// dabreceiver::DEGRADE_NONE
+//
+// Full quality; TII decoding if subscribed and every FIC frame decoded
+int const dabreceiver::DEGRADE_NONE = 0;
+
+// dabreceiver::DEGRADE_NOTII
+//
+// TII decoding is paused even if there is a subscriber
+int const dabreceiver::DEGRADE_NOTII = 1;
+
+// dabreceiver::DEGRADE_SPARSEFIC
+//
+// Only every SPARSE_FIC_INTERVAL frames of FIC data are decoded
+int const dabreceiver::DEGRADE_SPARSEFIC = 2;
+
+// dabreceiver::ENSEMBLE_CHECK_INTERVAL
+//
+// Interval at which the ensemble organisation is checked for changes
+std::chrono::milliseconds const dabreceiver::ENSEMBLE_CHECK_INTERVAL = std::chrono::seconds(5);
+
+// dabreceiver::RING_BUFFER_SIZE
+//
+// Input ring buffer size
+size_t const dabreceiver::RING_BUFFER_SIZE = (4 MiB); // 1 second @ 2048000
+
+// dabreceiver::SAMPLE_RATE
+//
+// Fixed device sample rate required for DAB
+uint32_t const dabreceiver::SAMPLE_RATE = 2048000;
+
+// dabreceiver::SPARSE_FIC_INTERVAL
+//
+// Number of frames between FIC decodes at DEGRADE_SPARSEFIC
+int const dabreceiver::SPARSE_FIC_INTERVAL = 4; // ~400ms
+
+//---------------------------------------------------------------------------
+// dabreceiver Constructor (private)
+//
+// Arguments:
+//
+//	device			- RTL-SDR device instance
+//	tunerprops		- Tuner device properties
+//	channelprops	- Channel properties
+//	dabprops		- DAB digital signal processor properties
+//	ensemble		- Cached ensemble organisation
+//	ensemblecb		- Ensemble organisation change callback
+//	synccb			- OFDM synchronisation callback
+
+dabreceiver::dabreceiver(std::unique_ptr<rtldevice> device,
+                         struct tunerprops const& tunerprops,
+                         struct channelprops const& channelprops,
+                         struct dabprops const& dabprops,
+                         std::vector<struct dabsubchannelprops> const& ensemble,
+                         ensemblecallback const& ensemblecb,
+                         synccallback const& synccb)
+  : m_device(std::move(device)),
+    m_ringbuffer(RING_BUFFER_SIZE),
+    m_counters(std::make_shared<perfcounters>()),
+    m_iqfanout(iqfanout::create()),
+    m_frequency(channelprops.frequency),
+    m_ensemble(ensemble),
+    m_ensemblecb(ensemblecb),
+    m_syncprops(dabprops.syncprops),
+    m_synccb(synccb)
+{
+  // Initialize the RTL-SDR device instance
+  m_device->set_frequency_correction(tunerprops.freqcorrection + channelprops.freqcorrection);
+  m_device->set_sample_rate(SAMPLE_RATE);
+  m_device->set_center_frequency(channelprops.frequency);
+
+  // Adjust the device gain as specified by the channel properties
+  m_device->set_automatic_gain_control(channelprops.autogain);
+  if (channelprops.autogain == false)
+    m_device->set_gain(channelprops.manualgain);
+
+  // Construct and initialize the demodulator instance
+  RadioControllerInterface& controllerinterface = *static_cast<RadioControllerInterface*>(this);
+  InputInterface& inputinterface = *static_cast<InputInterface*>(this);
+  m_options.disableCoarseCorrector = !dabprops.coarse_corrector;
+  m_options.freqsyncMethod = static_cast<FreqsyncMethod>(dabprops.coarse_corrector_type);
+
+  // Seed the OFDM synchronisation with the offsets from a previous lock, if available
+  if (dabprops.warmstart)
+  {
+
+    m_options.fftPlacementMethod = static_cast<FFTPlacementMethod>(dabprops.syncprops.fftplacement);
+    m_options.warmStart = true;
+    m_options.initialCoarseCorrector = dabprops.syncprops.coarsecorrector;
+
+    // The fine corrector is a 16-bit value in the OFDM processor; clamp the stored value so a
+    // corrupt or out of range database entry can't wrap around into an unrelated offset
+    m_options.initialFineCorrector = static_cast<int16_t>(
+        std::clamp(dabprops.syncprops.finecorrector,
+                   static_cast<int>(std::numeric_limits<int16_t>::min()),
+                   static_cast<int>(std::numeric_limits<int16_t>::max())));
+  }
+
+  else
+  {
+
+    m_syncprops = {};
+    m_syncprops.fftplacement = static_cast<int>(m_options.fftPlacementMethod);
+  }
+
+  m_receiver = make_aligned<RadioReceiver>(controllerinterface, inputinterface, m_options, 1);
+
+  // Create the ensemble organisation thread; the FIC is walked and the ensemble
+  // reported from there rather than from the device read callback
+  m_ensembleworker = std::thread(&dabreceiver::ensembleworker, this);
+
+  // Create the worker thread
+  scalar_condition<bool> started{false};
+  m_worker = std::thread(&dabreceiver::worker, this, std::ref(started));
+  started.wait_until_equals(true);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver Destructor
+
+dabreceiver::~dabreceiver()
+{
+  close();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::addconsumer
+//
+// Adds a consumer for the specified ensemble subchannel
+//
+// Arguments:
+//
+//	subchannel		- DAB subchannel to decode
+//	handler			- Consumer programme handler
+
+void dabreceiver::addconsumer(uint32_t subchannel, ProgrammeHandlerInterface& handler)
+{
+  std::unique_lock<std::mutex> consumerslock(m_consumerslock);
+  std::unique_lock<std::mutex> lock(m_fanoutslock);
+
+  // Get or create the fanout handler for the subchannel and attach the consumer
+  std::unique_ptr<fanout_t>& fanout = m_fanouts[subchannel];
+  if (!fanout)
+    fanout = std::make_unique<fanout_t>();
+  fanout->add(handler);
+
+  // If the subchannel organisation is known from the cache, start decoding it
+  // immediately rather than waiting for the FIC to describe it; the organisation
+  // is validated against the FIC once it has been decoded
+  if (!fanout->decoding && m_receiver)
+  {
+
+    auto found = std::find_if(m_ensemble.begin(), m_ensemble.end(),
+                              [&](struct dabsubchannelprops const& item) -> bool
+                              { return item.number == subchannel; });
+
+    if (found != m_ensemble.end())
+    {
+
+      Subchannel cached = to_subchannel(*found);
+      if (m_receiver->addSubchannelToDecode(*fanout,
+                                            (found->dabplus) ? AudioServiceComponentType::DABPlus
+                                                             : AudioServiceComponentType::DAB,
+                                            {}, cached))
+      {
+
+        fanout->subchannel = cached;
+        fanout->decoding = true;
+      }
+    }
+  }
+
+  lock.unlock();
+
+  // If the FIC has already been decoded for another consumer the subchannel
+  // can be decoded immediately, otherwise this will happen on the ensemble thread
+  start_decoders();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::check_ensemble (private)
+//
+// Validates the decoders and reports changes to the ensemble organisation
+//
+// Arguments:
+//
+//	NONE
+
+void dabreceiver::check_ensemble(void)
+{
+  std::unique_lock<std::mutex> lock(m_fanoutslock);
+
+  if (!m_receiver || !m_ensemblecb)
+    return;
+
+  // Generate the current organisation of all audio subchannels in the ensemble
+  std::vector<struct dabsubchannelprops> detected;
+  for (auto const& service : m_receiver->getServiceList())
+  {
+    for (auto const& component : m_receiver->getComponents(service))
+    {
+
+      if (component.transportMode() != TransportMode::Audio)
+        continue;
+
+      AudioServiceComponentType type = component.audioType();
+      if ((type != AudioServiceComponentType::DAB) && (type != AudioServiceComponentType::DABPlus))
+        continue;
+
+      Subchannel subchannel = m_receiver->getSubchannel(component);
+      if (!subchannel.valid())
+        continue;
+
+      uint32_t number = static_cast<uint32_t>(subchannel.subChId);
+      if (std::none_of(detected.begin(), detected.end(),
+                       [&](struct dabsubchannelprops const& item) -> bool
+                       { return item.number == number; }))
+        detected.push_back(to_subchannelprops(subchannel, service.serviceId,
+                                              type == AudioServiceComponentType::DABPlus));
+    }
+  }
+
+  std::sort(detected.begin(), detected.end(),
+            [](struct dabsubchannelprops const& lhs, struct dabsubchannelprops const& rhs) -> bool
+            { return lhs.number < rhs.number; });
+
+  // The organisation is only reported once it has been stable across two checks, this
+  // prevents persisting a partial ensemble while the FIC is still being acquired
+  bool stable = (!detected.empty()) && same_ensemble(detected, m_detected);
+  m_detected = detected;
+
+  if (stable && !same_ensemble(detected, m_ensemble))
+  {
+
+    m_ensemble = std::move(detected);
+    std::vector<struct dabsubchannelprops> ensemble(m_ensemble);
+
+    lock.unlock();
+    m_ensemblecb(m_frequency, ensemble);
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::close
+//
+// Closes the receiver
+//
+// Arguments:
+//
+//	NONE
+
+void dabreceiver::close(void)
+{
+  m_stop = true; // Signal worker thread to stop
+  if (m_device)
+    m_device->cancel_async(); // Cancel any async read operations
+  if (m_worker.joinable())
+    m_worker.join(); // Wait for thread
+  m_iqfanout->close(); // Detach any I/Q sample consumers
+
+  std::unique_lock<std::mutex> ensemblelock(m_ensemblelock);
+  m_ensemblestop = true; // Signal ensemble thread to stop
+  ensemblelock.unlock();
+
+  m_ensemblecv.notify_all();
+  if (m_ensembleworker.joinable())
+    m_ensembleworker.join(); // Wait for thread
+
+  if (m_receiver)
+    m_receiver->stop(); // Stop receiver
+  m_receiver.reset(); // Reset receiver instance
+
+  m_fanouts.clear(); // Release all fanout handlers
+
+  // Report the OFDM synchronisation properties if they were established and have changed
+  if (m_device && m_synccb && m_syncvalid.exchange(false))
+  {
+
+    struct dabsyncprops syncprops = m_syncprops;
+    syncprops.coarsecorrector = m_coarsecorrector.load();
+    syncprops.finecorrector = m_finecorrector.load();
+
+    if ((syncprops.coarsecorrector != m_syncprops.coarsecorrector) ||
+        (syncprops.finecorrector != m_syncprops.finecorrector))
+      m_synccb(m_frequency, m_device->get_device_name(), syncprops);
+  }
+
+  m_device.reset(); // Release RTL-SDR device
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::counters
+//
+// Gets the device and DSP performance counters of the receiver
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<perfcounters> const& dabreceiver::counters(void) const
+{
+  return m_counters;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::create (static)
+//
+// Factory method, creates a new dabreceiver instance
+//
+// Arguments:
+//
+//	device			- RTL-SDR device instance
+//	tunerprops		- Tunder device properties
+//	channelprops	- Channel properties
+//	dabprops		- DAB digital signal processor properties
+
+std::shared_ptr<dabreceiver> dabreceiver::create(std::unique_ptr<rtldevice> device,
+                                                 struct tunerprops const& tunerprops,
+                                                 struct channelprops const& channelprops,
+                                                 struct dabprops const& dabprops)
+{
+  return create(std::move(device), tunerprops, channelprops, dabprops, {}, nullptr, nullptr);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::create (static)
+//
+// Factory method, creates a new dabreceiver instance
+//
+// Arguments:
+//
+//	device			- RTL-SDR device instance
+//	tunerprops		- Tunder device properties
+//	channelprops	- Channel properties
+//	dabprops		- DAB digital signal processor properties
+//	ensemble		- Cached ensemble organisation
+//	ensemblecb		- Ensemble organisation change callback
+//	synccb			- OFDM synchronisation callback
+
+std::shared_ptr<dabreceiver> dabreceiver::create(
+    std::unique_ptr<rtldevice> device,
+    struct tunerprops const& tunerprops,
+    struct channelprops const& channelprops,
+    struct dabprops const& dabprops,
+    std::vector<struct dabsubchannelprops> const& ensemble,
+    ensemblecallback const& ensemblecb,
+    synccallback const& synccb)
+{
+  return std::shared_ptr<dabreceiver>(new dabreceiver(std::move(device), tunerprops, channelprops,
+                                                      dabprops, ensemble, ensemblecb, synccb));
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::degrade (private)
+//
+// Applies a DSP degradation level to the receiver
+//
+// Arguments:
+//
+//	level		- DSP degradation level to apply
+
+void dabreceiver::degrade(int level)
+{
+  assert((level >= DEGRADE_NONE) && (level <= DEGRADE_SPARSEFIC));
+
+  // The TII decoder state is shared with settiicallback(), as are the options
+  std::unique_lock<std::mutex> lock(m_tiilock);
+
+  m_degradation = level;
+  m_options.decodeTII = (static_cast<bool>(m_tiicb) && (level < DEGRADE_NOTII));
+  m_options.ficDecodeInterval = (level >= DEGRADE_SPARSEFIC) ? SPARSE_FIC_INTERVAL : 1;
+  if (m_receiver)
+    m_receiver->setReceiverOptions(m_options);
+
+  m_counters->degradation(level);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::devicename
+//
+// Gets the device name associated with the receiver
+//
+// Arguments:
+//
+//	NONE
+
+std::string dabreceiver::devicename(void) const
+{
+  return std::string(m_device->get_device_name());
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::frequency
+//
+// Gets the ensemble frequency the receiver is tuned to
+//
+// Arguments:
+//
+//	NONE
+
+uint32_t dabreceiver::frequency(void) const
+{
+  return m_frequency;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& dabreceiver::iqsamples(void) const
+{
+  return m_iqfanout;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::removeconsumer
+//
+// Removes a consumer from the receiver
+//
+// Arguments:
+//
+//	handler			- Consumer programme handler
+
+void dabreceiver::removeconsumer(ProgrammeHandlerInterface& handler)
+{
+  std::vector<std::unique_ptr<fanout_t>> removed; // Fanouts with no remaining consumers
+
+  // Hold the consumer lock until the decoders have been removed so that a new consumer
+  // of the same subchannel can't be started and then immediately removed below
+  std::unique_lock<std::mutex> consumerslock(m_consumerslock);
+  std::unique_lock<std::mutex> lock(m_fanoutslock);
+
+  auto it = m_fanouts.begin();
+  while (it != m_fanouts.end())
+  {
+
+    // Detach the consumer, if the fanout has no remaining consumers take it out of the map
+    if (it->second->remove(handler) && it->second->empty())
+    {
+
+      removed.emplace_back(std::move(it->second));
+      it = m_fanouts.erase(it);
+    }
+
+    else
+      ++it;
+  }
+
+  lock.unlock();
+
+  // Stop decoding the removed subchannels; this joins the decoder thread so it must
+  // not be done while holding the fanout lock or the FIC and SNR callbacks will stall
+  for (auto const& fanout : removed)
+  {
+
+    if (fanout->decoding && m_receiver)
+      m_receiver->removeSubchannelToDecode(fanout->subchannel);
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::settiicallback
+//
+// Subscribes to or unsubscribes from TII measurements; the TII decoder only
+// runs while there is a subscriber
+//
+// Arguments:
+//
+//	callback		- TII measurement callback, or nullptr to unsubscribe
+
+void dabreceiver::settiicallback(tiicallback const& callback)
+{
+  std::unique_lock<std::mutex> lock(m_tiilock);
+
+  m_tiicb = callback;
+
+  bool decodetii = (static_cast<bool>(m_tiicb) && (m_degradation < DEGRADE_NOTII));
+  if ((decodetii != m_options.decodeTII) && m_receiver)
+  {
+
+    m_options.decodeTII = decodetii;
+    m_receiver->setReceiverOptions(m_options);
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::start_decoders (private)
+//
+// Starts or restarts decoding any consumed subchannels based on the FIC; the
+// caller is expected to hold the m_consumerslock mutex
+//
+// Arguments:
+//
+//	NONE
+
+void dabreceiver::start_decoders(void)
+{
+  // restart_t (local)
+  //
+  // Subchannel decoder to be (re)started with the organisation from the FIC
+  struct restart_t
+  {
+
+    fanout_t* fanout; // Subchannel fanout handler
+    bool decoding; // Flag if the previous organisation was being decoded
+    Subchannel previous; // Previous subchannel organisation
+    Subchannel subchannel; // Subchannel organisation from the FIC
+    AudioServiceComponentType type; // Subchannel audio type
+  };
+
+  std::vector<restart_t> restarts; // Decoders to be (re)started
+
+  std::unique_lock<std::mutex> lock(m_fanoutslock);
+
+  if (!m_receiver || m_fanouts.empty())
+    return;
+
+  // Determine if any of the desired subchannels are now present in the decoded services
+  for (auto const& service : m_receiver->getServiceList())
+  {
+    for (auto const& component : m_receiver->getComponents(service))
+    {
+
+      if (component.transportMode() != TransportMode::Audio)
+        continue;
+
+      auto found = m_fanouts.find(static_cast<uint32_t>(component.subchannelId));
+      if (found == m_fanouts.end())
+        continue;
+
+      fanout_t& fanout = *found->second;
+
+      // If the subchannel is already being decoded with the organisation described
+      // by the FIC there is nothing to do, this is the normal case
+      Subchannel subchannel = m_receiver->getSubchannel(component);
+      if (!subchannel.valid() || (fanout.decoding && same_organisation(fanout.subchannel, subchannel)))
+        continue;
+
+      // The subchannel may be referenced by more than one service component
+      if (std::any_of(restarts.begin(), restarts.end(),
+                      [&](restart_t const& item) -> bool { return item.fanout == &fanout; }))
+        continue;
+
+      // The cached organisation no longer matches the ensemble (or the subchannel is
+      // not being decoded yet); (re)start decoding with the organisation from the FIC
+      restarts.push_back({&fanout, fanout.decoding, fanout.subchannel, subchannel,
+                          component.audioType()});
+      fanout.decoding = false;
+    }
+  }
+
+  lock.unlock();
+
+  // Stop decoding the stale organisations; this joins the decoder threads so it must
+  // not be done while holding the fanout lock
+  for (auto const& restart : restarts)
+  {
+
+    if (restart.decoding)
+      m_receiver->removeSubchannelToDecode(restart.previous);
+  }
+
+  if (restarts.empty())
+    return;
+
+  // Start decoding with the organisation from the FIC; the fanouts can't have been
+  // removed in the meantime since the caller holds the consumer lock
+  lock.lock();
+  for (auto const& restart : restarts)
+  {
+
+    if (m_receiver->addSubchannelToDecode(*restart.fanout, restart.type, {}, restart.subchannel))
+    {
+
+      restart.fanout->subchannel = restart.subchannel;
+      restart.fanout->decoding = true;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::stopped
+//
+// Gets a flag indicating if the receiver has stopped
+//
+// Arguments:
+//
+//	NONE
+
+bool dabreceiver::stopped(void) const
+{
+  return m_stopped.load();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::worker (private)
+//
+// Worker thread procedure used to transfer and process data
+//
+// Arguments:
+//
+//	started		- Condition variable to set when thread has started
+
+void dabreceiver::worker(scalar_condition<bool>& started)
+{
+  assert(m_device);
+  assert(m_receiver);
+
+  // DSP degradation controller, driven by the occupancy of the ring buffer
+  loadcontroller controller(DEGRADE_SPARSEFIC);
+
+  // read_callback_func (local)
+  //
+  // Asynchronous read callback function for the RTL-SDR device
+  auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
+  {
+    // Hand the raw samples to any other consumers attached to the device first
+    m_iqfanout->write(buffer, count);
+
+    // Trigger an InputFailure event if no data has been returned from the device
+    if (count == 0)
+      m_streamok.store(false);
+
+    // Copy the input data into the ring buffer; if the demodulator has fallen
+    // behind whatever part of the transfer doesn't fit will be discarded
+    assert(count <= std::numeric_limits<int32_t>::max());
+    if (static_cast<size_t>(m_ringbuffer.GetRingBufferWriteAvailable()) < count)
+      m_counters->buffersdropped(1);
+    m_ringbuffer.putDataIntoBuffer(buffer, static_cast<int32_t>(count));
+
+    // Track the depth of the ring buffer in units of device transfers
+    size_t const available = static_cast<size_t>(m_ringbuffer.GetRingBufferReadAvailable());
+    if (count > 0)
+      m_counters->bufferreceived(available / count);
+
+    // Shed or restore optional DSP work based on how far behind the OFDM processor is
+    int const level = controller.update(available, RING_BUFFER_SIZE);
+    if (level != m_degradation)
+      degrade(level);
+
+    // Check for and process any new events
+    std::unique_lock<std::mutex> eventslock(m_eventslock);
+    if (m_events.empty() == false)
+    {
+
+      // The threading model is a bit weird here; the callback that queued a new
+      // event needs to be free to continue execution otherwise the DSP may deadlock
+      // while we process that event. Combat this by swapping the queue<> with a new
+      // one, release the lock, then go ahead and process each of the queued events
+
+      event_queue_t events; // Empty event queue<>
+      m_events.swap(events); // Swap with existing queue<>
+      eventslock.unlock(); // Release the queue<> lock
+
+      while (!events.empty())
+      {
+
+        eventid_t eventid = events.front(); // eventid_t
+        events.pop(); // Remove from queue<>
+
+        switch (eventid)
+        {
+
+          // InputFailure
+          //
+          // Something has gone wrong with the input stream
+          case eventid_t::InputFailure:
+
+            throw string_exception("Input Failure"); // TODO: message
+            break;
+        }
+      }
+    }
+  };
+
+  // Begin streaming from the device via the receiver and inform the caller that the thread is running
+  m_receiver->restart(false);
+  started = true;
+
+  // Continuously read data from the device until cancel_async() has been called
+  // 40 KiB = ~1/100 of a second of data
+  try
+  {
+    m_device->read_async(read_callback_func, 40 KiB);
+  }
+  catch (...)
+  {
+    m_worker_exception = std::current_exception();
+  }
+
+  m_stopped.store(true); // Worker thread is now stopped
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::worker_exception
+//
+// Gets the exception that caused the worker thread to stop, if any
+//
+// Arguments:
+//
+//	NONE
+
+std::exception_ptr dabreceiver::worker_exception(void) const
+{
+  return (m_stopped.load()) ? m_worker_exception : nullptr;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::ensembleworker (private)
+//
+// Worker thread procedure used to validate and report the ensemble organisation
+//
+// Arguments:
+//
+//	NONE
+
+void dabreceiver::ensembleworker(void)
+{
+  // Ensemble organisation check time point
+  auto nextcheck = std::chrono::steady_clock::now() + ENSEMBLE_CHECK_INTERVAL;
+
+  std::unique_lock<std::mutex> lock(m_ensemblelock);
+
+  while (true)
+  {
+
+    m_ensemblecv.wait_until(lock, nextcheck,
+                            [&]() -> bool { return m_ensemblestop || m_servicedetected; });
+    if (m_ensemblestop)
+      break;
+
+    m_servicedetected = false;
+    lock.unlock();
+
+    auto now = std::chrono::steady_clock::now();
+    bool const check = (now >= nextcheck);
+
+    try
+    {
+      // Validate the organisation of the subchannels being decoded against the FIC;
+      // this is serialized with adding and removing consumers
+      std::unique_lock<std::mutex> consumerslock(m_consumerslock);
+      start_decoders();
+      consumerslock.unlock();
+
+      // Periodically report the ensemble organisation
+      if (check)
+        check_ensemble();
+    }
+    catch (...)
+    {
+      // The ensemble check is advisory; the next one will try again
+    }
+
+    if (check)
+      nextcheck = now + ENSEMBLE_CHECK_INTERVAL;
+
+    lock.lock();
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::getSamples (InputInterface)
+//
+// Reads the specified number of samples from the input device
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the input samples
+//	size		- Number of samples to read
+
+int32_t dabreceiver::getSamples(DSPCOMPLEX* buffer, int32_t size)
+{
+  int32_t numsamples = 0; // Number of available samples in the buffer
+
+  // Allocate a temporary buffer to pull the data out of the ring buffer
+  std::unique_ptr<uint8_t[]> tempbuffer(new uint8_t[size * 2]);
+
+  // Get the data from the ring buffer
+  numsamples = m_ringbuffer.getDataFromBuffer(tempbuffer.get(), size * 2);
+
+  // Scale the input data from [0,255] to [-1,1] for the demodulator
+  for (int32_t index = 0; index < numsamples / 2; index++)
+  {
+
+    buffer[index] =
+        DSPCOMPLEX((static_cast<float>(tempbuffer[index * 2]) - 128.0f) / 128.0f, // real
+                   (static_cast<float>(tempbuffer[(index * 2) + 1]) - 128.0f) / 128.0f // imaginary
+        );
+  }
+
+  return numsamples / 2;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::getSamplesToRead (InputInterface)
+//
+// Gets the number of input samples that are available to read from input
+//
+// Arguments:
+//
+//	NONE
+
+int32_t dabreceiver::getSamplesToRead(void)
+{
+  return m_ringbuffer.GetRingBufferReadAvailable() / 2;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::is_ok (InputInterface)
+//
+// Determines if the input is still "OK"
+//
+// Arguments:
+//
+//	NONE
+
+bool dabreceiver::is_ok(void)
+{
+  return m_streamok.load();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::restart (InputInterface)
+//
+// Restarts the input
+//
+// Arguments:
+//
+//	NONE
+
+bool dabreceiver::restart(void)
+{
+  assert(m_device);
+
+  m_streamok.store(true);
+  m_device->begin_stream();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onFIBDecodeSuccess (RadioControllerInterface)
+//
+// Invoked when a FIB has been decoded
+//
+// Arguments:
+//
+//	crcCheckOk	- Flag if the FIB passed the CRC check
+//	fib			- Pointer to the FIB data
+
+void dabreceiver::onFIBDecodeSuccess(bool crcCheckOk, uint8_t const* /*fib*/)
+{
+  m_ficok.store(crcCheckOk);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onFrequencyCorrectorChange (RadioControllerInterface)
+//
+// Invoked when the OFDM frequency correctors have been updated
+//
+// Arguments:
+//
+//	fine		- Fine frequency corrector
+//	coarse		- Coarse frequency corrector
+
+void dabreceiver::onFrequencyCorrectorChange(int fine, int coarse)
+{
+  // Only retain the correctors while synchronised and decoding the FIC,
+  // otherwise they may be the intermediate results of a coarse search
+  if (m_synced.load() && m_ficok.load())
+  {
+
+    m_coarsecorrector.store(coarse);
+    m_finecorrector.store(fine);
+    m_syncvalid.store(true);
+  }
+}
+
+// dabreceiver::onInputFailure (RadioControllerInterface)
+//
+// Invoked when the receiver has shut down to an input failure
+//
+// Arguments:
+//
+//	NONE
+
+void dabreceiver::onInputFailure(void)
+{
+  std::unique_lock<std::mutex> lock(m_eventslock);
+  m_events.emplace(eventid_t::InputFailure);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onServiceDetected (RadioControllerInterface)
+//
+// Invoked when a new service was detected
+//
+// Arguments:
+//
+//	sId			- New service identifier
+
+void dabreceiver::onServiceDetected(uint32_t /*sId*/)
+{
+  // Any decoders waiting for the service are started on the ensemble thread
+  std::unique_lock<std::mutex> lock(m_ensemblelock);
+  m_servicedetected = true;
+  lock.unlock();
+
+  m_ensemblecv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onSNR (RadioControllerInterface)
+//
+// Invoked when the OFDM signal-to-noise ratio has been calculated
+//
+// Arguments:
+//
+//	snr			- Signal-to-noise ratio in dB
+
+void dabreceiver::onSNR(float snr)
+{
+  // The signal-to-noise ratio applies to the entire ensemble, forward it to
+  // the consumers of every subchannel
+  std::unique_lock<std::mutex> lock(m_fanoutslock);
+  for (auto const& fanout : m_fanouts)
+    fanout.second->onSNR(snr);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onSyncChange (RadioControllerInterface)
+//
+// Invoked when the OFDM synchronisation state has changed
+//
+// Arguments:
+//
+//	isSync		- Flag if OFDM is synchronised
+
+void dabreceiver::onSyncChange(bool isSync)
+{
+  m_synced.store(isSync);
+
+  // The SNR isn't calculated without synchronisation, report it as zero
+  // rather than leaving the consumers with the last calculated value
+  if (!isSync)
+    onSNR(0.0f);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::onTIIMeasurement (RadioControllerInterface)
+//
+// Invoked when a TII measurement is available
+//
+// Arguments:
+//
+//	m			- TII measurement
+
+void dabreceiver::onTIIMeasurement(tii_measurement_t&& m)
+{
+  std::unique_lock<std::mutex> lock(m_tiilock);
+  if (m_tiicb)
+    m_tiicb(m);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::add
+//
+// Adds a consumer programme handler to the fanout
+//
+// Arguments:
+//
+//	handler		- Consumer programme handler
+
+void dabreceiver::fanout_t::add(ProgrammeHandlerInterface& handler)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_handlers.push_back(&handler);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::empty
+//
+// Determines if the fanout has no remaining consumers
+//
+// Arguments:
+//
+//	NONE
+
+bool dabreceiver::fanout_t::empty(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return m_handlers.empty();
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::remove
+//
+// Removes a consumer programme handler from the fanout
+//
+// Arguments:
+//
+//	handler		- Consumer programme handler
+
+bool dabreceiver::fanout_t::remove(ProgrammeHandlerInterface& handler)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  auto it = std::find(m_handlers.begin(), m_handlers.end(), &handler);
+  if (it == m_handlers.end())
+    return false;
+
+  m_handlers.erase(it);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::onNewAudio (ProgrammeHandlerInterface)
+//
+// Invoked when a new packet of audio data has been decoded
+//
+// Arguments:
+//
+//	audioData		- vector<> of stereo PCM audio data
+//	sampleRate		- Sample rate of the audio data (subject to change)
+//	mode			- Information about the audio encoding
+
+void dabreceiver::fanout_t::onNewAudio(std::vector<int16_t>&& audioData,
+                                       int sampleRate,
+                                       std::string const& mode)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // The decoded audio is only copied when there is more than one consumer,
+  // the last consumer always receives the original vector<>
+  for (size_t index = 0; index < m_handlers.size(); index++)
+  {
+
+    if (index == m_handlers.size() - 1)
+      m_handlers[index]->onNewAudio(std::move(audioData), sampleRate, mode);
+    else
+      m_handlers[index]->onNewAudio(std::vector<int16_t>(audioData), sampleRate, mode);
+  }
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::onNewDynamicLabel (ProgrammeHandlerInterface)
+//
+// Invoked when a new dynamic label has been decoded
+//
+// Arguments:
+//
+//	label		- The new dynamic label (UTF-8)
+
+void dabreceiver::fanout_t::onNewDynamicLabel(std::string const& label)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  for (auto const& handler : m_handlers)
+    handler->onNewDynamicLabel(label);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::onMOT (ProgrammeHandlerInterface)
+//
+// Invoked when a new slide has been decoded
+//
+// Arguments:
+//
+//	mot_file		- The new slide data
+
+void dabreceiver::fanout_t::onMOT(mot_file_t const& mot_file)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  for (auto const& handler : m_handlers)
+    handler->onMOT(mot_file);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::onSNR (ProgrammeHandlerInterface)
+//
+// Invoked when the OFDM signal-to-noise ratio has been calculated
+//
+// Arguments:
+//
+//	snr			- Signal-to-noise ratio in dB
+
+void dabreceiver::fanout_t::onSNR(float snr)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  for (auto const& handler : m_handlers)
+    handler->onSNR(snr);
+}
+
+//---------------------------------------------------------------------------
+// dabreceiver::fanout_t::onUntouchedStream (ProgrammeHandlerInterface)
+//
+// Invoked when a frame of the undecoded audio stream is available
+//
+// Arguments:
+//
+//	data		- Frame data
+//	len			- Length of the frame data
+//	durationMs	- Duration of the frame in milliseconds
+//	extension	- File extension suited to the stream
+
+void dabreceiver::fanout_t::onUntouchedStream(uint8_t const* data,
+                                              size_t len,
+                                              size_t durationMs,
+                                              std::string const& extension)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  for (auto const& handler : m_handlers)
+    handler->onUntouchedStream(data, len, durationMs, extension);
+}
+
+//---------------------------------------------------------------------------
+// same_ensemble (local)
+//
+// Determines if two cached ensemble organisations are the same
+//
+// Arguments:
+//
+//	lhs		- Left-hand ensemble organisation
+//	rhs		- Right-hand ensemble organisation
+
+static bool same_ensemble(std::vector<struct dabsubchannelprops> const& lhs,
+                          std::vector<struct dabsubchannelprops> const& rhs)
+{
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                    [](struct dabsubchannelprops const& left,
+                       struct dabsubchannelprops const& right) -> bool
+                    {
+                      return (left.number == right.number) &&
+                             (left.serviceid == right.serviceid) &&
+                             (left.dabplus == right.dabplus) &&
+                             same_organisation(to_subchannel(left), to_subchannel(right));
+                    });
+}
+
+//---------------------------------------------------------------------------
+// same_organisation (local)
+//
+// Determines if two subchannels share the same multiplex organisation
+//
+// Arguments:
+//
+//	lhs		- Left-hand subchannel
+//	rhs		- Right-hand subchannel
+
+static bool same_organisation(Subchannel const& lhs, Subchannel const& rhs)
+{
+  return (lhs.subChId == rhs.subChId) && (lhs.startAddr == rhs.startAddr) &&
+         (lhs.length == rhs.length) &&
+         (lhs.protectionSettings.shortForm == rhs.protectionSettings.shortForm) &&
+         (lhs.protectionSettings.uepTableIndex == rhs.protectionSettings.uepTableIndex) &&
+         (lhs.protectionSettings.uepLevel == rhs.protectionSettings.uepLevel) &&
+         (lhs.protectionSettings.eepProfile == rhs.protectionSettings.eepProfile) &&
+         (lhs.protectionSettings.eepLevel == rhs.protectionSettings.eepLevel);
+}
+
+//---------------------------------------------------------------------------
+// to_subchannel (local)
+//
+// Converts a dabsubchannelprops structure into a Subchannel
+//
+// Arguments:
+//
+//	props		- Cached subchannel properties
+
+static Subchannel to_subchannel(struct dabsubchannelprops const& props)
+{
+  Subchannel subchannel;
+
+  subchannel.subChId = static_cast<int32_t>(props.number);
+  subchannel.startAddr = props.startaddress;
+  subchannel.length = props.length;
+  subchannel.programmeNotData = true;
+  subchannel.protectionSettings.shortForm = props.shortform;
+  subchannel.protectionSettings.uepTableIndex = static_cast<int16_t>(props.ueptableindex);
+  subchannel.protectionSettings.uepLevel = static_cast<int16_t>(props.ueplevel);
+  subchannel.protectionSettings.eepProfile = static_cast<EEPProtectionProfile>(props.eepprofile);
+  subchannel.protectionSettings.eepLevel = static_cast<EEPProtectionLevel>(props.eeplevel);
+
+  return subchannel;
+}
+
+//---------------------------------------------------------------------------
+// to_subchannelprops (local)
+//
+// Converts a Subchannel into a dabsubchannelprops structure
+//
+// Arguments:
+//
+//	subchannel	- Subchannel organisation
+//	serviceid	- Owning service identifier
+//	dabplus		- Flag if the subchannel is DAB+
+
+static struct dabsubchannelprops to_subchannelprops(Subchannel const& subchannel,
+                                                    uint32_t serviceid,
+                                                    bool dabplus)
+{
+  struct dabsubchannelprops props = {};
+
+  props.number = static_cast<uint32_t>(subchannel.subChId);
+  props.serviceid = serviceid;
+  props.dabplus = dabplus;
+  props.startaddress = subchannel.startAddr;
+  props.length = subchannel.length;
+  props.shortform = subchannel.protectionSettings.shortForm;
+  props.ueptableindex = subchannel.protectionSettings.uepTableIndex;
+  props.ueplevel = subchannel.protectionSettings.uepLevel;
+  props.eepprofile = static_cast<int>(subchannel.protectionSettings.eepProfile);
+  props.eeplevel = static_cast<int>(subchannel.protectionSettings.eepLevel);
+
+  return props;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,405 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __DABRECEIVER_H_
+#define __DABRECEIVER_H_
+#pragma once
+
+#include "dsp_dab/radio-receiver.h"
+#include "dsp_dab/ringbuffer.h"
+#include "iqfanout.h"
+#include "loadcontroller.h"
+#include "perfcounters.h"
+#include "props.h"
+#include "rtldevice.h"
+#include "utils/scalar_condition.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class dabreceiver
+//
+// Implements a DAB ensemble receiver that can be shared among multiple consumers;
+// the device, OFDM demodulator and FIC decoder are shared by all consumers while
+// each subchannel is MSC/audio decoded only once regardless of the consumer count
+
+class dabreceiver : private InputInterface, private RadioControllerInterface
+{
+public:
+  // Destructor
+  //
+  virtual ~dabreceiver();
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // ensemblecallback
+  //
+  // Callback function invoked when the ensemble organisation has been detected or has changed
+  using ensemblecallback = std::function<void(
+      uint32_t frequency, std::vector<struct dabsubchannelprops> const& subchannels)>;
+
+  // synccallback
+  //
+  // Callback function invoked on close with the OFDM synchronisation properties
+  using synccallback = std::function<void(
+      uint32_t frequency, char const* device, struct dabsyncprops const& syncprops)>;
+
+  // tiicallback
+  //
+  // Callback function invoked when a TII measurement is available
+  using tiicallback = std::function<void(tii_measurement_t const& measurement)>;
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // addconsumer
+  //
+  // Adds a consumer for the specified ensemble subchannel
+  void addconsumer(uint32_t subchannel, ProgrammeHandlerInterface& handler);
+
+  // close
+  //
+  // Closes the receiver
+  void close(void);
+
+  // counters
+  //
+  // Gets the device and DSP performance counters of the receiver
+  std::shared_ptr<perfcounters> const& counters(void) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new dabreceiver instance
+  static std::shared_ptr<dabreceiver> create(std::unique_ptr<rtldevice> device,
+                                             struct tunerprops const& tunerprops,
+                                             struct channelprops const& channelprops,
+                                             struct dabprops const& dabprops);
+  static std::shared_ptr<dabreceiver> create(
+      std::unique_ptr<rtldevice> device,
+      struct tunerprops const& tunerprops,
+      struct channelprops const& channelprops,
+      struct dabprops const& dabprops,
+      std::vector<struct dabsubchannelprops> const& ensemble,
+      ensemblecallback const& ensemblecb,
+      synccallback const& synccb);
+
+  // devicename
+  //
+  // Gets the device name associated with the receiver
+  std::string devicename(void) const;
+
+  // frequency
+  //
+  // Gets the ensemble frequency the receiver is tuned to
+  uint32_t frequency(void) const;
+
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const;
+
+  // removeconsumer
+  //
+  // Removes a consumer from the receiver
+  void removeconsumer(ProgrammeHandlerInterface& handler);
+
+  // settiicallback
+  //
+  // Subscribes to or unsubscribes from TII measurements
+  void settiicallback(tiicallback const& callback);
+
+  // stopped
+  //
+  // Gets a flag indicating if the receiver has stopped
+  bool stopped(void) const;
+
+  // worker_exception
+  //
+  // Gets the exception that caused the worker thread to stop, if any
+  std::exception_ptr worker_exception(void) const;
+
+private:
+  dabreceiver(dabreceiver const&) = delete;
+  dabreceiver& operator=(dabreceiver const&) = delete;
+
+  // DEGRADE_XXXXXX
+  //
+  // DSP degradation levels; each level also applies the ones below it
+  static int const DEGRADE_NONE;
+  static int const DEGRADE_NOTII;
+  static int const DEGRADE_SPARSEFIC;
+
+  // ENSEMBLE_CHECK_INTERVAL
+  //
+  // Interval at which the ensemble organisation is checked for changes
+  static std::chrono::milliseconds const ENSEMBLE_CHECK_INTERVAL;
+
+  // SPARSE_FIC_INTERVAL
+  //
+  // Number of frames between FIC decodes at DEGRADE_SPARSEFIC
+  static int const SPARSE_FIC_INTERVAL;
+
+  // RING_BUFFER_SIZE
+  //
+  // Input ring buffer size
+  static size_t const RING_BUFFER_SIZE;
+
+  // SAMPLE_RATE
+  //
+  // Fixed device sample rate required for DAB
+  static uint32_t const SAMPLE_RATE;
+
+  // Instance Constructor
+  //
+  dabreceiver(std::unique_ptr<rtldevice> device,
+              struct tunerprops const& tunerprops,
+              struct channelprops const& channelprops,
+              struct dabprops const& dabprops,
+              std::vector<struct dabsubchannelprops> const& ensemble,
+              ensemblecallback const& ensemblecb,
+              synccallback const& synccb);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // eventid_t
+  //
+  // Defines a worker thread event identifier
+  enum class eventid_t
+  {
+
+    InputFailure, // An input failure has occurred
+  };
+
+  // event_queue_t
+  //
+  // Defines the type of the worker thread event queue
+  using event_queue_t = std::queue<eventid_t>;
+
+  // fanout_t
+  //
+  // Programme handler that distributes the decoded subchannel data to each consumer
+  class fanout_t : public ProgrammeHandlerInterface
+  {
+  public:
+    // Member Functions
+    //
+    void add(ProgrammeHandlerInterface& handler);
+    bool empty(void) const;
+    bool remove(ProgrammeHandlerInterface& handler);
+
+    // ProgrammeHandlerInterface
+    //
+    void onNewAudio(std::vector<int16_t>&& audioData,
+                    int sampleRate,
+                    const std::string& mode) override;
+    void onNewDynamicLabel(const std::string& label) override;
+    void onMOT(const mot_file_t& mot_file) override;
+    void onSNR(float snr) override;
+    void onUntouchedStream(uint8_t const* data,
+                           size_t len,
+                           size_t durationMs,
+                           std::string const& extension) override;
+
+    // Member Variables
+    //
+    bool decoding = false; // Flag if the subchannel is being decoded
+    Subchannel subchannel; // Organisation of the subchannel being decoded
+
+  private:
+    std::vector<ProgrammeHandlerInterface*> m_handlers; // Consumer handlers
+    mutable std::mutex m_lock; // Synchronization object
+  };
+
+  // fanout_map_t
+  //
+  // Defines the type of the subchannel fanout map
+  using fanout_map_t = std::map<uint32_t, std::unique_ptr<fanout_t>>;
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // check_ensemble
+  //
+  // Validates the decoders and reports changes to the ensemble organisation
+  void check_ensemble(void);
+
+  // degrade
+  //
+  // Applies a DSP degradation level to the receiver
+  void degrade(int level);
+
+  // ensembleworker
+  //
+  // Worker thread procedure used to validate and report the ensemble organisation
+  void ensembleworker(void);
+
+  // start_decoders
+  //
+  // Starts or restarts decoding any consumed subchannels based on the FIC
+  void start_decoders(void);
+
+  // worker
+  //
+  // Worker thread procedure used to transfer and process data
+  void worker(scalar_condition<bool>& started);
+
+  //-----------------------------------------------------------------------
+  // InputInterface Implementation
+
+  // getSamples
+  //
+  // Reads the specified number of samples from the input device
+  int32_t getSamples(DSPCOMPLEX* buffer, int32_t size) override;
+
+  // getSamplesToRead
+  //
+  // Gets the number of input samples that are available to read from input
+  int32_t getSamplesToRead(void) override;
+
+  // is_ok
+  //
+  // Determines if the input is still "OK"
+  bool is_ok(void) override;
+
+  // restart
+  //
+  // Restarts the input
+  bool restart(void) override;
+
+  //-----------------------------------------------------------------------
+  // RadioControllerInterface
+
+  // onFIBDecodeSuccess
+  //
+  // Invoked when a FIB has been decoded
+  void onFIBDecodeSuccess(bool crcCheckOk, uint8_t const* fib) override;
+
+  // onFrequencyCorrectorChange
+  //
+  // Invoked when the OFDM frequency correctors have been updated
+  void onFrequencyCorrectorChange(int fine, int coarse) override;
+
+  // onInputFailure
+  //
+  // Invoked when the receiver has shut down to an input failure
+  void onInputFailure(void) override;
+
+  // onServiceDetected
+  //
+  // Invoked when a new service was detected
+  void onServiceDetected(uint32_t sId) override;
+
+  // onSNR
+  //
+  // Invoked when the OFDM signal-to-noise ratio has been calculated
+  void onSNR(float snr) override;
+
+  // onSyncChange
+  //
+  // Invoked when the OFDM synchronisation state has changed
+  void onSyncChange(bool isSync) override;
+
+  // onTIIMeasurement
+  //
+  // Invoked when a TII measurement is available
+  void onTIIMeasurement(tii_measurement_t&& m) override;
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::unique_ptr<rtldevice> m_device; // RTL-SDR device instance
+  aligned_ptr<RadioReceiver> m_receiver; // RadioReceiver instance
+  RadioReceiverOptions m_options; // RadioReceiver options
+  RingBuffer<uint8_t> m_ringbuffer; // I/Q sample ring buffer
+  std::shared_ptr<perfcounters> const m_counters; // Performance counters
+  std::shared_ptr<iqfanout> const m_iqfanout; // I/Q sample fan-out
+  uint32_t const m_frequency; // Ensemble frequency
+  std::atomic<bool> m_streamok{true}; // "OK" flag for the stream
+
+  // CONSUMERS
+  //
+  fanout_map_t m_fanouts; // Subchannel fanout handlers
+  mutable std::mutex m_fanoutslock; // Synchronization object
+  std::mutex m_consumerslock; // Serializes adding and removing consumers
+
+  // ENSEMBLE ORGANISATION
+  //
+  std::vector<struct dabsubchannelprops> m_ensemble; // Known ensemble organisation
+  std::vector<struct dabsubchannelprops> m_detected; // Last detected organisation
+  ensemblecallback const m_ensemblecb; // Ensemble organisation callback
+
+  // OFDM SYNCHRONISATION
+  //
+  struct dabsyncprops m_syncprops; // Initial synchronisation properties
+  std::atomic<bool> m_synced{false}; // Flag if OFDM is synchronised
+  std::atomic<bool> m_ficok{false}; // Flag if the last FIB passed CRC
+  std::atomic<bool> m_syncvalid{false}; // Flag if the correctors are valid
+  std::atomic<int> m_coarsecorrector{0}; // Last valid coarse corrector
+  std::atomic<int> m_finecorrector{0}; // Last valid fine corrector
+  synccallback const m_synccb; // Synchronisation callback
+
+  // TII MEASUREMENT
+  //
+  tiicallback m_tiicb; // TII measurement callback
+  mutable std::mutex m_tiilock; // Synchronization object
+
+  // DSP DEGRADATION (protected by m_tiilock)
+  //
+  int m_degradation = 0; // Applied DSP degradation level
+
+  // WORKER THREAD
+  //
+  std::thread m_worker; // Data transfer thread
+  std::exception_ptr m_worker_exception; // Exception on worker thread
+  scalar_condition<bool> m_stop{false}; // Condition to stop data transfer
+  std::atomic<bool> m_stopped{false}; // Data transfer stopped flag
+  event_queue_t m_events; // queue<> of worker events
+  mutable std::mutex m_eventslock; // Synchronization object
+
+  // ENSEMBLE WORKER
+  //
+  std::thread m_ensembleworker; // Ensemble organisation thread
+  bool m_servicedetected = false; // Flag if a new service has been detected
+  bool m_ensemblestop = false; // Flag to stop the ensemble thread
+  mutable std::mutex m_ensemblelock; // Synchronization object
+  std::condition_variable m_ensemblecv; // Ensemble event condvar
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __DABRECEIVER_H_
@@ -22,11 +22,14 @@
 
 #include "dabstream.h"
 
-#include "exception_control/string_exception.h"
-#include "utils/value_size_defines.h"
+#include <algorithm>
 
 #pragma warning(push, 4)
 
+// FUNCTION PROTOTYPES
+//
+static void scale_pcm(int16_t* dest, int16_t const* source, size_t count, float gain);
+
 // dabstream::DEFAULT_AUDIO_RATE
 //
 // The default audio output sample rate
@@ -37,16 +40,6 @@ int const dabstream::DEFAULT_AUDIO_RATE = 48000;
 // Maximum number of queued demux packets
 size_t const dabstream::MAX_PACKET_QUEUE = 200; // ~5 seconds @ 24ms; 12 seconds @ 60ms
 
-// dabstream::RING_BUFFER_SIZE
-//
-// Input ring buffer size
-size_t const dabstream::RING_BUFFER_SIZE = (4 MiB); // 1 second @ 2048000
-
-// dabstream::SAMPLE_RATE
-//
-// Fixed device sample rate required for DAB
-uint32_t const dabstream::SAMPLE_RATE = 2048000;
-
 // dabstream::STREAM_ID_AUDIOBASE
 //
 // Base stream identifier for the audio output stream
@@ -62,44 +55,38 @@ int const dabstream::STREAM_ID_ID3TAG = 0;
 //
 // Arguments:
 //
-//	device			- RTL-SDR device instance
-//	tunerprops		- Tuner device properties
-//	channelprops	- Channel properties
+//	receiver		- Shared DAB receiver instance
 //	dabprops		- DAB digital signal processor properties
 //	subchannel		- DAB subchannel to decode/stream
 
-dabstream::dabstream(std::unique_ptr<rtldevice> device,
-                     struct tunerprops const& tunerprops,
-                     struct channelprops const& channelprops,
+dabstream::dabstream(std::shared_ptr<dabreceiver> receiver,
                      struct dabprops const& dabprops,
                      uint32_t subchannel)
-  : m_device(std::move(device)),
-    m_ringbuffer(RING_BUFFER_SIZE),
+  : pvrstream(receiver->counters()),
+    m_receiver(std::move(receiver)),
     m_subchannel((subchannel > 0) ? subchannel : 1),
-    m_pcmgain(powf(10.0f, dabprops.outputgain / 10.0f))
+    m_pcmgain(powf(10.0f, dabprops.outputgain / 10.0f)),
+    m_tii(dabprops.tii),
+    m_resampler(new CFractResampler())
 {
-  // Initialize the RTL-SDR device instance
-  m_device->set_frequency_correction(tunerprops.freqcorrection + channelprops.freqcorrection);
-  m_device->set_sample_rate(SAMPLE_RATE);
-  m_device->set_center_frequency(channelprops.frequency);
-
-  // Adjust the device gain as specified by the channel properties
-  m_device->set_automatic_gain_control(channelprops.autogain);
-  if (channelprops.autogain == false)
-    m_device->set_gain(channelprops.manualgain);
-
-  // Construct and initialize the demodulator instance
-  RadioControllerInterface& controllerinterface = *static_cast<RadioControllerInterface*>(this);
-  InputInterface& inputinterface = *static_cast<InputInterface*>(this);
-  RadioReceiverOptions options = {};
-  options.disableCoarseCorrector = !dabprops.coarse_corrector;
-  options.freqsyncMethod = static_cast<FreqsyncMethod>(dabprops.coarse_corrector_type);
-  m_receiver = make_aligned<RadioReceiver>(controllerinterface, inputinterface, options, 1);
-
-  // Create the worker thread
-  scalar_condition<bool> started{false};
-  m_worker = std::thread(&dabstream::worker, this, std::ref(started));
-  started.wait_until_equals(true);
+  // Publish the initial signal status before attaching to the receiver
+  publishstatus();
+
+  // Attach to the receiver as a consumer of the desired subchannel
+  m_receiver->addconsumer(m_subchannel, *static_cast<ProgrammeHandlerInterface*>(this));
+
+  // Subscribe to the TII measurements if transmitter identification was requested, the
+  // most recently identified transmitter is reported as the mux name in the signal status
+  if (m_tii)
+  {
+
+    m_receiver->settiicallback(
+        [this](tii_measurement_t const& measurement) -> void
+        {
+          m_tiimainid.store(measurement.pattern);
+          m_tiisubid.store(measurement.comb);
+        });
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -135,17 +122,20 @@ bool dabstream::canseek(void) const
 
 void dabstream::close(void)
 {
-  m_stop = true; // Signal worker thread to stop
-  if (m_device)
-    m_device->cancel_async(); // Cancel any async read operations
-  if (m_worker.joinable())
-    m_worker.join(); // Wait for thread
+  // Detach from the receiver; the receiver itself will be closed once the last
+  // consumer has released the shared instance.  The reference is held until the
+  // stream is destroyed so that a concurrent demuxread() can still access it
+  if (!m_stopped.exchange(true))
+  {
 
-  if (m_receiver)
-    m_receiver->stop(); // Stop receiver
-  m_receiver.reset(); // Reset receiver instance
+    if (m_tii)
+      m_receiver->settiicallback(nullptr);
+    m_receiver->removeconsumer(*static_cast<ProgrammeHandlerInterface*>(this));
 
-  m_device.reset(); // Release RTL-SDR device
+    // Unblock any demultiplexer waiters; this requires the queue lock
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    m_queuecv.notify_all();
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -167,8 +157,26 @@ std::unique_ptr<dabstream> dabstream::create(std::unique_ptr<rtldevice> device,
                                              struct dabprops const& dabprops,
                                              uint32_t subchannel)
 {
-  return std::unique_ptr<dabstream>(
-      new dabstream(std::move(device), tunerprops, channelprops, dabprops, subchannel));
+  return create(dabreceiver::create(std::move(device), tunerprops, channelprops, dabprops),
+                dabprops, subchannel);
+}
+
+//---------------------------------------------------------------------------
+// dabstream::create (static)
+//
+// Factory method, creates a new dabstream instance
+//
+// Arguments:
+//
+//	receiver		- Shared DAB receiver instance
+//	dabprops		- DAB digital signal processor properties
+//	subchannel		- DAB subchannel to decode/stream
+
+std::unique_ptr<dabstream> dabstream::create(std::shared_ptr<dabreceiver> receiver,
+                                             struct dabprops const& dabprops,
+                                             uint32_t subchannel)
+{
+  return std::unique_ptr<dabstream>(new dabstream(std::move(receiver), dabprops, subchannel));
 }
 
 //---------------------------------------------------------------------------
@@ -212,17 +220,21 @@ DEMUX_PACKET* dabstream::demuxread(std::function<DEMUX_PACKET*(int)> const& allo
 
   // Wait up to 50ms for there to be a packet available for processing
   if (!m_queuecv.wait_for(lock, std::chrono::milliseconds(50),
-                          [&]() -> bool
-                          { return ((m_queue.size() > 0) || m_stopped.load() == true); }))
+                          [&]() -> bool { return ((m_queue.size() > 0) || stopped()); }))
+    return allocator(0);
+
+  // If the stream was closed, return an empty demultiplexer packet
+  if (m_stopped.load())
     return allocator(0);
 
-  // If the worker thread was stopped, check for and re-throw any exception that occurred,
+  // If the receiver was stopped, check for and re-throw any exception that occurred,
   // otherwise assume it was stopped normally and return an empty demultiplexer packet
-  if (m_stopped.load() == true)
+  if (m_receiver->stopped() == true)
   {
 
-    if (m_worker_exception)
-      std::rethrow_exception(m_worker_exception);
+    std::exception_ptr ex = m_receiver->worker_exception();
+    if (ex)
+      std::rethrow_exception(ex);
     else
       return allocator(0);
   }
@@ -247,8 +259,10 @@ DEMUX_PACKET* dabstream::demuxread(std::function<DEMUX_PACKET*(int)> const& allo
     demuxpacket->duration = packet->duration;
     demuxpacket->dts = packet->dts;
     demuxpacket->pts = packet->pts;
+    // Apply the output gain while copying the PCM data into the demux packet
     if (packet->size > 0)
-      memcpy(demuxpacket->pData, packet->data.get(), packet->size);
+      scale_pcm(reinterpret_cast<int16_t*>(demuxpacket->pData), packet->pcm.data(),
+                packet->pcm.size(), m_pcmgain);
   }
 
   return demuxpacket;
@@ -278,7 +292,7 @@ void dabstream::demuxreset(void)
 
 std::string dabstream::devicename(void) const
 {
-  return std::string(m_device->get_device_name());
+  return m_receiver->devicename();
 }
 
 //---------------------------------------------------------------------------
@@ -303,6 +317,20 @@ void dabstream::enumproperties(std::function<void(struct streamprops const& prop
   callback(audio);
 }
 
+//---------------------------------------------------------------------------
+// dabstream::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& dabstream::iqsamples(void) const
+{
+  return m_receiver->iqsamples();
+}
+
 //---------------------------------------------------------------------------
 // dabstream::length
 //
@@ -328,7 +356,13 @@ long long dabstream::length(void) const
 
 std::string dabstream::muxname(void) const
 {
-  return "";
+  int mainid = m_tiimainid.load();
+  int subid = m_tiisubid.load();
+
+  if ((mainid < 0) || (subid < 0))
+    return "";
+
+  return "TII " + std::to_string(mainid) + "/" + std::to_string(subid);
 }
 
 //---------------------------------------------------------------------------
@@ -375,238 +409,127 @@ bool dabstream::realtime(void) const
 }
 
 //---------------------------------------------------------------------------
-// dabstream::seek
+// dabstream::receiver
 //
-// Sets the stream pointer to a specific position
+// Gets the shared receiver the stream is attached to
 //
 // Arguments:
 //
-//	position	- Delta within the stream to seek, relative to whence
-//	whence		- Starting position from which to apply the delta
+//	NONE
 
-long long dabstream::seek(long long /*position*/, int /*whence*/)
+std::shared_ptr<void> dabstream::receiver(void) const
 {
-  return -1;
+  return m_receiver;
 }
 
 //---------------------------------------------------------------------------
-// dabstream::servicename
+// dabstream::seek
 //
-// Gets the service name associated with the stream
+// Sets the stream pointer to a specific position
 //
 // Arguments:
 //
-//	NONE
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
 
-std::string dabstream::servicename(void) const
+long long dabstream::seek(long long /*position*/, int /*whence*/)
 {
-  return ""; // TODO
+  return -1;
 }
 
 //---------------------------------------------------------------------------
-// dabstream::signalquality
+// dabstream::seektime
 //
-// Gets the signal quality as percentages
+// Seeks the demultiplexer to a specific time
 //
 // Arguments:
 //
-//	NONE
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag to seek backwards from the time
+//	startpts	- On success, receives the time stamp of the seek position
 
-void dabstream::signalquality(int& quality, int& snr) const
+bool dabstream::seektime(double /*time*/, bool /*backwards*/, double& /*startpts*/)
 {
-  quality = snr = 0; // TODO
+  return false;
 }
 
 //---------------------------------------------------------------------------
-// dabstream::worker (private)
+// dabstream::servicename
 //
-// Worker thread procedure used to transfer and process data
+// Gets the service name associated with the stream
 //
 // Arguments:
 //
-//	started		- Condition variable to set when thread has started
+//	NONE
 
-void dabstream::worker(scalar_condition<bool>& started)
+std::string dabstream::servicename(void) const
 {
-  std::vector<Service> servicelist; // vector<> of current services
-  bool foundsub = false; // Flag indicating the desired subchannel was found
-
-  assert(m_device);
-  assert(m_receiver);
-
-  // read_callback_func (local)
-  //
-  // Asynchronous read callback function for the RTL-SDR device
-  auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
-  {
-    // Trigger an InputFailure event if no data has been returned from the device
-    if (count == 0)
-      m_streamok.store(false);
-
-    // Copy the input data into the ring buffer
-    assert(count <= std::numeric_limits<int32_t>::max());
-    m_ringbuffer.putDataIntoBuffer(buffer, static_cast<int32_t>(count));
-
-    // Check for and process any new events
-    std::unique_lock<std::mutex> eventslock(m_eventslock);
-    if (m_events.empty() == false)
-    {
-
-      // The threading model is a bit weird here; the callback that queued a new
-      // event needs to be free to continue execution otherwise the DSP may deadlock
-      // while we process that event. Combat this by swapping the queue<> with a new
-      // one, release the lock, then go ahead and process each of the queued events
-
-      event_queue_t events; // Empty event queue<>
-      m_events.swap(events); // Swap with existing queue<>
-      eventslock.unlock(); // Release the queue<> lock
-
-      while (!events.empty())
-      {
-
-        eventid_t eventid = events.front(); // eventid_t
-        events.pop(); // Remove from queue<>
-
-        switch (eventid)
-        {
-
-          // InputFailure
-          //
-          // Something has gone wrong with the input stream
-          case eventid_t::InputFailure:
-
-            throw string_exception("Input Failure"); // TODO: message
-            break;
-
-          // ServiceDetected
-          //
-          // A new service has been detected
-          case eventid_t::ServiceDetected:
-
-            if (foundsub)
-              break; // Subchannel has already been found; ignore
-
-            // Determine if the desired subchannel is now present in the decoded services
-            servicelist = m_receiver->getServiceList();
-            for (auto const& service : servicelist)
-            {
-              for (auto const& component : m_receiver->getComponents(service))
-              {
-
-                if (component.subchannelId == static_cast<int16_t>(m_subchannel))
-                {
-
-                  // The desired subchannel has been found; begin audio playback
-                  ProgrammeHandlerInterface& phi = *static_cast<ProgrammeHandlerInterface*>(this);
-                  m_receiver->playSingleProgramme(phi, {}, service);
-
-                  foundsub = true; //  Stop processing service events
-                }
-              }
-            }
-            break;
-        }
-      }
-    }
-  };
-
-  // Begin streaming from the device via the receiver and inform the caller that the thread is running
-  m_receiver->restart(false);
-  started = true;
-
-  // Continuously read data from the device until cancel_async() has been called
-  // 40 KiB = ~1/100 of a second of data
-  try
-  {
-    m_device->read_async(read_callback_func, 40 KiB);
-  }
-  catch (...)
-  {
-    m_worker_exception = std::current_exception();
-  }
-
-  m_stopped.store(true); // Worker thread is now stopped
-  m_queuecv.notify_all(); // Unblock any demux queue waiters
+  return ""; // TODO
 }
 
 //---------------------------------------------------------------------------
-// dabstream::getSamples (InputInterface)
+// dabstream::signalquality
 //
-// Reads the specified number of samples from the input device
+// Gets the signal quality as percentages
 //
 // Arguments:
 //
-//	buffer		- Buffer to receive the input samples
-//	size		- Number of samples to read
+//	NONE
 
-int32_t dabstream::getSamples(DSPCOMPLEX* buffer, int32_t size)
+void dabstream::signalquality(int& quality, int& snr) const
 {
-  int32_t numsamples = 0; // Number of available samples in the buffer
-
-  // Allocate a temporary buffer to pull the data out of the ring buffer
-  std::unique_ptr<uint8_t[]> tempbuffer(new uint8_t[size * 2]);
-
-  // Get the data from the ring buffer
-  numsamples = m_ringbuffer.getDataFromBuffer(tempbuffer.get(), size * 2);
+  float snrdb = m_snr.load();
 
-  // Scale the input data from [0,255] to [-1,1] for the demodulator
-  for (int32_t index = 0; index < numsamples / 2; index++)
-  {
-
-    buffer[index] =
-        DSPCOMPLEX((static_cast<float>(tempbuffer[index * 2]) - 128.0f) / 128.0f, // real
-                   (static_cast<float>(tempbuffer[(index * 2) + 1]) - 128.0f) / 128.0f // imaginary
-        );
-  }
+  // For signal quality, use the OFDM SNR relative to what is required to decode
+  // the ensemble. From observation audio starts to break up below 8dB and there
+  // is no further improvement above 12dB, so scale that range to (0...100)
+  quality = std::max(0, std::min(100, static_cast<int>(((snrdb - 8.0f) * 100.0f) / 4.0f)));
 
-  return numsamples / 2;
+  // For signal-to-noise ratio use a linear scale from (0...20) dB
+  snr = std::max(0, std::min(100, static_cast<int>((snrdb * 100.0f) / 20.0f)));
 }
 
 //---------------------------------------------------------------------------
-// dabstream::getSamplesToRead (InputInterface)
+// dabstream::stopped
 //
-// Gets the number of input samples that are available to read from input
+// Gets a flag indicating if the stream has stopped
 //
 // Arguments:
 //
 //	NONE
 
-int32_t dabstream::getSamplesToRead(void)
+bool dabstream::stopped(void) const
 {
-  return m_ringbuffer.GetRingBufferReadAvailable() / 2;
+  return (m_stopped.load() || m_receiver->stopped());
 }
 
 //---------------------------------------------------------------------------
-// dabstream::is_ok (InputInterface)
+// dabstream::streamtimes
 //
-// Determines if the input is still "OK"
+// Gets the time properties of the stream
 //
 // Arguments:
 //
-//	NONE
+//	times		- Structure to receive the stream time properties
 
-bool dabstream::is_ok(void)
+bool dabstream::streamtimes(struct streamtimeprops& /*times*/) const
 {
-  return m_streamok.load();
+  return false;
 }
 
 //---------------------------------------------------------------------------
-// dabstream::restart (InputInterface)
+// dabstream::onSNR (ProgrammeHandlerInterface)
 //
-// Restarts the input
+// Invoked when the OFDM signal-to-noise ratio has been calculated
 //
 // Arguments:
 //
-//	NONE
+//	snr			- Signal-to-noise ratio in dB
 
-bool dabstream::restart(void)
+void dabstream::onSNR(float snr)
 {
-  assert(m_device);
-
-  m_streamok.store(true);
-  m_device->begin_stream();
-
-  return true;
+  m_snr.store(snr);
+  publishstatus(snr);
 }
 
 //---------------------------------------------------------------------------
@@ -624,17 +547,67 @@ void dabstream::onNewAudio(std::vector<int16_t>&& audioData,
                            int sampleRate,
                            std::string const& /*mode*/)
 {
-  if (audioData.size() == 0)
+  size_t const frames = audioData.size() / 2;
+  if (frames == 0)
     return;
 
-  // Allocate the uint8_t buffer to hold the PCM audio data
-  size_t pcmsize = audioData.size() * sizeof(int16_t);
-  std::unique_ptr<uint8_t[]> pcm(new uint8_t[pcmsize]);
+  // Steer the resampler ratio to compensate for the drift between the device clock
+  // and the clock that the audio is being consumed with; the controller starts over
+  // if the sample rate has changed as the stream will be changed
+  size_t queued = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    queued = m_queue.size();
+  }
+
+  if (sampleRate != m_audiorate.load())
+    m_driftcontroller.reset();
+
+  // The queue depth only follows the consumer clock if the stream is read in real time
+  bool const controlled = realtimeconsumer();
+  if (!controlled)
+    m_driftcontroller.reset();
 
-  // Copy the audio data into the buffer while applying the specified PCM output gain
-  int16_t* pcmdata = reinterpret_cast<int16_t*>(pcm.get());
-  for (size_t index = 0; index < audioData.size(); index++)
-    pcmdata[index] = static_cast<int16_t>(audioData[index] * m_pcmgain);
+  double const correction =
+      (controlled) ? m_driftcontroller.update(queued, MAX_PACKET_QUEUE) : 1.0;
+  counters()->clockdrift(controlled, m_driftcontroller.ppm());
+
+  // The decoded audio is moved into the packet untouched unless the drift controller is
+  // steering the output.  The output gain is applied when it's copied into the packet
+  std::vector<int16_t> pcm(std::move(audioData));
+  if (correction != 1.0)
+  {
+
+    perfcounters::stagetimer timer(*counters(), perfcounters::stage::resample);
+
+    // The resampler has to be (re)initialized if the input is larger than it can accept
+    if (frames > m_resamplerinput.size())
+    {
+
+      m_resampler->Init(static_cast<int>(frames));
+      m_resamplerinput.resize(frames);
+    }
+
+    // Convert the interleaved stereo samples into the resampler input format
+    for (size_t index = 0; index < frames; index++)
+    {
+
+      m_resamplerinput[index].re = pcm[(index * 2)];
+      m_resamplerinput[index].im = pcm[(index * 2) + 1];
+    }
+
+    // Resample into the reusable output buffer, a ratio below 1.0 generates slightly more
+    // samples than were provided, and copy the result back into the decoded audio vector
+    size_t const maxframes = frames + (frames / 500) + 2;
+    if (m_resampleroutput.size() < (maxframes * 2))
+      m_resampleroutput.resize(maxframes * 2);
+
+    int resampled = m_resampler->Resample(
+        static_cast<int>(frames), static_cast<TYPEREAL>(correction), m_resamplerinput.data(),
+        reinterpret_cast<TYPESTEREO16*>(m_resampleroutput.data()), 1.0);
+    pcm.assign(m_resampleroutput.begin(),
+               m_resampleroutput.begin() + (static_cast<size_t>(resampled) * 2));
+  }
 
   std::unique_lock<std::mutex> lock(m_queuelock);
 
@@ -656,7 +629,9 @@ void dabstream::onNewAudio(std::vector<int16_t>&& audioData,
   if (m_queue.size() >= MAX_PACKET_QUEUE)
   {
 
+    counters()->packetsdropped(m_queue.size());
     m_queue = demux_queue_t(); // Replace the queue<>
+    m_driftcontroller.reset(); // Reset the clock drift controller
 
     // Queue a DEMUX_SPECIALID_STREAMCHANGE packet into the new queue
     std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
@@ -666,17 +641,20 @@ void dabstream::onNewAudio(std::vector<int16_t>&& audioData,
     m_dts = STREAM_TIME_BASE; // Reset DTS back to base time
   }
 
-  // Generate and queue the demux audio packet
+  // Generate and queue the demux audio packet; the resampled audio is retained as-is
+  // and the output gain is applied when it's copied into the demux packet
   std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
   packet->streamid = m_audioid.load();
-  packet->size = static_cast<int>(pcmsize);
-  packet->duration = (audioData.size() / 2.0 / static_cast<double>(sampleRate)) * STREAM_TIME_BASE;
+  packet->size = static_cast<int>(pcm.size() * sizeof(int16_t));
+  packet->duration = (pcm.size() / 2.0 / static_cast<double>(sampleRate)) * STREAM_TIME_BASE;
   packet->dts = packet->pts = m_dts;
-  packet->data = std::move(pcm);
+  packet->pcm = std::move(pcm);
 
   m_dts += packet->duration;
+  counters()->addsignaltime(packet->pcm.size() / 2.0 / static_cast<double>(sampleRate));
 
   m_queue.emplace(std::move(packet));
+  counters()->packetqueued(m_queue.size());
   m_queuecv.notify_all();
 }
 
@@ -714,99 +692,60 @@ void dabstream::onMOT(mot_file_t const& /*mot_file*/)
 }
 
 //---------------------------------------------------------------------------
-// dabstream::onFrequencyCorrectorChange (RadioControllerInterface)
-//
-// Invoked when the frequency correction has been changed
-//
-// Arguments:
-//
-//	fine			- Fine frequency correction value
-//	coarse			- Coarse frequency correction value
-
-void dabstream::onFrequencyCorrectorChange(int /*fine*/, int /*coarse*/)
-{
-  // TODO - This can be applied to the device real-time?
-}
-
-//---------------------------------------------------------------------------
-// dabstream::onInputFailure (RadioControllerInterface)
+// dabstream::onUntouchedStream (ProgrammeHandlerInterface)
 //
-// Invoked when the receiver has shut down to an input failure
+// Invoked when a frame of the undecoded audio stream is available
 //
 // Arguments:
 //
-//	NONE
+//	data			- Undecoded audio frame
+//	len				- Length of the undecoded audio frame
+//	durationMs		- Duration of the audio frame in milliseconds
+//	extension		- File extension associated with the audio format
 
-void dabstream::onInputFailure(void)
+void dabstream::onUntouchedStream(uint8_t const* data,
+                                  size_t len,
+                                  size_t durationMs,
+                                  std::string const& extension)
 {
-  std::unique_lock<std::mutex> lock(m_eventslock);
-  m_events.emplace(eventid_t::InputFailure);
-}
-
-//---------------------------------------------------------------------------
-// dabstream::onServiceDetected (RadioControllerInterface)
-//
-// Invoked when a new service was detected
-//
-// Arguments:
-//
-//	sId			- New service identifier
+  // DAB (MP2) and DAB+ (LOAS) audio is recorded without transcoding
+  std::shared_ptr<recordingsink> recording = recorder();
+  if (recording)
+  {
 
-void dabstream::onServiceDetected(uint32_t /*sId*/)
-{
-  std::unique_lock<std::mutex> lock(m_eventslock);
-  m_events.emplace(eventid_t::ServiceDetected);
+    recording->writeframe(data, len, durationMs, extension);
+  }
 }
 
 //---------------------------------------------------------------------------
-// dabstream::onSetEnsembleLabel (RadioControllerInterface)
+// scale_pcm (local)
 //
-// Invoked when the ensemble label has changed
+// Copies 16-bit PCM samples while applying a saturating gain
 //
 // Arguments:
 //
-//	label		- New ensemble label
+//	dest		- Destination sample buffer
+//	source		- Source sample buffer
+//	count		- Number of samples to copy
+//	gain		- Gain to apply to each sample
 
-void dabstream::onSetEnsembleLabel(DabLabel& /*label*/)
+static void scale_pcm(int16_t* dest, int16_t const* source, size_t count, float gain)
 {
-  //
-  // TODO: This can probably be used to automatically generate
-  // a channel group
-  //
-}
-
-//---------------------------------------------------------------------------
-// dabstream::onSNR (RadioControllerInterface)
-//
-// Invoked when the Signal-to-Nosie Radio has been calculated
-//
-// Arguments:
-//
-//	snr			- Signal-to-Noise Ratio, in dB
+  // Unity gain (0 dB) is a straight copy
+  if (gain == 1.0f)
+  {
 
-void dabstream::onSNR(float /*snr*/)
-{
-  //
-  // TODO: Figure out what an acceptable SNR is for DAB and provide
-  // the necessary event to change the signal quality metric
-  //
-}
+    memcpy(dest, source, count * sizeof(int16_t));
+    return;
+  }
 
-//---------------------------------------------------------------------------
-// dabstream::onSyncChange (RadioControllerInterface)
-//
-// Invoked when signal synchronization was acquired or lost
-//
-// Arguments:
-//
-//	isSync		- Synchronization flag
+  // Branchless clamp so the loop can be vectorized by the compiler
+  for (size_t index = 0; index < count; index++)
+  {
 
-void dabstream::onSyncChange(bool /*isSync*/)
-{
-  //
-  // TODO: This might need to STREAMCHANGE, clear the demux queue,
-  // silence the audio, and maybe throw up a banner to the user
-  //
+    float sample = static_cast<float>(source[index]) * gain;
+    dest[index] = static_cast<int16_t>(std::min(std::max(sample, -32768.0f), 32767.0f));
+  }
 }
 
 //---------------------------------------------------------------------------
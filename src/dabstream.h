@@ -24,19 +24,19 @@
 #define __DABSTREAM_H_
 #pragma once
 
-#include "dsp_dab/radio-receiver.h"
-#include "dsp_dab/ringbuffer.h"
+#include "dabreceiver.h"
+#include "driftcontroller.h"
+#include "dsp_fm/fractresampler.h"
 #include "props.h"
 #include "pvrstream.h"
 #include "rtldevice.h"
-#include "utils/scalar_condition.h"
 
 #include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <queue>
-#include <thread>
+#include <vector>
 
 #pragma warning(push, 4)
 
@@ -45,10 +45,7 @@
 //
 // Implements a DAB stream
 
-class dabstream : public pvrstream,
-                  private InputInterface,
-                  private ProgrammeHandlerInterface,
-                  private RadioControllerInterface
+class dabstream : public pvrstream, private ProgrammeHandlerInterface
 {
 public:
   // Destructor
@@ -76,6 +73,9 @@ public:
                                            struct channelprops const& channelprops,
                                            struct dabprops const& dabprops,
                                            uint32_t subchannel);
+  static std::unique_ptr<dabstream> create(std::shared_ptr<dabreceiver> receiver,
+                                           struct dabprops const& dabprops,
+                                           uint32_t subchannel);
 
   // demuxabort
   //
@@ -108,6 +108,11 @@ public:
   void enumproperties(
       std::function<void(struct streamprops const& props)> const& callback) override;
 
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const override;
+
   // length
   //
   // Gets the length of the stream
@@ -133,11 +138,21 @@ public:
   // Gets a flag indicating if the stream is real-time
   bool realtime(void) const override;
 
+  // receiver
+  //
+  // Gets the shared receiver the stream is attached to
+  std::shared_ptr<void> receiver(void) const override;
+
   // seek
   //
   // Sets the stream pointer to a specific position
   long long seek(long long position, int whence) override;
 
+  // seektime
+  //
+  // Seeks the demultiplexer to a specific time
+  bool seektime(double time, bool backwards, double& startpts) override;
+
   // servicename
   //
   // Gets the service name associated with the stream
@@ -148,6 +163,16 @@ public:
   // Gets the signal quality as percentages
   void signalquality(int& quality, int& snr) const override;
 
+  // stopped
+  //
+  // Gets a flag indicating if the stream has stopped
+  bool stopped(void) const override;
+
+  // streamtimes
+  //
+  // Gets the time properties of the stream
+  bool streamtimes(struct streamtimeprops& times) const override;
+
 private:
   dabstream(dabstream const&) = delete;
   dabstream& operator=(dabstream const&) = delete;
@@ -162,16 +187,6 @@ private:
   // Maximum number of queued demux packets
   static size_t const MAX_PACKET_QUEUE;
 
-  // RING_BUFFER_SIZE
-  //
-  // Input ring buffer size
-  static size_t const RING_BUFFER_SIZE;
-
-  // SAMPLE_RATE
-  //
-  // Fixed device sample rate required for DAB
-  static uint32_t const SAMPLE_RATE;
-
   // STREAM_ID_AUDIOBASE
   //
   // Base stream identifier for the audio output stream
@@ -184,9 +199,7 @@ private:
 
   // Instance Constructor
   //
-  dabstream(std::unique_ptr<rtldevice> device,
-            struct tunerprops const& tunerprops,
-            struct channelprops const& channelprops,
+  dabstream(std::shared_ptr<dabreceiver> receiver,
             struct dabprops const& dabprops,
             uint32_t subchannel);
 
@@ -204,7 +217,7 @@ private:
     double duration = 0;
     double dts = 0;
     double pts = 0;
-    std::unique_ptr<uint8_t[]> data;
+    std::vector<int16_t> pcm;
   };
 
   // demux_queue_t
@@ -212,52 +225,6 @@ private:
   // Defines the type of the demux queue
   using demux_queue_t = std::queue<std::unique_ptr<demux_packet_t>>;
 
-  // eventid_t
-  //
-  // Defines a worker thread event identifier
-  enum class eventid_t
-  {
-
-    InputFailure, // An input failure has occurred
-    ServiceDetected, // A new service has been detected
-  };
-
-  // event_queue_t
-  //
-  // Defines the type of the worker thread event queue
-  using event_queue_t = std::queue<eventid_t>;
-
-  //-----------------------------------------------------------------------
-  // Private Member Functions
-
-  // worker
-  //
-  // Worker thread procedure used to transfer and process data
-  void worker(scalar_condition<bool>& started);
-
-  //-----------------------------------------------------------------------
-  // InputInterface Implementation
-
-  // getSamples
-  //
-  // Reads the specified number of samples from the input device
-  int32_t getSamples(DSPCOMPLEX* buffer, int32_t size) override;
-
-  // getSamplesToRead
-  //
-  // Gets the number of input samples that are available to read from input
-  int32_t getSamplesToRead(void) override;
-
-  // is_ok
-  //
-  // Determines if the input is still "OK"
-  bool is_ok(void) override;
-
-  // restart
-  //
-  // Restarts the input
-  bool restart(void) override;
-
   //-----------------------------------------------------------------------
   // ProgrammeHandlerInterface
 
@@ -278,73 +245,53 @@ private:
   // Invoked when a new slide has been decoded
   void onMOT(const mot_file_t& mot_file) override;
 
-  //-----------------------------------------------------------------------
-  // RadioControllerInterface
-
-  // onFrequencyCorrectorChange
-  //
-  // Invoked when the frequency correction has been changed
-  void onFrequencyCorrectorChange(int fine, int coarse) override;
-
-  // onInputFailure
-  //
-  // Invoked when the receiver has shut down to an input failure
-  void onInputFailure(void) override;
-
-  // onServiceDetected
-  //
-  // Invoked when a new service was detected
-  void onServiceDetected(uint32_t sId) override;
-
-  // onSetEnsembleLabel
-  //
-  // Invoked when the ensemble label has changed
-  void onSetEnsembleLabel(DabLabel& label) override;
-
   // onSNR
   //
-  // Invoked when the Signal-to-Nosie Radio has been calculated
+  // Invoked when the OFDM signal-to-noise ratio has been calculated
   void onSNR(float snr) override;
 
-  // onSyncChange
+  // onUntouchedStream
   //
-  // Invoked when signal synchronization was acquired or lost
-  void onSyncChange(bool isSync) override;
+  // Invoked when a frame of the undecoded audio stream is available
+  void onUntouchedStream(const uint8_t* data,
+                         size_t len,
+                         size_t durationMs,
+                         const std::string& extension) override;
 
   //-----------------------------------------------------------------------
   // Member Variables
 
-  std::unique_ptr<rtldevice> m_device; // RTL-SDR device instance
-  aligned_ptr<RadioReceiver> m_receiver; // RadioReceiver instance
-  RingBuffer<uint8_t> m_ringbuffer; // I/Q sample ring buffer
+  std::shared_ptr<dabreceiver> m_receiver; // Shared DAB receiver instance
 
   // STREAM CONTROL
   //
   uint32_t const m_subchannel; // Ensemble subchannel number
   float const m_pcmgain; // Output gain
-  std::atomic<bool> m_streamok{true}; // "OK" flag for the stream
   double m_dts{STREAM_TIME_BASE}; // Current decode time stamp
   std::atomic<int> m_audioid{STREAM_ID_AUDIOBASE}; // Current audio stream id
   std::atomic<int> m_audiorate{DEFAULT_AUDIO_RATE}; // Current audio output rate
+  std::atomic<float> m_snr{0}; // Current OFDM signal-to-noise ratio
+  bool const m_tii; // Flag if subscribed to TII measurements
+  std::atomic<int> m_tiimainid{-1}; // Last measured TII main identifier
+  std::atomic<int> m_tiisubid{-1}; // Last measured TII sub identifier
+  std::atomic<bool> m_stopped{false}; // Flag if the stream has been closed
+
+  // CLOCK DRIFT
+  //
+  driftcontroller m_driftcontroller; // Clock drift controller
+  std::unique_ptr<CFractResampler> m_resampler; // Clock drift resampler
+  std::vector<TYPECPX> m_resamplerinput; // Resampler input buffer
+  std::vector<int16_t> m_resampleroutput; // Resampler output buffer
 
   // DEMUX QUEUE
   //
   demux_queue_t m_queue; // queue<> of demux objects
   mutable std::mutex m_queuelock; // Synchronization object
   std::condition_variable m_queuecv; // Event condition variable
-
-  // WORKER THREAD
-  //
-  std::thread m_worker; // Data transfer thread
-  std::exception_ptr m_worker_exception; // Exception on worker thread
-  scalar_condition<bool> m_stop{false}; // Condition to stop data transfer
-  std::atomic<bool> m_stopped{false}; // Data transfer stopped flag
-  event_queue_t m_events; // queue<> of worker events
-  mutable std::mutex m_eventslock; // Synchronization object
 };
 
 //-----------------------------------------------------------------------------
 
 #pragma warning(pop)
 
-#endif // __HDSTREAM_H_
+#endif // __DABSTREAM_H_
@@ -36,6 +36,7 @@
 
 static void bind_parameter(sqlite3_stmt* statement, int& paramindex, const char* value);
 static void bind_parameter(sqlite3_stmt* statement, int& paramindex, unsigned int value);
+static void bind_parameter(sqlite3_stmt* statement, int& paramindex, int64_t value);
 template<typename... _parameters>
 static int execute_non_query(sqlite3* instance, char const* sql, _parameters&&... parameters);
 template<typename... _parameters>
@@ -269,6 +270,39 @@ bool add_channel(sqlite3* instance,
   return result;
 }
 
+//---------------------------------------------------------------------------
+// add_recording
+//
+// Adds a new recording to the database
+//
+// Arguments:
+//
+//	instance		- Database instance
+//	channelid		- Recorded channel identifier
+//	channelname		- Recorded channel name
+//	title			- Recording title
+//	starttime		- Recording start time
+//	duration		- Recording duration in seconds
+//	filename		- Recording file name
+
+bool add_recording(sqlite3* instance,
+                   unsigned int channelid,
+                   char const* channelname,
+                   char const* title,
+                   time_t starttime,
+                   int duration,
+                   char const* filename)
+{
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  // id | channelid | channelname | title | starttime | duration | filename
+  return execute_non_query(instance,
+                           "insert into recording values(null, ?1, ?2, ?3, ?4, ?5, ?6)",
+                           channelid, channelname, title, static_cast<int64_t>(starttime),
+                           duration, filename) > 0;
+}
+
 //---------------------------------------------------------------------------
 // bind_parameter (local)
 //
@@ -330,6 +364,24 @@ static void bind_parameter(sqlite3_stmt* statement, int& paramindex, unsigned in
     throw sqlite_exception(result);
 }
 
+//---------------------------------------------------------------------------
+// bind_parameter (local)
+//
+// Used by execute_non_query to bind a 64-bit integer parameter
+//
+// Arguments:
+//
+//	statement		- SQL statement instance
+//	paramindex		- Index of the parameter to bind; will be incremented
+//	value			- Value to bind as the parameter
+
+static void bind_parameter(sqlite3_stmt* statement, int& paramindex, int64_t value)
+{
+  int result = sqlite3_bind_int64(statement, paramindex++, value);
+  if (result != SQLITE_OK)
+    throw sqlite_exception(result);
+}
+
 //---------------------------------------------------------------------------
 // channel_exists
 //
@@ -366,6 +418,8 @@ void clear_channels(sqlite3* instance)
     throw std::invalid_argument("instance");
 
   execute_non_query(instance, "delete from channel");
+  execute_non_query(instance, "delete from dabsubchannel");
+  execute_non_query(instance, "delete from dabsync");
 }
 
 //---------------------------------------------------------------------------
@@ -413,6 +467,14 @@ void delete_channel(sqlite3* instance, uint32_t frequency, enum modulation modul
     execute_non_query(instance, "delete from channel where frequency = ?1 and modulation = ?2",
                       frequency, static_cast<int>(modulation));
 
+    // Remove any cached DAB ensemble organisation and synchronisation properties
+    if (modulation == modulation::dab)
+    {
+
+      execute_non_query(instance, "delete from dabsubchannel where frequency = ?1", frequency);
+      execute_non_query(instance, "delete from dabsync where frequency = ?1", frequency);
+    }
+
     // Commit the database transaction
     execute_non_query(instance, "commit transaction");
   }
@@ -425,6 +487,24 @@ void delete_channel(sqlite3* instance, uint32_t frequency, enum modulation modul
   }
 }
 
+//---------------------------------------------------------------------------
+// delete_recording
+//
+// Deletes a recording from the database
+//
+// Arguments:
+//
+//	instance	- Database instance
+//	id			- Recording unique identifier
+
+void delete_recording(sqlite3* instance, unsigned int id)
+{
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  execute_non_query(instance, "delete from recording where id = ?1", id);
+}
+
 //---------------------------------------------------------------------------
 // delete_subchannel
 //
@@ -808,6 +888,62 @@ void enumerate_rawfiles(sqlite3* instance, enumerate_rawfiles_callback const& ca
   }
 }
 
+//---------------------------------------------------------------------------
+// enumerate_recordings
+//
+// Enumerates the recordings registered in the database
+//
+// Arguments:
+//
+//	instance	- Database instance
+//	callback	- Callback function
+
+void enumerate_recordings(sqlite3* instance, enumerate_recordings_callback const& callback)
+{
+  sqlite3_stmt* statement; // SQL statement to execute
+  int result; // Result from SQLite function
+
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  // id | channelid | channelname | title | starttime | duration | filename
+  auto sql = "select id, channelid, channelname, title, starttime, duration, filename "
+             "from recording order by starttime asc";
+
+  result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
+  if (result != SQLITE_OK)
+    throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+  try
+  {
+
+    // Execute the query and iterate over all returned rows
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+
+      struct recording item = {};
+
+      item.id = static_cast<unsigned int>(sqlite3_column_int64(statement, 0));
+      item.channelid = static_cast<unsigned int>(sqlite3_column_int64(statement, 1));
+      item.channelname = reinterpret_cast<char const*>(sqlite3_column_text(statement, 2));
+      item.title = reinterpret_cast<char const*>(sqlite3_column_text(statement, 3));
+      item.starttime = static_cast<time_t>(sqlite3_column_int64(statement, 4));
+      item.duration = sqlite3_column_int(statement, 5);
+      item.filename = reinterpret_cast<char const*>(sqlite3_column_text(statement, 6));
+
+      callback(item); // Invoke caller-supplied callback
+    }
+
+    sqlite3_finalize(statement); // Finalize the SQLite statement
+  }
+
+  catch (...)
+  {
+    sqlite3_finalize(statement);
+    throw;
+  }
+}
+
 //---------------------------------------------------------------------------
 // enumerate_wxradio_channels
 //
@@ -1263,6 +1399,185 @@ bool get_channel_properties(sqlite3* instance,
   return true;
 }
 
+//---------------------------------------------------------------------------
+// get_dabsubchannel_properties
+//
+// Gets the cached DAB ensemble subchannel organisation from the database
+//
+// Arguments:
+//
+//	instance			- SQLite database instance
+//	frequency			- Ensemble frequency
+//	dabsubchannelprops	- vector<> to receive the cached subchannel organisation
+
+bool get_dabsubchannel_properties(sqlite3* instance,
+                                  uint32_t frequency,
+                                  std::vector<struct dabsubchannelprops>& dabsubchannelprops)
+{
+  sqlite3_stmt* statement; // SQL statement to execute
+  int result; // Result from SQLite function
+
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  dabsubchannelprops.clear(); // Reset the vector<>
+
+  // number | serviceid | dabplus | startaddress | length | shortform | ueptableindex | ueplevel | eepprofile | eeplevel
+  auto sql = "select number, serviceid, dabplus, startaddress, length, shortform, ueptableindex, "
+             "ueplevel, eepprofile, eeplevel from dabsubchannel where frequency = ?1 order by "
+             "number";
+
+  result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
+  if (result != SQLITE_OK)
+    throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+  try
+  {
+
+    // Bind the query parameters
+    result = sqlite3_bind_int64(statement, 1, static_cast<int64_t>(frequency));
+    if (result != SQLITE_OK)
+      throw sqlite_exception(result);
+
+    // Execute the query and iterate over all returned rows
+    while (sqlite3_step(statement) == SQLITE_ROW)
+    {
+
+      struct dabsubchannelprops subchannel = {};
+
+      subchannel.number = static_cast<uint32_t>(sqlite3_column_int64(statement, 0));
+      subchannel.serviceid = static_cast<uint32_t>(sqlite3_column_int64(statement, 1));
+      subchannel.dabplus = (sqlite3_column_int(statement, 2) != 0);
+      subchannel.startaddress = sqlite3_column_int(statement, 3);
+      subchannel.length = sqlite3_column_int(statement, 4);
+      subchannel.shortform = (sqlite3_column_int(statement, 5) != 0);
+      subchannel.ueptableindex = sqlite3_column_int(statement, 6);
+      subchannel.ueplevel = sqlite3_column_int(statement, 7);
+      subchannel.eepprofile = sqlite3_column_int(statement, 8);
+      subchannel.eeplevel = sqlite3_column_int(statement, 9);
+
+      dabsubchannelprops.emplace_back(std::move(subchannel));
+    }
+
+    sqlite3_finalize(statement); // Finalize the SQLite statement
+  }
+
+  catch (...)
+  {
+    sqlite3_finalize(statement);
+    throw;
+  }
+
+  return !dabsubchannelprops.empty();
+}
+
+//---------------------------------------------------------------------------
+// get_dabsync_properties
+//
+// Gets the stored OFDM synchronisation properties for a DAB ensemble and device
+//
+// Arguments:
+//
+//	instance			- SQLite database instance
+//	frequency			- Ensemble frequency
+//	device				- Device name
+//	freqcorrection		- Device frequency correction (PPM)
+//	dabsyncprops		- Structure to receive the synchronisation properties
+
+bool get_dabsync_properties(sqlite3* instance,
+                            uint32_t frequency,
+                            char const* device,
+                            int freqcorrection,
+                            struct dabsyncprops& dabsyncprops)
+{
+  sqlite3_stmt* statement; // SQL statement to execute
+  int result; // Result from SQLite function
+  bool found = false; // Flag if the properties were found
+
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+  if (device == nullptr)
+    throw std::invalid_argument("device");
+
+  // The stored offsets are only valid if the device frequency correction has not changed
+  //
+  // coarsecorrector | finecorrector | fftplacement
+  auto sql = "select coarsecorrector, finecorrector, fftplacement from dabsync where frequency = "
+             "?1 and device = ?2 and freqcorrection = ?3";
+
+  result = sqlite3_prepare_v2(instance, sql, -1, &statement, nullptr);
+  if (result != SQLITE_OK)
+    throw sqlite_exception(result, sqlite3_errmsg(instance));
+
+  try
+  {
+
+    // Bind the query parameters
+    result = sqlite3_bind_int64(statement, 1, static_cast<int64_t>(frequency));
+    if (result == SQLITE_OK)
+      result = sqlite3_bind_text(statement, 2, device, -1, SQLITE_STATIC);
+    if (result == SQLITE_OK)
+      result = sqlite3_bind_int(statement, 3, freqcorrection);
+    if (result != SQLITE_OK)
+      throw sqlite_exception(result);
+
+    // Execute the query; there should be one and only one row returned
+    if (sqlite3_step(statement) == SQLITE_ROW)
+    {
+
+      dabsyncprops.coarsecorrector = sqlite3_column_int(statement, 0);
+      dabsyncprops.finecorrector = sqlite3_column_int(statement, 1);
+      dabsyncprops.fftplacement = sqlite3_column_int(statement, 2);
+      found = true;
+    }
+
+    sqlite3_finalize(statement); // Finalize the SQLite statement
+  }
+
+  catch (...)
+  {
+    sqlite3_finalize(statement);
+    throw;
+  }
+
+  return found;
+}
+
+//---------------------------------------------------------------------------
+// get_recording_count
+//
+// Gets the number of recordings in the database
+//
+// Arguments:
+//
+//	instance	- SQLite database instance
+
+int get_recording_count(sqlite3* instance)
+{
+  if (instance == nullptr)
+    return 0;
+
+  return execute_scalar_int(instance, "select count(*) from recording");
+}
+
+//---------------------------------------------------------------------------
+// get_recording_filename
+//
+// Gets the file name of a recording in the database
+//
+// Arguments:
+//
+//	instance	- SQLite database instance
+//	id			- Recording unique identifier
+
+std::string get_recording_filename(sqlite3* instance, unsigned int id)
+{
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  return execute_scalar_string(instance, "select filename from recording where id = ?1", id);
+}
+
 //---------------------------------------------------------------------------
 // has_rawfiles
 //
@@ -1583,6 +1898,65 @@ sqlite3* open_database(char const* connstring, int flags, bool initialize)
         execute_non_query(instance, "pragma user_version = 3");
         dbversion = 3;
       }
+
+      // SCHEMA VERSION 3 -> VERSION 4
+      //
+      if (dbversion == 3)
+      {
+
+        // table: dabsubchannel
+        //
+        // frequency(pk) | number(pk) | serviceid | dabplus | startaddress | length | shortform | ueptableindex | ueplevel | eepprofile | eeplevel
+        execute_non_query(instance, "drop table if exists dabsubchannel");
+        execute_non_query(
+            instance,
+            "create table dabsubchannel(frequency integer not null, number integer not null, "
+            "serviceid integer not null, dabplus integer not null, startaddress integer not null, "
+            "length integer not null, shortform integer not null, ueptableindex integer not null, "
+            "ueplevel integer not null, eepprofile integer not null, eeplevel integer not null, "
+            "primary key(frequency, number))");
+
+        execute_non_query(instance, "pragma user_version = 4");
+        dbversion = 4;
+      }
+
+      // SCHEMA VERSION 4 -> VERSION 5
+      //
+      if (dbversion == 4)
+      {
+
+        // table: dabsync
+        //
+        // frequency(pk) | device(pk) | freqcorrection | coarsecorrector | finecorrector | fftplacement
+        execute_non_query(instance, "drop table if exists dabsync");
+        execute_non_query(
+            instance,
+            "create table dabsync(frequency integer not null, device text not null, freqcorrection "
+            "integer not null, coarsecorrector integer not null, finecorrector integer not null, "
+            "fftplacement integer not null, primary key(frequency, device))");
+
+        execute_non_query(instance, "pragma user_version = 5");
+        dbversion = 5;
+      }
+
+      // SCHEMA VERSION 5 -> VERSION 6
+      //
+      if (dbversion == 5)
+      {
+
+        // table: recording
+        //
+        // id(pk) | channelid | channelname | title | starttime | duration | filename
+        execute_non_query(instance, "drop table if exists recording");
+        execute_non_query(
+            instance,
+            "create table recording(id integer primary key autoincrement, channelid integer not "
+            "null, channelname text, title text, starttime integer not null, duration integer not "
+            "null, filename text not null)");
+
+        execute_non_query(instance, "pragma user_version = 6");
+        dbversion = 6;
+      }
     }
   }
 
@@ -1762,6 +2136,89 @@ bool update_channel(sqlite3* instance,
   return result;
 }
 
+//---------------------------------------------------------------------------
+// update_dabsubchannel_properties
+//
+// Updates the cached DAB ensemble subchannel organisation in the database
+//
+// Arguments:
+//
+//	instance			- SQLite database instance
+//	frequency			- Ensemble frequency
+//	dabsubchannelprops	- vector<> containing the subchannel organisation
+
+void update_dabsubchannel_properties(
+    sqlite3* instance,
+    uint32_t frequency,
+    std::vector<struct dabsubchannelprops> const& dabsubchannelprops)
+{
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+
+  // This requires a multi-step operation; start a transaction
+  execute_non_query(instance, "begin immediate transaction");
+
+  try
+  {
+
+    // Replace the entire organisation of the ensemble; subchannels can be
+    // removed or renumbered when the ensemble is reconfigured
+    execute_non_query(instance, "delete from dabsubchannel where frequency = ?1", frequency);
+
+    // frequency | number | serviceid | dabplus | startaddress | length | shortform | ueptableindex | ueplevel | eepprofile | eeplevel
+    for (auto const& it : dabsubchannelprops)
+    {
+
+      execute_non_query(instance,
+                        "insert into dabsubchannel values(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, "
+                        "?10, ?11)",
+                        frequency, it.number, it.serviceid, (it.dabplus) ? 1 : 0, it.startaddress,
+                        it.length, (it.shortform) ? 1 : 0, it.ueptableindex, it.ueplevel,
+                        it.eepprofile, it.eeplevel);
+    }
+
+    // Commit the database transaction
+    execute_non_query(instance, "commit transaction");
+  }
+
+  // Rollback the transaction on any exception
+  catch (...)
+  {
+    try_execute_non_query(instance, "rollback transaction");
+    throw;
+  }
+}
+
+//---------------------------------------------------------------------------
+// update_dabsync_properties
+//
+// Updates the stored OFDM synchronisation properties for a DAB ensemble and device
+//
+// Arguments:
+//
+//	instance			- SQLite database instance
+//	frequency			- Ensemble frequency
+//	device				- Device name
+//	freqcorrection		- Device frequency correction (PPM)
+//	dabsyncprops		- Synchronisation properties to store
+
+void update_dabsync_properties(sqlite3* instance,
+                               uint32_t frequency,
+                               char const* device,
+                               int freqcorrection,
+                               struct dabsyncprops const& dabsyncprops)
+{
+  if (instance == nullptr)
+    throw std::invalid_argument("instance");
+  if (device == nullptr)
+    throw std::invalid_argument("device");
+
+  // frequency | device | freqcorrection | coarsecorrector | finecorrector | fftplacement
+  execute_non_query(instance, "replace into dabsync values(?1, ?2, ?3, ?4, ?5, ?6)", frequency,
+                    device, freqcorrection, dabsyncprops.coarsecorrector,
+                    dabsyncprops.finecorrector, dabsyncprops.fftplacement);
+}
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
@@ -56,6 +56,11 @@ using enumerate_namedchannels_callback =
 // Callback function passed to enumerate_rawfiles
 using enumerate_rawfiles_callback = std::function<void(struct rawfile const& rawfile)>;
 
+// enumerate_recordings_callback
+//
+// Callback function passed to enumerate_recordings
+using enumerate_recordings_callback = std::function<void(struct recording const& recording)>;
+
 //---------------------------------------------------------------------------
 // connectionpool
 //
@@ -144,6 +149,17 @@ bool add_channel(sqlite3* instance,
                  struct channelprops const& channelprops,
                  std::vector<struct subchannelprops> const& subchannelprops);
 
+// add_recording
+//
+// Adds a new recording to the database
+bool add_recording(sqlite3* instance,
+                   unsigned int channelid,
+                   char const* channelname,
+                   char const* title,
+                   time_t starttime,
+                   int duration,
+                   char const* filename);
+
 // channel_exists
 //
 // Determines if a channel exists in the database
@@ -169,6 +185,11 @@ void delete_channel(sqlite3* instance, uint32_t frequency, enum modulation modul
 // Deletes a channel from the database
 void delete_channel(sqlite3* instance, uint32_t frequency, enum modulation modulation);
 
+// delete_recording
+//
+// Deletes a recording from the database
+void delete_recording(sqlite3* instance, unsigned int id);
+
 // delete_subchannel
 //
 // Deletes a subchannel from the database
@@ -208,6 +229,11 @@ void enumerate_namedchannels(sqlite3* instance,
 // Enumerates available raw files registered in the database
 void enumerate_rawfiles(sqlite3* instance, enumerate_rawfiles_callback const& callback);
 
+// enumerate_recordings
+//
+// Enumerates the recordings registered in the database
+void enumerate_recordings(sqlite3* instance, enumerate_recordings_callback const& callback);
+
 // enumerate_wxradio_channels
 //
 // Enumerates Weather Radio channels
@@ -236,6 +262,32 @@ bool get_channel_properties(sqlite3* instance,
                             struct channelprops& channelprops,
                             std::vector<struct subchannelprops>& subchannelprops);
 
+// get_dabsubchannel_properties
+//
+// Gets the cached DAB ensemble subchannel organisation from the database
+bool get_dabsubchannel_properties(sqlite3* instance,
+                                  uint32_t frequency,
+                                  std::vector<struct dabsubchannelprops>& dabsubchannelprops);
+
+// get_dabsync_properties
+//
+// Gets the stored OFDM synchronisation properties for a DAB ensemble and device
+bool get_dabsync_properties(sqlite3* instance,
+                            uint32_t frequency,
+                            char const* device,
+                            int freqcorrection,
+                            struct dabsyncprops& dabsyncprops);
+
+// get_recording_count
+//
+// Gets the number of recordings in the database
+int get_recording_count(sqlite3* instance);
+
+// get_recording_filename
+//
+// Gets the file name of a recording in the database
+std::string get_recording_filename(sqlite3* instance, unsigned int id);
+
 // has_rawfiles
 //
 // Gets a flag indicating if there are raw input files available to use
@@ -273,6 +325,23 @@ bool update_channel(sqlite3* instance,
                     struct channelprops const& channelprops,
                     std::vector<struct subchannelprops> const& subchannelprops);
 
+// update_dabsubchannel_properties
+//
+// Updates the cached DAB ensemble subchannel organisation in the database
+void update_dabsubchannel_properties(
+    sqlite3* instance,
+    uint32_t frequency,
+    std::vector<struct dabsubchannelprops> const& dabsubchannelprops);
+
+// update_dabsync_properties
+//
+// Updates the stored OFDM synchronisation properties for a DAB ensemble and device
+void update_dabsync_properties(sqlite3* instance,
+                               uint32_t frequency,
+                               char const* device,
+                               int freqcorrection,
+                               struct dabsyncprops const& dabsyncprops);
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
@@ -133,6 +133,21 @@ struct rawfile
   uint32_t samplerate;
 };
 
+// recording
+//
+// Information about a single recording enumerated from the database
+struct recording
+{
+
+  unsigned int id;
+  unsigned int channelid;
+  char const* channelname;
+  char const* title;
+  time_t starttime;
+  int duration;
+  char const* filename;
+};
+
 //---------------------------------------------------------------------------
 
 #pragma warning(pop)
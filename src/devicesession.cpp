@@ -0,0 +1,527 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "devicesession.h"
+
+#include "exception_control/string_exception.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdint.h>
+
+#pragma warning(push, 4)
+
+// devicesession::DEVICE_IDLE_TIMEOUT
+//
+// Length of time an idle device is kept open
+std::chrono::seconds const devicesession::DEVICE_IDLE_TIMEOUT = std::chrono::seconds(60);
+
+// devicesession::RECEIVER_LINGER_TIMEOUT
+//
+// Length of time a DSP receiver is kept alive after its stream is closed
+std::chrono::seconds const devicesession::RECEIVER_LINGER_TIMEOUT = std::chrono::seconds(10);
+
+//---------------------------------------------------------------------------
+// devicesession Constructor (private)
+//
+// Arguments:
+//
+//	NONE
+
+devicesession::devicesession()
+{
+  // Create the worker thread to close idle resources
+  m_worker = std::thread(&devicesession::worker, this);
+}
+
+//---------------------------------------------------------------------------
+// devicesession Destructor
+
+devicesession::~devicesession()
+{
+  m_stop = true; // Signal worker thread to stop
+  if (m_worker.joinable())
+    m_worker.join(); // Wait for thread
+
+  reset();
+}
+
+//---------------------------------------------------------------------------
+// devicesession::acquire
+//
+// Acquires a free device from the candidates, preferring one already tuned nearby
+//
+// Arguments:
+//
+//	candidates	- Devices that can be used, in order of preference
+//	frequency	- Frequency the device will be tuned to
+
+std::unique_ptr<rtldevice> devicesession::acquire(std::vector<candidate> const& candidates,
+                                                  uint32_t frequency)
+{
+  std::exception_ptr failure; // Exception thrown opening a candidate device
+
+  // iscandidate (local)
+  //
+  // Determines if a connection string belongs to one of the candidate devices
+  auto iscandidate = [&](std::string const& connection) -> bool
+  {
+    return std::any_of(candidates.begin(), candidates.end(), [&](candidate const& item) -> bool
+                       { return item.connection == connection; });
+  };
+
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // A second pass is made after releasing any lingering receiver, which returns
+  // the device it owns to the session
+  for (int pass = 0; pass < 2; pass++)
+  {
+
+    // Prefer the idle device that was last tuned closest to the requested frequency,
+    // its tuner has already settled and there's less for the PLL to do
+    auto found = m_devices.end();
+    uint32_t distance = UINT32_MAX;
+    for (auto it = m_devices.begin(); it != m_devices.end(); ++it)
+    {
+
+      if (!iscandidate((*it)->connection))
+        continue;
+
+      uint32_t const delta = ((*it)->frequency > frequency) ? (*it)->frequency - frequency
+                                                            : frequency - (*it)->frequency;
+      if ((found == m_devices.end()) || (delta < distance))
+      {
+
+        found = it;
+        distance = delta;
+      }
+    }
+
+    if (found != m_devices.end())
+    {
+
+      std::unique_ptr<device_t> device = std::move(*found);
+      m_devices.erase(found);
+      m_inuse.insert(device->connection);
+
+      return std::unique_ptr<rtldevice>(new sessiondevice(shared_from_this(), std::move(device)));
+    }
+
+    // Open the first candidate device that isn't already open; the connection is reserved
+    // while the device is being opened since that can take some time
+    for (auto const& item : candidates)
+    {
+
+      if (m_inuse.find(item.connection) != m_inuse.end())
+        continue;
+
+      m_inuse.insert(item.connection);
+      lock.unlock();
+
+      try
+      {
+
+        std::unique_ptr<device_t> device = std::make_unique<device_t>();
+        device->connection = item.connection;
+        device->device = item.factory();
+
+        return std::unique_ptr<rtldevice>(new sessiondevice(shared_from_this(), std::move(device)));
+      }
+
+      catch (...)
+      {
+        failure = std::current_exception();
+      }
+
+      lock.lock();
+      m_inuse.erase(item.connection);
+    }
+
+    // Release the lingering receiver outside of the lock and try again
+    std::shared_ptr<void> receiver = std::move(m_receiver);
+    if (!receiver)
+      break;
+
+    lock.unlock();
+    receiver.reset();
+    lock.lock();
+  }
+
+  // Report the reason the last candidate device could not be opened, if there was one
+  if (failure)
+    std::rethrow_exception(failure);
+
+  throw string_exception(__func__, ": no RTL-SDR device is available");
+}
+
+//---------------------------------------------------------------------------
+// devicesession::available
+//
+// Determines if any of the candidate devices is not currently in use
+//
+// Arguments:
+//
+//	candidates	- Devices that can be used
+
+bool devicesession::available(std::vector<candidate> const& candidates) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  return std::any_of(candidates.begin(), candidates.end(), [&](candidate const& item) -> bool
+                     { return m_inuse.find(item.connection) == m_inuse.end(); });
+}
+
+//---------------------------------------------------------------------------
+// devicesession::create (static)
+//
+// Factory method, creates a new devicesession instance
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<devicesession> devicesession::create(void)
+{
+  return std::shared_ptr<devicesession>(new devicesession());
+}
+
+//---------------------------------------------------------------------------
+// devicesession::linger
+//
+// Keeps a DSP receiver alive for a short period after its stream is closed
+//
+// Arguments:
+//
+//	receiver	- DSP receiver instance
+
+void devicesession::linger(std::shared_ptr<void> receiver)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  std::shared_ptr<void> previous = std::move(m_receiver);
+  m_receiver = std::move(receiver);
+  m_receiveridle = std::chrono::steady_clock::now();
+  lock.unlock();
+
+  previous.reset(); // Release outside of the lock
+}
+
+//---------------------------------------------------------------------------
+// devicesession::release (private)
+//
+// Returns a device to the session
+//
+// Arguments:
+//
+//	device		- Device to be returned
+
+void devicesession::release(std::unique_ptr<device_t> device)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  m_inuse.erase(device->connection);
+  device->idle = std::chrono::steady_clock::now();
+  m_devices.push_back(std::move(device));
+}
+
+//---------------------------------------------------------------------------
+// devicesession::reset
+//
+// Closes the idle devices and releases any lingering DSP receiver
+//
+// Arguments:
+//
+//	NONE
+
+void devicesession::reset(void)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  std::shared_ptr<void> receiver = std::move(m_receiver);
+  lock.unlock();
+
+  // The receiver has to be released first as it returns its device to the session
+  receiver.reset();
+
+  lock.lock();
+  std::vector<std::unique_ptr<device_t>> devices = std::move(m_devices);
+  m_devices.clear();
+  lock.unlock();
+
+  devices.clear();
+}
+
+//---------------------------------------------------------------------------
+// devicesession::worker (private)
+//
+// Worker thread procedure used to close idle resources
+//
+// Arguments:
+//
+//	NONE
+
+void devicesession::worker(void)
+{
+  while (m_stop.wait_until_equals(true, 1000) == false)
+  {
+
+    std::shared_ptr<void> receiver;
+    std::vector<std::unique_ptr<device_t>> devices;
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+
+    if ((m_receiver) && ((now - m_receiveridle) >= RECEIVER_LINGER_TIMEOUT))
+      receiver = std::move(m_receiver);
+
+    for (auto it = m_devices.begin(); it != m_devices.end();)
+    {
+
+      if ((now - (*it)->idle) >= DEVICE_IDLE_TIMEOUT)
+      {
+
+        devices.push_back(std::move(*it));
+        it = m_devices.erase(it);
+      }
+
+      else
+        ++it;
+    }
+
+    lock.unlock();
+
+    // Release the resources outside of the lock
+    receiver.reset();
+    devices.clear();
+  }
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice Constructor
+//
+// Arguments:
+//
+//	session		- Parent devicesession instance
+//	device		- Device state
+
+devicesession::sessiondevice::sessiondevice(std::weak_ptr<devicesession> session,
+                                            std::unique_ptr<device_t> device)
+  : m_session(std::move(session)), m_device(std::move(device))
+{
+  assert(m_device && m_device->device);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice Destructor
+
+devicesession::sessiondevice::~sessiondevice()
+{
+  // Return the device to the session if it still exists, otherwise it is closed
+  std::shared_ptr<devicesession> session = m_session.lock();
+  if (session)
+    session->release(std::move(m_device));
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::begin_stream
+//
+// Starts streaming data from the device
+//
+// Arguments:
+//
+//	NONE
+
+void devicesession::sessiondevice::begin_stream(void) const
+{
+  m_device->device->begin_stream();
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::cancel_async
+//
+// Cancels any pending asynchronous read operations from the device
+//
+// Arguments:
+//
+//	NONE
+
+void devicesession::sessiondevice::cancel_async(void) const
+{
+  m_device->device->cancel_async();
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::get_device_name
+//
+// Gets the name of the device
+//
+// Arguments:
+//
+//	NONE
+
+char const* devicesession::sessiondevice::get_device_name(void) const
+{
+  return m_device->device->get_device_name();
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::get_valid_gains
+//
+// Gets the valid tuner gain values for the device
+//
+// Arguments:
+//
+//	dbs			- vector<> to retrieve the valid gain values
+
+void devicesession::sessiondevice::get_valid_gains(std::vector<int>& dbs) const
+{
+  m_device->device->get_valid_gains(dbs);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::read
+//
+// Reads data from the device
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the data
+//	count		- Size of the destination buffer, specified in bytes
+
+size_t devicesession::sessiondevice::read(uint8_t* buffer, size_t count) const
+{
+  return m_device->device->read(buffer, count);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::read_async
+//
+// Asynchronously reads data from the device
+//
+// Arguments:
+//
+//	callback		- Asynchronous read callback function
+//	bufferlength	- Output buffer length in bytes
+
+void devicesession::sessiondevice::read_async(asynccallback const& callback,
+                                              uint32_t bufferlength) const
+{
+  m_device->device->read_async(callback, bufferlength);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_automatic_gain_control
+//
+// Enables/disables the automatic gain control mode of the device
+//
+// Arguments:
+//
+//	enable		- Flag to enable/disable automatic gain control
+
+void devicesession::sessiondevice::set_automatic_gain_control(bool enable) const
+{
+  m_device->device->set_automatic_gain_control(enable);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_center_frequency
+//
+// Sets the center frequency of the device
+//
+// Arguments:
+//
+//	hz		- Center frequency to set, specified in hertz
+
+uint32_t devicesession::sessiondevice::set_center_frequency(uint32_t hz) const
+{
+  // Track the frequency to prefer this device for nearby channels once it's idle
+  m_device->frequency = m_device->device->set_center_frequency(hz);
+  return m_device->frequency;
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_frequency_correction
+//
+// Sets the frequency correction of the device
+//
+// Arguments:
+//
+//	ppm		- Frequency correction to set, specified in parts per million
+
+int devicesession::sessiondevice::set_frequency_correction(int ppm) const
+{
+  return m_device->device->set_frequency_correction(ppm);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_gain
+//
+// Sets the gain value of the device
+//
+// Arguments:
+//
+//	db			- New gain value, specified in tenths of a decibel
+
+int devicesession::sessiondevice::set_gain(int db) const
+{
+  return m_device->device->set_gain(db);
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_sample_rate
+//
+// Sets the sample rate of the device
+//
+// Arguments:
+//
+//	hz		- Sample rate to set, specified in hertz
+
+uint32_t devicesession::sessiondevice::set_sample_rate(uint32_t hz) const
+{
+  // Changing the sample rate reprograms the demodulator and the tuner bandwidth,
+  // skip that when a reused device is already running at the requested rate
+  if ((m_device->requestedrate != hz) || (m_device->samplerate == 0))
+  {
+
+    m_device->samplerate = m_device->device->set_sample_rate(hz);
+    m_device->requestedrate = hz;
+  }
+
+  return m_device->samplerate;
+}
+
+//---------------------------------------------------------------------------
+// devicesession::sessiondevice::set_test_mode
+//
+// Enables/disables the test mode of the device
+//
+// Arguments:
+//
+//	enable		- Flag to enable/disable test mode
+
+void devicesession::sessiondevice::set_test_mode(bool enable) const
+{
+  m_device->device->set_test_mode(enable);
+}
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
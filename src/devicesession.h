@@ -0,0 +1,201 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __DEVICESESSION_H_
+#define __DEVICESESSION_H_
+#pragma once
+
+#include "rtldevice.h"
+#include "utils/scalar_condition.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class devicesession
+//
+// Pool of the RTL-SDR devices available to the addon.  Each device is used by
+// a single stream at a time; devices acquired from the session are returned to
+// it rather than closed when they are released so that changing channels only
+// requires the device to be retuned, and the DSP receiver of the last stream
+// can be kept alive briefly to be reattached
+
+class devicesession : public std::enable_shared_from_this<devicesession>
+{
+public:
+  // Destructor
+  //
+  ~devicesession();
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // device_factory
+  //
+  // Function used to create a new device when one cannot be reused
+  using device_factory = std::function<std::unique_ptr<rtldevice>(void)>;
+
+  // candidate
+  //
+  // Device that can be acquired from the session
+  struct candidate
+  {
+
+    std::string connection; // Device connection string
+    device_factory factory; // Function to open the device
+  };
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // acquire
+  //
+  // Acquires a free device from the candidates, preferring one already tuned nearby
+  std::unique_ptr<rtldevice> acquire(std::vector<candidate> const& candidates, uint32_t frequency);
+
+  // available
+  //
+  // Determines if any of the candidate devices is not currently in use
+  bool available(std::vector<candidate> const& candidates) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new devicesession instance
+  static std::shared_ptr<devicesession> create(void);
+
+  // linger
+  //
+  // Keeps a DSP receiver alive for a short period after its stream is closed
+  void linger(std::shared_ptr<void> receiver);
+
+  // reset
+  //
+  // Closes the idle devices and releases any lingering DSP receiver
+  void reset(void);
+
+private:
+  devicesession(devicesession const&) = delete;
+  devicesession& operator=(devicesession const&) = delete;
+
+  // DEVICE_IDLE_TIMEOUT
+  //
+  // Length of time an idle device is kept open
+  static std::chrono::seconds const DEVICE_IDLE_TIMEOUT;
+
+  // RECEIVER_LINGER_TIMEOUT
+  //
+  // Length of time a DSP receiver is kept alive after its stream is closed
+  static std::chrono::seconds const RECEIVER_LINGER_TIMEOUT;
+
+  // Instance Constructor
+  //
+  devicesession();
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // device_t
+  //
+  // State of an open device owned by the session
+  struct device_t
+  {
+
+    std::string connection; // Device connection string
+    std::unique_ptr<rtldevice> device; // Device instance
+    uint32_t frequency = 0; // Last applied center frequency
+    uint32_t requestedrate = 0; // Last requested sample rate
+    uint32_t samplerate = 0; // Last applied sample rate
+    std::chrono::steady_clock::time_point idle; // Time the device became idle
+  };
+
+  // sessiondevice
+  //
+  // Device acquired from the session; returns the device to the session
+  class sessiondevice : public rtldevice
+  {
+  public:
+    // Instance Constructor / Destructor
+    //
+    sessiondevice(std::weak_ptr<devicesession> session, std::unique_ptr<device_t> device);
+    virtual ~sessiondevice();
+
+    // rtldevice
+    //
+    void begin_stream(void) const override;
+    void cancel_async(void) const override;
+    char const* get_device_name(void) const override;
+    void get_valid_gains(std::vector<int>& dbs) const override;
+    size_t read(uint8_t* buffer, size_t count) const override;
+    void read_async(asynccallback const& callback, uint32_t bufferlength) const override;
+    void set_automatic_gain_control(bool enable) const override;
+    uint32_t set_center_frequency(uint32_t hz) const override;
+    int set_frequency_correction(int ppm) const override;
+    int set_gain(int db) const override;
+    uint32_t set_sample_rate(uint32_t hz) const override;
+    void set_test_mode(bool enable) const override;
+
+  private:
+    sessiondevice(sessiondevice const&) = delete;
+    sessiondevice& operator=(sessiondevice const&) = delete;
+
+    std::weak_ptr<devicesession> const m_session; // Parent session
+    std::unique_ptr<device_t> m_device; // Device state
+  };
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // release
+  //
+  // Returns a device to the session
+  void release(std::unique_ptr<device_t> device);
+
+  // worker
+  //
+  // Worker thread procedure used to close idle resources
+  void worker(void);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::vector<std::unique_ptr<device_t>> m_devices; // Idle devices
+  std::set<std::string> m_inuse; // Connections of the acquired devices
+  std::shared_ptr<void> m_receiver; // Lingering DSP receiver
+  std::chrono::steady_clock::time_point m_receiveridle; // Time the receiver began lingering
+  mutable std::mutex m_lock; // Synchronization object
+  std::thread m_worker; // Idle resource worker thread
+  scalar_condition<bool> m_stop{false}; // Condition to stop the worker
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __DEVICESESSION_H_
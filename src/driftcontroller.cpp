@@ -0,0 +1,151 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "driftcontroller.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#pragma warning(push, 4)
+
+// driftcontroller::FILTER_TIME
+//
+// Time constant of the filter applied to the queue depth
+std::chrono::milliseconds const driftcontroller::FILTER_TIME = std::chrono::seconds(5);
+
+// driftcontroller::INTEGRAL_PPM
+//
+// Integral gain; ppm per percent of error per second
+double const driftcontroller::INTEGRAL_PPM = 1.0;
+
+// driftcontroller::MAX_CORRECTION_PPM
+//
+// Maximum correction that will be applied to the resampler ratio
+double const driftcontroller::MAX_CORRECTION_PPM = 1000.0; // ~1.7 cents of pitch
+
+// driftcontroller::PROPORTIONAL_PPM
+//
+// Proportional gain; ppm per percent of error
+double const driftcontroller::PROPORTIONAL_PPM = 300.0;
+
+// driftcontroller::SETPOINT_PERCENT
+//
+// Queue occupancy the controller steers towards
+double const driftcontroller::SETPOINT_PERCENT = 25.0;
+
+//---------------------------------------------------------------------------
+// driftcontroller Constructor
+//
+// Arguments:
+//
+//	NONE
+
+driftcontroller::driftcontroller() : m_lastupdate(std::chrono::steady_clock::now())
+{
+}
+
+//---------------------------------------------------------------------------
+// driftcontroller::ppm
+//
+// Gets the current correction in parts per million
+//
+// Arguments:
+//
+//	NONE
+
+double driftcontroller::ppm(void) const
+{
+  return m_ppm;
+}
+
+//---------------------------------------------------------------------------
+// driftcontroller::reset
+//
+// Resets the controller after a stream discontinuity
+//
+// Arguments:
+//
+//	NONE
+
+void driftcontroller::reset(void)
+{
+  m_locked = false;
+  m_filtered = m_integral = m_ppm = 0.0;
+}
+
+//---------------------------------------------------------------------------
+// driftcontroller::update
+//
+// Updates the controller with the current queue depth and gets the ratio
+//
+// Arguments:
+//
+//	depth		- Current depth of the demux packet queue
+//	capacity	- Capacity of the demux packet queue
+
+double driftcontroller::update(size_t depth, size_t capacity)
+{
+  assert(capacity > 0);
+
+  auto const now = std::chrono::steady_clock::now();
+  double const percent = (depth * 100.0) / capacity;
+
+  // The controller doesn't engage until the queue has reached the setpoint; until
+  // then Kodi is still filling its own buffers and drains the queue on demand
+  if (!m_locked)
+  {
+
+    if (percent < SETPOINT_PERCENT)
+      return 1.0;
+
+    m_locked = true;
+    m_filtered = percent;
+    m_lastupdate = now;
+  }
+
+  double const elapsed = std::chrono::duration<double>(now - m_lastupdate).count();
+  double const filtertime = std::chrono::duration<double>(FILTER_TIME).count();
+  m_lastupdate = now;
+
+  // Kodi reads from the queue in bursts, the depth is filtered to remove the
+  // short-term variation and leave the slow trend caused by the clock drift
+  m_filtered += (percent - m_filtered) * std::min(elapsed / filtertime, 1.0);
+
+  double const error = m_filtered - SETPOINT_PERCENT;
+  double const proportional = error * PROPORTIONAL_PPM;
+
+  // The integral term is only accumulated while the output isn't saturated,
+  // otherwise it would wind up during a large initial error and overshoot
+  double const integral = m_integral + (error * INTEGRAL_PPM * elapsed);
+  if (std::fabs(proportional + integral) < MAX_CORRECTION_PPM)
+    m_integral = integral;
+
+  // A deeper queue means audio is being produced faster than it's consumed; a
+  // positive correction increases the resampler ratio and produces fewer samples
+  m_ppm = std::max(-MAX_CORRECTION_PPM, std::min(proportional + m_integral, MAX_CORRECTION_PPM));
+  return 1.0 + (m_ppm / 1000000.0);
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
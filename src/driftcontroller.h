@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __DRIFTCONTROLLER_H_
+#define __DRIFTCONTROLLER_H_
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class driftcontroller
+//
+// Implements a closed-loop controller that compensates for the drift between
+// the tuner device clock and the clock that Kodi consumes the audio with.  The
+// depth of the demux packet queue is steered towards a fixed setpoint by
+// slightly adjusting the ratio of the output audio resampler, which keeps the
+// latency of the stream constant no matter how long it runs.
+//
+// The controller isn't thread-safe, it's expected to be updated from the
+// thread that produces the audio
+
+class driftcontroller
+{
+public:
+  // Instance Constructor
+  //
+  driftcontroller();
+
+  // Destructor
+  //
+  ~driftcontroller() = default;
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // ppm
+  //
+  // Gets the current correction in parts per million
+  double ppm(void) const;
+
+  // reset
+  //
+  // Resets the controller after a stream discontinuity
+  void reset(void);
+
+  // update
+  //
+  // Updates the controller with the current queue depth and gets the ratio
+  double update(size_t depth, size_t capacity);
+
+private:
+  driftcontroller(driftcontroller const&) = delete;
+  driftcontroller& operator=(driftcontroller const&) = delete;
+
+  // FILTER_TIME
+  //
+  // Time constant of the filter applied to the queue depth
+  static std::chrono::milliseconds const FILTER_TIME;
+
+  // INTEGRAL_PPM
+  //
+  // Integral gain; ppm per percent of error per second
+  static double const INTEGRAL_PPM;
+
+  // MAX_CORRECTION_PPM
+  //
+  // Maximum correction that will be applied to the resampler ratio
+  static double const MAX_CORRECTION_PPM;
+
+  // PROPORTIONAL_PPM
+  //
+  // Proportional gain; ppm per percent of error
+  static double const PROPORTIONAL_PPM;
+
+  // SETPOINT_PERCENT
+  //
+  // Queue occupancy the controller steers towards
+  static double const SETPOINT_PERCENT;
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  bool m_locked = false; // Flag if the queue has reached the setpoint
+  double m_filtered = 0.0; // Filtered queue occupancy (percent)
+  double m_integral = 0.0; // Integral term (ppm)
+  double m_ppm = 0.0; // Current correction (ppm)
+  std::chrono::steady_clock::time_point m_lastupdate; // Time of the last update
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __DRIFTCONTROLLER_H_
@@ -23,6 +23,7 @@
  *
  */
 
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include "decoder_adapter.h"
@@ -50,6 +51,9 @@ DecoderAdapter::DecoderAdapter(ProgrammeHandlerInterface &mr, int16_t bitRate, A
 
     // MOT, start of X-PAD data group, see EN 301 234
     padDecoder.SetMOTAppType(12);
+
+    // MB: Added - forward the undecoded stream for recording
+    decoder->AddUntouchedStreamConsumer(this);
 }
 
 void DecoderAdapter::addtoFrame(uint8_t *v)
@@ -99,18 +103,19 @@ void DecoderAdapter::PutAudio(const uint8_t *data, size_t len)
     size_t bufferSize = audioChannels == 2 ? len/2 : len;
     std::vector<int16_t> audio(bufferSize);
 
-    // Convert two uint8 into a int16 sample
+    // Stereo samples are already interleaved little-endian int16, no
+    // conversion is required. The vector is handed to the consumer as-is.
+    if (audioChannels == 2) {
+        memcpy(audio.data(), data, bufferSize * sizeof(int16_t));
+        myInterface.onNewAudio(std::move(audio), audioSamplerate, audioFormat);
+        return;
+    }
+
+    // Convert two uint8 into a int16 sample and upmix to stereo
     for(size_t i=0; i<len/2; ++i) {
         int16_t sample =  ((int16_t) data[i * 2 +1] << 8) | ((int16_t) data[i * 2]);
-
-        if (audioChannels == 2) {
-            audio[i] = sample;
-        }
-        else {
-        	// upmix to stereo
-            audio[i*2] = sample;
-            audio[i*2+1] = sample;
-        }
+        audio[i*2] = sample;
+        audio[i*2+1] = sample;
     }
 
     myInterface.onNewAudio(
@@ -175,3 +180,9 @@ void DecoderAdapter::PADLengthError(size_t announced_xpad_len, size_t xpad_len)
 {
     myInterface.onPADLengthError(announced_xpad_len, xpad_len);
 }
+
+// MB: Added
+void DecoderAdapter::ProcessUntouchedStream(const uint8_t *data, size_t len, size_t duration_ms)
+{
+    myInterface.onUntouchedStream(data, len, duration_ms, decoder->GetUntouchedStreamFileExtension());
+}
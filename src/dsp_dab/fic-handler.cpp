@@ -26,6 +26,7 @@
 #include "fic-handler.h"
 #include "msc-handler.h"
 #include "protTables.h"
+#include <algorithm>
 
 //  The 3072 bits of the serial motherword shall be split into
 //  24 blocks of 128 bits each.
@@ -113,8 +114,16 @@ void FicHandler::processFicBlock(const softbit_t *data, int16_t blkno)
     if (blkno == 1) {
         index = 0;
         ficno = 0;
+
+        // MB: Added
+        const int interval = decodeInterval.load();
+        skipFrame = (interval > 1) && ((frameCount++ % interval) != 0);
     }
 
+    // MB: Added
+    if (skipFrame)
+        return;
+
     if ((1 <= blkno) && (blkno <= 3)) {
         for (int i = 0; i < bitsperBlock; i ++) {
             ofdm_input[index ++] = data[i];
@@ -239,3 +248,9 @@ int FicHandler::getFicDecodeRatioPercent()
     return fic_decode_success_ratio * 10;
 }
 
+// MB: Added
+void FicHandler::setDecodeInterval(int interval)
+{
+    decodeInterval.store(std::max(interval, 1));
+}
+
@@ -28,6 +28,7 @@
 #ifndef __FIC_HANDLER
 #define __FIC_HANDLER
 
+#include <atomic>
 #include <mutex>
 #include <cstdio>
 #include <cstdint>
@@ -43,6 +44,8 @@ class FicHandler: public Viterbi
         void    setBitsperBlock(int16_t b);
         void    clearEnsemble();
         int     getFicDecodeRatioPercent();
+        // MB: Added
+        void    setDecodeInterval(int interval);
 
         FIBProcessor fibProcessor;
 
@@ -62,6 +65,11 @@ class FicHandler: public Viterbi
         // Saturating up/down-counter in range [0, 10] corresponding
         // to the number of FICs with correct CRC
         int         fic_decode_success_ratio = 0;
+
+        // MB: Added
+        std::atomic<int> decodeInterval{1};
+        unsigned int frameCount = 0;
+        bool        skipFrame = false;
 };
 
 #endif
@@ -45,6 +45,8 @@
 //
 #define SEARCH_RANGE        (2 * 36)
 #define CORRELATION_LENGTH  24
+//  Number of frames to hold off the coarse corrector search after a warm start
+#define WARM_START_HOLDOFF  10
 
 /**
   * \brief OFDMProcessor
@@ -129,8 +131,20 @@ void OFDMProcessor::restart()
         threadHandle.join();
     }
 
-    coarseCorrector    = 0;
-    fineCorrector      = 0;
+    {
+        // Seed the correctors from a previous lock on this channel, if known
+        std::lock_guard<std::mutex> lock(receiver_options_mutex);
+        if (receiver_options.warmStart) {
+            coarseCorrector     = receiver_options.initialCoarseCorrector;
+            fineCorrector       = receiver_options.initialFineCorrector;
+            coarseSearchHoldoff = WARM_START_HOLDOFF;
+        }
+        else {
+            coarseCorrector     = 0;
+            fineCorrector       = 0;
+            coarseSearchHoldoff = 0;
+        }
+    }
     syncBufferIndex    = 0;
     sLevel             = 0;
     localPhase         = 0;
@@ -402,7 +416,12 @@ SyncOnPhase:
         //  reception glitch might provoke a long delay until it resyncs properly.
         //  As long as some FICs have correct CRC, we assume the coarse corrector cannot
         //  be off.
-        if (!rro.disableCoarseCorrector and ficHandler.getFicDecodeRatioPercent() < 50) {
+        if (coarseSearchHoldoff > 0) {
+            //  Warm start: give the seeded correctors a chance to lock before
+            //  searching, the search is slow and may discard a good offset
+            coarseSearchHoldoff--;
+        }
+        else if (!rro.disableCoarseCorrector and ficHandler.getFicDecodeRatioPercent() < 50) {
             if (!coarseSyncCounter) {
                 //std::clog << "ofdm-processor: " << "Lost coarse sync (coarseCorrector: " << lastValidCoarseCorrector << "; fineCorrector: " <<  lastValidFineCorrector << ")" << std::endl;
             }
@@ -87,6 +87,7 @@ class OFDMProcessor
         int32_t T_s;
         int32_t T_F;
         int32_t coarseSyncCounter = 0;
+        int32_t coarseSearchHoldoff = 0;
 
         std::vector<DSPCOMPLEX> oscillatorTable;
 
@@ -173,6 +173,17 @@ class ProgrammeHandlerInterface {
          * and effective X-PAD length.
          */
         virtual void onPADLengthError(size_t announced_xpad_len, size_t xpad_len) {}
+
+        // MB: Added (dabreceiver.cpp)
+        /* Signal-to-Noise Ratio of the ensemble was calculated, forwarded
+         * from RadioControllerInterface::onSNR. snr is a value in dB. */
+        virtual void onSNR(float snr) {}
+
+        // MB: Added (decoder_adapter.cpp)
+        /* A frame of the undecoded audio stream is available; MP2 frames
+         * for DAB and LATM/LOAS framed AUs for DAB+. extension is the file
+         * extension suited to the stream ("mp2" or "aac"). */
+        virtual void onUntouchedStream(const uint8_t* data, size_t len, size_t durationMs, const std::string& extension) {}
 };
 
 enum class DeviceParam {
@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 // see OFDMProcessor::processPRS() for more information about these methods
 enum class FreqsyncMethod { GetMiddle = 0, CorrelatePRS = 1, PatternOfZeros = 2 };
 
@@ -81,5 +83,19 @@ struct RadioReceiverOptions {
     // Which method to use for the freqsyncmethod used in the coarse corrector.
     // Has no effect when coarse corrector is disabled.
     FreqsyncMethod freqsyncMethod = FreqsyncMethod::PatternOfZeros;
+
+    // Set to true to seed the frequency correctors with the offsets that
+    // were previously found for this channel and device. The coarse
+    // corrector search is held off for a few frames after a restart to
+    // give the seeded offsets the opportunity to lock.
+    bool warmStart = false;
+    int initialCoarseCorrector = 0;
+    int16_t initialFineCorrector = 0;
+
+    // MB: Added
+    // Only every Nth frame of FIC data is decoded, 1 decodes every frame.
+    // The ensemble information changes rarely, so a longer interval can be
+    // used to save CPU when it's scarce.
+    int ficDecodeInterval = 1;
 };
 
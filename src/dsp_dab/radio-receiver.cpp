@@ -78,7 +78,10 @@ RadioReceiver::RadioReceiver(
         mscHandler,
         ficHandler,
         rro)
-{ }
+{
+    // MB: Added
+    ficHandler.setDecodeInterval(rro.ficDecodeInterval);
+}
 
 void RadioReceiver::restart(bool doScan)
 {
@@ -114,8 +117,11 @@ void RadioReceiver::setReceiverOptions(const RadioReceiverOptions rro)
         "TII: " << rro.decodeTII <<
         " disable coarse corr: " << rro.disableCoarseCorrector <<
         " freqsync: " << fsm <<
-        " fft placement: " << fftPlacementMethodToString(rro.fftPlacementMethod) << endl;
+        " fft placement: " << fftPlacementMethodToString(rro.fftPlacementMethod) <<
+        " fic interval: " << rro.ficDecodeInterval << endl;
     ofdmProcessor.setReceiverOptions(rro);
+    // MB: Added
+    ficHandler.setDecodeInterval(rro.ficDecodeInterval);
 }
 
 bool RadioReceiver::playSingleProgramme(ProgrammeHandlerInterface& handler,
@@ -144,6 +150,27 @@ bool RadioReceiver::removeServiceToDecode(const Service& s)
     return false;
 }
 
+bool RadioReceiver::addSubchannelToDecode(ProgrammeHandlerInterface& handler,
+        AudioServiceComponentType ascty,
+        const std::string& dumpFileName, const Subchannel& sub)
+{
+    if (not sub.valid()) {
+        return false;
+    }
+
+    if (ascty != AudioServiceComponentType::DAB &&
+        ascty != AudioServiceComponentType::DABPlus) {
+        return false;
+    }
+
+    return mscHandler.addSubchannel(handler, ascty, dumpFileName, sub);
+}
+
+bool RadioReceiver::removeSubchannelToDecode(const Subchannel& sub)
+{
+    return mscHandler.removeSubchannel(sub);
+}
+
 bool RadioReceiver::playProgramme(ProgrammeHandlerInterface& handler,
         const Service& s, const std::string& dumpFileName, bool unique)
 {
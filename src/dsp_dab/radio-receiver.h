@@ -80,6 +80,15 @@ class RadioReceiver {
 
         bool removeServiceToDecode(const Service& s);
 
+        /* Decode an audio subchannel whose organisation is already known,
+         * for example from a cache, without waiting for the FIC to
+         * describe it. */
+        bool addSubchannelToDecode(ProgrammeHandlerInterface& handler,
+                AudioServiceComponentType ascty,
+                const std::string& dumpFileName, const Subchannel& sub);
+
+        bool removeSubchannelToDecode(const Subchannel& sub);
+
         uint16_t getEnsembleId(void) const;
         uint8_t getEnsembleEcc(void) const;
         DabLabel getEnsembleLabel(void) const;
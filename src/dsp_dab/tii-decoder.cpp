@@ -32,7 +32,7 @@
 
 using namespace std;
 
-static const int tii_pattern[70][8] = { // {{{
+static constexpr int tii_pattern[70][8] = { // {{{
     {0,0,0,0,1,1,1,1},
     {0,0,0,1,0,1,1,1},
     {0,0,0,1,1,0,1,1},
@@ -104,6 +104,55 @@ static const int tii_pattern[70][8] = { // {{{
     {1,1,1,0,1,0,0,0},
     {1,1,1,1,0,0,0,0} }; // }}}
 
+/* The TII carriers of comb c and pattern p are the carrier pairs starting at
+ * k = 1 + 2c + 48b (in [0, 384[) for each bit b set in the pattern. Each odd
+ * carrier in that range therefore belongs to exactly one comb and one bit,
+ * and to the 35 patterns that have that bit set. Both maps are generated at
+ * compile time rather than building a hash map on every receiver start. */
+struct tii_carrier_t {
+    int comb; // -1 if the carrier does not start a TII pair
+    int bit;
+};
+
+struct tii_carrier_map_t {
+    tii_carrier_t carrier[384];
+};
+
+struct tii_bit_patterns_t {
+    int count[8];
+    int pattern[8][70];
+};
+
+static constexpr tii_carrier_map_t make_tii_carrier_map()
+{
+    tii_carrier_map_t map = {};
+    for (carrier_t k = 0; k < 384; k++) {
+        map.carrier[k].comb = -1;
+        map.carrier[k].bit = -1;
+        if (k % 2 == 1) {
+            map.carrier[k].comb = ((k - 1) / 2) % 24;
+            map.carrier[k].bit = ((k - 1) / 2) / 24;
+        }
+    }
+    return map;
+}
+
+static constexpr tii_bit_patterns_t make_tii_bit_patterns()
+{
+    tii_bit_patterns_t patterns = {};
+    for (int b = 0; b < 8; b++) {
+        for (int p = 0; p < 70; p++) {
+            if (tii_pattern[p][b]) {
+                patterns.pattern[b][patterns.count[b]++] = p;
+            }
+        }
+    }
+    return patterns;
+}
+
+static constexpr tii_carrier_map_t tii_carrier_map = make_tii_carrier_map();
+static constexpr tii_bit_patterns_t tii_bit_patterns = make_tii_bit_patterns();
+
 bool operator==(const CombPattern& lhs, const CombPattern& rhs)
 {
     return lhs.comb == rhs.comb and lhs.pattern == rhs.pattern;
@@ -114,18 +163,17 @@ std::vector<carrier_t> CombPattern::generateCarriers() const
     std::vector<carrier_t> carriers;
     carriers.reserve(32);
 
-    for (carrier_t k = 0; k < 384; k++) {
-        for (int b = 0; b < 8; b++) {
-            if (k == 1 + 2*comb + 48*b and tii_pattern[pattern][b]) {
-                carriers.push_back(k - 769);
-                carriers.push_back(k - 769 + 1);
-                carriers.push_back(k - 385);
-                carriers.push_back(k - 385 + 1);
-                carriers.push_back(k);
-                carriers.push_back(k + 1);
-                carriers.push_back(k + 384);
-                carriers.push_back(k + 384 + 1);
-            }
+    for (int b = 0; b < 8; b++) {
+        if (tii_pattern[pattern][b]) {
+            const carrier_t k = 1 + 2*comb + 48*b;
+            carriers.push_back(k - 769);
+            carriers.push_back(k - 769 + 1);
+            carriers.push_back(k - 385);
+            carriers.push_back(k - 385 + 1);
+            carriers.push_back(k);
+            carriers.push_back(k + 1);
+            carriers.push_back(k + 384);
+            carriers.push_back(k + 384 + 1);
         }
     }
 
@@ -142,28 +190,19 @@ float tii_measurement_t::getDelayKm(void) const
 
 TIIDecoder::TIIDecoder(const DABParams& params, RadioControllerInterface& ri) :
     m_radioInterface(ri),
-    m_params(params),
-    m_fft_null(params.T_u),
-    m_fft_prs(params.T_u)
+    m_params(params)
 {
     if (m_params.dabMode != 1) {
         clog << "TII decoder does not support mode " << m_params.dabMode << endl;
         return;
     }
 
-    for (int c = 0; c < 24; c++) {
-        for (int p = 0; p < 70; p++) {
-            for (carrier_t k = 0; k < 384; k++) {
-                for (int b = 0; b < 8; b++) {
-                    if (k == 1 + 2*c + 48*b and tii_pattern[p][b]) {
-                        m_cp_per_carrier[k].emplace(c, p);
-                    }
-                }
-            }
-        }
-    }
-
-    m_thread = thread(&TIIDecoder::run, this);
+    // The FFTW planner is not thread-safe, so the plans are created here
+    // along with the other OFDM plans rather than on the OFDM thread. The
+    // analysis thread is only started once symbols have been pushed, i.e.
+    // when TII decoding has been requested
+    m_fft_null = make_unique<fft::Forward>(m_params.T_u);
+    m_fft_prs = make_unique<fft::Forward>(m_params.T_u);
 }
 
 TIIDecoder::~TIIDecoder()
@@ -182,8 +221,15 @@ void TIIDecoder::pushSymbols(
         const std::vector<complexf>& null,
         const std::vector<complexf>& prs)
 {
+    if (m_params.dabMode != 1) {
+        return;
+    }
+
     unique_lock<mutex> lock(m_state_mutex);
     if (m_state == State::Idle) {
+        if (not m_thread.joinable()) {
+            m_thread = thread(&TIIDecoder::run, this);
+        }
         m_prs = prs;
         m_null = null;
         m_state = State::NullPrsReady;
@@ -220,16 +266,16 @@ void TIIDecoder::run()
                     " vs " + to_string(nullsize));
         }
         copy(m_null.begin() + null_skip, m_null.begin() + null_skip + spacing,
-                m_fft_null.getVector());
-        m_fft_null.do_FFT();
+                m_fft_null->getVector());
+        m_fft_null->do_FFT();
 
         // The phase reference symbol, assume cyclic prefix absent
         if (m_prs.size() < spacing) {
             throw out_of_range("PRS length: " + to_string(m_prs.size()) +
                     " vs " + to_string(spacing));
         }
-        copy(m_prs.begin(), m_prs.begin() + spacing, m_fft_prs.getVector());
-        m_fft_prs.do_FFT();
+        copy(m_prs.begin(), m_prs.begin() + spacing, m_fft_prs->getVector());
+        m_fft_prs->do_FFT();
 
         /* In TM1, the carriers repeat four times:
          * [-768, -384[
@@ -257,12 +303,12 @@ void TIIDecoder::run()
         */
 
         for (size_t i = 0; i < 192; i++) {
-            const complexf *p = m_fft_prs.getVector();
+            const complexf *p = m_fft_prs->getVector();
             prs_power_sq[i] = norm(p[1 + 2*i]);
         }
 
         const size_t k_start[] = {2048 - 768, 2048 - 384, 1, 385};
-        const complexf *n = m_fft_null.getVector();
+        const complexf *n = m_fft_null->getVector();
         for (size_t k : k_start) {
             for (size_t i = 0; i < 192; i++) {
                 // The two consecutive carriers should have the
@@ -293,10 +339,13 @@ void TIIDecoder::run()
 
         unordered_map<CombPattern, int> cp_count;
         for (const carrier_t k : carriers) {
-            if (m_cp_per_carrier.count(k)) {
-                for (const auto& cps : m_cp_per_carrier[k]) {
-                    cp_count[cps]++;
-                }
+            if (k < 0 or k >= 384 or tii_carrier_map.carrier[k].comb < 0) {
+                continue;
+            }
+            const int comb = tii_carrier_map.carrier[k].comb;
+            const int bit = tii_carrier_map.carrier[k].bit;
+            for (int i = 0; i < tii_bit_patterns.count[bit]; i++) {
+                cp_count[CombPattern(comb, tii_bit_patterns.pattern[bit][i])]++;
             }
         }
 
@@ -327,8 +376,8 @@ void TIIDecoder::analyse_phase(const CombPattern& cp)
 {
     const auto carriers = cp.generateCarriers();
 
-    const complexf *n = m_fft_null.getVector();
-    const complexf *p = m_fft_prs.getVector();
+    const complexf *n = m_fft_null->getVector();
+    const complexf *p = m_fft_prs->getVector();
 
     auto k_to_ix = [](carrier_t k) -> int {
         if (k < 0)
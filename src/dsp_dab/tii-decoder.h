@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <list>
+#include <memory>
 #include <vector>
 #include <mutex>
 #include <thread>
@@ -82,9 +83,6 @@ class TIIDecoder {
         std::vector<complexf> m_null;
         std::vector<complexf> m_prs;
 
-        std::unordered_map<carrier_t, std::unordered_set<CombPattern> >
-            m_cp_per_carrier;
-
         enum class State { Idle, NullPrsReady, Abort };
 
         std::thread m_thread;
@@ -92,8 +90,9 @@ class TIIDecoder {
         std::condition_variable m_state_changed;
         State m_state = State::Idle;
 
-        fft::Forward m_fft_null;
-        fft::Forward m_fft_prs;
+        // Created in the constructor; the FFTW planner is not thread-safe
+        std::unique_ptr<fft::Forward> m_fft_null;
+        std::unique_ptr<fft::Forward> m_fft_prs;
 
         struct cp_error_measurement_t {
             std::unordered_map<float, uint64_t> error_per_correction;
@@ -152,6 +152,24 @@ void CDemodulator::SetDemod(int Mode, tDemodInfo CurrentDemodInfo)
 	m_InBufLimit &= 0xFFFFFF00;	//keep modulo 256 since decimation is only in power of 2
 }
 
+//////////////////////////////////////////////////////////////////
+//	Called to change the WFM downsample quality of a running demodulator;
+// the decimation filters are regenerated but the output rate is unchanged
+//////////////////////////////////////////////////////////////////
+void CDemodulator::SetDownsampleQuality(enum DownsampleQuality Quality)
+{
+#ifdef FMDSP_THREAD_SAFE
+	std::unique_lock<std::mutex> lock(m_Mutex);
+#endif
+
+	m_DemodInfo.WfmDownsampleQuality = Quality;
+	if(m_DemodMode == DEMOD_WFM)
+	{
+		m_DownConvert.SetQuality(Quality);
+		m_DownConverterOutputRate = m_DownConvert.SetWfmDataRate(m_InputRate, 100000);
+	}
+}
+
 //////////////////////////////////////////////////////////////////
 //	Called with complex data from radio and performs the demodulation
 // with MONO audio output
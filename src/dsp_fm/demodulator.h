@@ -84,6 +84,12 @@ public:
 	int ProcessData(int InLength, TYPECPX* pInData, TYPECPX* pOutData);
 
 	void SetUSFmVersion(bool USFm){m_USFm = USFm;}
+
+	// change the WFM downsample quality of a running demodulator
+	void SetDownsampleQuality(enum DownsampleQuality Quality);
+
+	// enable or disable RDS demodulation in WFM stereo mode
+	void SetRdsEnabled(bool Enabled){ if(m_pWFmDemod) m_pWFmDemod->SetRdsEnabled(Enabled); }
 	bool GetUSFmVersion(){return m_USFm;}
 
 	// expose the input buffer limit
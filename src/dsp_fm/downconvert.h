@@ -64,7 +64,8 @@ public:
 	int ProcessData(int InLength, TYPECPX* pInData, TYPECPX* pOutData);
 	TYPEREAL SetDataRate(TYPEREAL InRate, TYPEREAL MaxBW);
 	TYPEREAL SetWfmDataRate(TYPEREAL InRate, TYPEREAL MaxBW);
-	void SetQuality(enum DownsampleQuality Quality) { m_Quality = Quality; }
+	//a change in quality forces the decimation filters to be regenerated by the next Set*DataRate()
+	void SetQuality(enum DownsampleQuality Quality) { if(m_Quality != Quality) { m_Quality = Quality; m_InRate = 0.0; } }
 
 private:
 	////////////
@@ -364,57 +364,61 @@ TYPEREAL LminusR;
 		}
         m_PilotLocked = false;
 	}
-	//translate 57KHz RDS signal to baseband and decimate RDS complex signal
-	int length = m_RdsDownConvert.ProcessData(InLength, m_CpxRawFm, m_RdsRaw);
+	//RDS demodulation can be skipped when the caller is short on processing time
+	if(m_RdsEnabled)
+	{
+		//translate 57KHz RDS signal to baseband and decimate RDS complex signal
+		int length = m_RdsDownConvert.ProcessData(InLength, m_CpxRawFm, m_RdsRaw);
 
-	//filter baseband RDS signal
-	m_RdsBPFilter.ProcessFilter(length, m_RdsRaw, m_RdsRaw);
+		//filter baseband RDS signal
+		m_RdsBPFilter.ProcessFilter(length, m_RdsRaw, m_RdsRaw);
 
-	//PLL to remove any rotation since may not be phase locked to 19KHz Pilot or may not even have pilot
-	ProcessRdsPll(length, m_RdsRaw, m_RdsMag);
+		//PLL to remove any rotation since may not be phase locked to 19KHz Pilot or may not even have pilot
+		ProcessRdsPll(length, m_RdsRaw, m_RdsMag);
 
-	//run matched filter correlator to extract the bi-phase data bits
-	m_RdsMatchedFilter.ProcessFilter(length,m_RdsMag,m_RdsData);
-	//create bit sync signal in m_RdsMag[] by squaring data
-	for(int i=0; i<length; i++)
-		m_RdsMag[i] = m_RdsData[i]* m_RdsData[i];	//has high energy at the bit clock rate and 2x bit rate
+		//run matched filter correlator to extract the bi-phase data bits
+		m_RdsMatchedFilter.ProcessFilter(length,m_RdsMag,m_RdsData);
+		//create bit sync signal in m_RdsMag[] by squaring data
+		for(int i=0; i<length; i++)
+			m_RdsMag[i] = m_RdsData[i]* m_RdsData[i];	//has high energy at the bit clock rate and 2x bit rate
 
-	//run Hi-Q resonator filter that create a sin wave that will lock to BitRate clock and not 2X rate
-	m_RdsBitSyncFilter.ProcessFilter(length, m_RdsMag, m_RdsMag);
-	//now loop through samples to determine where bit position is and extract binary digital data
-	for(int i=0; i<length; i++)
-	{
-		TYPEREAL Data = m_RdsData[i];
-		TYPEREAL SyncVal = m_RdsMag[i];
-		//the best bit sync position is at the positive peak of the sync sine wave
-		TYPEREAL Slope = SyncVal - m_RdsLastSync;	//current slope
-		m_RdsLastSync = SyncVal;
-		//see if at the top of the sine wave
-		if( (Slope<0.0) && (m_RdsLastSyncSlope*Slope)<0.0 )
-		{	//are at sample time so read previous bit time since we are one sample behind in sync position
-			int bit;
-			if(m_RdsLastData>=0)
-			{
-				bit = 1;
-				m_RdsRaw[i].re = m_RdsLastData;
+		//run Hi-Q resonator filter that create a sin wave that will lock to BitRate clock and not 2X rate
+		m_RdsBitSyncFilter.ProcessFilter(length, m_RdsMag, m_RdsMag);
+		//now loop through samples to determine where bit position is and extract binary digital data
+		for(int i=0; i<length; i++)
+		{
+			TYPEREAL Data = m_RdsData[i];
+			TYPEREAL SyncVal = m_RdsMag[i];
+			//the best bit sync position is at the positive peak of the sync sine wave
+			TYPEREAL Slope = SyncVal - m_RdsLastSync;	//current slope
+			m_RdsLastSync = SyncVal;
+			//see if at the top of the sine wave
+			if( (Slope<0.0) && (m_RdsLastSyncSlope*Slope)<0.0 )
+			{	//are at sample time so read previous bit time since we are one sample behind in sync position
+				int bit;
+				if(m_RdsLastData>=0)
+				{
+					bit = 1;
+					m_RdsRaw[i].re = m_RdsLastData;
+				}
+				else
+				{
+					bit = 0;
+					m_RdsRaw[i].re = m_RdsLastData;
+				}
+				//need to XOR with previous bit to get actual data bit value
+				ProcessNewRdsBit(bit^m_RdsLastBit);		//go process new RDS Bit
+				m_RdsLastBit = bit;
 			}
 			else
 			{
-				bit = 0;
-				m_RdsRaw[i].re = m_RdsLastData;
+				m_RdsRaw[i].re = 0;
 			}
-			//need to XOR with previous bit to get actual data bit value
-			ProcessNewRdsBit(bit^m_RdsLastBit);		//go process new RDS Bit
-			m_RdsLastBit = bit;
-		}
-		else
-		{
-			m_RdsRaw[i].re = 0;
-		}
 
-		m_RdsLastData = Data;		//keep last bit since is differential data
-		m_RdsLastSyncSlope = Slope;
-		m_RdsRaw[i].im = Data;
+			m_RdsLastData = Data;		//keep last bit since is differential data
+			m_RdsLastSyncSlope = Slope;
+			m_RdsRaw[i].im = Data;
+		}
 	}
 
 	//decimate by 2's down close to final audio rate
@@ -60,6 +60,7 @@ public:
 
 	bool GetNextRdsGroupData(tRDS_GROUPS* pGroupData);
 	int GetStereoLock(int* pPilotLock);
+	void SetRdsEnabled(bool Enabled){m_RdsEnabled = Enabled;}
 
 private:
 	void InitDeemphasis( TYPEREAL Time, TYPEREAL SampleRate);	//create De-emphasis LP filter
@@ -129,6 +130,7 @@ private:
 	CIir m_RdsBitSyncFilter;
 	TYPEREAL m_RdsOutputRate;
 	int m_RdsLastBit;
+	bool m_RdsEnabled = true;
 	tRDS_GROUPS m_RdsGroupQueue[RDS_Q_SIZE];
 	int m_RdsQHead;
 	int m_RdsQTail;
@@ -98,12 +98,103 @@ static float filter_taps_am[] = {
     0
 };
 
+/*
+ * Correlates every sample of the acquisition block with the sample one FFT
+ * length later and accumulates the products across all of the symbols. The
+ * complex values are handled as interleaved floats with the symbol loop on
+ * the outside so that the inner loop is contiguous and can be vectorized by
+ * the compiler, which also avoids the C99 complex multiplication helper.
+ */
+static void correlate_symbols(const float *buffer, float *sums, unsigned int fftcp, unsigned int fft)
+{
+    unsigned int i, j;
+
+    memset(sums, 0, sizeof(float) * 2 * fftcp);
+    for (j = 0; j < ACQUIRE_SYMBOLS; ++j)
+    {
+        const float *x = &buffer[2 * j * fftcp];
+        const float *y = &buffer[2 * (j * fftcp + fft)];
+
+        for (i = 0; i < 2 * fftcp; i += 2)
+        {
+            // x * conj(y)
+            sums[i] += x[i] * y[i] + x[i + 1] * y[i + 1];
+            sums[i + 1] += x[i + 1] * y[i] - x[i] * y[i + 1];
+        }
+    }
+}
+
+/*
+ * The cyclic prefix window is the product of the rising and falling edges of
+ * the pulse shape, sin(pi/2 j/cp) * cos(pi/2 j/cp) = sin(pi j/cp) / 2. As the
+ * sine is the difference of two complex exponentials, the windowed sum can be
+ * slid along the correlation with two recursive running sums instead of being
+ * recomputed at each offset:
+ *
+ *   A(i+1) = (A(i) - s[i] - s[i+cp]) * exp(-j pi/cp)
+ *   B(i+1) = (B(i) - s[i] - s[i+cp]) * exp(+j pi/cp)
+ *   v(i)   = (A(i) - B(i)) / 4j
+ *
+ * The running sums are kept in double precision to prevent the error from
+ * accumulating across the block.
+ */
+static unsigned int find_symbol_start(const float *sums, unsigned int fftcp, unsigned int cp, fcomplex_t *max_v)
+{
+    double rot_re = cos(M_PI / cp), rot_im = sin(M_PI / cp);
+    double a_re = 0, a_im = 0, b_re = 0, b_im = 0;
+    double ph_re = 1, ph_im = 0, t;
+    double max_mag = -1.0;
+    unsigned int i, j, max_i = 0;
+
+    for (j = 0; j < cp; ++j)
+    {
+        a_re += sums[2 * j] * ph_re - sums[2 * j + 1] * ph_im;
+        a_im += sums[2 * j] * ph_im + sums[2 * j + 1] * ph_re;
+        b_re += sums[2 * j] * ph_re + sums[2 * j + 1] * ph_im;
+        b_im += sums[2 * j + 1] * ph_re - sums[2 * j] * ph_im;
+
+        t = ph_re * rot_re - ph_im * rot_im;
+        ph_im = ph_re * rot_im + ph_im * rot_re;
+        ph_re = t;
+    }
+
+    for (i = 0; i < fftcp; ++i)
+    {
+        double v_re = (a_im - b_im) / 4;
+        double v_im = (b_re - a_re) / 4;
+        double mag = v_re * v_re + v_im * v_im;
+        unsigned int k = (i + cp) % fftcp;
+
+        if (mag > max_mag)
+        {
+            max_mag = mag;
+            *max_v = CMPLXF(v_re, v_im);
+            max_i = i;
+        }
+
+        a_re -= sums[2 * i] + sums[2 * k];
+        a_im -= sums[2 * i + 1] + sums[2 * k + 1];
+        b_re -= sums[2 * i] + sums[2 * k];
+        b_im -= sums[2 * i + 1] + sums[2 * k + 1];
+
+        t = a_re * rot_re + a_im * rot_im;
+        a_im = a_im * rot_re - a_re * rot_im;
+        a_re = t;
+
+        t = b_re * rot_re - b_im * rot_im;
+        b_im = b_im * rot_re + b_re * rot_im;
+        b_re = t;
+    }
+
+    return max_i;
+}
+
 void acquire_process(acquire_t *st)
 {
     fcomplex_t max_v = CMPLXFSET(0), phase_increment;
-    float angle, angle_diff, angle_factor, max_mag = -1.0f;
+    float angle, angle_diff, angle_factor;
     int samperr = 0;
-    unsigned int i, j, keep;
+    unsigned int i, keep;
 
     if (st->idx != st->fftcp * (ACQUIRE_SYMBOLS + 1))
         return;
@@ -127,29 +218,9 @@ void acquire_process(acquire_t *st)
             st->buffer[i] = (st->mode == NRSC5_MODE_FM) ? cq15_to_cf_conj(y) : cq15_to_cf(y);
         }
 
-        memset(st->sums, 0, sizeof(fcomplex_t) * st->fftcp);
-        for (i = 0; i < st->fftcp; ++i)
-        {
-            for (j = 0; j < ACQUIRE_SYMBOLS; ++j)
-                st->sums[i] = CMPLXFADD(st->sums[i], CMPLXFMUL(st->buffer[i + j * st->fftcp], conjf(st->buffer[i + j * st->fftcp + st->fft])));
-        }
-
-        for (i = 0; i < st->fftcp; ++i)
-        {
-            float mag;
-            fcomplex_t v = CMPLXFSET(0);
-
-            for (j = 0; j < st->cp; ++j)
-                v = CMPLXFADD(v, CMPLXFMULF(CMPLXFMULF(st->sums[(i + j) % st->fftcp], st->shape[j]), st->shape[j + st->fft]));
-
-            mag = normf(v);
-            if (mag > max_mag)
-            {
-                max_mag = mag;
-                max_v = v;
-                samperr = (i + st->fftcp - FILTER_DELAY) % st->fftcp;
-            }
-        }
+        correlate_symbols((const float *) st->buffer, (float *) st->sums, st->fftcp, st->fft);
+        i = find_symbol_start((const float *) st->sums, st->fftcp, st->cp, &max_v);
+        samperr = (i + st->fftcp - FILTER_DELAY) % st->fftcp;
 
         angle_diff = cargf(CMPLXFMUL(max_v, cexpf(CMPLXFMULF(I, -st->prev_angle))));
         angle_factor = (st->prev_angle) ? 0.25 : 1.0;
@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "config.h"
+#include "conv_simd.h"
+
+#ifdef CONV_X86_SIMD
+
+// Compile the SSE trellis kernel for AVX2; the kernel uses VPBROADCASTW for
+// normalization and the compiler emits the non-destructive VEX encodings
+#define HAVE_SSE4_1
+#define HAVE_AVX2
+#define SSE_TARGET CONV_TARGET("avx2")
+#include "conv_sse.h"
+
+CONV_TARGET("avx2")
+void conv_avx2_metrics_k7_n3(const int8_t *val, const int16_t *out,
+			     int16_t *sums, int16_t *paths, int norm)
+{
+	gen_metrics_k7_n3(val, out, sums, paths, norm);
+}
+
+#endif	// CONV_X86_SIMD
@@ -19,20 +19,10 @@
  * Author: Tom Tsou <tom.tsou@ettus.com>
  */
 
-// Hack fix about build with SSE use.
-// Currently it always generate within Linux by use on call function e.g. like this
-// "error: inlining failed in call to ‘always_inline’ ‘_mm_minpos_epu16’: target specific option mismatch".
-// This fix prevent the use about if something has set in defines.
-//
-#if defined(HAVE_SSE3) && defined(TARGET_LINUX)
-#warning Undefined HAVE_SSE3 to workaround compile problems
-#undef HAVE_SSE3
-#endif
-
 #include "config.h"
 
 #include <stdlib.h>
-#ifndef __APPLE__
+#ifdef _WIN32
 #include <malloc.h>
 #endif
 #include <string.h>
@@ -43,9 +33,8 @@
 #include "conv.h"
 
 #include "conv_gen.h"
-#if defined(HAVE_SSE3)
-#include "conv_sse.h"
-#elif defined(HAVE_NEON)
+#include "conv_simd.h"
+#if defined(CONV_ARM_NEON)
 #include "conv_neon.h"
 #endif
 
@@ -108,16 +97,60 @@ struct vdecoder {
  *
  * SSE requires 16-byte memory alignment. We store relevant trellis values
  * (accumulated sums, outputs, and path decisions) as 16 bit signed integers
- * so the allocated memory is casted as such.
+ * so the allocated memory is casted as such. The SIMD kernel is selected at
+ * runtime so the memory is always aligned.
  */
 #define SSE_ALIGN	16
 
 static int16_t *vdec_malloc(size_t n)
 {
-#if defined(HAVE_SSE3) && !defined(__APPLE__)
-	return (int16_t *) memalign(SSE_ALIGN, sizeof(int16_t) * n);
+#ifdef _WIN32
+	return (int16_t *) _aligned_malloc(sizeof(int16_t) * n, SSE_ALIGN);
 #else
-	return (int16_t *) malloc(sizeof(int16_t) * n);
+	void *ptr = NULL;
+	if (posix_memalign(&ptr, SSE_ALIGN, sizeof(int16_t) * n) != 0)
+		return NULL;
+	return (int16_t *) ptr;
+#endif
+}
+
+static void vdec_free(int16_t *ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+/*
+ * Select the K=7, N=3 metrics function
+ *
+ * On x86 the fastest kernel supported by the CPU is selected at runtime, on
+ * ARM the NEON kernel is selected at compile time.
+ */
+typedef void (*metrics_func_t)(const int8_t *, const int16_t *,
+			       int16_t *, int16_t *, int);
+
+static metrics_func_t select_metrics_k7_n3(void)
+{
+#if defined(CONV_X86_SIMD)
+	static metrics_func_t selected = NULL;
+
+	if (selected == NULL) {
+		if (cpu_has_avx2())
+			selected = conv_avx2_metrics_k7_n3;
+		else if (cpu_has_sse41())
+			selected = conv_sse41_metrics_k7_n3;
+		else
+			selected = gen_metrics_k7_n3_generic;
+	}
+
+	return selected;
+#elif defined(CONV_ARM_NEON)
+	return gen_metrics_k7_n3;
+#else
+	return gen_metrics_k7_n3_generic;
 #endif
 }
 
@@ -208,8 +241,8 @@ static void free_trellis(struct vtrellis *trellis)
 		return;
 
 	free(trellis->vals);
-	free(trellis->outputs);
-	free(trellis->sums);
+	vdec_free(trellis->outputs);
+	vdec_free(trellis->sums);
 	free(trellis);
 }
 
@@ -353,7 +386,8 @@ static void free_vdec(struct vdecoder *dec)
 	if (!dec)
 		return;
 
-	free(dec->paths[0]);
+	if (dec->paths)
+		vdec_free(dec->paths[0]);
 	free(dec->paths);
 	free_trellis(dec->trellis);
 	free(dec);
@@ -390,6 +424,11 @@ static struct vdecoder *alloc_vdec(const struct lte_conv_code *code)
 	if (!dec->trellis)
 		goto fail;
 
+	if (dec->k == 7)
+		dec->metric_func = select_metrics_k7_n3();
+	else
+		dec->metric_func = gen_metrics_k9_n3;
+
 	dec->paths = (int16_t **) malloc(sizeof(int16_t *) * dec->len);
 	dec->paths[0] = vdec_malloc(ns * dec->len);
 	for (i = 1; i < dec->len; i++)
@@ -420,18 +459,11 @@ static void _conv_decode(struct vdecoder *dec, const int8_t *seq, int term, int
 		if (term == CONV_TERM_TAIL_BITING && j == len)
 			j = 0;
 
-		if (dec->k == 7)
-			gen_metrics_k7_n3(&seq[dec->n * j],
-					 trellis->outputs,
-					 trellis->sums,
-					 dec->paths[i],
-					 !(i % dec->intrvl));
-		else if (dec->k == 9)
-			gen_metrics_k9_n3(&seq[dec->n * j],
-					 trellis->outputs,
-					 trellis->sums,
-					 dec->paths[i],
-					 !(i % dec->intrvl));
+		dec->metric_func(&seq[dec->n * j],
+				 trellis->outputs,
+				 trellis->sums,
+				 dec->paths[i],
+				 !(i % dec->intrvl));
 	}
 }
 
@@ -79,7 +79,7 @@ static void _gen_path_metrics(int num_states, int16_t *sums,
 {
 	int i;
 	int16_t min;
-	int16_t* new_sums = malloc(num_states * sizeof(int16_t));
+	int16_t new_sums[256];
 
 	for (i = 0; i < num_states / 2; i++) {
 		acs_butterfly(i, num_states, metrics[i],
@@ -98,11 +98,9 @@ static void _gen_path_metrics(int num_states, int16_t *sums,
 	}
 
 	memcpy(sums, new_sums, num_states * sizeof(int16_t));
-	free(new_sums);
 }
 
-#if !defined(HAVE_SSE3) && !defined(HAVE_NEON)
-static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
+static void gen_metrics_k7_n3_generic(const int8_t *seq, const int16_t *out,
 		       int16_t *sums, int16_t *paths, int norm)
 {
 	int16_t metrics[32];
@@ -111,7 +109,6 @@ static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
 	_gen_path_metrics(64, sums, metrics, paths, norm);
 
 }
-#endif
 
 static void gen_metrics_k9_n3(const int8_t *seq, const int16_t *out,
 		       int16_t *sums, int16_t *paths, int norm)
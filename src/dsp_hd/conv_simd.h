@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __CONV_SIMD_H_
+#define __CONV_SIMD_H_
+#pragma once
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+// x86/x64
+//
+// The SSE4.1 and AVX2 trellis kernels are compiled into their own translation
+// units with per-function target attributes, the decoder selects one of them
+// at runtime based on the capabilities of the CPU
+#if defined(CPU_X86)
+
+#define CONV_X86_SIMD
+#define CONV_TARGET(x) CPU_TARGET(x)
+
+void conv_sse41_metrics_k7_n3(const int8_t *val, const int16_t *out,
+			      int16_t *sums, int16_t *paths, int norm);
+void conv_avx2_metrics_k7_n3(const int8_t *val, const int16_t *out,
+			     int16_t *sums, int16_t *paths, int norm);
+
+// ARM
+//
+// NEON is mandatory on AArch64 and implied by the compiler flags on ARMv7
+// when __ARM_NEON is defined, it's selected at compile time
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+
+#define CONV_ARM_NEON
+
+#endif
+
+#endif	// __CONV_SIMD_H_
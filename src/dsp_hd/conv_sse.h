@@ -33,6 +33,14 @@
 #include <immintrin.h>
 #endif
 
+/*
+ * Function target attribute, allows the kernel to be compiled for a specific
+ * instruction set without changing the flags for the entire build
+ */
+#ifndef SSE_TARGET
+#define SSE_TARGET
+#endif
+
 /*
  * Octo-Viterbi butterfly
  *
@@ -230,7 +238,7 @@
  * trellis. 32 butterfly operations are computed. Deinterleave path
  * metrics before computing branch metrics as in the half rate case.
  */
-static inline void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
+static inline SSE_TARGET void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
 					int16_t *sums, int16_t *paths, int norm)
 {
 	__m128i m0, m1, m2, m3, m4, m5, m6, m7;
@@ -314,7 +322,7 @@ static inline void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
 	_mm_store_si128((__m128i *) &sums[56], m11);
 }
 
-static void gen_metrics_k7_n3(const int8_t *val, const int16_t *out,
+static SSE_TARGET void gen_metrics_k7_n3(const int8_t *val, const int16_t *out,
 		       int16_t *sums, int16_t *paths, int norm)
 {
 	const int16_t _val[8] = { val[0], val[1], val[2], 0, val[0], val[1], val[2], 0 };
@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "config.h"
+#include "cpu.h"
+
+#ifdef CPU_X86
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+/*
+ * CPU feature detection
+ *
+ * AVX2 also requires the operating system to save the YMM registers, which
+ * __builtin_cpu_supports() accounts for but the raw CPUID bits do not.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+int cpu_has_sse41(void)
+{
+	int regs[4];
+
+	__cpuid(regs, 1);
+	return ((regs[2] & (1 << 9)) != 0) && ((regs[2] & (1 << 19)) != 0);
+}
+
+int cpu_has_avx2(void)
+{
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return 0;
+
+	/* OSXSAVE and AVX, with XMM and YMM state enabled by the OS */
+	__cpuid(regs, 1);
+	if ((regs[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+	if ((_xgetbv(0) & 0x06) != 0x06)
+		return 0;
+
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+}
+#else
+int cpu_has_sse41(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+}
+
+int cpu_has_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif	// CPU_X86
@@ -196,6 +196,24 @@ static void descramble(uint8_t *buf, unsigned int length)
     }
 }
 
+/*
+ * Determines if the bit error rate should be measured for the current frame.
+ * Measuring requires re-encoding the decoded frame so it's only done for every
+ * Nth frame, or not at all if the interval is zero.
+ */
+static int ber_due(decode_t *st)
+{
+    int due;
+
+    if (st->ber_interval == 0)
+        return 0;
+
+    due = (st->ber_count == 0);
+    st->ber_count = (st->ber_count + 1) % st->ber_interval;
+
+    return due;
+}
+
 void decode_process_p1(decode_t *st)
 {
     const int J = 20, B = 16, C = 36;
@@ -217,7 +235,8 @@ void decode_process_p1(decode_t *st)
     }
 
     nrsc5_conv_decode_p1(st->viterbi_p1, st->scrambler_p1);
-    nrsc5_report_ber(st->input->radio, (float) bit_errors_p1_fm(st->viterbi_p1, st->scrambler_p1) / P1_FRAME_LEN_ENCODED_FM);
+    if (ber_due(st))
+        nrsc5_report_ber(st->input->radio, (float) bit_errors_p1_fm(st->viterbi_p1, st->scrambler_p1) / P1_FRAME_LEN_ENCODED_FM);
     descramble(st->scrambler_p1, P1_FRAME_LEN_FM);
     frame_push(&st->input->frame, st->scrambler_p1, P1_FRAME_LEN_FM);
 }
@@ -315,6 +334,7 @@ void decode_process_pids_am(decode_t *st)
 void decode_process_p1_p3_am(decode_t *st)
 {
     int total_errors = 0;
+    int measure_ber;
 
     interleaver_ma1(st);
 
@@ -324,19 +344,24 @@ void decode_process_p1_p3_am(decode_t *st)
         return;
     }
 
+    measure_ber = ber_due(st);
+
     for (int block = 0; block < 8; block++)
     {
         nrsc5_conv_decode_e1(st->viterbi_p1_am + (block * P1_FRAME_LEN_AM * 3), st->scrambler_p1_am, P1_FRAME_LEN_AM);
-        total_errors += bit_errors_p1_am(st->viterbi_p1_am + (block * P1_FRAME_LEN_AM * 3), st->scrambler_p1_am);
+        if (measure_ber)
+            total_errors += bit_errors_p1_am(st->viterbi_p1_am + (block * P1_FRAME_LEN_AM * 3), st->scrambler_p1_am);
         descramble(st->scrambler_p1_am, P1_FRAME_LEN_AM);
         frame_push(&st->input->frame, st->scrambler_p1_am, P1_FRAME_LEN_AM);
     }
     nrsc5_conv_decode_e2(st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_AM);
-    total_errors += bit_errors_p3_am(st->viterbi_p3_am, st->scrambler_p3_am);
+    if (measure_ber)
+        total_errors += bit_errors_p3_am(st->viterbi_p3_am, st->scrambler_p3_am);
     descramble(st->scrambler_p3_am, P3_FRAME_LEN_AM);
     frame_push(&st->input->frame, st->scrambler_p3_am, P3_FRAME_LEN_AM);
 
-    nrsc5_report_ber(st->input->radio, (float) total_errors / (8 * P1_FRAME_LEN_ENCODED_AM + P3_FRAME_LEN_ENCODED_AM));
+    if (measure_ber)
+        nrsc5_report_ber(st->input->radio, (float) total_errors / (8 * P1_FRAME_LEN_ENCODED_AM + P3_FRAME_LEN_ENCODED_AM));
 }
 
 void decode_reset(decode_t *st)
@@ -348,11 +373,19 @@ void decode_reset(decode_t *st)
     st->i_p3 = 0;
     st->ready_p3 = 0;
     memset(st->pt_p3, 0, sizeof(unsigned int) * 4);
+    st->ber_count = 0;
     pids_init(&st->pids, st->input);
 }
 
 void decode_init(decode_t *st, struct input_t *input)
 {
     st->input = input;
+    st->ber_interval = 1;
     decode_reset(st);
 }
+
+void decode_set_ber_interval(decode_t *st, unsigned int interval)
+{
+    st->ber_interval = interval;
+    st->ber_count = 0;
+}
@@ -48,8 +48,12 @@ typedef struct
     uint8_t scrambler_p3_am[P3_FRAME_LEN_AM];
 
     pids_t pids;
+
+    unsigned int ber_interval;
+    unsigned int ber_count;
 } decode_t;
 
+void decode_set_ber_interval(decode_t *st, unsigned int interval);
 void decode_process_p1(decode_t *st);
 void decode_process_pids(decode_t *st);
 void decode_process_p3(decode_t *st);
@@ -59,22 +63,29 @@ static inline unsigned int decode_get_block(decode_t *st)
 {
     return st->idx_pm / (720 * BLKSZ);
 }
-static inline void decode_push_pm(decode_t *st, int8_t sbit)
+static inline int8_t *decode_get_pm(decode_t *st)
 {
-    st->buffer_pm[st->idx_pm++] = sbit;
-    if (st->idx_pm % (720 * BLKSZ) == 0)
-    {
-        decode_process_pids(st);
-    }
+    return &st->buffer_pm[st->idx_pm];
+}
+static inline void decode_commit_pm(decode_t *st)
+{
+    // a whole block of soft bits was written at decode_get_pm()
+    st->idx_pm += 720 * BLKSZ;
+    decode_process_pids(st);
     if (st->idx_pm == 720 * BLKSZ * 16)
     {
         decode_process_p1(st);
         st->idx_pm = 0;
     }
 }
-static inline void decode_push_px1(decode_t *st, int8_t sbit)
+static inline int8_t *decode_get_px1(decode_t *st)
+{
+    return &st->buffer_px1[st->idx_px1];
+}
+static inline void decode_commit_px1(decode_t *st)
 {
-    st->buffer_px1[st->idx_px1++] = sbit;
+    // a whole block of soft bits was written at decode_get_px1()
+    st->idx_px1 += 144 * BLKSZ;
     if (st->idx_px1 % (144 * BLKSZ * 2) == 0)
     {
         decode_process_p3(st);
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifdef HAVE_NEON
 #include <arm_neon.h>
@@ -14,6 +15,12 @@
 #include "firdecim_q15.h"
 
 #define WINDOW_SIZE 2048
+// Allows the vectorized halfband to load past the last sample in the window
+#define WINDOW_PAD 16
+
+typedef unsigned int (*halfband_block_func_t)(const cint16_t *, const int16_t *, cint16_t *, unsigned int);
+
+static halfband_block_func_t select_halfband_block(void);
 
 firdecim_q15 firdecim_q15_create(const float * taps, unsigned int ntaps)
 {
@@ -22,7 +29,7 @@ firdecim_q15 firdecim_q15_create(const float * taps, unsigned int ntaps)
     q = malloc(sizeof(*q));
     q->ntaps = (ntaps == 32) ? 32 : 15;
     q->taps = malloc(sizeof(int16_t) * ntaps * 2);
-    q->window = calloc(sizeof(cint16_t), WINDOW_SIZE);
+    q->window = calloc(sizeof(cint16_t), WINDOW_SIZE + WINDOW_PAD);
     firdecim_q15_reset(q);
 
     // reverse order so we can push into the window
@@ -46,6 +53,7 @@ void firdecim_q15_free(firdecim_q15 q)
 void firdecim_q15_reset(firdecim_q15 q)
 {
     q->idx = q->ntaps - 1;
+    q->phase = 0;
 }
 
 static void push(firdecim_q15 q, cint16_t x)
@@ -156,3 +164,83 @@ void halfband_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y)
     *y = dotprod_halfband_4(&q->window[q->idx - q->ntaps], q->taps);
     push(q, x[1]);
 }
+
+/*
+ * Block mode halfband decimator
+ *
+ * Decimates n input samples by two, returning the number of output samples
+ * written to y. The input is copied into the window as a whole and the outputs
+ * computed from it afterwards, which allows the filter to be run in place
+ * (x == y) and stages to be cascaded over the same buffer. An odd number of
+ * samples is carried over to the next call.
+ */
+unsigned int halfband_q15_execute_block(firdecim_q15 q, const cint16_t *x, unsigned int n, cint16_t *y)
+{
+    static halfband_block_func_t block_func = NULL;
+    unsigned int count = 0;
+
+    if (block_func == NULL)
+        block_func = select_halfband_block();
+
+    while (n > 0)
+    {
+        unsigned int len, start, outputs, k;
+        const cint16_t *a;
+
+        if (q->idx == WINDOW_SIZE)
+        {
+            memmove(&q->window[0], &q->window[q->idx - q->ntaps + 1], sizeof(cint16_t) * (q->ntaps - 1));
+            q->idx = q->ntaps - 1;
+        }
+
+        len = WINDOW_SIZE - q->idx;
+        if (len > n)
+            len = n;
+
+        start = q->idx + q->phase;
+        memcpy(&q->window[q->idx], x, sizeof(cint16_t) * len);
+        q->idx += len;
+        x += len;
+        n -= len;
+
+        // An output is generated for the first sample of every pair
+        outputs = (start < q->idx) ? (q->idx - start + 1) / 2 : 0;
+        a = &q->window[start + 1 - q->ntaps];
+
+        k = block_func(a, q->taps, y, outputs);
+        for (; k < outputs; k++)
+            y[k] = dotprod_halfband_4((cint16_t *) &a[k * 2], q->taps);
+
+        q->phase = (q->phase + len) & 1;
+        y += outputs;
+        count += outputs;
+    }
+
+    return count;
+}
+
+static unsigned int halfband_block_generic(const cint16_t *a, const int16_t *taps, cint16_t *y, unsigned int n)
+{
+    (void) a;
+    (void) taps;
+    (void) y;
+    (void) n;
+
+    return 0;
+}
+
+/*
+ * Select the block mode halfband kernel
+ *
+ * On x86 the AVX2 kernel is selected at runtime if the CPU supports it. The
+ * generic implementation leaves all of the outputs to the scalar (or NEON)
+ * dot product.
+ */
+static halfband_block_func_t select_halfband_block(void)
+{
+#ifdef CPU_X86
+    if (cpu_has_avx2())
+        return halfband_q15_avx2;
+#endif
+    return halfband_block_generic;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "cpu.h"
 #include "defines.h"
 
 typedef struct _firdecim_q15 {
@@ -7,6 +8,7 @@ typedef struct _firdecim_q15 {
 	unsigned int ntaps;
 	cint16_t* window;
 	unsigned int idx;
+	unsigned int phase;
 } *firdecim_q15;
 
 firdecim_q15 firdecim_q15_create(const float * taps, unsigned int ntaps);
@@ -14,3 +16,8 @@ void firdecim_q15_free(firdecim_q15);
 void firdecim_q15_reset(firdecim_q15);
 void fir_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y);
 void halfband_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y);
+unsigned int halfband_q15_execute_block(firdecim_q15 q, const cint16_t *x, unsigned int n, cint16_t *y);
+
+#ifdef CPU_X86
+unsigned int halfband_q15_avx2(const cint16_t *a, const int16_t *taps, cint16_t *y, unsigned int n);
+#endif
@@ -0,0 +1,79 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "config.h"
+#include "firdecim_q15.h"
+
+#ifdef CPU_X86
+
+#include <immintrin.h>
+
+// Gathers the even elements p[0], p[2], ... p[14] of a complex Q15 array
+CPU_TARGET("avx2")
+static inline __m256i even8(const cint16_t *p)
+{
+    __m256 lo = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) &p[0]));
+    __m256 hi = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) &p[8]));
+    __m256i e = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    return _mm256_permute4x64_epi64(e, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// Computes eight consecutive halfband outputs at a time, the output k is the
+// filter applied to the window starting at a[2k]. The symmetric tap pairs are
+// summed and multiplied in 32 bits with VPMADDWD and truncated back to 16 bits
+// so the result is identical to the scalar implementation. Returns the number
+// of outputs computed, the caller is responsible for the remainder.
+CPU_TARGET("avx2")
+unsigned int halfband_q15_avx2(const cint16_t *a, const int16_t *taps, cint16_t *y, unsigned int n)
+{
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i t[4];
+    unsigned int k, m;
+
+    for (m = 0; m < 4; m++)
+        t[m] = _mm256_set1_epi16(taps[m * 2]);
+
+    for (k = 0; k + 8 <= n; k += 8, a += 16)
+    {
+        // Center tap, sign extended into 32 bits
+        __m256i c = even8(a + 7);
+        __m256i sum_lo = _mm256_srai_epi32(_mm256_unpacklo_epi16(zero, c), 16);
+        __m256i sum_hi = _mm256_srai_epi32(_mm256_unpackhi_epi16(zero, c), 16);
+
+        for (m = 0; m < 4; m++)
+        {
+            __m256i x0 = even8(a + m * 2);
+            __m256i x1 = even8(a + 14 - m * 2);
+            sum_lo = _mm256_add_epi32(sum_lo, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1), t[m]), 15));
+            sum_hi = _mm256_add_epi32(sum_hi, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1), t[m]), 15));
+        }
+
+        sum_lo = _mm256_and_si256(sum_lo, mask);
+        sum_hi = _mm256_and_si256(sum_hi, mask);
+        _mm256_storeu_si256((__m256i *) &y[k], _mm256_packus_epi32(sum_lo, sum_hi));
+    }
+
+    return k;
+}
+
+#endif	// CPU_X86
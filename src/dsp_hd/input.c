@@ -74,17 +74,19 @@ void input_set_skip(input_t *st, unsigned int skip)
 static void measure_snr(input_t *st, uint8_t *buf, uint32_t len)
 {
     unsigned int i, j;
+    const float *out = (const float *) st->snr_fft_out;
 
     // use a small FFT to calculate magnitude of frequency ranges
     for (j = 0; j + SNR_FFT_LEN <= len / 2; j += SNR_FFT_LEN)
     {
         for (i = 0; i < SNR_FFT_LEN; i++)
-            st->snr_fft_in[i] = CMPLXFMULF(CMPLXF(U8_F(buf[(i+j) * 2]), U8_F(buf[(i+j) * 2 + 1])), pow(sinf(M_PI*i/(SNR_FFT_LEN-1)), 2));
+            st->snr_fft_in[i] = CMPLXFMULF(CMPLXF(U8_F(buf[(i+j) * 2]), U8_F(buf[(i+j) * 2 + 1])), st->snr_window[i]);
         fftwf_execute(st->snr_fft);
         fftshift(st->snr_fft_out, SNR_FFT_LEN);
 
+        // accumulate the power of each bin from the interleaved real and imaginary parts
         for (i = 0; i < SNR_FFT_LEN; i++)
-            st->snr_power[i] += normf(st->snr_fft_out[i]);
+            st->snr_power[i] += out[i * 2] * out[i * 2] + out[i * 2 + 1] * out[i * 2 + 1];
         st->snr_cnt++;
     }
 
@@ -154,7 +156,7 @@ void input_push(input_t *st)
 
 void input_push_cu8(input_t *st, uint8_t *buf, uint32_t len)
 {
-    unsigned int i;
+    unsigned int i, n, count;
     assert(len % 4 == 0);
 
     if (st->snr_cb)
@@ -168,40 +170,36 @@ void input_push_cu8(input_t *st, uint8_t *buf, uint32_t len)
     if (input_shift(st, len / 4) != 0)
         return;
 
-    for (i = 0; i < len; i += 4)
+    // Convert and decimate the samples a block at a time, the AM stages are
+    // cascaded in place over the block so it stays in cache through all of them
+    for (; len > 0; buf += n * 2, len -= n * 2)
     {
-        cint16_t x[2];
-
-        x[0].r = U8_Q15(buf[i]);
-        x[0].i = U8_Q15(buf[i + 1]);
-        x[1].r = U8_Q15(buf[i + 2]);
-        x[1].i = U8_Q15(buf[i + 3]);
+        n = len / 2;
+        if (n > INPUT_BLOCK_LEN)
+            n = INPUT_BLOCK_LEN;
 
         if (st->radio->mode == NRSC5_MODE_FM)
         {
-            halfband_q15_execute(st->decim[0], x, &st->buffer[st->avail++]);
+            for (i = 0; i < n; i++)
+            {
+                st->block[i].r = U8_Q15(buf[i * 2]);
+                st->block[i].i = U8_Q15(buf[i * 2 + 1]);
+            }
+
+            st->avail += halfband_q15_execute_block(st->decim[0], st->block, n, &st->buffer[st->avail]);
         }
         else
         {
-            x[0].r >>= 4;
-            x[0].i >>= 4;
-            x[1].r >>= 4;
-            x[1].i >>= 4;
-
-            halfband_q15_execute(st->decim[0], x, &st->stages[0][st->offset & 1]);
-            if ((st->offset & 0x1) == 0x1) {
-                halfband_q15_execute(st->decim[1], st->stages[0], &st->stages[1][(st->offset >> 1) & 1]);
-            }
-            if ((st->offset & 0x3) == 0x3) {
-                halfband_q15_execute(st->decim[2], st->stages[1], &st->stages[2][(st->offset >> 2) & 1]);
+            for (i = 0; i < n; i++)
+            {
+                st->block[i].r = U8_Q15(buf[i * 2]) >> 4;
+                st->block[i].i = U8_Q15(buf[i * 2 + 1]) >> 4;
             }
-            if ((st->offset & 0x7) == 0x7) {
-                halfband_q15_execute(st->decim[3], st->stages[2], &st->stages[3][(st->offset >> 3) & 1]);
-            }
-            if ((st->offset & 0xf) == 0xf) {
-                halfband_q15_execute(st->decim[4], st->stages[3], &st->buffer[st->avail++]);
-            }
-            st->offset++;
+
+            count = n;
+            for (i = 0; i < AM_DECIM_STAGES - 1; i++)
+                count = halfband_q15_execute_block(st->decim[i], st->block, count, st->block);
+            st->avail += halfband_q15_execute_block(st->decim[AM_DECIM_STAGES - 1], st->block, count, &st->buffer[st->avail]);
         }
     }
 
@@ -232,7 +230,6 @@ void input_reset(input_t *st)
     st->avail = 0;
     st->used = 0;
     st->skip = 0;
-    st->offset = 0;
     for (int i = 0; i < SNR_FFT_LEN; ++i)
         st->snr_power[i] = 0;
     st->snr_cnt = 0;
@@ -254,6 +251,9 @@ void input_init(input_t *st, nrsc5_t *radio, output_t *output)
     st->snr_cb_arg = NULL;
     st->sync_state = SYNC_STATE_NONE;
 
+    for (int i = 0; i < SNR_FFT_LEN; i++)
+        st->snr_window[i] = powf(sinf(M_PI * i / (SNR_FFT_LEN - 1)), 2);
+
     for (int i = 0; i < AM_DECIM_STAGES; i++)
         st->decim[i] = firdecim_q15_create(decim_taps, sizeof(decim_taps) / sizeof(decim_taps[0]));
     st->snr_fft = fftwf_plan_dft_1d(SNR_FFT_LEN, (fftwf_complex*)(st->snr_fft_in), (fftwf_complex*)st->snr_fft_out, FFTW_FORWARD, 0);
@@ -14,6 +14,7 @@
 #include "sync.h"
 
 #define INPUT_BUF_LEN (FFTCP_FM * 512)
+#define INPUT_BLOCK_LEN 2048
 #define AM_DECIM_STAGES 5
 
 #define SNR_FFT_COUNT 256
@@ -33,12 +34,13 @@ typedef struct input_t
     output_t *output;
 
     firdecim_q15 decim[AM_DECIM_STAGES];
-    cint16_t stages[AM_DECIM_STAGES][2];
+    cint16_t block[INPUT_BLOCK_LEN];
     cint16_t buffer[INPUT_BUF_LEN];
-    unsigned int avail, used, skip, offset;
+    unsigned int avail, used, skip;
     unsigned int sync_state;
 
     fftwf_plan snr_fft;
+    float snr_window[SNR_FFT_LEN];
     fcomplex_t snr_fft_in[SNR_FFT_LEN];
     fcomplex_t snr_fft_out[SNR_FFT_LEN];
     float snr_power[SNR_FFT_LEN];
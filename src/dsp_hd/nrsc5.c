@@ -125,6 +125,21 @@ NRSC5_API int nrsc5_set_mode(nrsc5_t *st, int mode)
     return 1;
 }
 
+NRSC5_API void nrsc5_set_programs(nrsc5_t *st, unsigned int programs)
+{
+    output_set_programs(&st->output, programs);
+}
+
+NRSC5_API void nrsc5_set_ber_interval(nrsc5_t *st, unsigned int interval)
+{
+    decode_set_ber_interval(&st->input.decode, interval);
+}
+
+NRSC5_API void nrsc5_set_data_services(nrsc5_t *st, int enabled)
+{
+    output_set_data_services(&st->output, enabled);
+}
+
 NRSC5_API void nrsc5_set_callback(nrsc5_t *st, nrsc5_callback_t callback, void *opaque)
 {
     st->callback = callback;
@@ -31,6 +31,8 @@ extern "C" {
 #define NRSC5_SCAN_END   107.9e6
 #define NRSC5_SCAN_SKIP    0.2e6
 
+#define NRSC5_PROGRAMS_ALL  0xFFFFFFFFu /**< Decode audio for all programs */
+
 #define NRSC5_MIME_PRIMARY_IMAGE    0xBE4B7536
 #define NRSC5_MIME_STATION_LOGO     0xD9C72536
 #define NRSC5_MIME_NAVTEQ           0x2D42AC3E
@@ -412,6 +414,47 @@ void nrsc5_close(nrsc5_t *);
  */
 int nrsc5_set_mode(nrsc5_t *, int mode);
 
+/**
+ * Select the programs to decode audio for.
+ *
+ * @param[in] st  pointer to an `nrsc5_t` session object
+ * @param[in] programs  bitmask of programs, bit 0 is the main program (HD1)
+ * @return Nothing is returned.
+ *
+ * HDC packets of all programs are still reported with `NRSC5_EVENT_HDC`,
+ * but only the selected programs are decoded and reported with
+ * `NRSC5_EVENT_AUDIO`. All programs are selected by default, use
+ * `NRSC5_PROGRAMS_ALL` to restore the default.
+ */
+void nrsc5_set_programs(nrsc5_t *st, unsigned int programs);
+
+/**
+ * Set how often the bit error rate is measured.
+ *
+ * @param[in] st  pointer to an `nrsc5_t` session object
+ * @param[in] interval  number of frames per measurement, 0 to disable
+ * @return Nothing is returned.
+ *
+ * Measuring the bit error rate requires re-encoding the decoded frame. By
+ * default it's measured for every frame and reported with `NRSC5_EVENT_BER`,
+ * an interval of N only measures every Nth frame.
+ */
+void nrsc5_set_ber_interval(nrsc5_t *st, unsigned int interval);
+
+/**
+ * Enable or disable the processing of data services.
+ *
+ * @param[in] st  pointer to an `nrsc5_t` session object
+ * @param[in] enabled  nonzero to process data services, 0 to discard them
+ * @return Nothing is returned.
+ *
+ * Data services are enabled by default. When disabled, program service data
+ * (ID3) and LOT/stream data ports are discarded without being parsed and
+ * `NRSC5_EVENT_ID3`, `NRSC5_EVENT_LOT` and `NRSC5_EVENT_STREAM` are not
+ * reported. Audio and the station information guide are unaffected.
+ */
+void nrsc5_set_data_services(nrsc5_t *st, int enabled);
+
 /**
  * Establish a callback function.
  *
@@ -35,6 +35,20 @@ void output_push(output_t *st, uint8_t *pkt, unsigned int len, unsigned int prog
     if (stream_id != 0)
         return; // TODO: Process enhanced stream
 
+    // Only decode the audio of the selected programs; any decoder left over from
+    // a previous selection is released to keep a stale state from being reused
+    if (program >= MAX_PROGRAMS || (st->programs & (1u << program)) == 0)
+    {
+#ifdef USE_FAAD2
+        if (program < MAX_PROGRAMS && st->aacdec[program])
+        {
+            NeAACDecClose(st->aacdec[program]);
+            st->aacdec[program] = NULL;
+        }
+#endif
+        return;
+    }
+
 #ifdef USE_FAAD2
     void *buffer;
     NeAACDecFrameInfo info;
@@ -111,6 +125,8 @@ void output_reset(output_t *st)
 void output_init(output_t *st, nrsc5_t *radio)
 {
     st->radio = radio;
+    st->programs = NRSC5_PROGRAMS_ALL;
+    st->data_services = 1;
 #ifdef USE_FAAD2
     for (int i = 0; i < MAX_PROGRAMS; i++)
         st->aacdec[i] = NULL;
@@ -122,6 +138,16 @@ void output_init(output_t *st, nrsc5_t *radio)
     output_reset(st);
 }
 
+void output_set_programs(output_t *st, unsigned int programs)
+{
+    st->programs = programs;
+}
+
+void output_set_data_services(output_t *st, int enabled)
+{
+    st->data_services = enabled;
+}
+
 void output_free(output_t *st)
 {
     output_reset(st);
@@ -661,7 +687,8 @@ void output_aas_push(output_t *st, uint8_t *buf, unsigned int len)
     if (port == 0x5100 || (port >= 0x5201 && port <= 0x5207))
     {
         // PSD ports
-        output_id3(st, port & 0x7, buf + 4, len - 4);
+        if (st->data_services)
+            output_id3(st, port & 0x7, buf + 4, len - 4);
     }
     else if (port == 0x20)
     {
@@ -670,7 +697,8 @@ void output_aas_push(output_t *st, uint8_t *buf, unsigned int len)
     }
     else if (port >= 0x401 && port <= 0x50FF)
     {
-        process_port(st, port, buf + 4, len - 4);
+        if (st->data_services)
+            process_port(st, port, buf + 4, len - 4);
     }
     else
     {
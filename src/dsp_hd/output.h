@@ -103,6 +103,8 @@ typedef struct
 typedef struct
 {
     nrsc5_t *radio;
+    unsigned int programs;
+    int data_services;
 #ifdef HAVE_FAAD2
     NeAACDecHandle aacdec[MAX_PROGRAMS];
 #endif
@@ -114,5 +116,7 @@ void output_push(output_t *st, uint8_t *pkt, unsigned int len, unsigned int prog
 void output_begin(output_t *st);
 void output_reset(output_t *st);
 void output_init(output_t *st, nrsc5_t *);
+void output_set_programs(output_t *st, unsigned int programs);
+void output_set_data_services(output_t *st, int enabled);
 void output_free(output_t *st);
 void output_aas_push(output_t *st, uint8_t *psd, unsigned int len);
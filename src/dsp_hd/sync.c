@@ -29,45 +29,31 @@
 
 #define PM_PARTITIONS 10
 #define MAX_PARTITIONS 14
-#define PARTITION_DATA_CARRIERS 18
-#define PARTITION_WIDTH 19
 #define MIDDLE_REF_SC 30 // midpoint of Table 11-3 in 1011s.pdf
 
+typedef void (*equalize_func_t)(fcomplex_t (*)[BLKSZ], const float (*)[BLKSZ], float, float);
+
+/*
+ * The gray code demappers count the decision thresholds below the value
+ * rather than walking a chain of comparisons. The count is taken down from
+ * the top so that a NaN lands in the last region, as it did when the
+ * comparisons were made one at a time.
+ */
 static uint8_t gray4(float f)
 {
-    if (f < -1)
-        return 0;
-    else if (f < 0)
-        return 2;
-    else if (f < 1)
-        return 3;
-    else
-        return 1;
+    static const uint8_t gray[4] = { 0, 2, 3, 1 };
+    return gray[3 - (f < -1) - (f < 0) - (f < 1)];
 }
 
 static uint8_t gray8(float f)
 {
-    if (f < -3)
-        return 0;
-    else if (f < -2)
-        return 4;
-    else if (f < -1)
-        return 6;
-    else if (f < 0)
-        return 2;
-    else if (f < 1)
-        return 3;
-    else if (f < 2)
-        return 7;
-    else if (f < 3)
-        return 5;
-    else
-        return 1;
+    static const uint8_t gray[8] = { 0, 4, 6, 2, 3, 7, 5, 1 };
+    return gray[7 - (f < -3) - (f < -2) - (f < -1) - (f < 0) - (f < 1) - (f < 2) - (f < 3)];
 }
 
 static uint8_t qpsk(fcomplex_t cf)
 {
-    return (crealf(cf) < 0 ? 0 : 1) | (cimagf(cf) < 0 ? 0 : 2);
+    return (!(crealf(cf) < 0)) | (!(cimagf(cf) < 0) << 1);
 }
 
 static uint8_t qam16(fcomplex_t cf)
@@ -230,25 +216,78 @@ static float calc_smag(sync_t *st, unsigned int ref)
     return sum / BLKSZ;
 }
 
+/*
+ * Equalize the data carriers of a partition
+ *
+ * Each data carrier is multiplied by (19 + 19i) / d, where d is the reference
+ * phasor interpolated between the lower and upper reference carriers. The
+ * division is carried out as a multiplication by the conjugate of d over its
+ * squared magnitude, and the loops run across the symbols of the block so
+ * that a SIMD implementation can process several symbols at a time.
+ */
+void sync_equalize_generic(fcomplex_t (*buffer)[BLKSZ], const float (*ref)[BLKSZ], float smag0, float smag19)
+{
+    for (int k = 1; k < PARTITION_WIDTH; k++)
+    {
+        float wu = k * smag19;
+        float wl = (PARTITION_WIDTH - k) * smag0;
+        float *data = (float *) buffer[k];
+
+        for (int n = 0; n < BLKSZ; n++)
+        {
+            float dr = ref[0][n] * wu + ref[2][n] * wl;
+            float di = ref[1][n] * wu + ref[3][n] * wl;
+            float scale = PARTITION_WIDTH / (dr * dr + di * di);
+            float cr = (dr + di) * scale;
+            float ci = (dr - di) * scale;
+            float re = data[n * 2];
+            float im = data[n * 2 + 1];
+
+            data[n * 2] = re * cr - im * ci;
+            data[n * 2 + 1] = im * cr + re * ci;
+        }
+    }
+}
+
+/*
+ * Select the partition equalizer
+ *
+ * On x86 the AVX2 kernel is selected at runtime if the CPU supports it.
+ */
+static equalize_func_t select_equalize(void)
+{
+#ifdef CPU_X86
+    if (cpu_has_avx2())
+        return sync_equalize_avx2;
+#endif
+    return sync_equalize_generic;
+}
+
 static void adjust_data(sync_t *st, unsigned int lower, unsigned int upper)
 {
+    static equalize_func_t equalize = NULL;
+    float ref[4][BLKSZ];
     float smag0, smag19;
+
+    if (equalize == NULL)
+        equalize = select_equalize();
+
     smag0 = calc_smag(st, lower);
     smag19 = calc_smag(st, upper);
 
+    // reference phasors, upper carrier followed by lower carrier
     for (int n = 0; n < BLKSZ; n++)
     {
         fcomplex_t upper_phase = cexpf(CMPLXFMULF(I, st->phases[upper][n]));
         fcomplex_t lower_phase = cexpf(CMPLXFMULF(I, st->phases[lower][n]));
 
-        for (int k = 1; k < PARTITION_WIDTH; k++)
-        {
-            // average phase difference
-            fcomplex_t C = CMPLXFDIV(CMPLXF(PARTITION_WIDTH, PARTITION_WIDTH), (CMPLXFADD(CMPLXFMULF(upper_phase, k * smag19), CMPLXFMULF(lower_phase, (PARTITION_WIDTH - k) * smag0))));
-            // adjust sample
-            st->buffer[lower + k][n] = CMPLXFMUL(st->buffer[lower + k][n], C);
-        }
+        ref[0][n] = crealf(upper_phase);
+        ref[1][n] = cimagf(upper_phase);
+        ref[2][n] = crealf(lower_phase);
+        ref[3][n] = cimagf(lower_phase);
     }
+
+    equalize(&st->buffer[lower], (const float (*)[BLKSZ]) ref, smag0, smag19);
 }
 
 float phase_diff(float a, float b)
@@ -400,23 +439,27 @@ void sync_process_fm(sync_t *st)
         angle /= (partitions_per_band + 1) * 2;
         st->angle = angle;
 
-        // Calculate modulation error
+        // Calculate modulation error; the ideal point has the same signs as
+        // the sample, so the distance to it is 1 - |x| in each dimension
         float error_lb = 0, error_ub = 0;
         for (int n = 0; n < BLKSZ; n++)
         {
-            fcomplex_t c, ideal;
+            fcomplex_t c;
+            float dr, di;
             for (i = 0; i < partitions_per_band * PARTITION_WIDTH; i += PARTITION_WIDTH)
             {
                 unsigned int j;
                 for (j = 1; j < PARTITION_WIDTH; j++)
                 {
                     c = st->buffer[LB_START + i + j][n];
-                    ideal = CMPLXF(crealf(c) >= 0 ? 1 : -1, cimagf(c) >= 0 ? 1 : -1);
-                    error_lb += normf(CMPLXFSUB(ideal, c));
+                    dr = 1 - fabsf(crealf(c));
+                    di = 1 - fabsf(cimagf(c));
+                    error_lb += dr * dr + di * di;
 
                     c = st->buffer[UB_END - i - PARTITION_WIDTH + j][n];
-                    ideal = CMPLXF(crealf(c) >= 0 ? 1 : -1, cimagf(c) >= 0 ? 1 : -1);
-                    error_ub += normf(CMPLXFSUB(ideal, c));
+                    dr = 1 - fabsf(crealf(c));
+                    di = 1 - fabsf(cimagf(c));
+                    error_ub += dr * dr + di * di;
                 }
             }
         }
@@ -444,7 +487,13 @@ void sync_process_fm(sync_t *st)
         float mult_lb = fmaxf(fminf(mer_lb * 10, 127), 1);
         float mult_ub = fmaxf(fminf(mer_ub * 10, 127), 1);
 
-#define DEMOD(x) ((x) >= 0 ? 1 : -1)
+        // The soft bits are written straight into the decoder buffers a block
+        // at a time and handed over once the whole block has been demapped
+        int8_t demod_lb[2] = { (int8_t)(-1 * mult_lb), (int8_t)(1 * mult_lb) };
+        int8_t demod_ub[2] = { (int8_t)(-1 * mult_ub), (int8_t)(1 * mult_ub) };
+        int8_t *pm = decode_get_pm(&st->input->decode);
+        int8_t *px1 = decode_get_px1(&st->input->decode);
+
         for (int n = 0; n < BLKSZ; n++)
         {
             fcomplex_t c;
@@ -454,8 +503,8 @@ void sync_process_fm(sync_t *st)
                 for (j = 1; j < PARTITION_WIDTH; j++)
                 {
                     c = st->buffer[i + j][n];
-                    decode_push_pm(&st->input->decode, DEMOD(crealf(c)) * mult_lb);
-                    decode_push_pm(&st->input->decode, DEMOD(cimagf(c)) * mult_lb);
+                    *pm++ = demod_lb[crealf(c) >= 0];
+                    *pm++ = demod_lb[cimagf(c) >= 0];
                 }
             }
             for (i = UB_END - (PM_PARTITIONS * PARTITION_WIDTH); i < UB_END; i += PARTITION_WIDTH)
@@ -464,8 +513,8 @@ void sync_process_fm(sync_t *st)
                 for (j = 1; j < PARTITION_WIDTH; j++)
                 {
                     c = st->buffer[i + j][n];
-                    decode_push_pm(&st->input->decode, DEMOD(crealf(c)) * mult_ub);
-                    decode_push_pm(&st->input->decode, DEMOD(cimagf(c)) * mult_ub);
+                    *pm++ = demod_ub[crealf(c) >= 0];
+                    *pm++ = demod_ub[cimagf(c) >= 0];
                 }
             }
             if (st->psmi == 3) {
@@ -475,8 +524,8 @@ void sync_process_fm(sync_t *st)
                     for (j = 1; j < PARTITION_WIDTH; j++)
                     {
                         c = st->buffer[i + j][n];
-                        decode_push_px1(&st->input->decode, DEMOD(crealf(c)) * mult_lb);
-                        decode_push_px1(&st->input->decode, DEMOD(cimagf(c)) * mult_lb);
+                        *px1++ = demod_lb[crealf(c) >= 0];
+                        *px1++ = demod_lb[cimagf(c) >= 0];
                     }
                 }
                 for (i = UB_END - (PM_PARTITIONS + 2) * PARTITION_WIDTH; i < UB_END - (PM_PARTITIONS * PARTITION_WIDTH); i += PARTITION_WIDTH)
@@ -485,12 +534,16 @@ void sync_process_fm(sync_t *st)
                     for (j = 1; j < PARTITION_WIDTH; j++)
                     {
                         c = st->buffer[i + j][n];
-                        decode_push_px1(&st->input->decode, DEMOD(crealf(c)) * mult_ub);
-                        decode_push_px1(&st->input->decode, DEMOD(cimagf(c)) * mult_ub);
+                        *px1++ = demod_ub[crealf(c) >= 0];
+                        *px1++ = demod_ub[cimagf(c) >= 0];
                     }
                 }
             }
         }
+
+        decode_commit_pm(&st->input->decode);
+        if (st->psmi == 3)
+            decode_commit_px1(&st->input->decode);
     }
 }
 
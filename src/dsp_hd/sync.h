@@ -1,9 +1,14 @@
 #pragma once
 
 #include "config.h"
+#include "cpu.h"
+#include "defines.h"
 
 //#include <complex.h>
 
+#define PARTITION_DATA_CARRIERS 18
+#define PARTITION_WIDTH 19
+
 typedef struct
 {
     struct input_t *input;
@@ -26,6 +31,11 @@ typedef struct
     float error_ub;
 } sync_t;
 
+void sync_equalize_generic(fcomplex_t (*buffer)[BLKSZ], const float (*ref)[BLKSZ], float smag0, float smag19);
+#ifdef CPU_X86
+void sync_equalize_avx2(fcomplex_t (*buffer)[BLKSZ], const float (*ref)[BLKSZ], float smag0, float smag19);
+#endif
+
 void sync_adjust(sync_t *st, int sample_adj);
 void sync_push(sync_t *st, fcomplex_t *fft);
 void sync_reset(sync_t *st);
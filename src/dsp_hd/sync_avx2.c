@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+
+#include "config.h"
+#include "sync.h"
+
+#ifdef CPU_X86
+
+#include <immintrin.h>
+
+// Expands eight real coefficients into two vectors that line up with eight
+// interleaved complex samples, { c0, c0, c1, c1, ... c7, c7 }
+CPU_TARGET("avx2")
+static inline void duplicate8(__m256 c, __m256 *lo, __m256 *hi)
+{
+    __m256 a = _mm256_unpacklo_ps(c, c);
+    __m256 b = _mm256_unpackhi_ps(c, c);
+    *lo = _mm256_permute2f128_ps(a, b, 0x20);
+    *hi = _mm256_permute2f128_ps(a, b, 0x31);
+}
+
+// Multiplies four interleaved complex samples by the duplicated coefficients,
+// the even lanes produce re*cr - im*ci and the odd lanes im*cr + re*ci
+CPU_TARGET("avx2")
+static inline __m256 cmul4(__m256 x, __m256 cr, __m256 ci)
+{
+    __m256 swapped = _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_addsub_ps(_mm256_mul_ps(x, cr), _mm256_mul_ps(swapped, ci));
+}
+
+// Equalizes the data carriers of one partition eight symbols at a time, using
+// the same operations in the same order as sync_equalize_generic()
+CPU_TARGET("avx2")
+void sync_equalize_avx2(fcomplex_t (*buffer)[BLKSZ], const float (*ref)[BLKSZ], float smag0, float smag19)
+{
+    const __m256 width = _mm256_set1_ps(PARTITION_WIDTH);
+    unsigned int k, n;
+
+    for (k = 1; k < PARTITION_WIDTH; k++)
+    {
+        const __m256 wu = _mm256_set1_ps(k * smag19);
+        const __m256 wl = _mm256_set1_ps((PARTITION_WIDTH - k) * smag0);
+        float *data = (float *) buffer[k];
+
+        for (n = 0; n < BLKSZ; n += 8)
+        {
+            __m256 dr = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&ref[0][n]), wu), _mm256_mul_ps(_mm256_loadu_ps(&ref[2][n]), wl));
+            __m256 di = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&ref[1][n]), wu), _mm256_mul_ps(_mm256_loadu_ps(&ref[3][n]), wl));
+            __m256 scale = _mm256_div_ps(width, _mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(di, di)));
+            __m256 cr_lo, cr_hi, ci_lo, ci_hi;
+
+            duplicate8(_mm256_mul_ps(_mm256_add_ps(dr, di), scale), &cr_lo, &cr_hi);
+            duplicate8(_mm256_mul_ps(_mm256_sub_ps(dr, di), scale), &ci_lo, &ci_hi);
+
+            _mm256_storeu_ps(&data[n * 2], cmul4(_mm256_loadu_ps(&data[n * 2]), cr_lo, ci_lo));
+            _mm256_storeu_ps(&data[n * 2 + 8], cmul4(_mm256_loadu_ps(&data[n * 2 + 8]), cr_hi, ci_hi));
+        }
+    }
+}
+
+#endif	// CPU_X86
@@ -28,10 +28,36 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <memory.h>
 
 #pragma warning(push, 4)
 
+// fmstream::DEGRADE_NONE
+//
+// Full quality; stereo, RDS and the configured downsample quality
+int const fmstream::DEGRADE_NONE = 0;
+
+// fmstream::DEGRADE_NORDS
+//
+// RDS demodulation is paused
+int const fmstream::DEGRADE_NORDS = 1;
+
+// fmstream::DEGRADE_LOWQUALITY
+//
+// The low quality downsample filters are used
+int const fmstream::DEGRADE_LOWQUALITY = 2;
+
+// fmstream::DEGRADE_MONO
+//
+// The audio is demodulated in mono
+int const fmstream::DEGRADE_MONO = 3;
+
+// fmstream::MAX_PACKET_QUEUE
+//
+// Maximum number of queued demux packets
+size_t const fmstream::MAX_PACKET_QUEUE = 200; // ~2sec
+
 // fmstream::MAX_SAMPLE_QUEUE
 //
 // Maximum number of queued sample sets from the device
@@ -62,11 +88,15 @@ fmstream::fmstream(std::unique_ptr<rtldevice> device,
                    struct channelprops const& channelprops,
                    struct fmprops const& fmprops)
   : m_device(std::move(device)),
+    m_iqfanout(iqfanout::create()),
+    m_downsamplequality(static_cast<enum DownsampleQuality>(fmprops.downsamplequality)),
     m_decoderds(fmprops.decoderds),
     m_rdsdecoder(fmprops.isnorthamerica),
     m_muxname(generate_mux_name(channelprops)),
     m_pcmsamplerate(fmprops.outputrate),
-    m_pcmgain(MPOW(10.0, (fmprops.outputgain / 10.0)))
+    m_pcmgain(MPOW(10.0, (fmprops.outputgain / 10.0))),
+    m_loadcontroller(DEGRADE_MONO),
+    m_degradation(DEGRADE_NONE)
 {
   // The sample rate must be within 900001Hz - 3200000Hz
   if ((fmprops.samplerate < 900001) || (fmprops.samplerate > 3200000))
@@ -109,6 +139,12 @@ fmstream::fmstream(std::unique_ptr<rtldevice> device,
   if (channelprops.autogain == false)
     m_device->set_gain(channelprops.manualgain);
 
+  // Publish the initial signal status before the worker threads are started
+  publishstatus();
+
+  // Create a worker thread on which to perform the demodulation operations
+  m_dspworker = std::thread(&fmstream::dspworker, this);
+
   // Create a worker thread on which to perform the transfer operations
   scalar_condition<bool> started{false};
   m_worker = std::thread(&fmstream::transfer, this, std::ref(started));
@@ -153,6 +189,9 @@ void fmstream::close(void)
     m_device->cancel_async(); // Cancel any async read operations
   if (m_worker.joinable())
     m_worker.join(); // Wait for thread
+  if (m_dspworker.joinable())
+    m_dspworker.join(); // Wait for thread
+  m_iqfanout->close(); // Detach any I/Q sample consumers
   m_device.reset(); // Release RTL-SDR device
 }
 
@@ -214,32 +253,8 @@ void fmstream::demuxflush(void)
 
 DEMUX_PACKET* fmstream::demuxread(std::function<DEMUX_PACKET*(int)> const& allocator)
 {
-  // If there is an RDS UECP packet available, handle it before demodulating more audio
-  uecp_data_packet uecp_packet;
-  if (m_rdsdecoder.pop_uecp_data_packet(uecp_packet) && (!uecp_packet.empty()))
-  {
-
-    // The user may have opted to disable RDS.  The packet from the decoder still
-    // needs to be popped from the queue, but don't do anything with it ...
-    if (m_decoderds)
-    {
-
-      // Allocate and initialize the UECP demultiplexer packet
-      int packetsize = static_cast<int>(uecp_packet.size());
-      DEMUX_PACKET* packet = allocator(packetsize);
-      if (packet == nullptr)
-        return nullptr;
-
-      packet->iStreamId = STREAM_ID_UECP;
-      packet->iSize = packetsize;
-
-      // Copy the UECP data into the demultiplexer packet and return it
-      memcpy(packet->pData, uecp_packet.data(), uecp_packet.size());
-      return packet;
-    }
-  }
-
-  // Wait for there to be a packet of samples available for processing
+  // Wait for there to be a packet available, the demodulator thread continuously
+  // generates audio packets as long as data is being transferred from the device
   std::unique_lock<std::mutex> lock(m_queuelock);
   m_cv.wait(lock, [&]() -> bool { return ((m_queue.size() > 0) || m_stopped.load() == true); });
 
@@ -250,62 +265,37 @@ DEMUX_PACKET* fmstream::demuxread(std::function<DEMUX_PACKET*(int)> const& alloc
 
     if (m_worker_exception)
       std::rethrow_exception(m_worker_exception);
+    else if (m_dspworker_exception)
+      std::rethrow_exception(m_dspworker_exception);
     else
       return allocator(0);
   }
 
-  // Pop off the topmost packet of samples from the queue<> and release the lock
-  std::unique_ptr<TYPECPX[]> samples(std::move(m_queue.front()));
+  // Pop off the topmost object from the queue<> and release the lock
+  std::unique_ptr<demux_packet_t> packet(std::move(m_queue.front()));
   m_queue.pop();
   lock.unlock();
 
-  // If the packet of samples is null, the writer has indicated there was a problem
-  if (!samples)
-  {
-
-    m_dts = STREAM_TIME_BASE; // Reset the current decode time stamp
+  // The packet queue should never have a null packet in it
+  assert(packet);
+  if (!packet)
+    return allocator(0);
 
-    // Create a STREAMCHANGE packet that has no data
-    DEMUX_PACKET* packet = allocator(0);
-    if (packet)
-      packet->iStreamId = DEMUX_SPECIALID_STREAMCHANGE;
+  // Allocate and initialize the DEMUX_PACKET
+  DEMUX_PACKET* demuxpacket = allocator(packet->size);
+  if (demuxpacket != nullptr)
+  {
 
-    return packet; // Return the generated packet
+    demuxpacket->iStreamId = packet->streamid;
+    demuxpacket->iSize = packet->size;
+    demuxpacket->duration = packet->duration;
+    demuxpacket->dts = packet->dts;
+    demuxpacket->pts = packet->pts;
+    if (packet->size > 0)
+      memcpy(demuxpacket->pData, packet->data.get(), packet->size);
   }
 
-  // Process the I/Q data, the original samples buffer can be reused/overwritten as it's processed
-  int audiopackets = m_demodulator->ProcessData(m_demodulator->GetInputBufferLimit(), samples.get(),
-                                                samples.get());
-
-  // Process any RDS group data that was collected during demodulation
-  tRDS_GROUPS rdsgroup = {};
-  while (m_demodulator->GetNextRdsGroupData(&rdsgroup))
-    m_rdsdecoder.decode_rdsgroup(rdsgroup);
-
-  // Determine the size of the demultiplexer packet data and allocate it
-  int packetsize = audiopackets * sizeof(TYPESTEREO16);
-  DEMUX_PACKET* packet = allocator(packetsize);
-  if (packet == nullptr)
-    return nullptr;
-
-  // Resample the audio data directly into the allocated packet buffer
-  audiopackets = m_resampler->Resample(
-      audiopackets, (m_demodulator->GetOutputRate() / m_pcmsamplerate), samples.get(),
-      reinterpret_cast<TYPESTEREO16*>(packet->pData), m_pcmgain);
-
-  // Calculate the proper duration for the packet
-  double duration = (audiopackets / static_cast<double>(m_pcmsamplerate)) * STREAM_TIME_BASE;
-
-  // Set up the demultiplexer packet with the proper size, duration and dts
-  packet->iStreamId = STREAM_ID_AUDIO;
-  packet->iSize = audiopackets * sizeof(TYPESTEREO16);
-  packet->duration = duration;
-  packet->dts = packet->pts = m_dts;
-
-  // Increment the decode time stamp value based on the calculated duration
-  m_dts += duration;
-
-  return packet;
+  return demuxpacket;
 }
 
 //---------------------------------------------------------------------------
@@ -335,6 +325,212 @@ std::string fmstream::devicename(void) const
   return std::string(m_device->get_device_name());
 }
 
+//---------------------------------------------------------------------------
+// fmstream::degrade (private)
+//
+// Applies a DSP degradation level to the demodulator
+//
+// Arguments:
+//
+//	level		- DSP degradation level to apply
+
+void fmstream::degrade(int level)
+{
+  assert((level >= DEGRADE_NONE) && (level <= DEGRADE_MONO));
+
+  m_demodulator->SetRdsEnabled(level < DEGRADE_NORDS);
+  m_demodulator->SetDownsampleQuality((level >= DEGRADE_LOWQUALITY) ? DownsampleQuality::Low
+                                                                     : m_downsamplequality);
+
+  m_degradation = level;
+  counters()->degradation(level);
+}
+
+//---------------------------------------------------------------------------
+// fmstream::dspworker (private)
+//
+// Worker thread procedure used to demodulate the queued I/Q samples
+//
+// Arguments:
+//
+//	NONE
+
+void fmstream::dspworker(void)
+{
+  assert(m_demodulator);
+  assert(m_resampler);
+
+  // Monaural audio is demodulated into a separate buffer when degraded
+  std::unique_ptr<TYPEREAL[]> monosamples(new TYPEREAL[m_demodulator->GetInputBufferLimit()]);
+
+  try
+  {
+
+    // Continuously demodulate the queued I/Q samples until the data transfer has stopped
+    while (true)
+    {
+
+      // Wait for there to be a packet of samples available for processing
+      std::unique_lock<std::mutex> lock(m_samplequeuelock);
+      m_samplecv.wait(lock, [&]() -> bool
+                      { return ((m_samplequeue.size() > 0) || m_stopped.load() == true); });
+      if (m_stopped.load() == true)
+        break;
+
+      // Pop off the topmost packet of samples from the queue<> and release the lock
+      std::unique_ptr<TYPECPX[]> samples(std::move(m_samplequeue.front()));
+      m_samplequeue.pop();
+      size_t const depth = m_samplequeue.size();
+      lock.unlock();
+
+      // If the packet of samples is null, the writer has indicated there was a problem
+      if (!samples)
+      {
+
+        m_dts = STREAM_TIME_BASE; // Reset the current decode time stamp
+        m_driftcontroller.reset(); // Reset the clock drift controller
+
+        // Queue a STREAMCHANGE packet that has no data
+        std::unique_ptr<demux_packet_t> streamchange = std::make_unique<demux_packet_t>();
+        streamchange->streamid = DEMUX_SPECIALID_STREAMCHANGE;
+        queue_packet(std::move(streamchange));
+
+        continue;
+      }
+
+      // Shed or restore optional DSP work based on how far behind the demodulator is
+      int const level = m_loadcontroller.update(depth, MAX_SAMPLE_QUEUE);
+      if (level != m_degradation)
+        degrade(level);
+
+      bool const mono = (m_degradation >= DEGRADE_MONO);
+
+      // Process the I/Q data, the original samples buffer can be reused/overwritten as it's processed
+      int audiopackets = 0;
+      {
+        perfcounters::stagetimer timer(*counters(), perfcounters::stage::demodulate);
+        audiopackets =
+            (mono) ? m_demodulator->ProcessData(m_demodulator->GetInputBufferLimit(),
+                                                samples.get(), monosamples.get())
+                   : m_demodulator->ProcessData(m_demodulator->GetInputBufferLimit(),
+                                                samples.get(), samples.get());
+      }
+
+      // Process any RDS group data that was collected during demodulation and queue
+      // the resultant UECP packets ahead of the audio
+      std::unique_lock<std::mutex> rdslock(m_rdslock);
+
+      tRDS_GROUPS rdsgroup = {};
+      {
+        perfcounters::stagetimer timer(*counters(), perfcounters::stage::decode);
+        while (m_demodulator->GetNextRdsGroupData(&rdsgroup))
+          m_rdsdecoder.decode_rdsgroup(rdsgroup);
+      }
+
+      // The user may have opted to disable RDS.  The packets from the decoder still
+      // need to be popped from the queue, but don't do anything with them ...
+      uecp_data_packet uecp_packet;
+      while (m_rdsdecoder.pop_uecp_data_packet(uecp_packet))
+      {
+
+        if ((m_decoderds) && (!uecp_packet.empty()))
+        {
+
+          std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
+          packet->streamid = STREAM_ID_UECP;
+          packet->size = static_cast<int>(uecp_packet.size());
+          packet->data = std::unique_ptr<uint8_t[]>(new uint8_t[uecp_packet.size()]);
+          memcpy(packet->data.get(), uecp_packet.data(), uecp_packet.size());
+
+          queue_packet(std::move(packet));
+        }
+      }
+
+      rdslock.unlock();
+
+      // Steer the resampler ratio to compensate for the drift between the device clock
+      // and the clock that the audio is being consumed with
+      size_t queued = 0;
+      {
+        std::unique_lock<std::mutex> queuelock(m_queuelock);
+        queued = m_queue.size();
+      }
+
+      // The queue depth only follows the consumer clock if the stream is read in real time
+      bool const controlled = realtimeconsumer();
+      if (!controlled)
+        m_driftcontroller.reset();
+
+      double const correction =
+          (controlled) ? m_driftcontroller.update(queued, MAX_PACKET_QUEUE) : 1.0;
+      counters()->clockdrift(controlled, m_driftcontroller.ppm());
+
+      // Resample the audio data into a new packet; the output rate can be higher than the
+      // demodulator rate (WFM at 48KHz) and is steered by the drift correction, so the buffer
+      // has to be sized from the resampling ratio with a margin for the fractional phase
+      TYPEREAL const rate =
+          static_cast<TYPEREAL>((m_demodulator->GetOutputRate() / m_pcmsamplerate) * correction);
+      size_t const maxframes = static_cast<size_t>(std::ceil(audiopackets / rate)) + 2;
+
+      std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
+      packet->data = std::unique_ptr<uint8_t[]>(new uint8_t[maxframes * sizeof(TYPESTEREO16)]);
+      {
+        perfcounters::stagetimer timer(*counters(), perfcounters::stage::resample);
+
+        if (mono)
+        {
+
+          // Resample the monaural audio and expand it in-place into interleaved stereo,
+          // working backwards so that no sample is overwritten before it has been copied
+          int16_t* pcm = reinterpret_cast<int16_t*>(packet->data.get());
+          audiopackets = m_resampler->Resample(audiopackets, rate, monosamples.get(),
+                                               reinterpret_cast<TYPEMONO16*>(pcm), m_pcmgain);
+          for (int index = audiopackets - 1; index >= 0; index--)
+            pcm[(index * 2)] = pcm[(index * 2) + 1] = pcm[index];
+        }
+
+        else
+          audiopackets = m_resampler->Resample(audiopackets, rate, samples.get(),
+                                               reinterpret_cast<TYPESTEREO16*>(packet->data.get()),
+                                               m_pcmgain);
+      }
+
+      // Calculate the proper duration for the packet
+      double duration = (audiopackets / static_cast<double>(m_pcmsamplerate)) * STREAM_TIME_BASE;
+      counters()->addsignaltime(audiopackets / static_cast<double>(m_pcmsamplerate));
+
+      // Set up the demultiplexer packet with the proper size, duration and dts
+      packet->streamid = STREAM_ID_AUDIO;
+      packet->size = audiopackets * sizeof(TYPESTEREO16);
+      packet->duration = duration;
+      packet->dts = packet->pts = m_dts;
+
+      // Increment the decode time stamp value based on the calculated duration
+      m_dts += duration;
+
+      // Provide a copy of the audio to the recording sink, if one is attached
+      std::shared_ptr<recordingsink> recording = recorder();
+      if (recording)
+        recording->writepcm(reinterpret_cast<int16_t const*>(packet->data.get()), audiopackets, 2,
+                            static_cast<int>(m_pcmsamplerate));
+
+      queue_packet(std::move(packet));
+
+      // Publish the signal status as of the samples that were just demodulated
+      publishstatus();
+    }
+  }
+
+  catch (...)
+  {
+
+    // Store the exception for the demultiplexer and stop the data transfer
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    m_dspworker_exception = std::current_exception();
+    m_device->cancel_async();
+  }
+}
+
 //---------------------------------------------------------------------------
 // fmstream::enumproperties
 //
@@ -386,6 +582,20 @@ std::string fmstream::generate_mux_name(struct channelprops const& channelprops)
   return std::string(buf);
 }
 
+//---------------------------------------------------------------------------
+// fmstream::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& fmstream::iqsamples(void) const
+{
+  return m_iqfanout;
+}
+
 //---------------------------------------------------------------------------
 // fmstream::length
 //
@@ -412,6 +622,7 @@ long long fmstream::length(void) const
 std::string fmstream::muxname(void) const
 {
   // If the callsign for the station is known, use that with an -FM suffix, otherwise use the default
+  std::unique_lock<std::mutex> lock(m_rdslock);
   return (m_rdsdecoder.has_rbds_callsign()) ? m_rdsdecoder.get_rbds_callsign() : m_muxname;
 }
 
@@ -429,6 +640,42 @@ long long fmstream::position(void) const
   return -1;
 }
 
+//---------------------------------------------------------------------------
+// fmstream::queue_packet (private)
+//
+// Queues a demux packet
+//
+// Arguments:
+//
+//	packet		- Demux packet to be queued
+
+void fmstream::queue_packet(std::unique_ptr<demux_packet_t> packet)
+{
+  std::unique_lock<std::mutex> lock(m_queuelock);
+  m_queue.emplace(std::move(packet));
+  counters()->packetqueued(m_queue.size());
+
+  // If the queue size has exceeded the maximum, the packets aren't
+  // being processed quickly enough by the demux read function
+  if (m_queue.size() > MAX_PACKET_QUEUE)
+  {
+
+    counters()->packetsdropped(m_queue.size());
+    m_queue = demux_queue_t(); // Replace the queue<>
+    m_driftcontroller.reset(); // Reset the clock drift controller
+
+    // Push a DEMUX_SPECIALID_STREAMCHANGE packet into the new queue
+    std::unique_ptr<demux_packet_t> streamchange = std::make_unique<demux_packet_t>();
+    streamchange->streamid = DEMUX_SPECIALID_STREAMCHANGE;
+    m_queue.emplace(std::move(streamchange));
+
+    // Reset the decode time stamp
+    m_dts = STREAM_TIME_BASE;
+  }
+
+  m_cv.notify_all(); // Notify queue was updated
+}
+
 //---------------------------------------------------------------------------
 // fmstream::read
 //
@@ -473,6 +720,22 @@ long long fmstream::seek(long long /*position*/, int /*whence*/)
   return -1;
 }
 
+//---------------------------------------------------------------------------
+// fmstream::seektime
+//
+// Seeks the demultiplexer to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag to seek backwards from the time
+//	startpts	- On success, receives the time stamp of the seek position
+
+bool fmstream::seektime(double /*time*/, bool /*backwards*/, double& /*startpts*/)
+{
+  return false;
+}
+
 //---------------------------------------------------------------------------
 // fmstream::servicename
 //
@@ -510,6 +773,34 @@ void fmstream::signalquality(int& quality, int& snr) const
   snr = std::max(0, std::min(100, static_cast<int>(100.0 * (demodsnr / 0.60))));
 }
 
+//---------------------------------------------------------------------------
+// fmstream::stopped
+//
+// Gets a flag indicating if the stream has stopped
+//
+// Arguments:
+//
+//	NONE
+
+bool fmstream::stopped(void) const
+{
+  return m_stopped.load();
+}
+
+//---------------------------------------------------------------------------
+// fmstream::streamtimes
+//
+// Gets the time properties of the stream
+//
+// Arguments:
+//
+//	times		- Structure to receive the stream time properties
+
+bool fmstream::streamtimes(struct streamtimeprops& /*times*/) const
+{
+  return false;
+}
+
 //---------------------------------------------------------------------------
 // fmstream::transfer (private)
 //
@@ -532,6 +823,9 @@ void fmstream::transfer(scalar_condition<bool>& started)
   // Asynchronous read callback function for the RTL-SDR device
   auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
   {
+    // Hand the raw samples to any other consumers attached to the device first
+    m_iqfanout->write(buffer, count);
+
     std::unique_ptr<TYPECPX[]> samples; // Array of I/Q samples to return
 
     // If the proper amount of data was returned by the callback, convert it into
@@ -560,20 +854,25 @@ void fmstream::transfer(scalar_condition<bool>& started)
 
     // Push the converted samples into the queue<> for processing.  If there is insufficient space
     // left in the queue<>, the samples aren't being processed quickly enough to keep up with the rate
-    std::unique_lock<std::mutex> lock(m_queuelock);
-    if (m_queue.size() < MAX_SAMPLE_QUEUE)
-      m_queue.emplace(std::move(samples));
+    std::unique_lock<std::mutex> lock(m_samplequeuelock);
+    if (!samples)
+      counters()->buffersdropped(1);
+    if (m_samplequeue.size() < MAX_SAMPLE_QUEUE)
+      m_samplequeue.emplace(std::move(samples));
     else
     {
 
-      m_queue = sample_queue_t(); // Replace the queue<>
-      m_queue.push(nullptr); // Push a resync packet (null)
+      counters()->buffersdropped(m_samplequeue.size());
+      m_samplequeue = sample_queue_t(); // Replace the queue<>
+      m_samplequeue.push(nullptr); // Push a resync packet (null)
       if (samples)
-        m_queue.emplace(std::move(samples)); // Push samples
+        m_samplequeue.emplace(std::move(samples)); // Push samples
     }
 
-    // Notify any threads waiting on the lock that the queue<> has been updated
-    m_cv.notify_all();
+    counters()->bufferreceived(m_samplequeue.size());
+
+    // Notify the demodulator thread that the queue<> has been updated
+    m_samplecv.notify_all();
   };
 
   // Begin streaming from the device and inform the caller that the thread is running
@@ -591,7 +890,16 @@ void fmstream::transfer(scalar_condition<bool>& started)
   }
 
   m_stopped.store(true); // Thread is stopped
-  m_cv.notify_all(); // Unblock any waiters
+
+  // Unblock the demodulator thread; the lock must be held to ensure that the
+  // demodulator can't miss the notification while it's checking the queue
+  std::unique_lock<std::mutex> lock(m_samplequeuelock);
+  m_samplecv.notify_all();
+  lock.unlock();
+
+  // Unblock any demultiplexer waiters, for the same reason this requires the queue lock
+  std::unique_lock<std::mutex> queuelock(m_queuelock);
+  m_cv.notify_all();
 }
 
 //---------------------------------------------------------------------------
@@ -692,11 +692,16 @@ GLint channelsettings::fftshader::uModelProjMatrix(void) const
 //
 // Arguments:
 //
-//	device			- Device instance
+//	device			- Device instance, or nullptr to use the I/Q samples of a stream
+//	iqsamples		- I/Q sample fan-out of the stream that is playing the channel
+//	samplerate		- Sample rate of the stream I/Q samples, or zero for the default
 //	tunerprops		- Tuner properties
 //	channelprops	- Channel properties
+//	isnew			- Flag indicating if this is a new channel
 
 channelsettings::channelsettings(std::unique_ptr<rtldevice> device,
+                                 std::shared_ptr<iqfanout> iqsamples,
+                                 uint32_t samplerate,
                                  struct tunerprops const& tunerprops,
                                  struct channelprops const& channelprops,
                                  bool isnew)
@@ -704,9 +709,10 @@ channelsettings::channelsettings(std::unique_ptr<rtldevice> device,
     m_device(std::move(device)),
     m_tunerprops(tunerprops),
     m_channelprops(channelprops),
-    m_isnew(isnew)
+    m_isnew(isnew),
+    m_iqfanout(std::move(iqsamples))
 {
-  assert(m_device);
+  assert((m_device) || (m_iqfanout));
 
   m_signalprops.filter = false; // Never apply the filter here
 
@@ -715,7 +721,7 @@ channelsettings::channelsettings(std::unique_ptr<rtldevice> device,
   if (channelprops.modulation == modulation::fm)
   {
 
-    m_signalprops.samplerate = 1600 KHz;
+    m_signalprops.samplerate = (samplerate > 0) ? samplerate : 1600 KHz;
     m_signalprops.bandwidth = 220 KHz;
     m_signalprops.lowcut = -103 KHz;
     m_signalprops.highcut = 103 KHz;
@@ -754,7 +760,7 @@ channelsettings::channelsettings(std::unique_ptr<rtldevice> device,
   else if (channelprops.modulation == modulation::wx)
   {
 
-    m_signalprops.samplerate = 1600 KHz;
+    m_signalprops.samplerate = (samplerate > 0) ? samplerate : 1600 KHz;
     m_signalprops.bandwidth = 200 KHz;
     m_signalprops.lowcut = -8 KHz;
     m_signalprops.highcut = 8 KHz;
@@ -767,6 +773,11 @@ channelsettings::channelsettings(std::unique_ptr<rtldevice> device,
   else
     throw string_exception("unknown channel modulation");
 
+  // When the samples come from the stream that is playing the channel the device
+  // belongs to that stream and the tuner settings can't be changed here
+  if (!m_device)
+    return;
+
   // Get the valid manual gain values supported by the device
   m_device->get_valid_gains(m_manualgains);
 
@@ -789,6 +800,13 @@ channelsettings::~channelsettings()
     m_device->cancel_async(); // Cancel any async read operations
   if (m_worker.joinable())
     m_worker.join(); // Wait for thread to exit
+
+  // Detach the consumers and wait for their threads to exit; the fan-out of a stream
+  // continues to be written to after the dialog has been closed
+  if (m_iqfanout)
+    for (auto const& consumerid : m_consumerids)
+      m_iqfanout->detach(consumerid);
+
   m_device.reset(); // Release RTL-SDR device
 }
 
@@ -843,7 +861,28 @@ std::unique_ptr<channelsettings> channelsettings::create(std::unique_ptr<rtldevi
                                                          bool isnew)
 {
   return std::unique_ptr<channelsettings>(
-      new channelsettings(std::move(device), tunerprops, channelprops, isnew));
+      new channelsettings(std::move(device), nullptr, 0, tunerprops, channelprops, isnew));
+}
+
+//---------------------------------------------------------------------------
+// channelsettings::create (static)
+//
+// Factory method, creates a new channelsettings instance
+//
+// Arguments:
+//
+//	iqsamples		- I/Q sample fan-out of the stream that is playing the channel
+//	samplerate		- Sample rate of the stream I/Q samples, or zero for the default
+//	tunerprops		- Tuner properties
+//	channelprops	- Channel properties
+
+std::unique_ptr<channelsettings> channelsettings::create(std::shared_ptr<iqfanout> iqsamples,
+                                                         uint32_t samplerate,
+                                                         struct tunerprops const& tunerprops,
+                                                         struct channelprops const& channelprops)
+{
+  return std::unique_ptr<channelsettings>(new channelsettings(
+      nullptr, std::move(iqsamples), samplerate, tunerprops, channelprops, false));
 }
 
 //---------------------------------------------------------------------------
@@ -1103,7 +1142,7 @@ void channelsettings::update_gain(void)
 //---------------------------------------------------------------------------
 // channelsettings::worker (private)
 //
-// Worker thread procedure used to pump data into the signal meter
+// Worker thread procedure used to pump data into the I/Q sample fan-out
 //
 // Arguments:
 //
@@ -1112,18 +1151,13 @@ void channelsettings::update_gain(void)
 void channelsettings::worker(scalar_condition<bool>& started)
 {
   assert(m_device);
-  assert(m_signalmeter);
+  assert(m_iqfanout);
 
   // read_callback_func (local)
   //
   // Asynchronous read callback function for the RTL-SDR device
   auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
-  {
-    // Feed the signal meter, and optionally the multiplex scanner
-    m_signalmeter->inputsamples(buffer, count);
-    if (m_muxscanner)
-      m_muxscanner->inputsamples(buffer, count);
-  };
+  { m_iqfanout->write(buffer, count); };
 
   // Begin streaming from the device and inform the caller that the thread is running
   m_device->begin_stream();
@@ -1192,6 +1226,8 @@ bool channelsettings::OnClick(int controlId)
       return true;
 
     case CONTROL_RADIO_AUTOMATICGAIN:
+      if (!m_device)
+        return true;
       m_channelprops.autogain = m_radio_autogain->IsSelected();
       m_device->set_automatic_gain_control(m_channelprops.autogain);
       if (!m_channelprops.autogain)
@@ -1201,6 +1237,8 @@ bool channelsettings::OnClick(int controlId)
       return true;
 
     case CONTROL_SLIDER_MANUALGAIN:
+      if (!m_device)
+        return true;
       m_channelprops.manualgain =
           percent_to_gain(static_cast<int>(m_slider_manualgain->GetPercentage()));
       if (!m_channelprops.autogain)
@@ -1209,6 +1247,8 @@ bool channelsettings::OnClick(int controlId)
       return true;
 
     case CONTROL_SLIDER_CORRECTION:
+      if (!m_device)
+        return true;
       m_channelprops.freqcorrection = m_slider_correction->GetIntValue();
       m_device->set_frequency_correction(m_tunerprops.freqcorrection +
                                          m_channelprops.freqcorrection);
@@ -1237,7 +1277,7 @@ bool channelsettings::OnClick(int controlId)
 
 bool channelsettings::OnInit(void)
 {
-  assert(m_device);
+  assert((m_device) || (m_iqfanout));
 
   try
   {
@@ -1329,11 +1369,13 @@ bool channelsettings::OnInit(void)
       m_button_channelicon->SetLabel(kodi::addon::GetLocalizedString(30311));
 
     // Adjust the manual gain value to match something that the tuner supports
-    m_channelprops.manualgain = nearest_valid_gain(m_channelprops.manualgain);
+    if (m_device)
+      m_channelprops.manualgain = nearest_valid_gain(m_channelprops.manualgain);
 
     // Set the tuner gain parameters
     m_radio_autogain->SetSelected(m_channelprops.autogain);
-    m_slider_manualgain->SetEnabled(!m_channelprops.autogain);
+    m_radio_autogain->SetEnabled(static_cast<bool>(m_device));
+    m_slider_manualgain->SetEnabled((m_device) && (!m_channelprops.autogain));
     m_slider_manualgain->SetPercentage(
         static_cast<float>(gain_to_percent(m_channelprops.manualgain)));
     update_gain();
@@ -1342,6 +1384,7 @@ bool channelsettings::OnInit(void)
     m_slider_correction->SetIntInterval(1);
     m_slider_correction->SetIntRange(-41, 40);
     m_slider_correction->SetIntValue(m_channelprops.freqcorrection);
+    m_slider_correction->SetEnabled(static_cast<bool>(m_device));
 
     // Set the default text for the signal indicators
     m_edit_signalpower->SetText(kodi::addon::GetLocalizedString(10006)); // "N/A"
@@ -1369,10 +1412,26 @@ bool channelsettings::OnInit(void)
           dabmuxscanner::create(m_signalprops.samplerate,
                                 std::bind(&channelsettings::mux_data, this, std::placeholders::_1));
 
-    // Create a worker thread on which to pump data into the signal meter
-    scalar_condition<bool> started{false};
-    m_worker = std::thread(&channelsettings::worker, this, std::ref(started));
-    started.wait_until_equals(true);
+    // Feed the signal meter, and optionally the multiplex scanner, from the device or the
+    // stream on their own threads so the slower multiplex scanner can't hold up the meter
+    if (m_device)
+      m_iqfanout = iqfanout::create();
+    m_consumerids.push_back(m_iqfanout->attach(std::bind(
+        &signalmeter::inputsamples, m_signalmeter.get(), std::placeholders::_1,
+        std::placeholders::_2)));
+    if (m_muxscanner)
+      m_consumerids.push_back(m_iqfanout->attach(std::bind(
+          &muxscanner::inputsamples, m_muxscanner.get(), std::placeholders::_1,
+          std::placeholders::_2)));
+
+    // Create a worker thread on which to pump data from the device into the fan-out
+    if (m_device)
+    {
+
+      scalar_condition<bool> started{false};
+      m_worker = std::thread(&channelsettings::worker, this, std::ref(started));
+      started.wait_until_equals(true);
+    }
   }
 
   catch (...)
@@ -24,6 +24,7 @@
 #define __CHANNELSETTINGS_H_
 #pragma once
 
+#include "iqfanout.h"
 #include "muxscanner.h"
 #include "props.h"
 #include "renderingcontrol.h"
@@ -77,6 +78,10 @@ public:
                                                  struct tunerprops const& tunerprops,
                                                  struct channelprops const& channelprops,
                                                  bool isnew);
+  static std::unique_ptr<channelsettings> create(std::shared_ptr<iqfanout> iqsamples,
+                                                 uint32_t samplerate,
+                                                 struct tunerprops const& tunerprops,
+                                                 struct channelprops const& channelprops);
 
   // get_channel_properties
   //
@@ -115,6 +120,8 @@ private:
   // Instance Constructor
   //
   channelsettings(std::unique_ptr<rtldevice> device,
+                  std::shared_ptr<iqfanout> iqsamples,
+                  uint32_t samplerate,
                   struct tunerprops const& tunerprops,
                   struct channelprops const& channelprops,
                   bool isnew);
@@ -287,6 +294,8 @@ private:
   bool m_isnew = false; // New channel flag
   std::unique_ptr<signalmeter> m_signalmeter; // Signal meter instance
   std::unique_ptr<muxscanner> m_muxscanner; // Multiplex scanner instance
+  std::shared_ptr<iqfanout> m_iqfanout; // I/Q sample fan-out
+  std::vector<unsigned int> m_consumerids; // I/Q sample fan-out consumers
   std::vector<int> m_manualgains; // Manual gain values
   bool m_result = false; // Dialog result
 
@@ -0,0 +1,601 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "hdblender.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#pragma warning(push, 4)
+
+// hdblender::ALIGN_DECIMATION
+//
+// Decimation factor applied to the audio for the coarse alignment search
+size_t const hdblender::ALIGN_DECIMATION = 32; // ~1378Hz
+
+// hdblender::ALIGN_RETRY
+//
+// Number of analog frames between failed alignment attempts
+uint64_t const hdblender::ALIGN_RETRY = 22050; // ~0.5sec
+
+// hdblender::ALIGN_THRESHOLD
+//
+// Minimum normalized correlation required to accept an alignment
+float const hdblender::ALIGN_THRESHOLD = 0.5f;
+
+// hdblender::ALIGN_WINDOW
+//
+// Number of digital frames correlated against the analog history
+size_t const hdblender::ALIGN_WINDOW = (1 << 16); // ~1.5sec
+
+// hdblender::BURST_MARGIN
+//
+// Number of frames of digital audio to keep in hand
+uint64_t const hdblender::BURST_MARGIN = (1 << 16) + 8192; // ~1.7sec
+
+// hdblender::HISTORY_FRAMES
+//
+// Number of frames held for each input, must be a power of two
+size_t const hdblender::HISTORY_FRAMES = (1 << 19); // ~11.9sec
+
+// hdblender::MAX_DELAY
+//
+// Maximum output delay in analog frames
+uint64_t const hdblender::MAX_DELAY = (44100 * 5); // ~5sec
+
+// hdblender::RAMP_FRAMES
+//
+// Number of frames over which the audio is crossfaded
+size_t const hdblender::RAMP_FRAMES = 22050; // ~0.5sec
+
+//---------------------------------------------------------------------------
+// hdblender Constructor (private)
+//
+// Arguments:
+//
+//	output		- Function invoked to output blended PCM samples
+
+hdblender::hdblender(output_func const& output)
+  : m_output(output), m_analog(HISTORY_FRAMES * 2), m_digital(HISTORY_FRAMES * 2)
+{
+  assert((HISTORY_FRAMES & (HISTORY_FRAMES - 1)) == 0);
+  assert(m_output);
+
+  m_worker = std::thread(&hdblender::alignworker, this);
+}
+
+//---------------------------------------------------------------------------
+// hdblender Destructor
+
+hdblender::~hdblender()
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_stop = true;
+  lock.unlock();
+
+  m_cv.notify_all();
+  if (m_worker.joinable())
+    m_worker.join();
+}
+
+//---------------------------------------------------------------------------
+// hdblender::align (private)
+//
+// Snapshots the history for alignment and applies completed alignments
+//
+// Arguments:
+//
+//	NONE
+
+void hdblender::align(void)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // Apply the result of a completed alignment job; results from before the most
+  // recent synchronization no longer apply to the digital audio being decoded
+  if (m_done)
+  {
+
+    m_done = m_busy = false;
+    bool found = m_found;
+    int64_t const offset = m_foundoffset;
+    if (m_foundgeneration != m_generation)
+      return;
+
+    lock.unlock();
+
+    // The output has to be delayed enough that the digital audio matching each analog
+    // frame has been decoded by the time it's output. If the digital audio is too far
+    // behind to be held in the history or would exceed the maximum latency the blend
+    // can't be performed
+    int64_t required = 0;
+    if (found)
+    {
+
+      required = static_cast<int64_t>(m_analogframes) -
+                 (static_cast<int64_t>(m_digitalframes) + offset) +
+                 static_cast<int64_t>(BURST_MARGIN);
+      if (required > static_cast<int64_t>(std::min(MAX_DELAY, HISTORY_FRAMES - ALIGN_WINDOW)))
+        found = false;
+    }
+
+    if (!found)
+    {
+
+      m_nextalign = m_analogframes + ALIGN_RETRY;
+      return;
+    }
+
+    // The delay is increased as needed; it's only reduced while the output is analog
+    // audio alone, the analog audio held back by the excess delay is output at once
+    if (required > static_cast<int64_t>(m_delay))
+      m_delay = static_cast<uint64_t>(required);
+    else if ((m_gain == 0.0f) && (!m_previous.valid))
+      m_delay = static_cast<uint64_t>(std::max(required, int64_t(0)));
+
+    m_current.valid = true;
+    m_current.offset = offset;
+    m_current.first = m_digitalbase;
+    m_current.end = 0;
+
+    return;
+  }
+
+  // Snapshot the history for a new alignment job, this requires a full window of
+  // digital audio since synchronization; the correlation is expensive so it's done
+  // on the worker thread rather than on the calling DSP thread
+  if (m_busy || (m_analogframes < m_nextalign) ||
+      ((m_digitalframes - m_digitalbase) < ALIGN_WINDOW))
+    return;
+
+  std::unique_ptr<alignjob_t> job = std::make_unique<alignjob_t>();
+  job->generation = m_generation;
+  job->digitalstart = m_digitalframes - ALIGN_WINDOW;
+  job->analogfirst = (m_analogframes > HISTORY_FRAMES) ? m_analogframes - HISTORY_FRAMES : 0;
+  snapshot(m_digital, job->digitalstart, ALIGN_WINDOW, job->digital);
+  snapshot(m_analog, job->analogfirst, static_cast<size_t>(m_analogframes - job->analogfirst),
+           job->analog);
+
+  m_job = std::move(job);
+  m_busy = true;
+  lock.unlock();
+
+  m_cv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// hdblender::alignworker (private)
+//
+// Worker thread procedure used to perform the alignment correlations
+//
+// Arguments:
+//
+//	NONE
+
+void hdblender::alignworker(void)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  while (true)
+  {
+
+    m_cv.wait(lock, [&]() -> bool { return m_stop || m_job; });
+    if (m_stop)
+      break;
+
+    std::unique_ptr<alignjob_t> job = std::move(m_job);
+    lock.unlock();
+
+    // Coarse search of the entire analog history at a reduced rate
+    size_t lag = 0;
+    bool found = correlate(job->digital, job->analog, 0, job->analog.size() / 2,
+                           ALIGN_DECIMATION, lag);
+
+    // Fine search at the full rate around the coarse offset
+    if (found)
+    {
+
+      size_t const finefirst = (lag > ALIGN_DECIMATION) ? lag - ALIGN_DECIMATION : 0;
+      size_t const finelast =
+          std::min(lag + ALIGN_DECIMATION + ALIGN_WINDOW, job->analog.size() / 2);
+
+      size_t finelag = 0;
+      if ((finelast - finefirst >= ALIGN_WINDOW) &&
+          correlate(job->digital, job->analog, finefirst, finelast - finefirst, 1, finelag))
+        lag = finefirst + finelag;
+    }
+
+    lock.lock();
+
+    m_done = true;
+    m_found = found;
+    m_foundgeneration = job->generation;
+    m_foundoffset =
+        static_cast<int64_t>(job->analogfirst + lag) - static_cast<int64_t>(job->digitalstart);
+  }
+}
+
+//---------------------------------------------------------------------------
+// hdblender::analog
+//
+// Pushes analog PCM samples into the blender and outputs the blended samples
+//
+// Arguments:
+//
+//	samples		- Interleaved stereo PCM samples
+//	count		- Number of PCM samples
+
+void hdblender::analog(int16_t const* samples, size_t count)
+{
+  assert(samples != nullptr);
+
+  size_t const mask = HISTORY_FRAMES - 1;
+
+  // Append the analog frames to the history
+  for (size_t index = 0; index < count / 2; index++)
+  {
+
+    size_t slot = static_cast<size_t>(m_analogframes & mask) * 2;
+    m_analog[slot] = samples[index * 2];
+    m_analog[slot + 1] = samples[(index * 2) + 1];
+    m_analogframes++;
+  }
+
+  // Attempt to align newly synchronized digital audio, if it fails it won't be
+  // attempted again until more audio has been received
+  if (m_synced && !m_current.valid)
+    align();
+
+  // Output everything up to the current output delay; when the delay has just been
+  // increased there may be nothing to output until enough analog audio has arrived
+  if (m_analogframes <= m_delay)
+    return;
+  uint64_t const end = m_analogframes - m_delay;
+  if (end <= m_emitted)
+    return;
+
+  size_t const frames = static_cast<size_t>(end - m_emitted);
+  m_output_buffer.resize(frames * 2);
+
+  for (size_t index = 0; index < frames; index++)
+  {
+
+    uint64_t frame = m_emitted + index;
+    size_t analogslot = static_cast<size_t>(frame & mask) * 2;
+    float left = m_analog[analogslot];
+    float right = m_analog[analogslot + 1];
+
+    // Determine the digital frame that carries the same audio as this analog frame; the
+    // alignment of the previous synchronization remains in use until its audio runs out
+    float gain = 0.0f;
+    for (segment_t const* segment : {&m_current, &m_previous})
+    {
+
+      if (!segment->valid)
+        continue;
+
+      // The decoded audio of a closed segment ends where synchronization was reacquired
+      bool const closed = (segment == &m_previous);
+      uint64_t const end = (closed) ? segment->end : m_digitalframes;
+
+      int64_t digital = static_cast<int64_t>(frame) - segment->offset;
+      if ((digital < static_cast<int64_t>(segment->first)) ||
+          (digital >= static_cast<int64_t>(end)) ||
+          ((m_digitalframes - static_cast<uint64_t>(digital)) > HISTORY_FRAMES))
+        continue;
+
+      // Ramp the digital audio in, and if synchronization was lost ramp it
+      // back out such that it reaches zero as the decoded audio runs out
+      float target = 1.0f;
+      if (closed || !m_synced)
+        target = std::min(1.0f, static_cast<float>(end - digital) / RAMP_FRAMES);
+
+      gain = std::min(m_gain + (1.0f / RAMP_FRAMES), target);
+
+      size_t digitalslot = static_cast<size_t>(static_cast<uint64_t>(digital) & mask) * 2;
+      left += (m_digital[digitalslot] - left) * gain;
+      right += (m_digital[digitalslot + 1] - right) * gain;
+      break;
+    }
+
+    m_gain = gain;
+
+    m_output_buffer[index * 2] = static_cast<int16_t>(left);
+    m_output_buffer[(index * 2) + 1] = static_cast<int16_t>(right);
+  }
+
+  m_emitted = end;
+
+  // Once the output has passed the end of the previous alignment it's no longer needed
+  if (m_previous.valid &&
+      (static_cast<int64_t>(m_emitted) - m_previous.offset >= static_cast<int64_t>(m_previous.end)))
+    m_previous.valid = false;
+
+  m_output(m_output_buffer.data(), m_output_buffer.size());
+}
+
+//---------------------------------------------------------------------------
+// hdblender::blended
+//
+// Gets a flag indicating if the digital audio is currently audible
+//
+// Arguments:
+//
+//	NONE
+
+bool hdblender::blended(void) const
+{
+  return m_gain > 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// hdblender::correlate (private, static)
+//
+// Locates the analog frame lag that best matches the digital audio
+//
+// Arguments:
+//
+//	digitalframes	- Digital frames of the correlation window
+//	analogframes	- Analog frames to search
+//	analogfirst		- First analog frame to search
+//	analogcount		- Number of analog frames to search
+//	decimation		- Decimation factor to apply to the audio
+//	lag				- On success, set to the analog frame lag from analogfirst
+
+bool hdblender::correlate(std::vector<int16_t> const& digitalframes,
+                          std::vector<int16_t> const& analogframes,
+                          size_t analogfirst,
+                          size_t analogcount,
+                          size_t decimation,
+                          size_t& lag)
+{
+  if (analogcount < ALIGN_WINDOW)
+    return false;
+
+  std::vector<float> digital;
+  std::vector<float> analog;
+  mono(digitalframes, 0, ALIGN_WINDOW, decimation, digital);
+  mono(analogframes, analogfirst, analogcount, decimation, analog);
+
+  size_t const length = digital.size();
+  if ((length == 0) || (analog.size() < length))
+    return false;
+
+  // The digital window has to contain something other than silence
+  double digitalenergy = 0;
+  for (size_t index = 0; index < length; index++)
+    digitalenergy += static_cast<double>(digital[index]) * digital[index];
+  if (digitalenergy <= 0)
+    return false;
+
+  // Slide the digital window across the analog history maintaining a running sum
+  // of the energy of the analog samples under the window to normalize the result
+  double analogenergy = 0;
+  for (size_t index = 0; index < length; index++)
+    analogenergy += static_cast<double>(analog[index]) * analog[index];
+
+  float best = 0.0f;
+  size_t bestlag = 0;
+  size_t const lags = analog.size() - length + 1;
+
+  for (size_t index = 0; index < lags; index++)
+  {
+
+    if (index > 0)
+    {
+
+      double leaving = analog[index - 1];
+      double entering = analog[index + length - 1];
+      analogenergy += (entering * entering) - (leaving * leaving);
+    }
+
+    float dot = 0.0f;
+    float const* a = &analog[index];
+    for (size_t sample = 0; sample < length; sample++)
+      dot += digital[sample] * a[sample];
+
+    if (analogenergy > 0)
+    {
+
+      float normalized = static_cast<float>(dot / std::sqrt(digitalenergy * analogenergy));
+      if (normalized > best)
+      {
+
+        best = normalized;
+        bestlag = index;
+      }
+    }
+  }
+
+  if (best < ALIGN_THRESHOLD)
+    return false;
+
+  lag = bestlag * decimation;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// hdblender::create (static)
+//
+// Factory method, creates a new hdblender instance
+//
+// Arguments:
+//
+//	output		- Function invoked to output blended PCM samples
+
+std::unique_ptr<hdblender> hdblender::create(output_func const& output)
+{
+  return std::unique_ptr<hdblender>(new hdblender(output));
+}
+
+//---------------------------------------------------------------------------
+// hdblender::digital
+//
+// Pushes digital PCM samples into the blender
+//
+// Arguments:
+//
+//	samples		- Interleaved stereo PCM samples
+//	count		- Number of PCM samples
+
+void hdblender::digital(int16_t const* samples, size_t count)
+{
+  assert(samples != nullptr);
+
+  // Digital audio implies synchronization; a consumer that attached to a
+  // receiver that was already synchronized won't have seen the event
+  if (!m_synced)
+    sync();
+
+  size_t const mask = HISTORY_FRAMES - 1;
+
+  for (size_t index = 0; index < count / 2; index++)
+  {
+
+    size_t slot = static_cast<size_t>(m_digitalframes & mask) * 2;
+    m_digital[slot] = samples[index * 2];
+    m_digital[slot + 1] = samples[(index * 2) + 1];
+    m_digitalframes++;
+  }
+}
+
+//---------------------------------------------------------------------------
+// hdblender::lostsync
+//
+// Indicates that the digital signal has been lost
+//
+// Arguments:
+//
+//	NONE
+
+void hdblender::lostsync(void)
+{
+  // Leave the alignment in place, the digital audio that has already been
+  // decoded continues to be output while it's crossfaded back to analog
+  m_synced = false;
+}
+
+//---------------------------------------------------------------------------
+// hdblender::mono (private, static)
+//
+// Generates a mean-removed, decimated mono signal from interleaved frames
+//
+// Arguments:
+//
+//	frames		- Interleaved stereo frames
+//	start		- First frame
+//	count		- Number of frames
+//	decimation	- Decimation factor
+//	signal		- Generated signal
+
+void hdblender::mono(std::vector<int16_t> const& frames,
+                     size_t start,
+                     size_t count,
+                     size_t decimation,
+                     std::vector<float>& signal)
+{
+  signal.resize(count / decimation);
+  if (signal.empty())
+    return;
+
+  double sum = 0;
+  for (size_t index = 0; index < signal.size(); index++)
+  {
+
+    int32_t accumulator = 0;
+    int16_t const* frame = &frames[(start + (index * decimation)) * 2];
+    for (size_t sample = 0; sample < decimation * 2; sample++)
+      accumulator += frame[sample];
+
+    signal[index] = static_cast<float>(accumulator);
+    sum += accumulator;
+  }
+
+  float const mean = static_cast<float>(sum / signal.size());
+  for (auto& sample : signal)
+    sample -= mean;
+}
+
+//---------------------------------------------------------------------------
+// hdblender::snapshot (private)
+//
+// Copies a range of frames out of a history buffer in chronological order
+//
+// Arguments:
+//
+//	history		- History buffer
+//	start		- First frame
+//	frames		- Number of frames
+//	linear		- Copied frames
+
+void hdblender::snapshot(std::vector<int16_t> const& history,
+                         uint64_t start,
+                         size_t frames,
+                         std::vector<int16_t>& linear) const
+{
+  assert(frames <= HISTORY_FRAMES);
+
+  linear.resize(frames * 2);
+  if (frames == 0)
+    return;
+
+  // The range wraps around the end of the history buffer at most once
+  size_t const first = static_cast<size_t>(start & (HISTORY_FRAMES - 1));
+  size_t const head = std::min(frames, HISTORY_FRAMES - first);
+
+  std::copy_n(&history[first * 2], head * 2, linear.begin());
+  std::copy_n(history.begin(), (frames - head) * 2, linear.begin() + (head * 2));
+}
+
+//---------------------------------------------------------------------------
+// hdblender::sync
+//
+// Indicates that the digital signal has been acquired
+//
+// Arguments:
+//
+//	NONE
+
+void hdblender::sync(void)
+{
+  // The digital audio decoded before now keeps its alignment and continues to be
+  // crossfaded out until it runs out or the new synchronization has been aligned
+  if (m_current.valid)
+  {
+
+    m_previous = m_current;
+    m_previous.end = m_digitalframes;
+    m_current.valid = false;
+  }
+
+  // Only digital audio decoded since synchronization can be aligned; any alignment
+  // job still running for the previous synchronization will be discarded
+  m_synced = true;
+  m_generation++;
+  m_digitalbase = m_digitalframes;
+  m_nextalign = 0;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,249 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __HDBLENDER_H_
+#define __HDBLENDER_H_
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class hdblender
+//
+// Implements the blend between the analog FM host and the digital audio of the
+// main HD Radio program. Both inputs are 44.1KHz interleaved stereo PCM; output
+// is paced by the analog audio, which is continuous, and the digital audio is
+// time-aligned against it by cross-correlation before it is crossfaded in; the
+// correlation is performed on a worker thread against a snapshot of the history
+
+class hdblender
+{
+public:
+  // output_func
+  //
+  // Function invoked to output blended PCM samples
+  using output_func = std::function<void(int16_t const* samples, size_t count)>;
+
+  // Destructor
+  //
+  ~hdblender();
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // analog
+  //
+  // Pushes analog PCM samples into the blender and outputs the blended samples
+  void analog(int16_t const* samples, size_t count);
+
+  // blended
+  //
+  // Gets a flag indicating if the digital audio is currently audible
+  bool blended(void) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new hdblender instance
+  static std::unique_ptr<hdblender> create(output_func const& output);
+
+  // digital
+  //
+  // Pushes digital PCM samples into the blender
+  void digital(int16_t const* samples, size_t count);
+
+  // lostsync
+  //
+  // Indicates that the digital signal has been lost
+  void lostsync(void);
+
+  // sync
+  //
+  // Indicates that the digital signal has been acquired
+  void sync(void);
+
+private:
+  hdblender(hdblender const&) = delete;
+  hdblender& operator=(hdblender const&) = delete;
+
+  // ALIGN_DECIMATION
+  //
+  // Decimation factor applied to the audio for the coarse alignment search
+  static size_t const ALIGN_DECIMATION;
+
+  // ALIGN_RETRY
+  //
+  // Number of analog frames between failed alignment attempts
+  static uint64_t const ALIGN_RETRY;
+
+  // ALIGN_THRESHOLD
+  //
+  // Minimum normalized correlation required to accept an alignment
+  static float const ALIGN_THRESHOLD;
+
+  // ALIGN_WINDOW
+  //
+  // Number of digital frames correlated against the analog history
+  static size_t const ALIGN_WINDOW;
+
+  // BURST_MARGIN
+  //
+  // Number of frames of digital audio to keep in hand, nrsc5 produces
+  // the digital audio in bursts as each group of frames is decoded
+  static uint64_t const BURST_MARGIN;
+
+  // HISTORY_FRAMES
+  //
+  // Number of frames held for each input, must be a power of two
+  static size_t const HISTORY_FRAMES;
+
+  // MAX_DELAY
+  //
+  // Maximum output delay in analog frames
+  static uint64_t const MAX_DELAY;
+
+  // RAMP_FRAMES
+  //
+  // Number of frames over which the audio is crossfaded
+  static size_t const RAMP_FRAMES;
+
+  // Instance Constructor
+  //
+  hdblender(output_func const& output);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // alignjob_t
+  //
+  // Snapshot of the history to be aligned on the worker thread
+  struct alignjob_t
+  {
+    uint64_t generation; // Synchronization generation
+    uint64_t digitalstart; // First digital frame of the window
+    uint64_t analogfirst; // First analog frame of the history
+    std::vector<int16_t> digital; // Digital frames of the window
+    std::vector<int16_t> analog; // Analog frame history
+  };
+
+  // segment_t
+  //
+  // Range of digital frames that share the same alignment
+  struct segment_t
+  {
+    bool valid; // Flag if the segment is valid
+    int64_t offset; // Analog frame = digital frame + offset
+    uint64_t first; // First digital frame of the segment
+    uint64_t end; // One past the last digital frame of a closed segment
+  };
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // align
+  //
+  // Snapshots the history for alignment and applies completed alignments
+  void align(void);
+
+  // alignworker
+  //
+  // Worker thread procedure used to perform the alignment correlations
+  void alignworker(void);
+
+  // correlate (static)
+  //
+  // Locates the analog frame lag that best matches the digital audio
+  static bool correlate(std::vector<int16_t> const& digitalframes,
+                        std::vector<int16_t> const& analogframes,
+                        size_t analogfirst,
+                        size_t analogcount,
+                        size_t decimation,
+                        size_t& lag);
+
+  // mono (static)
+  //
+  // Generates a mean-removed, decimated mono signal from interleaved frames
+  static void mono(std::vector<int16_t> const& frames,
+                   size_t start,
+                   size_t count,
+                   size_t decimation,
+                   std::vector<float>& signal);
+
+  // snapshot
+  //
+  // Copies a range of frames out of a history buffer in chronological order
+  void snapshot(std::vector<int16_t> const& history,
+                uint64_t start,
+                size_t frames,
+                std::vector<int16_t>& linear) const;
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  output_func const m_output; // Output function
+  std::vector<int16_t> m_output_buffer; // Output buffer
+
+  // HISTORY
+  //
+  std::vector<int16_t> m_analog; // Analog frame history
+  uint64_t m_analogframes = 0; // Total analog frames received
+  std::vector<int16_t> m_digital; // Digital frame history
+  uint64_t m_digitalframes = 0; // Total digital frames received
+  uint64_t m_digitalbase = 0; // First digital frame since sync
+
+  // BLEND STATE
+  //
+  bool m_synced = false; // Flag if digital is synchronized
+  uint64_t m_generation = 0; // Synchronization generation
+  segment_t m_current = {}; // Alignment of the current synchronization
+  segment_t m_previous = {}; // Alignment of the previous synchronization
+  uint64_t m_delay = 0; // Output delay in analog frames
+  uint64_t m_emitted = 0; // Next analog frame to output
+  uint64_t m_nextalign = 0; // Next analog frame to attempt alignment
+  float m_gain = 0.0f; // Current digital audio gain
+
+  // ALIGNMENT WORKER
+  //
+  std::thread m_worker; // Alignment worker thread
+  std::unique_ptr<alignjob_t> m_job; // Pending alignment job
+  bool m_busy = false; // Flag if a job is pending or running
+  bool m_done = false; // Flag if a job has completed
+  bool m_found = false; // Flag if the completed job found an alignment
+  uint64_t m_foundgeneration = 0; // Generation of the completed job
+  int64_t m_foundoffset = 0; // Offset found by the completed job
+  bool m_stop = false; // Flag to stop the worker thread
+  mutable std::mutex m_lock; // Synchronization object
+  std::condition_variable m_cv; // Worker condition variable
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __HDBLENDER_H_
@@ -0,0 +1,737 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "hdreceiver.h"
+
+#include "utils/value_size_defines.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+
+#pragma warning(push, 4)
+
+// hdreceiver::ANALOG_HOLD
+//
+// Number of digital audio frames after synchronization to hold full analog quality
+uint64_t const hdreceiver::ANALOG_HOLD = (44100 * 10); // ~10sec
+
+// hdreceiver::ANALOG_OUTPUT_RATE
+//
+// Analog FM audio output sample rate
+uint32_t const hdreceiver::ANALOG_OUTPUT_RATE = 44100;
+
+// hdreceiver::ANALOG_PRIME
+//
+// Number of I/Q samples used to prime an analog demodulator before it's output
+size_t const hdreceiver::ANALOG_PRIME = (1488375 / 10); // ~100ms
+
+// hdreceiver::BER_SAMPLE_INTERVAL
+//
+// Number of frames between bit error rate measurements
+unsigned int const hdreceiver::BER_SAMPLE_INTERVAL = 4; // ~6sec digital
+
+// hdreceiver::DEGRADE_NONE
+//
+// Full quality; bit error rate measurements and data services
+int const hdreceiver::DEGRADE_NONE = 0;
+
+// hdreceiver::DEGRADE_NOBER
+//
+// Bit error rate measurements are paused
+int const hdreceiver::DEGRADE_NOBER = 1;
+
+// hdreceiver::DEGRADE_NODATA
+//
+// Data services (ID3 and LOT/stream ports) are discarded
+int const hdreceiver::DEGRADE_NODATA = 2;
+
+// hdreceiver::DSP_BLOCK_SIZE
+//
+// Maximum number of bytes of I/Q samples processed at a time by the demodulator
+size_t const hdreceiver::DSP_BLOCK_SIZE = (32 KiB); // ~1/100 of a second
+
+// hdreceiver::RING_BUFFER_SIZE
+//
+// Input ring buffer size
+size_t const hdreceiver::RING_BUFFER_SIZE = (4 MiB); // ~1.4 seconds @ 1488375
+
+// hdreceiver::SAMPLE_RATE
+//
+// Fixed device sample rate required for HD Radio
+uint32_t const hdreceiver::SAMPLE_RATE = 1488375;
+
+// event_program (local)
+//
+// Gets the 1-based program number of a program-specific event, or zero
+static uint32_t event_program(nrsc5_event_t const* event);
+
+//---------------------------------------------------------------------------
+// hdreceiver Constructor (private)
+//
+// Arguments:
+//
+//	device			- RTL-SDR device instance
+//	tunerprops		- Tuner device properties
+//	channelprops	- Channel properties
+//	hdprops			- HD Radio digital signal processor properties
+
+hdreceiver::hdreceiver(std::unique_ptr<rtldevice> device,
+                       struct tunerprops const& tunerprops,
+                       struct channelprops const& channelprops,
+                       struct hdprops const& hdprops)
+  : m_device(std::move(device)),
+    m_ringbuffer(static_cast<uint32_t>(RING_BUFFER_SIZE)),
+    m_counters(std::make_shared<perfcounters>()),
+    m_iqfanout(iqfanout::create()),
+    m_frequency(channelprops.frequency),
+    m_analogblend(hdprops.analogblend)
+{
+  // Initialize the RTL-SDR device instance
+  m_device->set_frequency_correction(tunerprops.freqcorrection + channelprops.freqcorrection);
+  m_device->set_sample_rate(SAMPLE_RATE);
+  m_device->set_center_frequency(channelprops.frequency);
+
+  // Adjust the device gain as specified by the channel properties
+  m_device->set_automatic_gain_control(channelprops.autogain);
+  if (channelprops.autogain == false)
+    m_device->set_gain(channelprops.manualgain);
+
+  // Initialize the analog FM demodulators for blending; the reduced quality chain only
+  // demodulates mono with the fastest downsampling, the full quality chain demodulates
+  // stereo with the configured downsampling. Both are fed from the same device samples
+  if (m_analogblend)
+  {
+
+    init_analog_chain(m_analogeconomy, DownsampleQuality::Low, false);
+    init_analog_chain(m_analogfull, static_cast<enum DownsampleQuality>(hdprops.analogquality),
+                      true);
+
+    // The demodulators expect the I/Q samples in the range of -32767.0 through +32767.0
+    // (32767.0 / 127.5) = 256.9960784313725
+    for (size_t index = 0; index < m_analoglut.size(); index++)
+      m_analoglut[index] = (static_cast<TYPEREAL>(index) - static_cast<TYPEREAL>(127.5)) *
+                           static_cast<TYPEREAL>(256.9960784313725);
+
+    int limit = m_analogfull.demodulator->GetInputBufferLimit();
+    m_analogiq = std::unique_ptr<TYPECPX[]>(new TYPECPX[limit]);
+    m_analogstereo = std::unique_ptr<TYPECPX[]>(new TYPECPX[limit]);
+    m_analogmono = std::unique_ptr<TYPEREAL[]>(new TYPEREAL[limit]);
+    m_analogpcm.resize(static_cast<size_t>(limit) * 2);
+  }
+
+  // Initialize the HD Radio demodulator; no program audio is decoded until
+  // there is a consumer for it
+  nrsc5_open_pipe(&m_nrsc5);
+  nrsc5_set_mode(m_nrsc5, NRSC5_MODE_FM);
+  nrsc5_set_callback(m_nrsc5, nrsc5_callback, this);
+  nrsc5_set_programs(m_nrsc5, 0);
+
+  // The bit error rate is only used to report the signal quality, it doesn't need
+  // to be measured for every frame during playback
+  nrsc5_set_ber_interval(m_nrsc5, BER_SAMPLE_INTERVAL);
+
+  // Create a worker thread on which to perform demodulation; this is kept separate
+  // from the device transfer thread so that a busy frame can't stall the device
+  scalar_condition<bool> dspstarted{false};
+  m_dspworker = std::thread(&hdreceiver::dspworker, this, std::ref(dspstarted));
+  dspstarted.wait_until_equals(true);
+
+  // Create a worker thread on which to transfer data from the device
+  scalar_condition<bool> started{false};
+  m_worker = std::thread(&hdreceiver::worker, this, std::ref(started));
+  started.wait_until_equals(true);
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver Destructor
+
+hdreceiver::~hdreceiver()
+{
+  close();
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::addconsumer
+//
+// Adds a consumer for the specified multiplex program
+//
+// Arguments:
+//
+//	program			- Multiplex program number (1-based)
+//	handler			- Consumer event handler
+
+void hdreceiver::addconsumer(uint32_t program, hdprogramhandler& handler)
+{
+  assert((program > 0) && (program <= 32));
+
+  std::unique_lock<std::mutex> lock(m_consumerslock);
+  m_consumers.push_back({program, &handler});
+
+  // The analog FM host only carries the main program
+  if (program == 1)
+    m_analogwanted.store(m_analogblend);
+
+  // Start decoding the program audio; this is applied on the demodulator thread
+  m_programs.fetch_or(1U << (program - 1));
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::close
+//
+// Closes the receiver
+//
+// Arguments:
+//
+//	NONE
+
+void hdreceiver::close(void)
+{
+  m_stop = true; // Signal worker threads to stop
+  if (m_device)
+    m_device->cancel_async(); // Cancel any async read operations
+  if (m_worker.joinable())
+    m_worker.join(); // Wait for thread
+  if (m_dspworker.joinable())
+    m_dspworker.join(); // Wait for thread
+  m_iqfanout->close(); // Detach any I/Q sample consumers
+
+  nrsc5_close(m_nrsc5); // Close NRSC5
+  m_nrsc5 = nullptr; // Reset NRSC5 API handle
+
+  m_consumers.clear(); // Release all consumers
+  m_device.reset(); // Release RTL-SDR device
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::counters
+//
+// Gets the device and DSP performance counters of the receiver
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<perfcounters> const& hdreceiver::counters(void) const
+{
+  return m_counters;
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::create (static)
+//
+// Factory method, creates a new hdreceiver instance
+//
+// Arguments:
+//
+//	device			- RTL-SDR device instance
+//	tunerprops		- Tunder device properties
+//	channelprops	- Channel properties
+//	hdprops			- HD Radio digital signal processor properties
+
+std::shared_ptr<hdreceiver> hdreceiver::create(std::unique_ptr<rtldevice> device,
+                                               struct tunerprops const& tunerprops,
+                                               struct channelprops const& channelprops,
+                                               struct hdprops const& hdprops)
+{
+  return std::shared_ptr<hdreceiver>(
+      new hdreceiver(std::move(device), tunerprops, channelprops, hdprops));
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::demodulate_analog (private)
+//
+// Demodulates the analog FM host from a block of I/Q samples
+//
+// Arguments:
+//
+//	samples		- Block of cu8 I/Q samples
+//	length		- Length of the block in bytes
+
+void hdreceiver::demodulate_analog(uint8_t const* samples, size_t length)
+{
+  if (!m_analogwanted.load())
+    return;
+
+  size_t const limit = static_cast<size_t>(m_analogfull.demodulator->GetInputBufferLimit());
+
+  // Full quality is required while the digital signal is missing and until the
+  // consumers have had a chance to align and blend back to the digital audio
+  bool const wantfull = (!m_digitalsynced) || (m_analogheld < ANALOG_HOLD);
+
+  // The demodulators only handle up to their input buffer limit at a time
+  size_t const total = length / 2;
+  for (size_t offset = 0; offset < total;)
+  {
+
+    size_t const count = std::min(total - offset, limit);
+    uint8_t const* iq = &samples[offset * 2];
+    offset += count;
+
+    // Convert the I/Q samples once for both of the demodulator chains
+    for (size_t index = 0; index < count; index++)
+      m_analogiq[index] = {m_analoglut[iq[index * 2]], m_analoglut[iq[(index * 2) + 1]]};
+
+    // When switching chains, run the incoming chain without using its output for
+    // a short time to flush out the stale filter state from when it was last used
+    if ((wantfull != m_analogfullactive) && (m_analogprime == 0))
+      m_analogprime = ANALOG_PRIME;
+
+    if (m_analogprime > 0)
+    {
+
+      process_analog_chain((m_analogfullactive) ? m_analogeconomy : m_analogfull,
+                           static_cast<int>(count));
+
+      m_analogprime -= std::min(m_analogprime, count);
+      if (m_analogprime == 0)
+        m_analogfullactive = !m_analogfullactive;
+    }
+
+    size_t pcmcount = process_analog_chain((m_analogfullactive) ? m_analogfull : m_analogeconomy,
+                                           static_cast<int>(count));
+    if (pcmcount == 0)
+      continue;
+
+    // The analog FM host only carries the main program
+    std::unique_lock<std::mutex> lock(m_consumerslock);
+    for (auto const& consumer : m_consumers)
+    {
+
+      if (consumer.program == 1)
+        consumer.handler->onanalogaudio(m_analogpcm.data(), pcmcount);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::devicename
+//
+// Gets the device name associated with the receiver
+//
+// Arguments:
+//
+//	NONE
+
+std::string hdreceiver::devicename(void) const
+{
+  return std::string(m_device->get_device_name());
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::dspworker (private)
+//
+// Worker thread procedure used to demodulate the buffered I/Q samples
+//
+// Arguments:
+//
+//	started		- Condition variable to set when thread has started
+
+void hdreceiver::dspworker(scalar_condition<bool>& started)
+{
+  assert(m_nrsc5);
+
+  unsigned int programs = 0; // Programs being audio decoded
+  int degradation = DEGRADE_NONE; // Applied DSP degradation level
+  loadcontroller controller(DEGRADE_NODATA); // DSP degradation controller
+
+  // Allocate the buffer used to pull the I/Q samples out of the ring buffer
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[DSP_BLOCK_SIZE]);
+
+  started = true; // Inform the caller that the thread is running
+
+  try
+  {
+
+    // Continuously demodulate the buffered samples until the receiver has been stopped;
+    // the I/Q samples are processed in pairs so only whole multiples of 4 are read
+    while (m_stop.test(true) == false)
+    {
+
+      // Apply any change to the set of consumed programs, NRSC5 isn't thread-safe
+      // so this can only be done between calls into the demodulator
+      unsigned int consumed = m_programs.load();
+      if (consumed != programs)
+      {
+
+        nrsc5_set_programs(m_nrsc5, consumed);
+        programs = consumed;
+      }
+
+      size_t available = static_cast<size_t>(m_ringbuffer.GetRingBufferReadAvailable()) & ~size_t(3);
+      if (available == 0)
+      {
+
+        // If the data transfer thread has stopped there won't be any more samples
+        if (m_stopped.load() == true)
+          break;
+
+        // Wait for more samples to arrive, the transfer thread doesn't signal
+        // when data is written so as to keep the device callback lock-free
+        m_stop.wait_until_equals(true, 5);
+        continue;
+      }
+
+      // Shed or restore optional decoder work based on how far behind the demodulator is,
+      // this can only be applied between calls into the demodulator for the same reason
+      int const level = controller.update(available, RING_BUFFER_SIZE);
+      if (level != degradation)
+      {
+
+        nrsc5_set_ber_interval(m_nrsc5, (level >= DEGRADE_NOBER) ? 0 : BER_SAMPLE_INTERVAL);
+        nrsc5_set_data_services(m_nrsc5, (level >= DEGRADE_NODATA) ? 0 : 1);
+
+        degradation = level;
+        m_counters->degradation(level);
+      }
+
+      int32_t count = m_ringbuffer.getDataFromBuffer(
+          buffer.get(), static_cast<int32_t>(std::min(available, DSP_BLOCK_SIZE)));
+
+      // Demodulate the analog FM host from the same samples for blending
+      if (m_analogblend)
+      {
+
+        perfcounters::stagetimer timer(*m_counters, perfcounters::stage::demodulate);
+        demodulate_analog(buffer.get(), static_cast<size_t>(count));
+      }
+
+      // Pipe the samples into NRSC5, it will invoke the necessary callback(s); this
+      // covers both the OFDM demodulation and the decoding of the digital audio
+      {
+        perfcounters::stagetimer timer(*m_counters, perfcounters::stage::decode);
+        nrsc5_pipe_samples_cu8(m_nrsc5, buffer.get(), static_cast<unsigned int>(count));
+      }
+    }
+  }
+
+  catch (...)
+  {
+    m_dspworker_exception = std::current_exception();
+  }
+
+  m_stopped.store(true); // Thread is stopped
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::frequency
+//
+// Gets the frequency the receiver is tuned to
+//
+// Arguments:
+//
+//	NONE
+
+uint32_t hdreceiver::frequency(void) const
+{
+  return m_frequency;
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::init_analog_chain (private, static)
+//
+// Initializes an analog FM demodulator chain
+//
+// Arguments:
+//
+//	chain		- Analog demodulator chain to initialize
+//	quality		- Downsample quality
+//	stereo		- Flag to demodulate stereo
+
+void hdreceiver::init_analog_chain(analog_chain_t& chain,
+                                   enum DownsampleQuality quality,
+                                   bool stereo)
+{
+  // Initialize the demodulator parameters
+  //
+  tDemodInfo demodinfo = {};
+  demodinfo.HiCutmax = 100000;
+  demodinfo.HiCut = 100000;
+  demodinfo.LowCut = -100000;
+  demodinfo.SquelchValue = -160;
+  demodinfo.WfmDownsampleQuality = quality;
+
+  // Initialize the wideband FM demodulator; HD Radio is only broadcast in North
+  // America and the analog host is at the center frequency required by NRSC5
+  chain.demodulator = std::unique_ptr<CDemodulator>(new CDemodulator());
+  chain.demodulator->SetUSFmVersion(true);
+  chain.demodulator->SetInputSampleRate(static_cast<TYPEREAL>(SAMPLE_RATE));
+  chain.demodulator->SetDemod(DEMOD_WFM, demodinfo);
+  chain.demodulator->SetDemodFreq(0);
+
+  // Initialize the output resampler
+  chain.resampler = std::unique_ptr<CFractResampler>(new CFractResampler());
+  chain.resampler->Init(chain.demodulator->GetInputBufferLimit());
+
+  chain.stereo = stereo;
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::nrsc5_callback (private, static)
+//
+// NRSC5 library event callback function
+//
+// Arguments:
+//
+//	event	- NRSC5 event being raised
+//	arg		- Implementation-specific context pointer
+
+void hdreceiver::nrsc5_callback(nrsc5_event_t const* event, void* arg)
+{
+  assert(arg != nullptr);
+  reinterpret_cast<hdreceiver*>(arg)->nrsc5_callback(event);
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::nrsc5_callback (private)
+//
+// NRSC5 library event callback function
+//
+// Arguments:
+//
+//	event	- NRSC5 event being raised
+
+void hdreceiver::nrsc5_callback(nrsc5_event_t const* event)
+{
+  // Program-specific events are only passed to the consumers of that program,
+  // everything else applies to the entire multiplex and goes to every consumer
+  uint32_t program = event_program(event);
+
+  // Track the digital signal state to select the analog demodulator quality
+  if (event->event == NRSC5_EVENT_SYNC)
+  {
+
+    m_digitalsynced = true;
+    m_analogheld = 0;
+  }
+  else if (event->event == NRSC5_EVENT_LOST_SYNC)
+    m_digitalsynced = false;
+  else if ((event->event == NRSC5_EVENT_AUDIO) && (program == 1))
+    m_analogheld += event->audio.count / 2;
+
+  std::unique_lock<std::mutex> lock(m_consumerslock);
+  for (auto const& consumer : m_consumers)
+  {
+
+    if ((program == 0) || (consumer.program == program))
+      consumer.handler->onnrsc5event(event);
+  }
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::process_analog_chain (private)
+//
+// Processes I/Q samples through an analog demodulator chain into m_analogpcm
+//
+// Arguments:
+//
+//	chain		- Analog demodulator chain
+//	count		- Number of converted I/Q samples in m_analogiq
+
+size_t hdreceiver::process_analog_chain(analog_chain_t& chain, int count)
+{
+  TYPEREAL const rate = chain.demodulator->GetOutputRate() / ANALOG_OUTPUT_RATE;
+
+  if (chain.stereo)
+  {
+
+    int audio = chain.demodulator->ProcessData(count, m_analogiq.get(), m_analogstereo.get());
+    if (audio <= 0)
+      return 0;
+
+    int frames =
+        chain.resampler->Resample(audio, rate, m_analogstereo.get(),
+                                  reinterpret_cast<TYPESTEREO16*>(m_analogpcm.data()), 1.0);
+    return static_cast<size_t>(frames) * 2;
+  }
+
+  int audio = chain.demodulator->ProcessData(count, m_analogiq.get(), m_analogmono.get());
+  if (audio <= 0)
+    return 0;
+
+  // Resample the mono audio into the front of the PCM buffer and expand it into
+  // stereo in place, working backwards so that nothing is overwritten early
+  int frames = chain.resampler->Resample(audio, rate, m_analogmono.get(),
+                                         reinterpret_cast<TYPEMONO16*>(m_analogpcm.data()), 1.0);
+  for (int index = frames - 1; index >= 0; index--)
+    m_analogpcm[(index * 2)] = m_analogpcm[(index * 2) + 1] = m_analogpcm[index];
+
+  return static_cast<size_t>(frames) * 2;
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& hdreceiver::iqsamples(void) const
+{
+  return m_iqfanout;
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::removeconsumer
+//
+// Removes a consumer from the receiver
+//
+// Arguments:
+//
+//	handler			- Consumer event handler
+
+void hdreceiver::removeconsumer(hdprogramhandler& handler)
+{
+  std::unique_lock<std::mutex> lock(m_consumerslock);
+
+  m_consumers.erase(std::remove_if(m_consumers.begin(), m_consumers.end(),
+                                   [&](consumer_t const& consumer) -> bool
+                                   { return consumer.handler == &handler; }),
+                    m_consumers.end());
+
+  // Stop decoding the audio of any programs that no longer have a consumer
+  unsigned int programs = 0;
+  for (auto const& consumer : m_consumers)
+    programs |= (1U << (consumer.program - 1));
+  m_programs.store(programs);
+
+  // Stop demodulating the analog FM host if the main program is no longer consumed
+  m_analogwanted.store(m_analogblend && ((programs & 1U) != 0));
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::stopped
+//
+// Gets a flag indicating if the receiver has stopped
+//
+// Arguments:
+//
+//	NONE
+
+bool hdreceiver::stopped(void) const
+{
+  return m_stopped.load();
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::worker (private)
+//
+// Worker thread procedure used to transfer data from the device
+//
+// Arguments:
+//
+//	started		- Condition variable to set when thread has started
+
+void hdreceiver::worker(scalar_condition<bool>& started)
+{
+  assert(m_device);
+
+  // read_callback_func (local)
+  //
+  // Asynchronous read callback function for the RTL-SDR device
+  auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
+  {
+    // Hand the raw samples to any other consumers attached to the device first
+    m_iqfanout->write(buffer, count);
+
+    // Copy the input data into the ring buffer for the demodulator thread; if the
+    // demodulator has fallen behind drop the entire transfer rather than a partial
+    // one to keep the I/Q sample pairs aligned
+    assert(count <= static_cast<size_t>(std::numeric_limits<int32_t>::max()));
+    if (static_cast<size_t>(m_ringbuffer.GetRingBufferWriteAvailable()) >= count)
+      m_ringbuffer.putDataIntoBuffer(buffer, static_cast<int32_t>(count));
+    else
+      m_counters->buffersdropped(1);
+
+    // Track the depth of the ring buffer in units of device transfers
+    if (count > 0)
+      m_counters->bufferreceived(static_cast<size_t>(m_ringbuffer.GetRingBufferReadAvailable()) / count);
+  };
+
+  // Begin streaming from the device and inform the caller that the thread is running
+  m_device->begin_stream();
+  started = true;
+
+  // Continuously read data from the device until cancel_async() has been called
+  // 32 KiB = ~1/100 of a second of data
+  try
+  {
+    m_device->read_async(read_callback_func, 32 KiB);
+  }
+  catch (...)
+  {
+    m_worker_exception = std::current_exception();
+  }
+
+  m_stopped.store(true); // Thread is stopped
+}
+
+//---------------------------------------------------------------------------
+// hdreceiver::worker_exception
+//
+// Gets the exception that caused a worker thread to stop, if any
+//
+// Arguments:
+//
+//	NONE
+
+std::exception_ptr hdreceiver::worker_exception(void) const
+{
+  if (!m_stopped.load())
+    return nullptr;
+
+  return (m_worker_exception) ? m_worker_exception : m_dspworker_exception;
+}
+
+//---------------------------------------------------------------------------
+// event_program (local)
+//
+// Gets the 1-based program number of a program-specific event, or zero
+//
+// Arguments:
+//
+//	event	- NRSC5 event
+
+static uint32_t event_program(nrsc5_event_t const* event)
+{
+  switch (event->event)
+  {
+
+    case NRSC5_EVENT_AUDIO:
+      return event->audio.program + 1;
+
+    case NRSC5_EVENT_HDC:
+      return event->hdc.program + 1;
+
+    case NRSC5_EVENT_ID3:
+      return event->id3.program + 1;
+
+    default:
+      return 0;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
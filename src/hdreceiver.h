@@ -0,0 +1,309 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __HDRECEIVER_H_
+#define __HDRECEIVER_H_
+#pragma once
+
+#include "dsp_dab/ringbuffer.h"
+#include "dsp_fm/demodulator.h"
+#include "dsp_fm/fractresampler.h"
+#include "dsp_hd/nrsc5.h"
+#include "iqfanout.h"
+#include "loadcontroller.h"
+#include "perfcounters.h"
+#include "props.h"
+#include "rtldevice.h"
+#include "utils/scalar_condition.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class hdprogramhandler
+//
+// Interface implemented by the consumers of an HD Radio receiver
+
+class hdprogramhandler
+{
+public:
+  // Destructor
+  //
+  virtual ~hdprogramhandler() = default;
+
+  // onnrsc5event
+  //
+  // Invoked when an NRSC5 event has been raised that applies to the consumer
+  virtual void onnrsc5event(nrsc5_event_t const* event) = 0;
+
+  // onanalogaudio
+  //
+  // Invoked when analog FM audio has been demodulated (44.1KHz interleaved stereo)
+  virtual void onanalogaudio(int16_t const* /*samples*/, size_t /*count*/)
+  {
+  }
+};
+
+//---------------------------------------------------------------------------
+// Class hdreceiver
+//
+// Implements an HD Radio receiver that can be shared among multiple consumers;
+// the device, acquisition, synchronisation and decoding are shared by all of the
+// consumers while only the programs that are being consumed are audio decoded.
+//
+// When analog blend is enabled the analog FM host is also demodulated from the
+// same I/Q samples for the consumers of the main program; it's demodulated at
+// reduced quality while the digital signal is locked and at full quality while
+// the digital signal is missing or has only just been reacquired
+
+class hdreceiver
+{
+public:
+  // Destructor
+  //
+  ~hdreceiver();
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // addconsumer
+  //
+  // Adds a consumer for the specified multiplex program
+  void addconsumer(uint32_t program, hdprogramhandler& handler);
+
+  // close
+  //
+  // Closes the receiver
+  void close(void);
+
+  // counters
+  //
+  // Gets the device and DSP performance counters of the receiver
+  std::shared_ptr<perfcounters> const& counters(void) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new hdreceiver instance
+  static std::shared_ptr<hdreceiver> create(std::unique_ptr<rtldevice> device,
+                                            struct tunerprops const& tunerprops,
+                                            struct channelprops const& channelprops,
+                                            struct hdprops const& hdprops);
+
+  // devicename
+  //
+  // Gets the device name associated with the receiver
+  std::string devicename(void) const;
+
+  // frequency
+  //
+  // Gets the frequency the receiver is tuned to
+  uint32_t frequency(void) const;
+
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const;
+
+  // removeconsumer
+  //
+  // Removes a consumer from the receiver
+  void removeconsumer(hdprogramhandler& handler);
+
+  // stopped
+  //
+  // Gets a flag indicating if the receiver has stopped
+  bool stopped(void) const;
+
+  // worker_exception
+  //
+  // Gets the exception that caused a worker thread to stop, if any
+  std::exception_ptr worker_exception(void) const;
+
+private:
+  hdreceiver(hdreceiver const&) = delete;
+  hdreceiver& operator=(hdreceiver const&) = delete;
+
+  // ANALOG_HOLD
+  //
+  // Number of digital audio frames after synchronization to hold full analog quality
+  static uint64_t const ANALOG_HOLD;
+
+  // ANALOG_OUTPUT_RATE
+  //
+  // Analog FM audio output sample rate
+  static uint32_t const ANALOG_OUTPUT_RATE;
+
+  // ANALOG_PRIME
+  //
+  // Number of I/Q samples used to prime an analog demodulator before it's output
+  static size_t const ANALOG_PRIME;
+
+  // BER_SAMPLE_INTERVAL
+  //
+  // Number of frames between bit error rate measurements
+  static unsigned int const BER_SAMPLE_INTERVAL;
+
+  // DEGRADE_XXXXXX
+  //
+  // DSP degradation levels; each level also applies the ones below it
+  static int const DEGRADE_NONE;
+  static int const DEGRADE_NOBER;
+  static int const DEGRADE_NODATA;
+
+  // DSP_BLOCK_SIZE
+  //
+  // Maximum number of bytes of I/Q samples processed at a time by the demodulator
+  static size_t const DSP_BLOCK_SIZE;
+
+  // RING_BUFFER_SIZE
+  //
+  // Input ring buffer size
+  static size_t const RING_BUFFER_SIZE;
+
+  // SAMPLE_RATE
+  //
+  // Fixed device sample rate required for HD Radio
+  static uint32_t const SAMPLE_RATE;
+
+  // Instance Constructor
+  //
+  hdreceiver(std::unique_ptr<rtldevice> device,
+             struct tunerprops const& tunerprops,
+             struct channelprops const& channelprops,
+             struct hdprops const& hdprops);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // analog_chain_t
+  //
+  // Defines an analog FM demodulator chain
+  struct analog_chain_t
+  {
+
+    std::unique_ptr<CDemodulator> demodulator; // CuteSDR demodulator instance
+    std::unique_ptr<CFractResampler> resampler; // CuteSDR resampler instance
+    bool stereo; // Flag if demodulating stereo
+  };
+
+  // consumer_t
+  //
+  // Defines a consumer of a multiplex program
+  struct consumer_t
+  {
+
+    uint32_t program; // Multiplex program number (1-based)
+    hdprogramhandler* handler; // Consumer event handler
+  };
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // demodulate_analog
+  //
+  // Demodulates the analog FM host from a block of I/Q samples
+  void demodulate_analog(uint8_t const* samples, size_t length);
+
+  // dspworker
+  //
+  // Worker thread procedure used to demodulate the buffered I/Q samples
+  void dspworker(scalar_condition<bool>& started);
+
+  // init_analog_chain (static)
+  //
+  // Initializes an analog FM demodulator chain
+  static void init_analog_chain(analog_chain_t& chain, enum DownsampleQuality quality, bool stereo);
+
+  // process_analog_chain
+  //
+  // Processes I/Q samples through an analog demodulator chain into m_analogpcm
+  size_t process_analog_chain(analog_chain_t& chain, int count);
+
+  // nrsc5_callback (static)
+  //
+  // NRSC5 library event callback function
+  static void nrsc5_callback(nrsc5_event_t const* event, void* arg);
+
+  // nrsc5_callback
+  //
+  // NRSC5 library event callback function
+  void nrsc5_callback(nrsc5_event_t const* event);
+
+  // worker
+  //
+  // Worker thread procedure used to transfer data from the device
+  void worker(scalar_condition<bool>& started);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::unique_ptr<rtldevice> m_device; // RTL-SDR device instance
+  nrsc5_t* m_nrsc5 = nullptr; // NRSC5 demodulator handle
+  RingBuffer<uint8_t> m_ringbuffer; // I/Q sample ring buffer
+  std::shared_ptr<perfcounters> const m_counters; // Performance counters
+  std::shared_ptr<iqfanout> const m_iqfanout; // I/Q sample fan-out
+  uint32_t const m_frequency; // Multiplex frequency
+
+  // CONSUMERS
+  //
+  std::vector<consumer_t> m_consumers; // Program consumers
+  mutable std::mutex m_consumerslock; // Synchronization object
+  std::atomic<unsigned int> m_programs{0}; // Bitmask of consumed programs
+  std::atomic<bool> m_analogwanted{false}; // Flag if analog audio is consumed
+
+  // ANALOG BLEND
+  //
+  bool const m_analogblend; // Flag if analog blend is enabled
+  analog_chain_t m_analogeconomy; // Reduced quality analog chain
+  analog_chain_t m_analogfull; // Full quality analog chain
+  bool m_analogfullactive = true; // Flag if full quality chain is output
+  size_t m_analogprime = 0; // Remaining I/Q samples to prime
+  uint64_t m_analogheld = 0; // Digital audio frames since sync
+  bool m_digitalsynced = false; // Flag if digital signal is synchronized
+  std::array<TYPEREAL, 256> m_analoglut; // cu8 I/Q sample conversion table
+  std::unique_ptr<TYPECPX[]> m_analogiq; // Converted I/Q samples
+  std::unique_ptr<TYPECPX[]> m_analogstereo; // Demodulated stereo audio
+  std::unique_ptr<TYPEREAL[]> m_analogmono; // Demodulated mono audio
+  std::vector<int16_t> m_analogpcm; // Resampled PCM audio
+
+  // WORKER THREADS
+  //
+  std::thread m_worker; // Data transfer thread
+  std::exception_ptr m_worker_exception; // Exception on worker thread
+  std::thread m_dspworker; // Demodulator thread
+  std::exception_ptr m_dspworker_exception; // Exception on demodulator thread
+  scalar_condition<bool> m_stop{false}; // Condition to stop data transfer
+  std::atomic<bool> m_stopped{false}; // Data transfer stopped flag
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __HDRECEIVER_H_
@@ -25,7 +25,6 @@
 #include "id3v2tag.h"
 #include "exception_control/string_exception.h"
 #include "utils/align.h"
-#include "utils/value_size_defines.h"
 
 #include <algorithm>
 #include <chrono>
@@ -41,11 +40,6 @@
 // Maximum number of queued demux packets
 size_t const hdstream::MAX_PACKET_QUEUE = 200; // ~2sec analog / ~10sec digital
 
-// hdstream::SAMPLE_RATE
-//
-// Fixed device sample rate required for HD Radio
-uint32_t const hdstream::SAMPLE_RATE = 1488375;
-
 // hdstream::STREAM_ID_AUDIO
 //
 // Stream identifier for the audio output stream
@@ -61,41 +55,32 @@ int const hdstream::STREAM_ID_ID3TAG = 2;
 //
 // Arguments:
 //
-//	device			- RTL-SDR device instance
-//	tunerprops		- Tuner device properties
-//	channelprops	- Channel properties
+//	receiver		- Shared HD Radio receiver instance
 //	hdprops			- HD Radio digital signal processor properties
 //	subchannel		- Multiplex subchannel number
 
-hdstream::hdstream(std::unique_ptr<rtldevice> device,
-                   struct tunerprops const& tunerprops,
-                   struct channelprops const& channelprops,
+hdstream::hdstream(std::shared_ptr<hdreceiver> receiver,
                    struct hdprops const& hdprops,
                    uint32_t subchannel)
-  : m_device(std::move(device)),
+  : pvrstream(receiver->counters()),
+    m_receiver(std::move(receiver)),
     m_subchannel((subchannel > 0) ? subchannel : 1),
     m_muxname(""),
-    m_pcmgain(powf(10.0f, hdprops.outputgain / 10.0f))
+    m_pcmgain(powf(10.0f, hdprops.outputgain / 10.0f)),
+    m_resampler(new CFractResampler())
 {
-  // Initialize the RTL-SDR device instance
-  m_device->set_frequency_correction(tunerprops.freqcorrection + channelprops.freqcorrection);
-  m_device->set_sample_rate(SAMPLE_RATE);
-  m_device->set_center_frequency(channelprops.frequency);
-
-  // Adjust the device gain as specified by the channel properties
-  m_device->set_automatic_gain_control(channelprops.autogain);
-  if (channelprops.autogain == false)
-    m_device->set_gain(channelprops.manualgain);
-
-  // Initialize the HD Radio demodulator
-  nrsc5_open_pipe(&m_nrsc5);
-  nrsc5_set_mode(m_nrsc5, NRSC5_MODE_FM);
-  nrsc5_set_callback(m_nrsc5, nrsc5_callback, this);
-
-  // Create a worker thread on which to perform demodulation
-  scalar_condition<bool> started{false};
-  m_worker = std::thread(&hdstream::worker, this, std::ref(started));
-  started.wait_until_equals(true);
+  // When blending to analog the output is paced by the analog FM audio, which is
+  // only available for the main program that it carries
+  if (hdprops.analogblend && (m_subchannel == 1))
+    m_blender = hdblender::create([this](int16_t const* samples, size_t count) -> void
+                                  { queue_audio(samples, count, 1.0f); });
+
+  // Publish the initial signal status before attaching to the receiver
+  publishstatus();
+
+  // Attach to the receiver as a consumer of the desired program; only the audio
+  // of programs that have a consumer is decoded by the receiver
+  m_receiver->addconsumer(m_subchannel, *static_cast<hdprogramhandler*>(this));
 }
 
 //---------------------------------------------------------------------------
@@ -106,6 +91,29 @@ hdstream::~hdstream()
   close();
 }
 
+//---------------------------------------------------------------------------
+// hdstream::apply_gain (private)
+//
+// Applies the PCM output gain to audio samples into the blend buffer
+//
+// Arguments:
+//
+//	samples		- PCM audio samples
+//	count		- Number of PCM audio samples
+
+void hdstream::apply_gain(int16_t const* samples, size_t count)
+{
+  m_blendbuffer.resize(count);
+
+  // Saturate rather than wrap around when the gain is above 0 dB
+  for (size_t index = 0; index < count; index++)
+  {
+
+    float sample = static_cast<float>(samples[index]) * m_pcmgain;
+    m_blendbuffer[index] = static_cast<int16_t>(std::min(std::max(sample, -32768.0f), 32767.0f));
+  }
+}
+
 //---------------------------------------------------------------------------
 // hdstream::canseek
 //
@@ -131,16 +139,18 @@ bool hdstream::canseek(void) const
 
 void hdstream::close(void)
 {
-  m_stop = true; // Signal worker thread to stop
-  if (m_device)
-    m_device->cancel_async(); // Cancel any async read operations
-  if (m_worker.joinable())
-    m_worker.join(); // Wait for thread
+  // Detach from the receiver; the receiver itself will be closed once the last
+  // consumer has released the shared instance.  The reference is held until the
+  // stream is destroyed so that a concurrent demuxread() can still access it
+  if (!m_stopped.exchange(true))
+  {
 
-  nrsc5_close(m_nrsc5); // Close NRSC5
-  m_nrsc5 = nullptr; // Reset NRSC5 API handle
+    m_receiver->removeconsumer(*static_cast<hdprogramhandler*>(this));
 
-  m_device.reset(); // Release RTL-SDR device
+    // Unblock any demultiplexer waiters; this requires the queue lock
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    m_cv.notify_all();
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -162,8 +172,26 @@ std::unique_ptr<hdstream> hdstream::create(std::unique_ptr<rtldevice> device,
                                            struct hdprops const& hdprops,
                                            uint32_t subchannel)
 {
-  return std::unique_ptr<hdstream>(
-      new hdstream(std::move(device), tunerprops, channelprops, hdprops, subchannel));
+  return create(hdreceiver::create(std::move(device), tunerprops, channelprops, hdprops), hdprops,
+                subchannel);
+}
+
+//---------------------------------------------------------------------------
+// hdstream::create (static)
+//
+// Factory method, creates a new hdstream instance
+//
+// Arguments:
+//
+//	receiver		- Shared HD Radio receiver instance
+//	hdprops			- HD Radio digital signal processor properties
+//	subchannel		- Multiplex subchannel number
+
+std::unique_ptr<hdstream> hdstream::create(std::shared_ptr<hdreceiver> receiver,
+                                           struct hdprops const& hdprops,
+                                           uint32_t subchannel)
+{
+  return std::unique_ptr<hdstream>(new hdstream(std::move(receiver), hdprops, subchannel));
 }
 
 //---------------------------------------------------------------------------
@@ -208,16 +236,21 @@ DEMUX_PACKET* hdstream::demuxread(std::function<DEMUX_PACKET*(int)> const& alloc
   // the digitial signal has been synchronized
   std::unique_lock<std::mutex> lock(m_queuelock);
   if (!m_cv.wait_for(lock, std::chrono::milliseconds(100),
-                     [&]() -> bool { return ((m_queue.size() > 0) || m_stopped.load() == true); }))
+                     [&]() -> bool { return ((m_queue.size() > 0) || stopped()); }))
+    return allocator(0);
+
+  // If the stream was closed, return an empty demultiplexer packet
+  if (m_stopped.load())
     return allocator(0);
 
-  // If the worker thread was stopped, check for and re-throw any exception that occurred,
+  // If the receiver was stopped, check for and re-throw any exception that occurred,
   // otherwise assume it was stopped normally and return an empty demultiplexer packet
-  if (m_stopped.load() == true)
+  if (m_receiver->stopped() == true)
   {
 
-    if (m_worker_exception)
-      std::rethrow_exception(m_worker_exception);
+    std::exception_ptr ex = m_receiver->worker_exception();
+    if (ex)
+      std::rethrow_exception(ex);
     else
       return allocator(0);
   }
@@ -273,7 +306,7 @@ void hdstream::demuxreset(void)
 
 std::string hdstream::devicename(void) const
 {
-  return std::string(m_device->get_device_name());
+  return m_receiver->devicename();
 }
 
 //---------------------------------------------------------------------------
@@ -307,6 +340,20 @@ void hdstream::enumproperties(std::function<void(struct streamprops const& props
 #endif
 }
 
+//---------------------------------------------------------------------------
+// hdstream::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& hdstream::iqsamples(void) const
+{
+  return m_receiver->iqsamples();
+}
+
 //---------------------------------------------------------------------------
 // hdstream::length
 //
@@ -336,75 +383,89 @@ std::string hdstream::muxname(void) const
 }
 
 //---------------------------------------------------------------------------
-// hdstream::nrsc5_callback (private, static)
+// hdstream::onanalogaudio (private)
 //
-// NRSC5 library event callback function
+// Invoked when analog FM audio has been demodulated
 //
 // Arguments:
 //
-//	event	- NRSC5 event being raised
-//	arg		- Implementation-specific context pointer
+//	samples		- Interleaved stereo PCM audio samples
+//	count		- Number of PCM audio samples
 
-void hdstream::nrsc5_callback(nrsc5_event_t const* event, void* arg)
+void hdstream::onanalogaudio(int16_t const* samples, size_t count)
 {
-  assert(arg != nullptr);
-  reinterpret_cast<hdstream*>(arg)->nrsc5_callback(event);
+  if (m_blender)
+  {
+
+    apply_gain(samples, count);
+    m_blender->analog(m_blendbuffer.data(), count);
+  }
 }
 
 //---------------------------------------------------------------------------
-// hdstream::nrsc5_callback (private)
+// hdstream::onnrsc5event (private)
 //
-// NRSC5 library event callback function
+// Invoked when an NRSC5 event has been raised that applies to the stream
 //
 // Arguments:
 //
 //	event	- NRSC5 event being raised
 
-void hdstream::nrsc5_callback(nrsc5_event_t const* event)
+void hdstream::onnrsc5event(nrsc5_event_t const* event)
 {
-  bool queued = false; // Flag if an item was queued
-
-  std::unique_lock<std::mutex> lock(m_queuelock);
-
   // NRSC5_EVENT_AUDIO
   //
   // A digital stream audio packet has been generated
   if (event->event == NRSC5_EVENT_AUDIO)
   {
 
-    // Filter out anything other than program zero for now
+    // Filter out anything other than the selected program
     if (event->audio.program == (m_subchannel - 1))
     {
 
-      // Allocate an initialize a heap buffer and copy the audio data into it
-      size_t audiosize = event->audio.count * sizeof(int16_t);
-      std::unique_ptr<uint8_t[]> audiodata(new uint8_t[audiosize]);
+      // When blending, the digital audio is passed through the blender instead
+      // and the output is paced by the analog audio
+      if (m_blender)
+      {
 
-      // Apply the specified PCM output gain while copying the audio data into the packet buffer
-      int16_t* pcmdata = reinterpret_cast<int16_t*>(audiodata.get());
-      for (size_t index = 0; index < event->audio.count; index++)
-        pcmdata[index] = static_cast<int16_t>(event->audio.data[index] * m_pcmgain);
+        apply_gain(event->audio.data, event->audio.count);
+        m_blender->digital(m_blendbuffer.data(), event->audio.count);
+      }
 
-      // Generate and queue the audio packet
-      std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
-      packet->streamid = STREAM_ID_AUDIO;
-      packet->size = static_cast<int>(audiosize);
-      packet->duration = (event->audio.count / 2.0 / 44100.0) * STREAM_TIME_BASE;
-      packet->dts = packet->pts = m_dts;
-      packet->data = std::move(audiodata);
+      else
+        queue_audio(event->audio.data, event->audio.count, m_pcmgain);
+    }
+  }
 
-      m_dts += packet->duration;
+  // NRSC5_EVENT_SYNC
+  //
+  // The digital signal has been synchronized
+  else if (event->event == NRSC5_EVENT_SYNC)
+  {
 
-      m_queue.emplace(std::move(packet));
-      queued = true;
-    }
+    if (m_blender)
+      m_blender->sync();
+  }
+
+  // NRSC5_EVENT_LOST_SYNC
+  //
+  // The digital signal has been lost
+  else if (event->event == NRSC5_EVENT_LOST_SYNC)
+  {
+
+    if (m_blender)
+      m_blender->lostsync();
   }
 
   // NRSC5_EVENT_BER
   //
   // Reporting the current bit error rate
   else if (event->event == NRSC5_EVENT_BER)
+  {
+
     m_ber.store(event->ber.cber);
+    publishstatus(0.0f, m_mer.load(), m_ber.load());
+  }
 
   // NRSC5_EVENT_MER
   //
@@ -415,6 +476,7 @@ void hdstream::nrsc5_callback(nrsc5_event_t const* event)
     // Store the higher of the two values instead of the mean, some HD radio stations
     // are allowed to transmit one sideband at a higher power than the other
     m_mer.store(std::max(event->mer.lower, event->mer.upper));
+    publishstatus(0.0f, m_mer.load(), m_ber.load());
   }
 
 #ifdef KODI_HAS_ID3
@@ -424,8 +486,8 @@ void hdstream::nrsc5_callback(nrsc5_event_t const* event)
   else if (event->event == NRSC5_EVENT_ID3)
   {
 
-    // Filter out anything other than program zero for now
-    if (event->id3.program == 0)
+    // Filter out anything other than the selected program
+    if (event->id3.program == (m_subchannel - 1))
     {
 
       size_t tagsize = 0; // Length of the ID3 tag
@@ -473,8 +535,7 @@ void hdstream::nrsc5_callback(nrsc5_event_t const* event)
         packet->size = static_cast<int>(tagsize);
         packet->data = std::move(tagdata);
 
-        m_queue.emplace(std::move(packet));
-        queued = true;
+        queue_packet(std::move(packet));
       }
     }
   }
@@ -498,42 +559,169 @@ void hdstream::nrsc5_callback(nrsc5_event_t const* event)
     }
   }
 #endif
+}
+
+//---------------------------------------------------------------------------
+// hdstream::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
 
-  if (queued)
+long long hdstream::position(void) const
+{
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+// hdstream::queue_audio (private)
+//
+// Generates and queues an audio demux packet
+//
+// Arguments:
+//
+//	samples		- Interleaved stereo PCM audio samples
+//	count		- Number of PCM audio samples
+//	gain		- Gain to apply to the samples
+
+void hdstream::queue_audio(int16_t const* samples, size_t count, float gain)
+{
+  size_t const frames = count / 2;
+  if (frames == 0)
+    return;
+
+  // Steer the resampler ratio to compensate for the drift between the device clock
+  // and the clock that the audio is being consumed with
+  size_t queued = 0;
   {
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    queued = m_queue.size();
+  }
+
+  // The queue depth only follows the consumer clock if the stream is read in real time
+  bool const controlled = realtimeconsumer();
+  if (!controlled)
+    m_driftcontroller.reset();
 
-    // If the queue size has exceeded the maximum, the packets aren't
-    // being processed quickly enough by the demux read function
-    if (m_queue.size() > MAX_PACKET_QUEUE)
+  double const correction =
+      (controlled) ? m_driftcontroller.update(queued, MAX_PACKET_QUEUE) : 1.0;
+  counters()->clockdrift(controlled, m_driftcontroller.ppm());
+
+  // The audio is only resampled while the drift controller is steering the output
+  std::unique_ptr<uint8_t[]> audiodata;
+  int resampled = static_cast<int>(frames);
+
+  if (correction == 1.0)
+  {
+
+    // Copy the audio into a new heap buffer while applying the specified PCM output gain,
+    // saturating rather than wrapping around when the gain is above 0 dB
+    audiodata.reset(new uint8_t[frames * sizeof(TYPESTEREO16)]);
+    int16_t* pcmdata = reinterpret_cast<int16_t*>(audiodata.get());
+    if (gain == 1.0f)
+      memcpy(pcmdata, samples, frames * sizeof(TYPESTEREO16));
+
+    else
     {
 
-      m_queue = demux_queue_t(); // Replace the queue<>
+      for (size_t index = 0; index < (frames * 2); index++)
+      {
 
-      // Push a DEMUX_SPECIALID_STREAMCHANGE packet into the new queue
-      std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
-      packet->streamid = DEMUX_SPECIALID_STREAMCHANGE;
-      m_queue.emplace(std::move(packet));
+        float sample = static_cast<float>(samples[index]) * gain;
+        pcmdata[index] = static_cast<int16_t>(std::min(std::max(sample, -32768.0f), 32767.0f));
+      }
+    }
+  }
 
-      // Reset the decode time stamp
-      m_dts = STREAM_TIME_BASE;
+  else
+  {
+
+    perfcounters::stagetimer timer(*counters(), perfcounters::stage::resample);
+
+    // The resampler has to be (re)initialized if the input is larger than it can accept
+    if (frames > m_resamplerinput.size())
+    {
+
+      m_resampler->Init(static_cast<int>(frames));
+      m_resamplerinput.resize(frames);
     }
 
-    m_cv.notify_all(); // Notify queue was updated
+    // Convert the interleaved stereo samples into the resampler input format
+    for (size_t index = 0; index < frames; index++)
+    {
+
+      m_resamplerinput[index].re = samples[(index * 2)];
+      m_resamplerinput[index].im = samples[(index * 2) + 1];
+    }
+
+    // Resample the audio directly into the packet buffer while applying the specified PCM
+    // output gain; a ratio below 1.0 generates slightly more samples than were provided
+    size_t const maxframes = frames + (frames / 500) + 2;
+    audiodata.reset(new uint8_t[maxframes * sizeof(TYPESTEREO16)]);
+    resampled = m_resampler->Resample(static_cast<int>(frames), static_cast<TYPEREAL>(correction),
+                                      m_resamplerinput.data(),
+                                      reinterpret_cast<TYPESTEREO16*>(audiodata.get()), gain);
   }
+
+  // Generate and queue the audio packet
+  std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
+  packet->streamid = STREAM_ID_AUDIO;
+  packet->size = static_cast<int>(resampled * sizeof(TYPESTEREO16));
+  packet->duration = (resampled / 44100.0) * STREAM_TIME_BASE;
+  packet->dts = packet->pts = m_dts;
+  packet->data = std::move(audiodata);
+
+  m_dts += packet->duration;
+  counters()->addsignaltime(resampled / 44100.0);
+
+  // Provide a copy of the audio to the recording sink, if one is attached; the
+  // HDC bitstream is proprietary so the decoded audio is transcoded instead
+  std::shared_ptr<recordingsink> recording = recorder();
+  if (recording)
+    recording->writepcm(reinterpret_cast<int16_t const*>(packet->data.get()),
+                        static_cast<size_t>(resampled), 2, 44100);
+
+  queue_packet(std::move(packet));
 }
 
 //---------------------------------------------------------------------------
-// hdstream::position
+// hdstream::queue_packet (private)
 //
-// Gets the current position of the stream
+// Queues a demux packet
 //
 // Arguments:
 //
-//	NONE
+//	packet		- Demux packet to be queued
 
-long long hdstream::position(void) const
+void hdstream::queue_packet(std::unique_ptr<demux_packet_t> packet)
 {
-  return -1;
+  // This is invoked on the demodulator thread and shouldn't block the
+  // demultiplexer any longer than necessary
+  std::unique_lock<std::mutex> lock(m_queuelock);
+  m_queue.emplace(std::move(packet));
+  counters()->packetqueued(m_queue.size());
+
+  // If the queue size has exceeded the maximum, the packets aren't
+  // being processed quickly enough by the demux read function
+  if (m_queue.size() > MAX_PACKET_QUEUE)
+  {
+
+    counters()->packetsdropped(m_queue.size());
+    m_queue = demux_queue_t(); // Replace the queue<>
+    m_driftcontroller.reset(); // Reset the clock drift controller
+
+    // Push a DEMUX_SPECIALID_STREAMCHANGE packet into the new queue
+    std::unique_ptr<demux_packet_t> streamchange = std::make_unique<demux_packet_t>();
+    streamchange->streamid = DEMUX_SPECIALID_STREAMCHANGE;
+    m_queue.emplace(std::move(streamchange));
+
+    // Reset the decode time stamp
+    m_dts = STREAM_TIME_BASE;
+  }
+
+  m_cv.notify_all(); // Notify queue was updated
 }
 
 //---------------------------------------------------------------------------
@@ -565,6 +753,20 @@ bool hdstream::realtime(void) const
   return true;
 }
 
+//---------------------------------------------------------------------------
+// hdstream::receiver
+//
+// Gets the shared receiver the stream is attached to
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<void> hdstream::receiver(void) const
+{
+  return m_receiver;
+}
+
 //---------------------------------------------------------------------------
 // hdstream::seek
 //
@@ -580,6 +782,22 @@ long long hdstream::seek(long long /*position*/, int /*whence*/)
   return -1;
 }
 
+//---------------------------------------------------------------------------
+// hdstream::seektime
+//
+// Seeks the demultiplexer to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag to seek backwards from the time
+//	startpts	- On success, receives the time stamp of the seek position
+
+bool hdstream::seektime(double /*time*/, bool /*backwards*/, double& /*startpts*/)
+{
+  return false;
+}
+
 //---------------------------------------------------------------------------
 // hdstream::servicename
 //
@@ -622,45 +840,31 @@ void hdstream::signalquality(int& quality, int& snr) const
 }
 
 //---------------------------------------------------------------------------
-// hdstream::worker (private)
+// hdstream::stopped
 //
-// Worker thread procedure used to transfer data from the device
+// Gets a flag indicating if the stream has stopped
 //
 // Arguments:
 //
-//	started		- Condition variable to set when thread has started
+//	NONE
 
-void hdstream::worker(scalar_condition<bool>& started)
+bool hdstream::stopped(void) const
 {
-  assert(m_device);
-  assert(m_nrsc5);
-
-  // read_callback_func (local)
-  //
-  // Asynchronous read callback function for the RTL-SDR device
-  auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
-  {
-    // Pipe the samples into NRSC5, it will invoke the necessary callback(s)
-    nrsc5_pipe_samples_cu8(m_nrsc5, const_cast<uint8_t*>(buffer), static_cast<unsigned int>(count));
-  };
-
-  // Begin streaming from the device and inform the caller that the thread is running
-  m_device->begin_stream();
-  started = true;
+  return (m_stopped.load() || m_receiver->stopped());
+}
 
-  // Continuously read data from the device until cancel_async() has been called
-  // 32 KiB = ~1/100 of a second of data
-  try
-  {
-    m_device->read_async(read_callback_func, 32 KiB);
-  }
-  catch (...)
-  {
-    m_worker_exception = std::current_exception();
-  }
+//---------------------------------------------------------------------------
+// hdstream::streamtimes
+//
+// Gets the time properties of the stream
+//
+// Arguments:
+//
+//	times		- Structure to receive the stream time properties
 
-  m_stopped.store(true); // Thread is stopped
-  m_cv.notify_all(); // Unblock any waiters
+bool hdstream::streamtimes(struct streamtimeprops& /*times*/) const
+{
+  return false;
 }
 
 //---------------------------------------------------------------------------
@@ -24,11 +24,14 @@
 #define __HDSTREAM_H_
 #pragma once
 
+#include "driftcontroller.h"
+#include "dsp_fm/fractresampler.h"
 #include "dsp_hd/nrsc5.h"
+#include "hdblender.h"
+#include "hdreceiver.h"
 #include "props.h"
 #include "pvrstream.h"
 #include "rtldevice.h"
-#include "utils/scalar_condition.h"
 
 #include <atomic>
 #include <condition_variable>
@@ -36,7 +39,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
-#include <thread>
+#include <vector>
 
 #pragma warning(push, 4)
 
@@ -45,7 +48,7 @@
 //
 // Implements an HD Radio stream
 
-class hdstream : public pvrstream
+class hdstream : public pvrstream, private hdprogramhandler
 {
 public:
   // Destructor
@@ -73,6 +76,9 @@ public:
                                           struct channelprops const& channelprops,
                                           struct hdprops const& hdprops,
                                           uint32_t subchannel);
+  static std::unique_ptr<hdstream> create(std::shared_ptr<hdreceiver> receiver,
+                                          struct hdprops const& hdprops,
+                                          uint32_t subchannel);
 
   // demuxabort
   //
@@ -105,6 +111,11 @@ public:
   void enumproperties(
       std::function<void(struct streamprops const& props)> const& callback) override;
 
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const override;
+
   // length
   //
   // Gets the length of the stream
@@ -130,11 +141,21 @@ public:
   // Gets a flag indicating if the stream is real-time
   bool realtime(void) const override;
 
+  // receiver
+  //
+  // Gets the shared receiver the stream is attached to
+  std::shared_ptr<void> receiver(void) const override;
+
   // seek
   //
   // Sets the stream pointer to a specific position
   long long seek(long long position, int whence) override;
 
+  // seektime
+  //
+  // Seeks the demultiplexer to a specific time
+  bool seektime(double time, bool backwards, double& startpts) override;
+
   // servicename
   //
   // Gets the service name associated with the stream
@@ -145,6 +166,16 @@ public:
   // Gets the signal quality as percentages
   void signalquality(int& quality, int& snr) const override;
 
+  // stopped
+  //
+  // Gets a flag indicating if the stream has stopped
+  bool stopped(void) const override;
+
+  // streamtimes
+  //
+  // Gets the time properties of the stream
+  bool streamtimes(struct streamtimeprops& times) const override;
+
 private:
   hdstream(hdstream const&) = delete;
   hdstream& operator=(hdstream const&) = delete;
@@ -154,11 +185,6 @@ private:
   // Maximum number of queued demux packets
   static size_t const MAX_PACKET_QUEUE;
 
-  // SAMPLE_RATE
-  //
-  // Fixed device sample rate required for HD Radio
-  static uint32_t const SAMPLE_RATE;
-
   // STREAM_ID_AUDIO
   //
   // Stream identifier for the audio output stream
@@ -171,9 +197,7 @@ private:
 
   // Instance Constructor
   //
-  hdstream(std::unique_ptr<rtldevice> device,
-           struct tunerprops const& tunerprops,
-           struct channelprops const& channelprops,
+  hdstream(std::shared_ptr<hdreceiver> receiver,
            struct hdprops const& hdprops,
            uint32_t subchannel);
 
@@ -218,26 +242,38 @@ private:
   //-----------------------------------------------------------------------
   // Private Member Functions
 
-  // nrsc5_callback (static)
+  // apply_gain
   //
-  // NRSC5 library event callback function
-  static void nrsc5_callback(nrsc5_event_t const* event, void* arg);
+  // Applies the PCM output gain to audio samples into the blend buffer
+  void apply_gain(int16_t const* samples, size_t count);
 
-  // nrsc5_callback
+  // queue_audio
   //
-  // NRSC5 library event callback function
-  void nrsc5_callback(nrsc5_event_t const* event);
+  // Generates and queues an audio demux packet
+  void queue_audio(int16_t const* samples, size_t count, float gain);
 
-  // worker
+  // queue_packet
   //
-  // Worker thread procedure used to transfer data from the device
-  void worker(scalar_condition<bool>& started);
+  // Queues a demux packet
+  void queue_packet(std::unique_ptr<demux_packet_t> packet);
+
+  //-----------------------------------------------------------------------
+  // hdprogramhandler
+
+  // onanalogaudio
+  //
+  // Invoked when analog FM audio has been demodulated
+  void onanalogaudio(int16_t const* samples, size_t count) override;
+
+  // onnrsc5event
+  //
+  // Invoked when an NRSC5 event has been raised that applies to the stream
+  void onnrsc5event(nrsc5_event_t const* event) override;
 
   //-----------------------------------------------------------------------
   // Member Variables
 
-  std::unique_ptr<rtldevice> m_device; // RTL-SDR device instance
-  nrsc5_t* m_nrsc5; // NRSC5 demodulator handle
+  std::shared_ptr<hdreceiver> m_receiver; // Shared HD Radio receiver instance
 
   uint32_t const m_subchannel; // Multiplex subchannel number
   std::string m_muxname; // Generated mux name
@@ -246,16 +282,21 @@ private:
   std::atomic<float> m_mer{0}; // Current modulation error ratio
   std::atomic<float> m_ber{0}; // Current bit erorr rate
   lot_map_t m_lots; // Cached LOT item data
+  std::unique_ptr<hdblender> m_blender; // Analog/digital audio blender
+  std::vector<int16_t> m_blendbuffer; // Audio blender input buffer
+  std::atomic<bool> m_stopped{false}; // Flag if the stream has been closed
+
+  // CLOCK DRIFT
+  //
+  driftcontroller m_driftcontroller; // Clock drift controller
+  std::unique_ptr<CFractResampler> m_resampler; // Clock drift resampler
+  std::vector<TYPECPX> m_resamplerinput; // Resampler input buffer
 
   // STREAM CONTROL
   //
   demux_queue_t m_queue; // queue<> of demux objects
   mutable std::mutex m_queuelock; // Synchronization object
   std::condition_variable m_cv; // Transfer event condvar
-  std::thread m_worker; // Data transfer thread
-  std::exception_ptr m_worker_exception; // Exception on worker thread
-  scalar_condition<bool> m_stop{false}; // Condition to stop data transfer
-  std::atomic<bool> m_stopped{false}; // Data transfer stopped flag
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,277 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "iqfanout.h"
+
+#include "exception_control/string_exception.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <utility>
+
+#pragma warning(push, 4)
+
+// iqfanout::DEFAULT_CAPACITY (static)
+//
+// Default number of sample blocks held by the ring
+size_t const iqfanout::DEFAULT_CAPACITY = 64;
+
+//---------------------------------------------------------------------------
+// iqfanout Constructor (private)
+//
+// Arguments:
+//
+//	capacity	- Number of sample blocks held by the ring
+
+iqfanout::iqfanout(size_t capacity) : m_ring(std::max(capacity, static_cast<size_t>(1)))
+{
+}
+
+//---------------------------------------------------------------------------
+// iqfanout Destructor
+
+iqfanout::~iqfanout()
+{
+  close();
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::attach
+//
+// Attaches a new consumer and returns the identifier used to detach it
+//
+// Arguments:
+//
+//	callback	- Function to be invoked with each block of samples
+
+unsigned int iqfanout::attach(consumer_callback const& callback)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  if (m_closed)
+    throw string_exception(__func__, ": the I/Q sample fan-out has been closed");
+
+  // The consumer begins with the next block written into the ring
+  std::unique_ptr<consumer_t> consumer = std::make_unique<consumer_t>();
+  consumer->id = m_nextid++;
+  consumer->callback = callback;
+  consumer->cursor = m_head;
+  consumer->thread = std::thread(&iqfanout::consume, this, consumer.get());
+
+  unsigned int const consumerid = consumer->id;
+  m_consumers.push_back(std::move(consumer));
+
+  return consumerid;
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::close
+//
+// Detaches all consumers and rejects any further samples
+//
+// Arguments:
+//
+//	NONE
+
+void iqfanout::close(void)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  m_closed = true;
+
+  std::list<std::unique_ptr<consumer_t>> consumers = std::move(m_consumers);
+  m_consumers.clear();
+  for (auto const& consumer : consumers)
+    consumer->stop = true;
+
+  lock.unlock();
+  m_cv.notify_all();
+
+  // Wait for the consumer threads outside of the lock
+  for (auto const& consumer : consumers)
+    if (consumer->thread.joinable())
+      consumer->thread.join();
+
+  lock.lock();
+  std::vector<block_t> ring(m_ring.size());
+  m_ring.swap(ring);
+  lock.unlock();
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::consume (private)
+//
+// Consumer thread procedure used to deliver the sample blocks
+//
+// Arguments:
+//
+//	consumer	- State of the consumer to deliver the blocks to
+
+void iqfanout::consume(consumer_t* consumer)
+{
+  assert(consumer != nullptr);
+
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  while (true)
+  {
+
+    // Wait for a block to be written into the ring or for the consumer to be stopped
+    m_cv.wait(lock, [&]() -> bool { return ((consumer->stop) || (consumer->cursor < m_head)); });
+    if (consumer->stop)
+      break;
+
+    // A consumer that has fallen further behind than the capacity of the ring skips
+    // ahead to the oldest block that is still available
+    uint64_t const capacity = m_ring.size();
+    if ((m_head - consumer->cursor) > capacity)
+      consumer->cursor = m_head - capacity;
+
+    // Take a reference to the block so that it can be delivered outside of the lock;
+    // the writer replaces blocks in the ring rather than overwriting them
+    block_t block = m_ring[consumer->cursor % capacity];
+    consumer->cursor++;
+    lock.unlock();
+
+    try
+    {
+      consumer->callback(block->data(), block->size());
+    }
+
+    // A consumer that throws stops receiving samples, the others are not affected; it
+    // remains attached until it's detached but no longer counts as a consumer
+    catch (...)
+    {
+
+      lock.lock();
+      consumer->failed = true;
+      break;
+    }
+
+    block.reset();
+    lock.lock();
+  }
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::create (static)
+//
+// Factory method, creates a new iqfanout instance
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> iqfanout::create(void)
+{
+  return create(DEFAULT_CAPACITY);
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::create (static)
+//
+// Factory method, creates a new iqfanout instance
+//
+// Arguments:
+//
+//	capacity	- Number of sample blocks held by the ring
+
+std::shared_ptr<iqfanout> iqfanout::create(size_t capacity)
+{
+  return std::shared_ptr<iqfanout>(new iqfanout(capacity));
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::detach
+//
+// Detaches a consumer and waits for its thread to stop
+//
+// Arguments:
+//
+//	consumerid	- Identifier returned when the consumer was attached
+
+void iqfanout::detach(unsigned int consumerid)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  auto found = std::find_if(m_consumers.begin(), m_consumers.end(),
+                            [&](std::unique_ptr<consumer_t> const& item) -> bool
+                            { return item->id == consumerid; });
+  if (found == m_consumers.end())
+    return;
+
+  std::unique_ptr<consumer_t> consumer = std::move(*found);
+  m_consumers.erase(found);
+  consumer->stop = true;
+
+  lock.unlock();
+  m_cv.notify_all();
+
+  // Wait for the consumer thread outside of the lock
+  if (consumer->thread.joinable())
+    consumer->thread.join();
+}
+
+//---------------------------------------------------------------------------
+// iqfanout::write
+//
+// Writes a block of samples into the ring; this never waits for a consumer
+//
+// Arguments:
+//
+//	samples		- Pointer to the raw 8-bit I/Q samples from the device
+//	length		- Length of the input data in bytes
+
+void iqfanout::write(uint8_t const* samples, size_t length)
+{
+  if ((samples == nullptr) || (length == 0))
+    return;
+
+  // There's nothing to do if no consumers are attached, or if all of them have failed
+  std::unique_lock<std::mutex> lock(m_lock);
+  if ((m_closed) || std::all_of(m_consumers.begin(), m_consumers.end(),
+                                [](std::unique_ptr<consumer_t> const& item) -> bool
+                                { return item->failed; }))
+    return;
+  lock.unlock();
+
+  // Copy the samples outside of the lock; a consumer may still be using the block that
+  // is being replaced so each write creates a new one
+  block_t block = std::make_shared<std::vector<uint8_t> const>(samples, samples + length);
+
+  // The fan-out may have been closed while the samples were being copied
+  lock.lock();
+  if (m_closed)
+    return;
+
+  block_t previous = std::exchange(m_ring[m_head % m_ring.size()], std::move(block));
+  m_head++;
+  lock.unlock();
+
+  m_cv.notify_all(); // Wake up the consumers
+
+  previous.reset(); // Release outside of the lock
+}
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __IQFANOUT_H_
+#define __IQFANOUT_H_
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class iqfanout
+//
+// Distributes the raw 8-bit I/Q samples read from a device to any number of
+// consumers.  The device thread is the single writer of a ring of sample
+// blocks and each consumer reads from the ring at its own position on its own
+// thread; a consumer that falls behind loses the oldest blocks rather than
+// stalling the device or the other consumers
+
+class iqfanout
+{
+public:
+  // Destructor
+  //
+  ~iqfanout();
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // consumer_callback
+  //
+  // Callback function invoked on the consumer thread with each block of samples
+  using consumer_callback = std::function<void(uint8_t const* samples, size_t length)>;
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // attach
+  //
+  // Attaches a new consumer and returns the identifier used to detach it
+  unsigned int attach(consumer_callback const& callback);
+
+  // close
+  //
+  // Detaches all consumers and rejects any further samples
+  void close(void);
+
+  // create (static)
+  //
+  // Factory method, creates a new iqfanout instance
+  static std::shared_ptr<iqfanout> create(void);
+  static std::shared_ptr<iqfanout> create(size_t capacity);
+
+  // detach
+  //
+  // Detaches a consumer and waits for its thread to stop
+  void detach(unsigned int consumerid);
+
+  // write
+  //
+  // Writes a block of samples into the ring; this never waits for a consumer
+  void write(uint8_t const* samples, size_t length);
+
+private:
+  iqfanout(iqfanout const&) = delete;
+  iqfanout& operator=(iqfanout const&) = delete;
+
+  // DEFAULT_CAPACITY
+  //
+  // Default number of sample blocks held by the ring
+  static size_t const DEFAULT_CAPACITY;
+
+  // Instance Constructor
+  //
+  explicit iqfanout(size_t capacity);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // block_t
+  //
+  // Defines the type of a block of samples held by the ring
+  using block_t = std::shared_ptr<std::vector<uint8_t> const>;
+
+  // consumer_t
+  //
+  // Defines the state of an attached consumer
+  struct consumer_t
+  {
+
+    unsigned int id = 0; // Consumer identifier
+    consumer_callback callback; // Consumer callback function
+    uint64_t cursor = 0; // Sequence number of the next block to read
+    bool stop = false; // Flag to stop the consumer thread
+    bool failed = false; // Flag indicating the consumer callback threw
+    std::thread thread; // Consumer thread
+  };
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // consume
+  //
+  // Consumer thread procedure used to deliver the sample blocks
+  void consume(consumer_t* consumer);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::vector<block_t> m_ring; // Ring of sample blocks
+  uint64_t m_head = 0; // Sequence number of the next block to write
+  std::list<std::unique_ptr<consumer_t>> m_consumers; // Attached consumers
+  unsigned int m_nextid = 1; // Next consumer identifier
+  bool m_closed = false; // Flag indicating the fan-out was closed
+  mutable std::mutex m_lock; // Synchronization object
+  std::condition_variable m_cv; // Ring event condvar
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __IQFANOUT_H_
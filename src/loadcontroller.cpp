@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "loadcontroller.h"
+
+#include <assert.h>
+
+#pragma warning(push, 4)
+
+// loadcontroller::STEPDOWN_HOLD
+//
+// Minimum time between degradation steps, allows a step to take effect
+std::chrono::milliseconds const loadcontroller::STEPDOWN_HOLD = std::chrono::milliseconds(500);
+
+// loadcontroller::STEPDOWN_PERCENT
+//
+// Queue occupancy at or above which the controller steps down
+size_t const loadcontroller::STEPDOWN_PERCENT = 25;
+
+// loadcontroller::STEPUP_HOLD
+//
+// Time the queue must remain below STEPUP_PERCENT before stepping up
+std::chrono::milliseconds const loadcontroller::STEPUP_HOLD = std::chrono::seconds(10);
+
+// loadcontroller::STEPUP_PERCENT
+//
+// Queue occupancy at or below which there is considered to be headroom
+size_t const loadcontroller::STEPUP_PERCENT = 5;
+
+//---------------------------------------------------------------------------
+// loadcontroller Constructor
+//
+// Arguments:
+//
+//	maxlevel	- Maximum degradation level
+
+loadcontroller::loadcontroller(int maxlevel)
+  : m_maxlevel(maxlevel), m_lastchange(std::chrono::steady_clock::now())
+{
+  assert(maxlevel >= 0);
+}
+
+//---------------------------------------------------------------------------
+// loadcontroller::level
+//
+// Gets the current degradation level
+//
+// Arguments:
+//
+//	NONE
+
+int loadcontroller::level(void) const
+{
+  return m_level;
+}
+
+//---------------------------------------------------------------------------
+// loadcontroller::update
+//
+// Updates the controller with the current queue depth and gets the level
+//
+// Arguments:
+//
+//	depth		- Current depth of the input queue
+//	capacity	- Capacity of the input queue
+
+int loadcontroller::update(size_t depth, size_t capacity)
+{
+  assert(capacity > 0);
+
+  auto const now = std::chrono::steady_clock::now();
+  size_t const percent = (depth * 100) / capacity;
+
+  // The queue is backing up; step down one level at a time, giving each step
+  // a chance to take effect before taking the next one
+  if (percent >= STEPDOWN_PERCENT)
+  {
+
+    m_headroom = false;
+    if ((m_level < m_maxlevel) && ((now - m_lastchange) >= STEPDOWN_HOLD))
+    {
+
+      ++m_level;
+      m_lastchange = now;
+    }
+  }
+
+  // The queue is nearly empty; step back up one level at a time once it has
+  // stayed that way long enough to be confident the work can be sustained
+  else if (percent <= STEPUP_PERCENT)
+  {
+
+    if (!m_headroom)
+    {
+
+      m_headroom = true;
+      m_headroomsince = now;
+    }
+
+    else if ((m_level > 0) && ((now - m_headroomsince) >= STEPUP_HOLD))
+    {
+
+      --m_level;
+      m_lastchange = m_headroomsince = now;
+    }
+  }
+
+  else
+    m_headroom = false;
+
+  return m_level;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __LOADCONTROLLER_H_
+#define __LOADCONTROLLER_H_
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class loadcontroller
+//
+// Implements an adaptive controller that sheds optional DSP work when the
+// input queue of a stream starts to back up and restores it once the queue
+// has stayed nearly empty for a while.  Level zero is full quality, each
+// higher level up to the specified maximum indicates another step of work
+// that should be skipped; what each level means is up to the stream.
+//
+// The controller isn't thread-safe, it's expected to be updated from the
+// thread that consumes the queue
+
+class loadcontroller
+{
+public:
+  // Instance Constructor
+  //
+  explicit loadcontroller(int maxlevel);
+
+  // Destructor
+  //
+  ~loadcontroller() = default;
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // level
+  //
+  // Gets the current degradation level
+  int level(void) const;
+
+  // update
+  //
+  // Updates the controller with the current queue depth and gets the level
+  int update(size_t depth, size_t capacity);
+
+private:
+  loadcontroller(loadcontroller const&) = delete;
+  loadcontroller& operator=(loadcontroller const&) = delete;
+
+  // STEPDOWN_HOLD
+  //
+  // Minimum time between degradation steps, allows a step to take effect
+  static std::chrono::milliseconds const STEPDOWN_HOLD;
+
+  // STEPDOWN_PERCENT
+  //
+  // Queue occupancy at or above which the controller steps down
+  static size_t const STEPDOWN_PERCENT;
+
+  // STEPUP_HOLD
+  //
+  // Time the queue must remain below STEPUP_PERCENT before stepping up
+  static std::chrono::milliseconds const STEPUP_HOLD;
+
+  // STEPUP_PERCENT
+  //
+  // Queue occupancy at or below which there is considered to be headroom
+  static size_t const STEPUP_PERCENT;
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  int const m_maxlevel; // Maximum degradation level
+  int m_level = 0; // Current degradation level
+  std::chrono::steady_clock::time_point m_lastchange; // Time of the last change
+  std::chrono::steady_clock::time_point m_headroomsince; // Start of the headroom
+  bool m_headroom = false; // Flag if there is currently headroom
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __LOADCONTROLLER_H_
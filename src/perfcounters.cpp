@@ -0,0 +1,318 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "perfcounters.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// perfcounters Constructor
+//
+// Arguments:
+//
+//	NONE
+
+perfcounters::perfcounters() : perfcounters(nullptr)
+{
+}
+
+//---------------------------------------------------------------------------
+// perfcounters Constructor
+//
+// Arguments:
+//
+//	upstream	- Counters of the shared receiver the stream consumes
+
+perfcounters::perfcounters(std::shared_ptr<perfcounters const> upstream)
+  : m_upstream(std::move(upstream)),
+    m_baseline((m_upstream) ? m_upstream->snapshot() : perfcounterprops{}),
+    m_start(std::chrono::steady_clock::now())
+{
+  for (auto& stagetime : m_stagetime)
+    stagetime.store(0, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::addsignaltime
+//
+// Adds to the amount of audio generated by the stream
+//
+// Arguments:
+//
+//	seconds		- Duration of the generated audio in seconds
+
+void perfcounters::addsignaltime(double seconds)
+{
+  m_signaltime.fetch_add(static_cast<int64_t>(seconds * 1000000000.0), std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::addstagetime
+//
+// Adds to the accumulated processing time of a DSP stage
+//
+// Arguments:
+//
+//	stage		- DSP stage that was timed
+//	duration	- Elapsed processing time of the stage
+
+void perfcounters::addstagetime(enum stage stage, std::chrono::steady_clock::duration duration)
+{
+  size_t const index = static_cast<size_t>(stage);
+  assert(index < NUM_STAGES);
+
+  m_stagetime[index].fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+      std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::bufferreceived
+//
+// Counts an I/Q buffer received from the device
+//
+// Arguments:
+//
+//	queuedepth	- Depth of the sample queue after the buffer was queued
+
+void perfcounters::bufferreceived(size_t queuedepth)
+{
+  m_buffersreceived.fetch_add(1, std::memory_order_relaxed);
+  highwater(m_samplequeuehighwater, queuedepth);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::buffersdropped
+//
+// Counts I/Q buffers that were discarded due to a queue overflow
+//
+// Arguments:
+//
+//	count		- Number of discarded buffers
+
+void perfcounters::buffersdropped(size_t count)
+{
+  m_buffersdropped.fetch_add(count, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::clockdrift
+//
+// Sets the current clock drift correction
+//
+// Arguments:
+//
+//	controlled	- Flag if the clock drift is being controlled
+//	ppm			- Clock drift correction in parts per million
+
+void perfcounters::clockdrift(bool controlled, double ppm)
+{
+  m_clockdriftcontrol.store(controlled, std::memory_order_relaxed);
+  m_clockdrift.store(static_cast<int>(std::lround(ppm)), std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::degradation
+//
+// Sets the current DSP degradation level
+//
+// Arguments:
+//
+//	level		- DSP degradation level (0 = full quality)
+
+void perfcounters::degradation(int level)
+{
+  m_degradation.store(level, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::discontinuity
+//
+// Resets the demux playout clock after a stream discontinuity
+//
+// Arguments:
+//
+//	NONE
+
+void perfcounters::discontinuity(void)
+{
+  m_playoutvalid = false;
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::encodedropped
+//
+// Counts audio buffers that were discarded by the recording encoder
+//
+// Arguments:
+//
+//	count		- Number of discarded buffers
+
+void perfcounters::encodedropped(size_t count)
+{
+  m_encodedropped.fetch_add(count, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::highwater (private, static)
+//
+// Updates a high-water mark counter
+//
+// Arguments:
+//
+//	counter		- High-water mark counter to update
+//	value		- Value to be compared with the high-water mark
+
+void perfcounters::highwater(std::atomic<uint64_t>& counter, uint64_t value)
+{
+  uint64_t current = counter.load(std::memory_order_relaxed);
+  while ((value > current) &&
+         !counter.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    ;
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::packetqueued
+//
+// Counts a demux packet that was added to the packet queue
+//
+// Arguments:
+//
+//	queuedepth	- Depth of the packet queue after the packet was queued
+
+void perfcounters::packetqueued(size_t queuedepth)
+{
+  m_packetsqueued.fetch_add(1, std::memory_order_relaxed);
+  highwater(m_packetqueuehighwater, queuedepth);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::packetread
+//
+// Advances the demux playout clock by the duration of a packet read by Kodi; this
+// must only be invoked for packets delivered to Kodi, which plays them in real time
+//
+// Arguments:
+//
+//	seconds		- Duration of the packet in seconds
+
+void perfcounters::packetread(double seconds)
+{
+  auto const now = std::chrono::steady_clock::now();
+
+  // Kodi plays the audio back in real time; if all of the audio delivered so far
+  // would have been played out before this packet arrived the player was starved
+  bool const valid = m_playoutvalid.exchange(true);
+  if ((valid) && (now > m_playout))
+    m_underruns.fetch_add(1, std::memory_order_relaxed);
+
+  if ((!valid) || (now > m_playout))
+    m_playout = now;
+
+  m_playout += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::packetsdropped
+//
+// Counts demux packets that were discarded due to a queue overflow
+//
+// Arguments:
+//
+//	count		- Number of discarded packets
+
+void perfcounters::packetsdropped(size_t count)
+{
+  m_packetsdropped.fetch_add(count, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// perfcounters::snapshot
+//
+// Gets a snapshot of the current counter values
+//
+// Arguments:
+//
+//	NONE
+
+struct perfcounterprops perfcounters::snapshot(void) const
+{
+  struct perfcounterprops props = {};
+
+  // seconds (local)
+  //
+  // Converts an atomic nanosecond counter into seconds
+  auto seconds = [](std::atomic<int64_t> const& counter) -> double
+  { return static_cast<double>(counter.load(std::memory_order_relaxed)) / 1000000000.0; };
+
+  props.buffersreceived = m_buffersreceived.load(std::memory_order_relaxed);
+  props.buffersdropped = m_buffersdropped.load(std::memory_order_relaxed);
+  props.samplequeuehighwater = m_samplequeuehighwater.load(std::memory_order_relaxed);
+  props.packetsqueued = m_packetsqueued.load(std::memory_order_relaxed);
+  props.packetsdropped = m_packetsdropped.load(std::memory_order_relaxed);
+  props.packetqueuehighwater = m_packetqueuehighwater.load(std::memory_order_relaxed);
+  props.underruns = m_underruns.load(std::memory_order_relaxed);
+  props.encodedropped = m_encodedropped.load(std::memory_order_relaxed);
+  props.demodulatetime = seconds(m_stagetime[static_cast<size_t>(stage::demodulate)]);
+  props.decodetime = seconds(m_stagetime[static_cast<size_t>(stage::decode)]);
+  props.resampletime = seconds(m_stagetime[static_cast<size_t>(stage::resample)]);
+  props.encodetime = seconds(m_stagetime[static_cast<size_t>(stage::encode)]);
+  props.signaltime = seconds(m_signaltime);
+  props.degradation = m_degradation.load(std::memory_order_relaxed);
+  props.clockdrift = m_clockdrift.load(std::memory_order_relaxed);
+  props.clockdriftcontrol = m_clockdriftcontrol.load(std::memory_order_relaxed);
+  props.elapsedtime =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+
+  // Include the device and DSP counters of the shared receiver, if any, that have
+  // accumulated since this instance was created
+  if (m_upstream)
+  {
+
+    struct perfcounterprops const upstream = m_upstream->snapshot();
+
+    props.buffersreceived += upstream.buffersreceived - m_baseline.buffersreceived;
+    props.buffersdropped += upstream.buffersdropped - m_baseline.buffersdropped;
+    props.samplequeuehighwater = std::max(props.samplequeuehighwater, upstream.samplequeuehighwater);
+    props.demodulatetime += upstream.demodulatetime - m_baseline.demodulatetime;
+    props.decodetime += upstream.decodetime - m_baseline.decodetime;
+    props.resampletime += upstream.resampletime - m_baseline.resampletime;
+    props.degradation = std::max(props.degradation, upstream.degradation);
+  }
+
+  // The realtime factor is the ratio of the time spent processing to the amount of
+  // audio that was generated; anything approaching 1.0 cannot keep up with the signal
+  if (props.signaltime > 0.0)
+    props.realtimefactor =
+        (props.demodulatetime + props.decodetime + props.resampletime) / props.signaltime;
+
+  return props;
+}
+
+//---------------------------------------------------------------------------
+
+#pragma warning(pop)
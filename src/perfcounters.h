@@ -0,0 +1,210 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __PERFCOUNTERS_H_
+#define __PERFCOUNTERS_H_
+#pragma once
+
+#include "props.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class perfcounters
+//
+// Implements a set of lock-free performance counters for a PVR stream; the
+// counters are updated by the stream threads and can be read from any thread.
+//
+// A stream that consumes a shared receiver has the receiver counters as its
+// upstream; the device and DSP counters of the upstream instance are included
+// in the snapshot since every consumer depends on them to keep up with the signal
+
+class perfcounters
+{
+public:
+  // stage
+  //
+  // Defines the DSP processing stages that are individually timed
+  enum class stage
+  {
+
+    demodulate = 0, // I/Q demodulation
+    decode = 1, // Digital audio and data decoding
+    resample = 2, // Output audio resampling
+    encode = 3, // Recording audio encoding
+  };
+
+  // Instance Constructors
+  //
+  perfcounters();
+  explicit perfcounters(std::shared_ptr<perfcounters const> upstream);
+
+  // Destructor
+  //
+  ~perfcounters() = default;
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // stagetimer
+  //
+  // Accumulates the elapsed time of a DSP stage over the lifetime of the object
+  class stagetimer
+  {
+  public:
+    stagetimer(perfcounters& counters, enum stage stage)
+      : m_counters(counters), m_stage(stage), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~stagetimer()
+    {
+      m_counters.addstagetime(m_stage, std::chrono::steady_clock::now() - m_start);
+    }
+
+  private:
+    stagetimer(stagetimer const&) = delete;
+    stagetimer& operator=(stagetimer const&) = delete;
+
+    perfcounters& m_counters; // Counters instance
+    enum stage const m_stage; // Stage being timed
+    std::chrono::steady_clock::time_point const m_start; // Stage start time
+  };
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // addsignaltime
+  //
+  // Adds to the amount of audio generated by the stream
+  void addsignaltime(double seconds);
+
+  // addstagetime
+  //
+  // Adds to the accumulated processing time of a DSP stage
+  void addstagetime(enum stage stage, std::chrono::steady_clock::duration duration);
+
+  // bufferreceived
+  //
+  // Counts an I/Q buffer received from the device
+  void bufferreceived(size_t queuedepth);
+
+  // buffersdropped
+  //
+  // Counts I/Q buffers that were discarded due to a queue overflow
+  void buffersdropped(size_t count);
+
+  // clockdrift
+  //
+  // Sets the current clock drift correction
+  void clockdrift(bool controlled, double ppm);
+
+  // degradation
+  //
+  // Sets the current DSP degradation level
+  void degradation(int level);
+
+  // discontinuity
+  //
+  // Resets the demux playout clock after a stream discontinuity
+  void discontinuity(void);
+
+  // encodedropped
+  //
+  // Counts audio buffers that were discarded by the recording encoder
+  void encodedropped(size_t count);
+
+  // packetqueued
+  //
+  // Counts a demux packet that was added to the packet queue
+  void packetqueued(size_t queuedepth);
+
+  // packetread
+  //
+  // Advances the demux playout clock by the duration of a packet read by Kodi
+  void packetread(double seconds);
+
+  // packetsdropped
+  //
+  // Counts demux packets that were discarded due to a queue overflow
+  void packetsdropped(size_t count);
+
+  // snapshot
+  //
+  // Gets a snapshot of the current counter values
+  struct perfcounterprops snapshot(void) const;
+
+private:
+  perfcounters(perfcounters const&) = delete;
+  perfcounters& operator=(perfcounters const&) = delete;
+
+  // NUM_STAGES
+  //
+  // Number of individually timed DSP stages
+  static size_t const NUM_STAGES = 4;
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // highwater (static)
+  //
+  // Updates a high-water mark counter
+  static void highwater(std::atomic<uint64_t>& counter, uint64_t value);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::shared_ptr<perfcounters const> const m_upstream; // Upstream counters
+  struct perfcounterprops const m_baseline; // Upstream counters at creation
+  std::chrono::steady_clock::time_point const m_start; // Creation time
+  std::atomic<uint64_t> m_buffersreceived{0}; // I/Q buffers received
+  std::atomic<uint64_t> m_buffersdropped{0}; // I/Q buffers discarded
+  std::atomic<uint64_t> m_samplequeuehighwater{0}; // I/Q queue high-water mark
+  std::atomic<uint64_t> m_packetsqueued{0}; // Demux packets queued
+  std::atomic<uint64_t> m_packetsdropped{0}; // Demux packets discarded
+  std::atomic<uint64_t> m_packetqueuehighwater{0}; // Demux queue high-water mark
+  std::atomic<uint64_t> m_underruns{0}; // Demux playout underruns
+  std::atomic<uint64_t> m_encodedropped{0}; // Recording buffers discarded
+  std::atomic<int64_t> m_stagetime[NUM_STAGES]; // Stage times (nanoseconds)
+  std::atomic<int64_t> m_signaltime{0}; // Generated audio (nanoseconds)
+  std::atomic<int> m_degradation{0}; // DSP degradation level
+  std::atomic<int> m_clockdrift{0}; // Clock drift correction (ppm)
+  std::atomic<bool> m_clockdriftcontrol{true}; // Flag if the clock drift is controlled
+
+  // DEMUX PLAYOUT CLOCK
+  //
+  // Only advanced by the thread that delivers packets to Kodi; the clock can be
+  // reset from any thread when playback is paused or seeks
+  std::chrono::steady_clock::time_point m_playout; // Time delivered audio runs out
+  std::atomic<bool> m_playoutvalid{false}; // Flag if the playout clock is running
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __PERFCOUNTERS_H_
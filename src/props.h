@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <time.h>
 
 #pragma warning(push, 4)
 
@@ -46,6 +47,17 @@ struct channelprops
   int freqcorrection; // Frequency correction for this channel
 };
 
+// dabsyncprops
+//
+// Defines the OFDM synchronisation properties of a DAB ensemble for a device
+struct dabsyncprops
+{
+
+  int coarsecorrector; // Coarse frequency corrector (Hz)
+  int finecorrector; // Fine frequency corrector (Hz)
+  int fftplacement; // FFT window placement method
+};
+
 // dabprops
 //
 // Defines properties for the DAB digital signal processor
@@ -55,6 +67,27 @@ struct dabprops
   float outputgain; // Output gain in Decibels
   bool coarse_corrector; // Flage for coarse corrector (for receivers with >1kHz error)
   int coarse_corrector_type; // Coarse corrector frequency sync method
+  bool warmstart; // Flag to seed the OFDM synchronisation from syncprops
+  bool tii; // Flag to identify the transmitter (TII)
+  struct dabsyncprops syncprops; // Previous OFDM synchronisation properties
+};
+
+// dabsubchannelprops
+//
+// Defines the cached multiplex organisation of a DAB ensemble subchannel
+struct dabsubchannelprops
+{
+
+  uint32_t number; // Subchannel identifier
+  uint32_t serviceid; // Owning service identifier
+  bool dabplus; // Flag if the subchannel is DAB+ rather than DAB
+  int startaddress; // Subchannel start address (CU)
+  int length; // Subchannel length (CU)
+  bool shortform; // Flag if short form (UEP) protection is used
+  int ueptableindex; // UEP protection table index
+  int ueplevel; // UEP protection level
+  int eepprofile; // EEP protection profile (0 = A, 1 = B)
+  int eeplevel; // EEP protection level
 };
 
 // fmprops
@@ -78,6 +111,8 @@ struct hdprops
 {
 
   float outputgain; // Output gain in Decibels
+  bool analogblend; // Flag to blend to analog FM when digital is lost
+  int analogquality; // Analog FM downsample quality setting
 };
 
 // modulation
@@ -104,6 +139,32 @@ enum class regioncode
   europe = 3, // FM/DAB
 };
 
+// perfcounterprops
+//
+// Defines a snapshot of the performance counters of a stream
+struct perfcounterprops
+{
+
+  uint64_t buffersreceived; // Number of I/Q buffers received from the device
+  uint64_t buffersdropped; // Number of I/Q buffers discarded due to overflow
+  uint64_t samplequeuehighwater; // Maximum depth of the I/Q sample queue
+  uint64_t packetsqueued; // Number of demux packets queued
+  uint64_t packetsdropped; // Number of demux packets discarded due to overflow
+  uint64_t packetqueuehighwater; // Maximum depth of the demux packet queue
+  uint64_t underruns; // Number of times the delivered audio ran out
+  uint64_t encodedropped; // Number of audio buffers discarded by the recording encoder
+  int degradation; // Current DSP degradation level (0 = full quality)
+  int clockdrift; // Current clock drift correction (ppm)
+  bool clockdriftcontrol; // Flag if the clock drift is being controlled
+  double demodulatetime; // Time spent demodulating I/Q samples (seconds)
+  double decodetime; // Time spent decoding digital audio and data (seconds)
+  double resampletime; // Time spent resampling output audio (seconds)
+  double encodetime; // Time spent encoding recorded audio (seconds)
+  double signaltime; // Amount of audio generated by the stream (seconds)
+  double elapsedtime; // Amount of time the stream has been open (seconds)
+  double realtimefactor; // Ratio of processing time to generated audio time
+};
+
 // signalplotprops
 //
 // Defines signal meter plot properties
@@ -130,6 +191,22 @@ struct signalprops
   bool filter; // Flag to filter the signal
 };
 
+// signalstatusprops
+//
+// Defines the signal status published by a stream
+struct signalstatusprops
+{
+
+  int quality; // Signal quality as a percentage
+  int snr; // Signal-to-noise ratio as a percentage
+  float snrdb; // DAB: OFDM signal-to-noise ratio (dB)
+  float mer; // HD Radio: modulation error ratio (dB)
+  float ber; // HD Radio: bit error rate
+  char devicename[128]; // Device name
+  char muxname[128]; // Mux name
+  char servicename[128]; // Service name
+};
+
 // streamprops
 //
 // Defines stream-specific properties
@@ -143,6 +220,18 @@ struct streamprops
   int bitspersample; // Stream bits per sample
 };
 
+// streamtimeprops
+//
+// Defines the time properties of a seekable stream
+struct streamtimeprops
+{
+
+  time_t starttime; // Stream start time
+  double ptsstart; // Time stamp of the stream start
+  double ptsbegin; // Time stamp of the oldest available data
+  double ptsend; // Time stamp of the newest available data
+};
+
 // subchannelprops
 //
 // Defines properties for a radio subchannel
@@ -154,6 +243,16 @@ struct subchannelprops
   std::string logourl; // Subchannel logo URL
 };
 
+// timeshiftprops
+//
+// Defines properties for the timeshift buffer
+struct timeshiftprops
+{
+
+  std::string folder; // Folder in which to create the buffer
+  size_t buffersize; // Size of the buffer in bytes
+};
+
 // tunerprops
 //
 // Defines tuner-specific properties
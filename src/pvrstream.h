@@ -24,10 +24,18 @@
 #define __PVRSTREAM_H_
 #pragma once
 
+#include "iqfanout.h"
+#include "perfcounters.h"
 #include "props.h"
+#include "recordingsink.h"
+#include "utils/seqlock.h"
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <kodi/addon-instance/PVR.h>
+#include <memory>
+#include <memory.h>
 #include <string>
 
 #pragma warning(push, 4)
@@ -42,9 +50,37 @@ class pvrstream
 public:
   // Constructor / Destructor
   //
-  pvrstream() {}
+  pvrstream()
+    : m_perfcounters(std::make_shared<perfcounters>()),
+      m_signalstatus(std::make_shared<signalstatus_t>())
+  {
+  }
+  explicit pvrstream(std::shared_ptr<perfcounters const> upstream)
+    : m_perfcounters(std::make_shared<perfcounters>(std::move(upstream))),
+      m_signalstatus(std::make_shared<signalstatus_t>())
+  {
+  }
   virtual ~pvrstream() {}
 
+protected:
+  // Instance Constructor (wrapper)
+  //
+  // Shares the performance counters and signal status of a wrapped stream
+  explicit pvrstream(pvrstream const* wrapped)
+    : m_perfcounters(wrapped->m_perfcounters), m_signalstatus(wrapped->m_signalstatus)
+  {
+  }
+
+public:
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // signalstatus_t
+  //
+  // Defines the type of the published signal status snapshot
+  using signalstatus_t = seqlock<struct signalstatusprops>;
+
   //-----------------------------------------------------------------------
   // Member Functions
 
@@ -58,6 +94,15 @@ public:
   // Closes the stream
   virtual void close(void) = 0;
 
+  // counters
+  //
+  // Gets the performance counters, these can be read without synchronizing
+  // with the stream and remain valid after the stream has been destroyed
+  std::shared_ptr<perfcounters> const& counters(void) const
+  {
+    return m_perfcounters;
+  }
+
   // demuxabort
   //
   // Aborts the demultiplexer
@@ -89,6 +134,12 @@ public:
   virtual void enumproperties(
       std::function<void(struct streamprops const& props)> const& callback) = 0;
 
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device; consumers attached
+  // to it receive the samples on their own threads alongside the stream
+  virtual std::shared_ptr<iqfanout> const& iqsamples(void) const = 0;
+
   // length
   //
   // Gets the length of the stream
@@ -114,11 +165,42 @@ public:
   // Gets a flag indicating if the stream is real-time
   virtual bool realtime(void) const = 0;
 
+  // realtimeconsumer
+  //
+  // Indicates if the stream is read by a consumer that plays it in real time; the
+  // clock drift can only be controlled from the queue depth when that is the case
+  void realtimeconsumer(bool realtime)
+  {
+    m_realtimeconsumer.store(realtime);
+  }
+
+  // receiver
+  //
+  // Gets the shared receiver the stream is attached to, if any; the receiver can be
+  // kept alive after the stream has been closed for another stream to reattach to it
+  virtual std::shared_ptr<void> receiver(void) const
+  {
+    return nullptr;
+  }
+
+  // record
+  //
+  // Attaches or detaches (nullptr) the recording sink for the stream audio
+  virtual void record(std::shared_ptr<recordingsink> sink)
+  {
+    std::atomic_store(&m_recordingsink, std::move(sink));
+  }
+
   // seek
   //
   // Sets the stream pointer to a specific position
   virtual long long seek(long long position, int whence) = 0;
 
+  // seektime
+  //
+  // Seeks the demultiplexer to a specific time
+  virtual bool seektime(double time, bool backwards, double& startpts) = 0;
+
   // servicename
   //
   // Gets the service name associated with the stream
@@ -129,9 +211,86 @@ public:
   // Gets the signal quality as percentages
   virtual void signalquality(int& quality, int& snr) const = 0;
 
+  // signalstatus
+  //
+  // Gets the signal status snapshot, this can be read without synchronizing
+  // with the stream and remains valid after the stream has been destroyed
+  std::shared_ptr<signalstatus_t const> signalstatus(void) const
+  {
+    return m_signalstatus;
+  }
+
+  // stopped
+  //
+  // Gets a flag indicating if the stream has stopped and won't produce any more packets
+  virtual bool stopped(void) const = 0;
+
+  // streamtimes
+  //
+  // Gets the time properties of the stream
+  virtual bool streamtimes(struct streamtimeprops& times) const = 0;
+
+protected:
+  //-----------------------------------------------------------------------
+  // Protected Member Functions
+
+  // publishstatus
+  //
+  // Publishes the current signal status of the stream to the snapshot; this
+  // should be invoked from the thread that updates the underlying metrics
+  void publishstatus(float snrdb = 0.0f, float mer = 0.0f, float ber = 0.0f)
+  {
+    struct signalstatusprops status = {};
+
+    signalquality(status.quality, status.snr);
+    status.snrdb = snrdb;
+    status.mer = mer;
+    status.ber = ber;
+    copystring(status.devicename, devicename());
+    copystring(status.muxname, muxname());
+    copystring(status.servicename, servicename());
+
+    m_signalstatus->store(status);
+  }
+
+  // realtimeconsumer
+  //
+  // Gets a flag indicating if the stream is read by a real-time consumer
+  bool realtimeconsumer(void) const
+  {
+    return m_realtimeconsumer.load();
+  }
+
+  // recorder
+  //
+  // Gets the attached recording sink, if any; this can be invoked from any thread
+  std::shared_ptr<recordingsink> recorder(void) const
+  {
+    return std::atomic_load(&m_recordingsink);
+  }
+
 private:
   pvrstream(pvrstream const&) = delete;
   pvrstream& operator=(pvrstream const&) = delete;
+
+  // copystring (static)
+  //
+  // Copies a string into a fixed-length snapshot buffer
+  template<size_t _length>
+  static void copystring(char (&dest)[_length], std::string const& source)
+  {
+    size_t const length = std::min(source.length(), _length - 1);
+    memcpy(dest, source.data(), length);
+    dest[length] = '\0';
+  }
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::shared_ptr<perfcounters> const m_perfcounters; // Performance counters
+  std::shared_ptr<signalstatus_t> const m_signalstatus; // Signal status snapshot
+  std::shared_ptr<recordingsink> m_recordingsink; // Attached recording sink
+  std::atomic<bool> m_realtimeconsumer{true}; // Flag if read by a real-time consumer
 };
 
 //-----------------------------------------------------------------------------
@@ -38,6 +38,7 @@
 static int const MENUHOOK_SETTING_IMPORTCHANNELS = 10;
 static int const MENUHOOK_SETTING_EXPORTCHANNELS = 11;
 static int const MENUHOOK_SETTING_CLEARCHANNELS = 12;
+static int const MENUHOOK_SETTING_SHOWPERFORMANCE = 13;
 
 //---------------------------------------------------------------------------
 // DATA TYPES
@@ -99,6 +100,16 @@ struct settings
   // The port number of the rtl_tcp host to connect to
   int device_connection_tcp_port;
 
+  // device_pool_enable
+  //
+  // Flag to use all of the available devices rather than just one
+  bool device_pool_enable;
+
+  // device_pool_tcp_endpoints
+  //
+  // Additional rtl_tcp hosts to use when the device pool is enabled
+  std::string device_pool_tcp_endpoints;
+
   // region_regioncode
   //
   // The region in which the RTL-SDR device is operating
@@ -149,6 +160,11 @@ struct settings
   // Specifies the output gain for the HD DSP
   float hdradio_output_gain;
 
+  // hdradio_analog_blend
+  //
+  // Flag to blend to the analog FM signal when the digital signal is lost
+  bool hdradio_analog_blend;
+
   // dabradio_enable
   //
   // Enables/disables the DAB DSP
@@ -169,6 +185,11 @@ struct settings
   // Coarse corrector frequency sync method
   int dabradio_coarse_corrector_type;
 
+  // dabradio_tii
+  //
+  // Flag to identify the transmitter (TII) of the DAB ensemble
+  bool dabradio_tii;
+
   // wxradio_enable
   //
   // Enables the WX DSP
@@ -188,6 +209,16 @@ struct settings
   //
   // Specified the output gain for the WX DSP
   float wxradio_output_gain;
+
+  // timeshift_enable
+  //
+  // Enables/disables the timeshift buffer
+  bool timeshift_enable;
+
+  // timeshift_buffer_size
+  //
+  // Specifies the size of the timeshift buffer in megabytes
+  int timeshift_buffer_size;
 };
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,546 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "recordingsink.h"
+
+#include "exception_control/string_exception.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#include <fdk-aac/aacenc_lib.h>
+#ifdef _WINDOWS
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#pragma warning(push, 4)
+
+// recordingsink::AAC_BITRATE_PER_CHANNEL
+//
+// AAC encoder bit rate for each audio channel
+unsigned int const recordingsink::AAC_BITRATE_PER_CHANNEL = 64000;
+
+// recordingsink::MAX_WRITE_QUEUE
+//
+// Maximum number of audio buffers queued for the worker thread
+size_t const recordingsink::MAX_WRITE_QUEUE = 100;
+
+//---------------------------------------------------------------------------
+// recordingsink Constructor (private)
+//
+// Arguments:
+//
+//	basename	- Output file name without an extension
+//	maxduration	- Maximum duration of the recording in seconds
+//	counters	- Stream performance counters instance
+
+recordingsink::recordingsink(std::string const& basename,
+                             double maxduration,
+                             std::shared_ptr<perfcounters> counters)
+  : m_basename(basename), m_maxduration(maxduration), m_counters(std::move(counters))
+{
+  assert(m_counters);
+
+  // Create the worker thread to encode and write the queued audio
+  m_worker = std::thread(&recordingsink::worker, this);
+}
+
+//---------------------------------------------------------------------------
+// recordingsink Destructor
+
+recordingsink::~recordingsink()
+{
+  close();
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::close
+//
+// Stops the recording and closes the output file
+//
+// Arguments:
+//
+//	NONE
+
+void recordingsink::close(void)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_stop = true;
+  m_cv.notify_all();
+  lock.unlock();
+
+  if (m_worker.joinable())
+    m_worker.join(); // Wait for thread
+
+  // The worker thread flushes the encoder before it exits, close the file
+  closeencoder();
+  if (m_file != nullptr)
+  {
+
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::closeencoder (private)
+//
+// Flushes and closes the AAC encoder instance
+//
+// Arguments:
+//
+//	NONE
+
+void recordingsink::closeencoder(void)
+{
+  if (m_encoder == nullptr)
+  {
+
+    return;
+  }
+
+  // Flush any buffered samples into the output file
+  try
+  {
+    encode(nullptr, -1);
+  }
+  catch (...)
+  {
+  }
+
+  aacEncClose(&m_encoder);
+
+  m_encoder = nullptr;
+  m_channels = m_samplerate = 0;
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::completed
+//
+// Gets a flag indicating if the maximum duration has been recorded
+//
+// Arguments:
+//
+//	NONE
+
+bool recordingsink::completed(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return (m_maxduration > 0.0) && (m_queued >= m_maxduration);
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::create (static)
+//
+// Factory method, creates a new recordingsink instance
+//
+// Arguments:
+//
+//	basename	- Output file name without an extension
+//	maxduration	- Maximum duration of the recording in seconds
+//	counters	- Stream performance counters instance
+
+std::shared_ptr<recordingsink> recordingsink::create(std::string const& basename,
+                                                     double maxduration,
+                                                     std::shared_ptr<perfcounters> counters)
+{
+  return std::shared_ptr<recordingsink>(
+      new recordingsink(basename, maxduration, std::move(counters)));
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::duration
+//
+// Gets the duration of the recorded audio in seconds
+//
+// Arguments:
+//
+//	NONE
+
+double recordingsink::duration(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return m_duration;
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::encode (private)
+//
+// Encodes a buffer of PCM samples into the output file
+//
+// Arguments:
+//
+//	samples		- Interleaved PCM samples
+//	count		- Number of samples (not frames); -1 to flush the encoder
+
+void recordingsink::encode(int16_t const* samples, int count)
+{
+  assert(m_encoder != nullptr);
+
+  perfcounters::stagetimer timer(*m_counters, perfcounters::stage::encode);
+
+  void* inbuf = const_cast<int16_t*>(samples);
+  INT inid = IN_AUDIO_DATA;
+  INT insize = (count > 0) ? count * static_cast<INT>(sizeof(int16_t)) : 0;
+  INT inelsize = sizeof(int16_t);
+
+  void* outbuf = m_encoded.data();
+  INT outid = OUT_BITSTREAM_DATA;
+  INT outsize = static_cast<INT>(m_encoded.size());
+  INT outelsize = sizeof(uint8_t);
+
+  AACENC_BufDesc indesc = {1, &inbuf, &inid, &insize, &inelsize};
+  AACENC_BufDesc outdesc = {1, &outbuf, &outid, &outsize, &outelsize};
+
+  // The encoder consumes as many samples as it is able to on each pass and
+  // only generates output once a full AAC frame has been accumulated
+  while ((count < 0) || (count > 0))
+  {
+
+    AACENC_InArgs inargs = {count, 0};
+    AACENC_OutArgs outargs = {};
+
+    AACENC_ERROR result = aacEncEncode(m_encoder, &indesc, &outdesc, &inargs, &outargs);
+    if (result == AACENC_ENCODE_EOF)
+    {
+
+      break;
+    }
+
+    if (result != AACENC_OK)
+    {
+
+      throw string_exception(__func__, ": aacEncEncode() failed");
+    }
+
+    if ((outargs.numOutBytes > 0) && (m_file != nullptr))
+    {
+
+      fwrite(m_encoded.data(), 1, outargs.numOutBytes, m_file);
+    }
+
+    if (count > 0)
+    {
+
+      if ((outargs.numInSamples == 0) && (outargs.numOutBytes == 0))
+      {
+
+        break;
+      }
+
+      inbuf = reinterpret_cast<int16_t*>(inbuf) + outargs.numInSamples;
+      insize -= outargs.numInSamples * static_cast<INT>(sizeof(int16_t));
+      count -= outargs.numInSamples;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::filename
+//
+// Gets the name of the output file, or an empty string if not created
+//
+// Arguments:
+//
+//	NONE
+
+std::string recordingsink::filename(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return m_filename;
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::openencoder (private)
+//
+// Opens the AAC encoder instance
+//
+// Arguments:
+//
+//	channels	- Number of PCM audio channels
+//	samplerate	- PCM audio sample rate
+
+void recordingsink::openencoder(int channels, int samplerate)
+{
+  assert(m_encoder == nullptr);
+  assert((channels == 1) || (channels == 2));
+
+  if (aacEncOpen(&m_encoder, 0, static_cast<UINT>(channels)) != AACENC_OK)
+    throw string_exception(__func__, ": aacEncOpen() failed");
+
+  UINT const bitrate = AAC_BITRATE_PER_CHANNEL * static_cast<UINT>(channels);
+
+  if ((aacEncoder_SetParam(m_encoder, AACENC_AOT, AOT_AAC_LC) != AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_SAMPLERATE, static_cast<UINT>(samplerate)) !=
+       AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_CHANNELMODE, (channels == 1) ? MODE_1 : MODE_2) !=
+       AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_CHANNELORDER, 1) != AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_BITRATE, bitrate) != AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_TRANSMUX, TT_MP4_ADTS) != AACENC_OK) ||
+      (aacEncoder_SetParam(m_encoder, AACENC_AFTERBURNER, 1) != AACENC_OK))
+  {
+
+    aacEncClose(&m_encoder);
+    m_encoder = nullptr;
+    throw string_exception(__func__, ": unable to configure AAC encoder");
+  }
+
+  // Passing all NULL parameters initializes the encoder with the set parameters
+  if (aacEncEncode(m_encoder, nullptr, nullptr, nullptr, nullptr) != AACENC_OK)
+  {
+
+    aacEncClose(&m_encoder);
+    m_encoder = nullptr;
+    throw string_exception(__func__, ": unable to initialize AAC encoder");
+  }
+
+  AACENC_InfoStruct info = {};
+  aacEncInfo(m_encoder, &info);
+  m_encoded.resize(std::max(info.maxOutBufBytes, 8192U));
+
+  m_channels = channels;
+  m_samplerate = samplerate;
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::openfile (private)
+//
+// Opens the output file with a specific extension
+//
+// Arguments:
+//
+//	extension	- Output file extension
+
+void recordingsink::openfile(std::string const& extension)
+{
+  assert(m_file == nullptr);
+
+  std::string filename = m_basename + "." + extension;
+
+  m_file = fopen(filename.c_str(), "wb");
+  if (m_file == nullptr)
+    throw string_exception(__func__, ": unable to create recording file ", filename.c_str());
+
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_filename = std::move(filename);
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::queue_buffer (private)
+//
+// Queues an audio buffer for the worker thread
+//
+// Arguments:
+//
+//	buffer		- Audio buffer to be queued
+
+void recordingsink::queue_buffer(std::unique_ptr<write_buffer_t> buffer)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // Audio provided after the recording has stopped or completed is ignored
+  if (m_stop || ((m_maxduration > 0.0) && (m_queued >= m_maxduration)))
+  {
+
+    return;
+  }
+
+  // Never block the DSP thread; drop the buffer if the worker has fallen behind
+  if (m_queue.size() >= MAX_WRITE_QUEUE)
+  {
+
+    m_counters->encodedropped(1);
+    return;
+  }
+
+  m_queued += buffer->duration;
+  m_queue.emplace_back(std::move(buffer));
+  m_cv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::worker (private)
+//
+// Worker thread procedure used to encode and write the queued audio
+//
+// Arguments:
+//
+//	NONE
+
+void recordingsink::worker(void)
+{
+  // Encoding the recording is less important than producing the live stream
+#ifdef _WINDOWS
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+
+  try
+  {
+    while (true)
+    {
+
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_cv.wait(lock, [&]() -> bool { return m_stop || !m_queue.empty(); });
+
+      // Stopped with nothing left to write
+      if (m_queue.empty())
+      {
+
+        break;
+      }
+
+      std::unique_ptr<write_buffer_t> buffer = std::move(m_queue.front());
+      m_queue.pop_front();
+      lock.unlock();
+
+      // The format of the recording is established by the first buffer
+      if (m_file == nullptr)
+      {
+
+        m_format = buffer->format;
+        openfile(m_format.empty() ? "aac" : m_format);
+      }
+
+      // Passthrough frames must match the established format
+      if (buffer->format != m_format)
+      {
+
+        continue;
+      }
+
+      if (m_format.empty())
+      {
+
+        // Reinitialize the encoder if the PCM audio format has changed
+        if ((m_encoder != nullptr) &&
+            ((buffer->channels != m_channels) || (buffer->samplerate != m_samplerate)))
+        {
+
+          closeencoder();
+        }
+
+        if (m_encoder == nullptr)
+        {
+
+          openencoder(buffer->channels, buffer->samplerate);
+        }
+
+        encode(reinterpret_cast<int16_t const*>(buffer->data.data()),
+               static_cast<int>(buffer->data.size() / sizeof(int16_t)));
+      }
+
+      else
+      {
+
+        perfcounters::stagetimer timer(*m_counters, perfcounters::stage::encode);
+        fwrite(buffer->data.data(), 1, buffer->data.size(), m_file);
+      }
+
+      lock.lock();
+      m_duration += buffer->duration;
+    }
+  }
+
+  // Stop accepting audio if the recording cannot be written
+  catch (...)
+  {
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_stop = true;
+    m_queue.clear();
+  }
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::writeframe
+//
+// Writes a frame of compressed audio into the recording
+//
+// Arguments:
+//
+//	data		- Compressed audio frame
+//	length		- Length of the compressed audio frame
+//	durationms	- Duration of the compressed audio frame in milliseconds
+//	format		- Compressed audio format (file extension)
+
+void recordingsink::writeframe(uint8_t const* data,
+                               size_t length,
+                               size_t durationms,
+                               std::string const& format)
+{
+  assert(!format.empty());
+  if ((data == nullptr) || (length == 0))
+  {
+
+    return;
+  }
+
+  std::unique_ptr<write_buffer_t> buffer = std::make_unique<write_buffer_t>();
+  buffer->data.assign(data, data + length);
+  buffer->format = format;
+  buffer->duration = static_cast<double>(durationms) / 1000.0;
+
+  queue_buffer(std::move(buffer));
+}
+
+//---------------------------------------------------------------------------
+// recordingsink::writepcm
+//
+// Writes interleaved 16-bit PCM audio into the recording
+//
+// Arguments:
+//
+//	samples		- Interleaved PCM samples
+//	frames		- Number of PCM frames (samples per channel)
+//	channels	- Number of PCM audio channels
+//	samplerate	- PCM audio sample rate
+
+void recordingsink::writepcm(int16_t const* samples, size_t frames, int channels, int samplerate)
+{
+  if ((samples == nullptr) || (frames == 0) || (channels < 1) || (samplerate <= 0))
+  {
+
+    return;
+  }
+
+  size_t const count = frames * static_cast<size_t>(channels);
+
+  std::unique_ptr<write_buffer_t> buffer = std::make_unique<write_buffer_t>();
+  buffer->data.resize(count * sizeof(int16_t));
+  memcpy(buffer->data.data(), samples, count * sizeof(int16_t));
+  buffer->channels = channels;
+  buffer->samplerate = samplerate;
+  buffer->duration = static_cast<double>(frames) / static_cast<double>(samplerate);
+
+  queue_buffer(std::move(buffer));
+}
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,210 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __RECORDINGSINK_H_
+#define __RECORDINGSINK_H_
+#pragma once
+
+#include "perfcounters.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma warning(push, 4)
+
+struct AACENCODER; // aacenc_lib.h
+
+//---------------------------------------------------------------------------
+// Class recordingsink
+//
+// Implements a recording sink that stores the audio generated by a stream in
+// a compressed file.  Decoded PCM audio is encoded into AAC (ADTS) and frames
+// of an already compressed audio stream are written without transcoding.
+//
+// All encoding and file I/O occurs on a low-priority worker thread; audio
+// provided to the sink is discarded rather than blocking the caller when the
+// worker isn't able to keep up
+
+class recordingsink
+{
+public:
+  // Destructor
+  //
+  ~recordingsink();
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // close
+  //
+  // Stops the recording and closes the output file
+  void close(void);
+
+  // completed
+  //
+  // Gets a flag indicating if the maximum duration has been recorded
+  bool completed(void) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new recordingsink instance
+  static std::shared_ptr<recordingsink> create(std::string const& basename,
+                                               double maxduration,
+                                               std::shared_ptr<perfcounters> counters);
+
+  // duration
+  //
+  // Gets the duration of the recorded audio in seconds
+  double duration(void) const;
+
+  // filename
+  //
+  // Gets the name of the output file, or an empty string if not created
+  std::string filename(void) const;
+
+  // writeframe
+  //
+  // Writes a frame of compressed audio into the recording
+  void writeframe(uint8_t const* data, size_t length, size_t durationms, std::string const& format);
+
+  // writepcm
+  //
+  // Writes interleaved 16-bit PCM audio into the recording
+  void writepcm(int16_t const* samples, size_t frames, int channels, int samplerate);
+
+private:
+  recordingsink(recordingsink const&) = delete;
+  recordingsink& operator=(recordingsink const&) = delete;
+
+  // AAC_BITRATE_PER_CHANNEL
+  //
+  // AAC encoder bit rate for each audio channel
+  static unsigned int const AAC_BITRATE_PER_CHANNEL;
+
+  // MAX_WRITE_QUEUE
+  //
+  // Maximum number of audio buffers queued for the worker thread
+  static size_t const MAX_WRITE_QUEUE;
+
+  // Instance Constructor
+  //
+  recordingsink(std::string const& basename,
+                double maxduration,
+                std::shared_ptr<perfcounters> counters);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // write_buffer_t
+  //
+  // Defines the contents of a queued audio buffer
+  struct write_buffer_t
+  {
+
+    std::vector<uint8_t> data; // Compressed frame or PCM samples
+    std::string format; // Compressed format; empty for PCM
+    int channels = 0; // PCM channel count
+    int samplerate = 0; // PCM sample rate
+    double duration = 0.0; // Duration of the buffer in seconds
+  };
+
+  // write_queue_t
+  //
+  // Defines the type of the worker thread queue
+  using write_queue_t = std::deque<std::unique_ptr<write_buffer_t>>;
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // closeencoder
+  //
+  // Flushes and closes the AAC encoder instance
+  void closeencoder(void);
+
+  // encode
+  //
+  // Encodes a buffer of PCM samples into the output file
+  void encode(int16_t const* samples, int count);
+
+  // openencoder
+  //
+  // Opens the AAC encoder instance
+  void openencoder(int channels, int samplerate);
+
+  // openfile
+  //
+  // Opens the output file with a specific extension
+  void openfile(std::string const& extension);
+
+  // queue_buffer
+  //
+  // Queues an audio buffer for the worker thread
+  void queue_buffer(std::unique_ptr<write_buffer_t> buffer);
+
+  // worker
+  //
+  // Worker thread procedure used to encode and write the queued audio
+  void worker(void);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::string const m_basename; // Output file name without extension
+  double const m_maxduration; // Maximum recording duration
+  std::shared_ptr<perfcounters> const m_counters; // Stream performance counters
+
+  // OUTPUT
+  //
+  FILE* m_file = nullptr; // Output file
+  std::string m_filename; // Output file name
+  std::string m_format; // Output file format
+  double m_duration = 0.0; // Duration of the written audio
+  double m_queued = 0.0; // Duration of the queued audio
+
+  // AAC ENCODER
+  //
+  AACENCODER* m_encoder = nullptr; // AAC encoder instance
+  int m_channels = 0; // Encoder channel count
+  int m_samplerate = 0; // Encoder sample rate
+  std::vector<uint8_t> m_encoded; // Encoder output buffer
+
+  // WORKER THREAD
+  //
+  write_queue_t m_queue; // deque<> of queued audio buffers
+  mutable std::mutex m_lock; // Synchronization object
+  std::condition_variable m_cv; // Queue updated event condvar
+  std::thread m_worker; // Worker thread
+  bool m_stop = false; // Flag to stop the worker thread
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __RECORDINGSINK_H_
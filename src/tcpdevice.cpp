@@ -33,17 +33,24 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #endif
 #include "exception_control/socket_exception.h"
 #include "exception_control/string_exception.h"
 #include "utils/align.h"
+#include "utils/value_size_defines.h"
 
 #include <cstring>
 
 #pragma warning(push, 4)
 
+// tcpdevice::MAX_DISCARD_BYTES
+//
+// Maximum amount of stale data discarded when streaming begins
+size_t const tcpdevice::MAX_DISCARD_BYTES = 8 MiB;
+
 // tcpdevice::s_gaintable_e4k
 //
 std::vector<int> const tcpdevice::s_gaintable_e4k{-10, 15,  40,  65,  90,  115, 140,
@@ -252,6 +259,38 @@ tcpdevice::~tcpdevice()
 
 void tcpdevice::begin_stream(void) const
 {
+  assert(m_socket != -1);
+
+  uint8_t buffer[16 KiB]; // Discard buffer
+  size_t discarded = 0; // Total bytes discarded
+
+  // rtl_tcp streams continuously; when the device is reused between streams any data that
+  // was received at the previous frequency is still queued in the socket and has to be
+  // discarded.  Stop when the socket is drained or after a limited amount of data
+  while (discarded < MAX_DISCARD_BYTES)
+  {
+
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(m_socket, &readfds);
+
+    struct timeval timeout = {0, 0};
+    int result = select(m_socket + 1, &readfds, nullptr, nullptr, &timeout);
+    if (result == -1)
+      throw socket_exception(__func__, ": select() failed");
+    if (result == 0)
+      break;
+
+    size_t const count = read(buffer, sizeof(buffer));
+    if (count == 0)
+      break;
+
+    discarded += count;
+  }
+
+  // Maintain the alignment of the I/Q sample pairs
+  if ((discarded & 1) != 0)
+    read(buffer, 1);
 }
 
 //---------------------------------------------------------------------------
@@ -142,6 +142,11 @@ private:
   tcpdevice(tcpdevice const&) = delete;
   tcpdevice& operator=(tcpdevice const&) = delete;
 
+  // MAX_DISCARD_BYTES
+  //
+  // Maximum amount of stale data discarded when streaming begins
+  static size_t const MAX_DISCARD_BYTES;
+
   // Instance Constructor
   //
   tcpdevice(char const* host, uint16_t port);
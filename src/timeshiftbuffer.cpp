@@ -0,0 +1,439 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "timeshiftbuffer.h"
+
+#include "exception_control/string_exception.h"
+#include "utils/value_size_defines.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#ifdef _WINDOWS
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#pragma warning(push, 4)
+
+// timeshiftbuffer::MIN_SEGMENTS
+//
+// Minimum number of segments in the ring
+size_t const timeshiftbuffer::MIN_SEGMENTS = 2;
+
+// timeshiftbuffer::SEGMENT_SIZE
+//
+// Size of each memory-mapped segment
+size_t const timeshiftbuffer::SEGMENT_SIZE = (16 MiB);
+
+// align_record (local)
+//
+// Aligns the length of a stored record to an 8-byte boundary
+inline static size_t align_record(size_t length)
+{
+  return (length + 7) & ~static_cast<size_t>(7);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer Constructor (private)
+//
+// Arguments:
+//
+//	folder		- Folder in which to create the segment files
+//	size		- Requested size of the buffer in bytes
+
+timeshiftbuffer::timeshiftbuffer(std::string const& folder, size_t size)
+  : m_segments(std::max(size / SEGMENT_SIZE, MIN_SEGMENTS))
+{
+  // The segment file names only need to be unique for the lifetime of this instance,
+  // they are deleted as soon as they are mapped (or when closed on Windows)
+  std::string const prefix =
+      folder + "/timeshift-" + std::to_string(reinterpret_cast<uintptr_t>(this)) + "-";
+
+  try
+  {
+    for (size_t index = 0; index < m_segments.size(); index++)
+      map_segment(prefix + std::to_string(index) + ".tmp", m_segments[index]);
+  }
+
+  catch (...)
+  {
+    for (auto& segment : m_segments) unmap_segment(segment);
+    throw;
+  }
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer Destructor
+
+timeshiftbuffer::~timeshiftbuffer()
+{
+  for (auto& segment : m_segments) unmap_segment(segment);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::begin
+//
+// Gets the time of the oldest packet in the buffer
+//
+// Arguments:
+//
+//	NONE
+
+double timeshiftbuffer::begin(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return (m_index.empty()) ? m_end : m_index.front().time;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::create (static)
+//
+// Factory method, creates a new timeshiftbuffer instance
+//
+// Arguments:
+//
+//	folder		- Folder in which to create the segment files
+//	size		- Requested size of the buffer in bytes
+
+std::unique_ptr<timeshiftbuffer> timeshiftbuffer::create(std::string const& folder, size_t size)
+{
+  return std::unique_ptr<timeshiftbuffer>(new timeshiftbuffer(folder, size));
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::end
+//
+// Gets the time at the end of the newest packet in the buffer
+//
+// Arguments:
+//
+//	NONE
+
+double timeshiftbuffer::end(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return m_end;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::head
+//
+// Gets the sequence number that will be assigned to the next packet
+//
+// Arguments:
+//
+//	NONE
+
+uint64_t timeshiftbuffer::head(void) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  return m_first + m_index.size();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::map_segment (private, static)
+//
+// Creates and maps a segment file
+//
+// Arguments:
+//
+//	filename	- Segment file name
+//	segment		- Segment to be initialized
+
+void timeshiftbuffer::map_segment(std::string const& filename, segment_t& segment)
+{
+#ifdef _WINDOWS
+  // Convert the file name into a wide character string
+  int length = MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, nullptr, 0);
+  std::vector<wchar_t> wfilename(std::max(length, 1));
+  MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, wfilename.data(), length);
+
+  ULARGE_INTEGER mapsize = {};
+  mapsize.QuadPart = SEGMENT_SIZE;
+
+#ifdef TARGET_WINDOWS_STORE
+  CREATEFILE2_EXTENDED_PARAMETERS params = {};
+  params.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+  params.dwFileAttributes = FILE_ATTRIBUTE_TEMPORARY;
+  params.dwFileFlags = FILE_FLAG_DELETE_ON_CLOSE;
+  HANDLE file = CreateFile2(wfilename.data(), GENERIC_READ | GENERIC_WRITE, 0, CREATE_ALWAYS,
+                            &params);
+#else
+  HANDLE file = CreateFileW(wfilename.data(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                            nullptr);
+#endif
+  if (file == INVALID_HANDLE_VALUE)
+    throw string_exception(__func__, ": unable to create timeshift segment file ", filename);
+
+#ifdef TARGET_WINDOWS_STORE
+  HANDLE mapping =
+      CreateFileMappingFromApp(file, nullptr, PAGE_READWRITE, mapsize.QuadPart, nullptr);
+#else
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, mapsize.HighPart,
+                                      mapsize.LowPart, nullptr);
+#endif
+  if (mapping == nullptr)
+  {
+    CloseHandle(file);
+    throw string_exception(__func__, ": unable to create timeshift segment file mapping");
+  }
+
+#ifdef TARGET_WINDOWS_STORE
+  void* base = MapViewOfFileFromApp(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, SEGMENT_SIZE);
+#else
+  void* base = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, SEGMENT_SIZE);
+#endif
+  if (base == nullptr)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw string_exception(__func__, ": unable to map timeshift segment file");
+  }
+
+  segment.base = reinterpret_cast<uint8_t*>(base);
+  segment.file = file;
+  segment.mapping = mapping;
+#else
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    throw string_exception(__func__, ": unable to create timeshift segment file ", filename);
+
+  // The mapping keeps the file alive after it has been unlinked; this ensures the
+  // segments are cleaned up by the operating system even if the process crashes
+  void* base = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(SEGMENT_SIZE)) == 0)
+    base = mmap(nullptr, SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+  unlink(filename.c_str());
+
+  if (base == MAP_FAILED)
+    throw string_exception(__func__, ": unable to map timeshift segment file ", filename);
+
+  segment.base = reinterpret_cast<uint8_t*>(base);
+#endif
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::read
+//
+// Reads the packet at a sequence number and advances the sequence number
+//
+// Arguments:
+//
+//	sequence	- Sequence number of the packet to read
+//	allocator	- DEMUX_PACKET allocator function
+
+DEMUX_PACKET* timeshiftbuffer::read(uint64_t& sequence,
+                                    std::function<DEMUX_PACKET*(int)> const& allocator)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // If the oldest segment was evicted out from under the reader, skip forward to
+  // the oldest packet that is still available
+  if (sequence < m_first)
+    sequence = m_first;
+  if (sequence >= (m_first + m_index.size()))
+    return nullptr;
+
+  index_t const& entry = m_index[static_cast<size_t>(sequence - m_first)];
+  uint8_t const* record = m_segments[static_cast<size_t>(
+                                         (entry.position / SEGMENT_SIZE) % m_segments.size())]
+                              .base +
+                          (entry.position % SEGMENT_SIZE);
+
+  packetheader_t header;
+  memcpy(&header, record, sizeof(packetheader_t));
+
+  DEMUX_PACKET* packet = allocator(header.size);
+  if (packet == nullptr)
+    return nullptr;
+
+  packet->iStreamId = header.streamid;
+  packet->duration = header.duration;
+  packet->dts = header.dts;
+  packet->pts = header.pts;
+  if (header.size > 0)
+    memcpy(packet->pData, record + sizeof(packetheader_t), header.size);
+
+  ++sequence;
+  return packet;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::seek
+//
+// Gets the sequence number of the packet nearest to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to
+//	backwards	- Flag to select the packet at or before the time
+//	packettime	- On success, receives the time of the selected packet
+
+uint64_t timeshiftbuffer::seek(double time, bool backwards, double& packettime) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  auto found = std::lower_bound(m_index.begin(), m_index.end(), time,
+                                [](index_t const& entry, double value) -> bool
+                                { return entry.time < value; });
+
+  // Seeking backwards selects the last packet at or before the requested time
+  if ((backwards) && (found != m_index.begin()) &&
+      ((found == m_index.end()) || (found->time > time)))
+    --found;
+
+  packettime = (found == m_index.end()) ? m_end : found->time;
+  return m_first + static_cast<uint64_t>(found - m_index.begin());
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::time
+//
+// Gets the time of the packet at a sequence number
+//
+// Arguments:
+//
+//	sequence	- Packet sequence number
+
+double timeshiftbuffer::time(uint64_t sequence) const
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  if (m_index.empty())
+    return m_end;
+  if (sequence < m_first)
+    return m_index.front().time;
+  if (sequence >= (m_first + m_index.size()))
+    return m_end;
+
+  return m_index[static_cast<size_t>(sequence - m_first)].time;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::unmap_segment (private, static)
+//
+// Unmaps and deletes a segment file
+//
+// Arguments:
+//
+//	segment		- Segment to be released
+
+void timeshiftbuffer::unmap_segment(segment_t& segment)
+{
+#ifdef _WINDOWS
+  if (segment.base)
+    UnmapViewOfFile(segment.base);
+  if (segment.mapping)
+    CloseHandle(segment.mapping);
+  if (segment.file)
+    CloseHandle(segment.file); // FILE_FLAG_DELETE_ON_CLOSE
+
+  segment.mapping = segment.file = nullptr;
+#else
+  if (segment.base)
+    munmap(segment.base, SEGMENT_SIZE);
+#endif
+
+  segment.base = nullptr;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftbuffer::write
+//
+// Writes a packet into the buffer, evicting the oldest segment if necessary
+//
+// Arguments:
+//
+//	header		- Packet header
+//	data		- Packet data
+
+void timeshiftbuffer::write(packetheader_t const& header, uint8_t const* data)
+{
+  assert(header.size >= 0);
+
+  size_t const length = align_record(sizeof(packetheader_t) + header.size);
+  if (length > SEGMENT_SIZE)
+    throw string_exception(__func__, ": packet is too large for the timeshift buffer");
+
+  uint64_t const ringsize = static_cast<uint64_t>(SEGMENT_SIZE) * m_segments.size();
+
+  // There is only one writer, m_position doesn't need to be protected from itself
+  uint64_t position = m_position;
+
+  // Packets never span a segment; skip to the start of the next segment when the
+  // remaining space in the current one is insufficient
+  if ((position % SEGMENT_SIZE) + length > SEGMENT_SIZE)
+    position += SEGMENT_SIZE - (position % SEGMENT_SIZE);
+
+  // Entering a segment that has been written before evicts all of its packets from
+  // the index before the segment contents are overwritten
+  if (((position % SEGMENT_SIZE) == 0) && (position >= ringsize))
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    uint64_t const evict = position + SEGMENT_SIZE - ringsize;
+    while ((!m_index.empty()) && (m_index.front().position < evict))
+    {
+
+      m_index.pop_front();
+      ++m_first;
+    }
+  }
+
+  // Copy the record into the segment outside of the lock, readers are unable to
+  // access it until it has been added to the index
+  uint8_t* record =
+      m_segments[static_cast<size_t>((position / SEGMENT_SIZE) % m_segments.size())].base +
+      (position % SEGMENT_SIZE);
+  memcpy(record, &header, sizeof(packetheader_t));
+  if (header.size > 0)
+    memcpy(record + sizeof(packetheader_t), data, header.size);
+
+  m_position = position + length;
+
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // Untimed packets (metadata, stream changes) are indexed at the current end time
+  // to keep the index monotonic for seeking
+  double time = m_end;
+  if (header.duration > 0.0)
+  {
+
+    time = std::max(header.dts, m_end);
+    m_end = std::max(header.dts + header.duration, m_end);
+  }
+
+  m_index.push_back({position, time});
+}
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
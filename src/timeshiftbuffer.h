@@ -0,0 +1,188 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __TIMESHIFTBUFFER_H_
+#define __TIMESHIFTBUFFER_H_
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <kodi/addon-instance/PVR.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class timeshiftbuffer
+//
+// Implements a size-bounded ring of demux packets stored in a set of fixed
+// size memory-mapped segment files.  Packets never span a segment; once the
+// ring is full, the oldest segment is evicted and reused as a whole.  Every
+// stored packet is indexed in memory by its sequence number and its time on
+// the timeshift timeline, which is never decreasing.
+//
+// A single writer and any number of readers are supported; readers track
+// their own position in the ring as a packet sequence number
+
+class timeshiftbuffer
+{
+public:
+  // Destructor
+  //
+  ~timeshiftbuffer();
+
+  //-----------------------------------------------------------------------
+  // Type Declarations
+
+  // packetheader_t
+  //
+  // Defines the header of a stored demux packet
+  struct packetheader_t
+  {
+
+    int32_t streamid; // Demux stream identifier
+    int32_t size; // Size of the packet data
+    double duration; // Packet duration
+    double dts; // Decode time stamp (timeshift timeline)
+    double pts; // Presentation time stamp (timeshift timeline)
+  };
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // begin
+  //
+  // Gets the time of the oldest packet in the buffer
+  double begin(void) const;
+
+  // create (static)
+  //
+  // Factory method, creates a new timeshiftbuffer instance
+  static std::unique_ptr<timeshiftbuffer> create(std::string const& folder, size_t size);
+
+  // end
+  //
+  // Gets the time at the end of the newest packet in the buffer
+  double end(void) const;
+
+  // head
+  //
+  // Gets the sequence number that will be assigned to the next packet
+  uint64_t head(void) const;
+
+  // read
+  //
+  // Reads the packet at a sequence number and advances the sequence number
+  DEMUX_PACKET* read(uint64_t& sequence, std::function<DEMUX_PACKET*(int)> const& allocator);
+
+  // seek
+  //
+  // Gets the sequence number of the packet nearest to a specific time
+  uint64_t seek(double time, bool backwards, double& packettime) const;
+
+  // time
+  //
+  // Gets the time of the packet at a sequence number
+  double time(uint64_t sequence) const;
+
+  // write
+  //
+  // Writes a packet into the buffer, evicting the oldest segment if necessary
+  void write(packetheader_t const& header, uint8_t const* data);
+
+private:
+  timeshiftbuffer(timeshiftbuffer const&) = delete;
+  timeshiftbuffer& operator=(timeshiftbuffer const&) = delete;
+
+  // MIN_SEGMENTS
+  //
+  // Minimum number of segments in the ring
+  static size_t const MIN_SEGMENTS;
+
+  // SEGMENT_SIZE
+  //
+  // Size of each memory-mapped segment
+  static size_t const SEGMENT_SIZE;
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // index_t
+  //
+  // Defines an entry in the packet index
+  struct index_t
+  {
+
+    uint64_t position; // Logical position of the packet in the ring
+    double time; // Time of the packet on the timeshift timeline
+  };
+
+  // segment_t
+  //
+  // Defines a memory-mapped segment
+  struct segment_t
+  {
+
+    uint8_t* base = nullptr; // Base address of the mapped view
+#ifdef _WINDOWS
+    void* file = nullptr; // File handle
+    void* mapping = nullptr; // File mapping handle
+#endif
+  };
+
+  // Instance Constructor
+  //
+  timeshiftbuffer(std::string const& folder, size_t size);
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // map_segment (static)
+  //
+  // Creates and maps a segment file
+  static void map_segment(std::string const& filename, segment_t& segment);
+
+  // unmap_segment (static)
+  //
+  // Unmaps and deletes a segment file
+  static void unmap_segment(segment_t& segment);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::vector<segment_t> m_segments; // Memory-mapped segments
+  std::deque<index_t> m_index; // Packet index
+  uint64_t m_first = 0; // Sequence number of the first indexed packet
+  uint64_t m_position = 0; // Logical position of the next packet
+  double m_end = 0.0; // Time at the end of the newest packet
+  mutable std::mutex m_lock; // Synchronization object
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __TIMESHIFTBUFFER_H_
@@ -0,0 +1,621 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#include "timeshiftstream.h"
+
+#include <assert.h>
+#include <cstring>
+
+#pragma warning(push, 4)
+
+// timeshiftstream::MAX_WRITE_QUEUE
+//
+// Maximum number of packets queued for the timeshift buffer
+size_t const timeshiftstream::MAX_WRITE_QUEUE = 200;
+
+// timeshiftstream::REALTIME_THRESHOLD
+//
+// Distance from the end of the buffer considered to be real-time
+double const timeshiftstream::REALTIME_THRESHOLD = (10.0 * STREAM_TIME_BASE);
+
+//---------------------------------------------------------------------------
+// timeshiftstream Constructor (private)
+//
+// Arguments:
+//
+//	stream			- PVR stream instance to be wrapped
+//	timeshiftprops	- Timeshift buffer properties
+
+timeshiftstream::timeshiftstream(std::unique_ptr<pvrstream> stream,
+                                 struct timeshiftprops const& timeshiftprops)
+  : pvrstream(stream.get()),
+    m_stream(std::move(stream)),
+    m_buffer(timeshiftbuffer::create(timeshiftprops.folder, timeshiftprops.buffersize)),
+    m_starttime(time(nullptr))
+{
+  // The wrapped stream is drained into the buffer as fast as it can be read, so its
+  // queue depth no longer follows the clock that the audio is being played out with
+  m_stream->realtimeconsumer(false);
+
+  // Create the worker threads to write the buffer and to read from the wrapped stream
+  m_writer = std::thread(&timeshiftstream::writer, this);
+  m_ingest = std::thread(&timeshiftstream::ingest, this);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream Destructor
+
+timeshiftstream::~timeshiftstream()
+{
+  close();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::canseek
+//
+// Gets a flag indicating if the stream allows seek operations
+//
+// Arguments:
+//
+//	NONE
+
+bool timeshiftstream::canseek(void) const
+{
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::close
+//
+// Closes the stream
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::close(void)
+{
+  m_stop = true; // Signal ingest thread to stop
+  if (m_stream)
+    m_stream->close(); // Close the wrapped stream to unblock the ingest thread
+  if (m_ingest.joinable())
+    m_ingest.join(); // Wait for thread
+  if (m_writer.joinable())
+    m_writer.join(); // Wait for thread
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::create (static)
+//
+// Factory method, creates a new timeshiftstream instance
+//
+// Arguments:
+//
+//	stream			- PVR stream instance to be wrapped
+//	timeshiftprops	- Timeshift buffer properties
+
+std::unique_ptr<timeshiftstream> timeshiftstream::create(
+    std::unique_ptr<pvrstream> stream, struct timeshiftprops const& timeshiftprops)
+{
+  return std::unique_ptr<timeshiftstream>(new timeshiftstream(std::move(stream), timeshiftprops));
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::demuxabort
+//
+// Aborts the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::demuxabort(void)
+{
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::demuxflush
+//
+// Flushes the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::demuxflush(void)
+{
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::demuxread
+//
+// Reads the next packet from the demultiplexer
+//
+// Arguments:
+//
+//	allocator		- DemuxPacket allocation function
+
+DEMUX_PACKET* timeshiftstream::demuxread(std::function<DEMUX_PACKET*(int)> const& allocator)
+{
+  // Wait up to 100ms for there to be a packet available in the timeshift buffer at the
+  // current read position; this only blocks when the reader has caught up with the live
+  // stream, don't use an unconditional wait here as the caller may be holding locks
+  std::unique_lock<std::mutex> lock(m_readlock);
+  if (!m_readcv.wait_for(lock, std::chrono::milliseconds(100), [&]() -> bool
+                         { return ((m_buffer->head() > m_sequence) || m_stopped.load() == true); }))
+    return allocator(0);
+
+  // If the writer thread was stopped, check for and re-throw any exception that occurred,
+  // otherwise assume it was stopped normally and continue to read any remaining packets
+  if (m_stopped.load() == true)
+  {
+
+    if (m_ingest_exception)
+      std::rethrow_exception(m_ingest_exception);
+    else if (m_writer_exception)
+      std::rethrow_exception(m_writer_exception);
+    else if (m_buffer->head() <= m_sequence)
+      return allocator(0);
+  }
+
+  return m_buffer->read(m_sequence, allocator);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::demuxreset
+//
+// Resets the demultiplexer
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::demuxreset(void)
+{
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::devicename
+//
+// Gets the device name associated with the stream
+//
+// Arguments:
+//
+//	NONE
+
+std::string timeshiftstream::devicename(void) const
+{
+  return m_stream->devicename();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::enumproperties
+//
+// Enumerates the stream properties
+//
+// Arguments:
+//
+//	callback		- Callback to invoke for each stream
+
+void timeshiftstream::enumproperties(
+    std::function<void(struct streamprops const& props)> const& callback)
+{
+  m_stream->enumproperties(callback);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::ingest (private)
+//
+// Worker thread procedure used to read packets from the wrapped stream
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::ingest(void)
+{
+  DEMUX_PACKET demuxpacket = {}; // Packet provided to the wrapped stream
+  std::vector<uint8_t> data; // Data buffer for the packet
+
+  double offset = 0.0; // Offset from the wrapped stream time stamps
+  double end = STREAM_TIME_BASE; // End of the timeshift timeline
+  bool rebase = true; // Flag to recalculate the offset
+
+  // allocator (local)
+  //
+  // Allocates the packet to be filled in by the wrapped stream
+  auto allocator = [&](int size) -> DEMUX_PACKET*
+  {
+    data.resize(std::max(size, 0));
+
+    demuxpacket = {};
+    demuxpacket.pData = data.data();
+    demuxpacket.iSize = size;
+    demuxpacket.iStreamId = -1;
+    return &demuxpacket;
+  };
+
+  try
+  {
+
+    while (m_stop.test(true) == false)
+    {
+
+      DEMUX_PACKET* packet = m_stream->demuxread(allocator);
+      if (packet == nullptr)
+        continue;
+
+      // Empty packets are returned by the wrapped stream when no data is available,
+      // or when it has stopped and won't produce any more packets
+      bool const streamchange = (packet->iStreamId == DEMUX_SPECIALID_STREAMCHANGE);
+      if ((packet->iSize == 0) && (!streamchange))
+      {
+
+        if (m_stream->stopped())
+          break;
+        continue;
+      }
+
+      std::unique_ptr<write_packet_t> item = std::make_unique<write_packet_t>();
+      item->header.streamid = packet->iStreamId;
+      item->header.size = packet->iSize;
+      item->header.duration = packet->duration;
+      item->header.dts = packet->dts;
+      item->header.pts = packet->pts;
+      item->data = std::move(data);
+
+      // The wrapped stream resets its time stamps after a stream change; the timed
+      // packets are restamped to keep the timeshift timeline continuous
+      if (streamchange)
+        rebase = true;
+
+      else if (packet->duration > 0.0)
+      {
+
+        if ((rebase) || (packet->dts + offset < end))
+          offset = end - packet->dts;
+        rebase = false;
+
+        item->header.dts += offset;
+        item->header.pts += offset;
+        end = item->header.dts + item->header.duration;
+      }
+
+      queue_packet(std::move(item));
+    }
+  }
+
+  catch (...)
+  {
+    m_ingest_exception = std::current_exception();
+  }
+
+  // Signal the writer thread that no further packets will be queued
+  std::unique_lock<std::mutex> lock(m_queuelock);
+  m_ingested = true;
+  m_queuecv.notify_all();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& timeshiftstream::iqsamples(void) const
+{
+  return m_stream->iqsamples();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::length
+//
+// Gets the length of the stream; or -1 if stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftstream::length(void) const
+{
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::muxname
+//
+// Gets the mux name associated with the stream
+//
+// Arguments:
+//
+//	NONE
+
+std::string timeshiftstream::muxname(void) const
+{
+  return m_stream->muxname();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::position
+//
+// Gets the current position of the stream
+//
+// Arguments:
+//
+//	NONE
+
+long long timeshiftstream::position(void) const
+{
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::queue_packet (private)
+//
+// Queues a packet to be written into the timeshift buffer
+//
+// Arguments:
+//
+//	packet		- Packet to be queued
+
+void timeshiftstream::queue_packet(std::unique_ptr<write_packet_t> packet)
+{
+  std::unique_lock<std::mutex> lock(m_queuelock);
+  m_queue.emplace_back(std::move(packet));
+
+  // If the queue size has exceeded the maximum, the packets aren't being
+  // written into the timeshift buffer quickly enough by the writer thread
+  if (m_queue.size() > MAX_WRITE_QUEUE)
+  {
+
+    counters()->packetsdropped(m_queue.size());
+    m_queue.clear();
+
+    // Push a DEMUX_SPECIALID_STREAMCHANGE packet into the cleared queue
+    std::unique_ptr<write_packet_t> streamchange = std::make_unique<write_packet_t>();
+    streamchange->header.streamid = DEMUX_SPECIALID_STREAMCHANGE;
+    m_queue.emplace_back(std::move(streamchange));
+  }
+
+  m_queuecv.notify_all(); // Notify queue was updated
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::read
+//
+// Reads data from the live stream
+//
+// Arguments:
+//
+//	buffer		- Buffer to receive the live stream data
+//	count		- Size of the destination buffer in bytes
+
+size_t timeshiftstream::read(uint8_t* /*buffer*/, size_t /*count*/)
+{
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::realtime
+//
+// Gets a flag indicating if the stream is real-time
+//
+// Arguments:
+//
+//	NONE
+
+bool timeshiftstream::realtime(void) const
+{
+  std::unique_lock<std::mutex> lock(m_readlock);
+  return ((m_buffer->end() - m_buffer->time(m_sequence)) < REALTIME_THRESHOLD);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::receiver
+//
+// Gets the shared receiver the stream is attached to
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<void> timeshiftstream::receiver(void) const
+{
+  return m_stream->receiver();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::record
+//
+// Attaches or detaches (nullptr) the recording sink for the stream audio
+//
+// Arguments:
+//
+//	sink		- Recording sink instance or nullptr
+
+void timeshiftstream::record(std::shared_ptr<recordingsink> sink)
+{
+  // The audio is recorded as it is produced by the wrapped stream
+  m_stream->record(std::move(sink));
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::seek
+//
+// Sets the stream pointer to a specific position
+//
+// Arguments:
+//
+//	position	- Delta within the stream to seek, relative to whence
+//	whence		- Starting position from which to apply the delta
+
+long long timeshiftstream::seek(long long /*position*/, int /*whence*/)
+{
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::seektime
+//
+// Seeks the demultiplexer to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag to seek backwards from the time
+//	startpts	- On success, receives the time stamp of the seek position
+
+bool timeshiftstream::seektime(double time, bool backwards, double& startpts)
+{
+  // The demultiplexer time stamps are on the timeshift timeline, which is in
+  // microseconds; the requested time is in milliseconds on the same timeline
+  std::unique_lock<std::mutex> lock(m_readlock);
+  m_sequence = m_buffer->seek(time * (STREAM_TIME_BASE / 1000), backwards, startpts);
+  m_readcv.notify_all();
+
+  // Kodi flushes its buffered audio when it seeks, restart the playout clock
+  counters()->discontinuity();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::servicename
+//
+// Gets the service name associated with the stream
+//
+// Arguments:
+//
+//	NONE
+
+std::string timeshiftstream::servicename(void) const
+{
+  return m_stream->servicename();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::signalquality
+//
+// Gets the signal quality as percentages
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::signalquality(int& quality, int& snr) const
+{
+  m_stream->signalquality(quality, snr);
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::stopped
+//
+// Gets a flag indicating if the stream has stopped
+//
+// Arguments:
+//
+//	NONE
+
+bool timeshiftstream::stopped(void) const
+{
+  return m_stopped.load();
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::streamtimes
+//
+// Gets the time properties of the stream
+//
+// Arguments:
+//
+//	times		- Structure to receive the stream time properties
+
+bool timeshiftstream::streamtimes(struct streamtimeprops& times) const
+{
+  times.starttime = m_starttime;
+  times.ptsstart = STREAM_TIME_BASE;
+  times.ptsbegin = m_buffer->begin();
+  times.ptsend = m_buffer->end();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// timeshiftstream::writer (private)
+//
+// Worker thread procedure used to write packets into the timeshift buffer
+//
+// Arguments:
+//
+//	NONE
+
+void timeshiftstream::writer(void)
+{
+  try
+  {
+
+    // Continuously write the queued packets until the ingest thread has stopped
+    while (true)
+    {
+
+      // Wait for there to be a packet available to write
+      std::unique_lock<std::mutex> lock(m_queuelock);
+      m_queuecv.wait(lock, [&]() -> bool { return ((m_queue.size() > 0) || m_ingested); });
+      if (m_queue.empty())
+        break;
+
+      // Pop off the topmost packet from the deque<> and release the lock
+      std::unique_ptr<write_packet_t> packet(std::move(m_queue.front()));
+      m_queue.pop_front();
+      lock.unlock();
+
+      assert(packet);
+      m_buffer->write(packet->header, packet->data.data());
+
+      // Notify the reader that the timeshift buffer has been updated; the lock
+      // must be held to ensure the reader can't miss the notification
+      std::unique_lock<std::mutex> readlock(m_readlock);
+      m_readcv.notify_all();
+    }
+  }
+
+  catch (...)
+  {
+
+    // Store the exception for the demultiplexer and stop the ingest thread
+    m_writer_exception = std::current_exception();
+    m_stop = true;
+  }
+
+  // Unblock the reader; the lock must be held to ensure that the
+  // reader can't miss the notification while it's checking the buffer
+  std::unique_lock<std::mutex> lock(m_readlock);
+  m_stopped.store(true);
+  m_readcv.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
@@ -0,0 +1,265 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __TIMESHIFTSTREAM_H_
+#define __TIMESHIFTSTREAM_H_
+#pragma once
+
+#include "props.h"
+#include "pvrstream.h"
+#include "timeshiftbuffer.h"
+#include "utils/scalar_condition.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#pragma warning(push, 4)
+
+//---------------------------------------------------------------------------
+// Class timeshiftstream
+//
+// Implements a timeshifted wrapper around another PVR stream; the packets
+// produced by the wrapped stream are continuously stored in a timeshift
+// buffer and delivered to the demultiplexer from there
+
+class timeshiftstream : public pvrstream
+{
+public:
+  // Destructor
+  //
+  virtual ~timeshiftstream();
+
+  //-----------------------------------------------------------------------
+  // Member Functions
+
+  // canseek
+  //
+  // Flag indicating if the stream allows seek operations
+  bool canseek(void) const override;
+
+  // close
+  //
+  // Closes the stream
+  void close(void) override;
+
+  // create (static)
+  //
+  // Factory method, creates a new timeshiftstream instance
+  static std::unique_ptr<timeshiftstream> create(std::unique_ptr<pvrstream> stream,
+                                                 struct timeshiftprops const& timeshiftprops);
+
+  // demuxabort
+  //
+  // Aborts the demultiplexer
+  void demuxabort(void) override;
+
+  // demuxflush
+  //
+  // Flushes the demultiplexer
+  void demuxflush(void) override;
+
+  // demuxread
+  //
+  // Reads the next packet from the demultiplexer
+  DEMUX_PACKET* demuxread(std::function<DEMUX_PACKET*(int)> const& allocator) override;
+
+  // demuxreset
+  //
+  // Resets the demultiplexer
+  void demuxreset(void) override;
+
+  // devicename
+  //
+  // Gets the device name associated with the stream
+  std::string devicename(void) const override;
+
+  // enumproperties
+  //
+  // Enumerates the stream properties
+  void enumproperties(
+      std::function<void(struct streamprops const& props)> const& callback) override;
+
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const override;
+
+  // length
+  //
+  // Gets the length of the stream
+  long long length(void) const override;
+
+  // muxname
+  //
+  // Gets the mux name associated with the stream
+  std::string muxname(void) const override;
+
+  // position
+  //
+  // Gets the current position of the stream
+  long long position(void) const override;
+
+  // read
+  //
+  // Reads available data from the stream
+  size_t read(uint8_t* buffer, size_t count) override;
+
+  // realtime
+  //
+  // Gets a flag indicating if the stream is real-time
+  bool realtime(void) const override;
+
+  // receiver
+  //
+  // Gets the shared receiver the stream is attached to
+  std::shared_ptr<void> receiver(void) const override;
+
+  // record
+  //
+  // Attaches or detaches (nullptr) the recording sink for the stream audio
+  void record(std::shared_ptr<recordingsink> sink) override;
+
+  // seek
+  //
+  // Sets the stream pointer to a specific position
+  long long seek(long long position, int whence) override;
+
+  // seektime
+  //
+  // Seeks the demultiplexer to a specific time
+  bool seektime(double time, bool backwards, double& startpts) override;
+
+  // servicename
+  //
+  // Gets the service name associated with the stream
+  std::string servicename(void) const override;
+
+  // signalquality
+  //
+  // Gets the signal quality as percentages
+  void signalquality(int& quality, int& snr) const override;
+
+  // stopped
+  //
+  // Gets a flag indicating if the stream has stopped
+  bool stopped(void) const override;
+
+  // streamtimes
+  //
+  // Gets the time properties of the stream
+  bool streamtimes(struct streamtimeprops& times) const override;
+
+private:
+  timeshiftstream(timeshiftstream const&) = delete;
+  timeshiftstream& operator=(timeshiftstream const&) = delete;
+
+  // MAX_WRITE_QUEUE
+  //
+  // Maximum number of packets queued for the timeshift buffer
+  static size_t const MAX_WRITE_QUEUE;
+
+  // REALTIME_THRESHOLD
+  //
+  // Distance from the end of the buffer considered to be real-time
+  static double const REALTIME_THRESHOLD;
+
+  // Instance Constructor
+  //
+  timeshiftstream(std::unique_ptr<pvrstream> stream, struct timeshiftprops const& timeshiftprops);
+
+  //-----------------------------------------------------------------------
+  // Private Type Declarations
+
+  // write_packet_t
+  //
+  // Defines the contents of a packet queued for the timeshift buffer
+  struct write_packet_t
+  {
+
+    timeshiftbuffer::packetheader_t header = {};
+    std::vector<uint8_t> data;
+  };
+
+  // write_queue_t
+  //
+  // Defines the type of the timeshift buffer write queue
+  using write_queue_t = std::deque<std::unique_ptr<write_packet_t>>;
+
+  //-----------------------------------------------------------------------
+  // Private Member Functions
+
+  // ingest
+  //
+  // Worker thread procedure used to read packets from the wrapped stream
+  void ingest(void);
+
+  // queue_packet
+  //
+  // Queues a packet to be written into the timeshift buffer
+  void queue_packet(std::unique_ptr<write_packet_t> packet);
+
+  // writer
+  //
+  // Worker thread procedure used to write packets into the timeshift buffer
+  void writer(void);
+
+  //-----------------------------------------------------------------------
+  // Member Variables
+
+  std::unique_ptr<pvrstream> m_stream; // Wrapped PVR stream instance
+  std::unique_ptr<timeshiftbuffer> m_buffer; // Timeshift buffer instance
+  time_t const m_starttime; // Time at which the stream was started
+
+  // READER
+  //
+  uint64_t m_sequence = 0; // Sequence number of the next packet to read
+  mutable std::mutex m_readlock; // Synchronization object
+  std::condition_variable m_readcv; // Buffer updated event condvar
+
+  // WRITE QUEUE
+  //
+  write_queue_t m_queue; // deque<> of packets to be written
+  mutable std::mutex m_queuelock; // Synchronization object
+  std::condition_variable m_queuecv; // Queue updated event condvar
+
+  // STREAM CONTROL
+  //
+  std::thread m_ingest; // Packet ingest thread
+  std::exception_ptr m_ingest_exception; // Exception on ingest thread
+  std::thread m_writer; // Buffer writer thread
+  std::exception_ptr m_writer_exception; // Exception on writer thread
+  scalar_condition<bool> m_stop{false}; // Condition to stop the ingest thread
+  bool m_ingested = false; // Flag indicating the ingest thread has stopped
+  std::atomic<bool> m_stopped{false}; // Buffer writer stopped flag
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __TIMESHIFTSTREAM_H_
@@ -181,6 +181,25 @@ std::unique_ptr<usbdevice> usbdevice::create(uint32_t index)
   return std::unique_ptr<usbdevice>(new usbdevice(index));
 }
 
+//---------------------------------------------------------------------------
+// usbdevice::device_count (static)
+//
+// Gets the number of connected RTL-SDR devices
+//
+// Arguments:
+//
+//	NONE
+
+uint32_t usbdevice::device_count(void)
+{
+#ifdef __ANDROID__
+  kodi::platform::CInterfaceAndroidSystem system;
+  libusb_set_option(nullptr, LIBUSB_OPTION_NO_DEVICE_DISCOVERY, system.GetJNIEnv());
+#endif
+
+  return rtlsdr_get_device_count();
+}
+
 //---------------------------------------------------------------------------
 // usbdevice::get_center_frequency
 //
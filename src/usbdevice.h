@@ -70,6 +70,11 @@ public:
   static std::unique_ptr<usbdevice> create(void);
   static std::unique_ptr<usbdevice> create(uint32_t index);
 
+  // device_count (static)
+  //
+  // Gets the number of connected RTL-SDR devices
+  static uint32_t device_count(void);
+
   // get_center_frequency
   //
   // Gets the center frequency of the device
@@ -0,0 +1,169 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2020-2022 Michael G. Brehm
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//-----------------------------------------------------------------------------
+
+#ifndef __SEQLOCK_H_
+#define __SEQLOCK_H_
+#pragma once
+
+#include <atomic>
+#include <memory.h>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <type_traits>
+
+#pragma warning(push, 4)
+
+//-----------------------------------------------------------------------------
+// seqlock
+//
+// Implements a sequence lock around a trivially copyable value; readers never
+// block the writer and retry if the value was changed while it was being read.
+// The value is stored as a series of atomic words so that a read that overlaps
+// a write is well-defined, the sequence number detects and discards it
+
+template<typename _type>
+class seqlock
+{
+  static_assert(std::is_trivially_copyable<_type>::value,
+                "seqlock<> requires a trivially copyable type");
+
+public:
+  // Instance Constructor
+  //
+  seqlock()
+  {
+    store(_type{});
+  }
+
+  // Destructor
+  //
+  ~seqlock() = default;
+
+  //-------------------------------------------------------------------------
+  // Member Functions
+
+  // load
+  //
+  // Reads a consistent copy of the value
+  _type load(void) const
+  {
+    uint32_t words[WORDS];
+    _type value;
+
+    while (true)
+    {
+
+      // An odd sequence number indicates that a write is in progress
+      uint32_t const sequence = m_sequence.load(std::memory_order_acquire);
+      if ((sequence & 1) == 0)
+      {
+
+        for (size_t index = 0; index < WORDS; index++)
+          words[index] = m_words[index].load(std::memory_order_relaxed);
+
+        // If the sequence number is unchanged the copy is consistent
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == sequence)
+          break;
+      }
+
+      std::this_thread::yield();
+    }
+
+    memcpy(&value, words, sizeof(_type));
+    return value;
+  }
+
+  // modify
+  //
+  // Applies a modification function to the current value and stores the result
+  template<typename _func>
+  void modify(_func func)
+  {
+    std::unique_lock<std::mutex> lock(m_writelock);
+
+    // There can only be one writer at a time, so the words can be read directly
+    uint32_t words[WORDS];
+    for (size_t index = 0; index < WORDS; index++)
+      words[index] = m_words[index].load(std::memory_order_relaxed);
+
+    _type value;
+    memcpy(&value, words, sizeof(_type));
+    func(value);
+
+    write(value);
+  }
+
+  // store
+  //
+  // Replaces the value
+  void store(_type const& value)
+  {
+    std::unique_lock<std::mutex> lock(m_writelock);
+    write(value);
+  }
+
+private:
+  seqlock(seqlock const&) = delete;
+  seqlock& operator=(seqlock const&) = delete;
+
+  // WORDS
+  //
+  // Number of 32-bit words required to hold the value
+  static size_t const WORDS = (sizeof(_type) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  //-------------------------------------------------------------------------
+  // Private Member Functions
+
+  // write
+  //
+  // Writes the value; the write lock must be held by the caller
+  void write(_type const& value)
+  {
+    uint32_t words[WORDS] = {};
+    memcpy(words, &value, sizeof(_type));
+
+    // Bump the sequence number to odd while the words are being written
+    uint32_t const sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t index = 0; index < WORDS; index++)
+      m_words[index].store(words[index], std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  //-------------------------------------------------------------------------
+  // Member Variables
+
+  std::atomic<uint32_t> m_sequence{0}; // Sequence number
+  std::atomic<uint32_t> m_words[WORDS]; // Stored value
+  std::mutex m_writelock; // Writer synchronization object
+};
+
+//-----------------------------------------------------------------------------
+
+#pragma warning(pop)
+
+#endif // __SEQLOCK_H_
@@ -28,10 +28,16 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <memory.h>
 
 #pragma warning(push, 4)
 
+// wxstream::MAX_PACKET_QUEUE
+//
+// Maximum number of queued demux packets
+size_t const wxstream::MAX_PACKET_QUEUE = 200; // ~2sec
+
 // wxstream::MAX_SAMPLE_QUEUE
 //
 // Maximum number of queued sample sets from the device
@@ -57,6 +63,7 @@ wxstream::wxstream(std::unique_ptr<rtldevice> device,
                    struct channelprops const& channelprops,
                    struct wxprops const& wxprops)
   : m_device(std::move(device)),
+    m_iqfanout(iqfanout::create()),
     m_muxname(generate_mux_name(channelprops)),
     m_pcmsamplerate(wxprops.outputrate),
     m_pcmgain(MPOW(10.0, (wxprops.outputgain / 10.0)))
@@ -101,6 +108,12 @@ wxstream::wxstream(std::unique_ptr<rtldevice> device,
   if (channelprops.autogain == false)
     m_device->set_gain(channelprops.manualgain);
 
+  // Publish the initial signal status before the worker threads are started
+  publishstatus();
+
+  // Create a worker thread on which to perform the demodulation operations
+  m_dspworker = std::thread(&wxstream::dspworker, this);
+
   // Create a worker thread on which to perform the transfer operations
   scalar_condition<bool> started{false};
   m_worker = std::thread(&wxstream::transfer, this, std::ref(started));
@@ -145,6 +158,9 @@ void wxstream::close(void)
     m_device->cancel_async(); // Cancel any async read operations
   if (m_worker.joinable())
     m_worker.join(); // Wait for thread
+  if (m_dspworker.joinable())
+    m_dspworker.join(); // Wait for thread
+  m_iqfanout->close(); // Detach any I/Q sample consumers
   m_device.reset(); // Release RTL-SDR device
 }
 
@@ -206,7 +222,8 @@ void wxstream::demuxflush(void)
 
 DEMUX_PACKET* wxstream::demuxread(std::function<DEMUX_PACKET*(int)> const& allocator)
 {
-  // Wait for there to be a packet of samples available for processing
+  // Wait for there to be a packet available, the demodulator thread continuously
+  // generates audio packets as long as data is being transferred from the device
   std::unique_lock<std::mutex> lock(m_queuelock);
   m_cv.wait(lock, [&]() -> bool { return ((m_queue.size() > 0) || m_stopped.load() == true); });
 
@@ -217,58 +234,37 @@ DEMUX_PACKET* wxstream::demuxread(std::function<DEMUX_PACKET*(int)> const& alloc
 
     if (m_worker_exception)
       std::rethrow_exception(m_worker_exception);
+    else if (m_dspworker_exception)
+      std::rethrow_exception(m_dspworker_exception);
     else
       return allocator(0);
   }
 
-  // Pop off the topmost packet of samples from the queue<> and release the lock
-  std::unique_ptr<TYPECPX[]> insamples(std::move(m_queue.front()));
+  // Pop off the topmost object from the queue<> and release the lock
+  std::unique_ptr<demux_packet_t> packet(std::move(m_queue.front()));
   m_queue.pop();
   lock.unlock();
 
-  // If the packet of samples is null, the writer has indicated there was a problem
-  if (!insamples)
-  {
-
-    m_dts = STREAM_TIME_BASE; // Reset the current decode time stamp
+  // The packet queue should never have a null packet in it
+  assert(packet);
+  if (!packet)
+    return allocator(0);
 
-    // Create a STREAMCHANGE packet that has no data
-    DEMUX_PACKET* packet = allocator(0);
-    if (packet)
-      packet->iStreamId = DEMUX_SPECIALID_STREAMCHANGE;
+  // Allocate and initialize the DEMUX_PACKET
+  DEMUX_PACKET* demuxpacket = allocator(packet->size);
+  if (demuxpacket != nullptr)
+  {
 
-    return packet; // Return the generated packet
+    demuxpacket->iStreamId = packet->streamid;
+    demuxpacket->iSize = packet->size;
+    demuxpacket->duration = packet->duration;
+    demuxpacket->dts = packet->dts;
+    demuxpacket->pts = packet->pts;
+    if (packet->size > 0)
+      memcpy(demuxpacket->pData, packet->data.get(), packet->size);
   }
 
-  // Process the I/Q data
-  std::unique_ptr<TYPEREAL[]> outsamples(new TYPEREAL[m_demodulator->GetInputBufferLimit()]);
-  int audiopackets = m_demodulator->ProcessData(m_demodulator->GetInputBufferLimit(),
-                                                insamples.get(), outsamples.get());
-
-  // Determine the size of the demultiplexer packet data and allocate it
-  int packetsize = audiopackets * sizeof(TYPEMONO16);
-  DEMUX_PACKET* packet = allocator(packetsize);
-  if (packet == nullptr)
-    return nullptr;
-
-  // Resample the audio data directly into the allocated packet buffer
-  audiopackets = m_resampler->Resample(
-      audiopackets, (m_demodulator->GetOutputRate() / m_pcmsamplerate), outsamples.get(),
-      reinterpret_cast<TYPEMONO16*>(packet->pData), m_pcmgain);
-
-  // Calculate the proper duration for the packet
-  double duration = (audiopackets / static_cast<double>(m_pcmsamplerate)) * STREAM_TIME_BASE;
-
-  // Set up the demultiplexer packet with the proper size, duration and dts
-  packet->iStreamId = STREAM_ID_AUDIO;
-  packet->iSize = audiopackets * sizeof(TYPEMONO16);
-  packet->duration = duration;
-  packet->dts = packet->pts = m_dts;
-
-  // Increment the decode time stamp value based on the calculated duration
-  m_dts += duration;
-
-  return packet;
+  return demuxpacket;
 }
 
 //---------------------------------------------------------------------------
@@ -298,6 +294,134 @@ std::string wxstream::devicename(void) const
   return std::string(m_device->get_device_name());
 }
 
+//---------------------------------------------------------------------------
+// wxstream::dspworker (private)
+//
+// Worker thread procedure used to demodulate the queued I/Q samples
+//
+// Arguments:
+//
+//	NONE
+
+void wxstream::dspworker(void)
+{
+  assert(m_demodulator);
+  assert(m_resampler);
+
+  try
+  {
+
+    // Allocate the buffer to hold the demodulated audio samples
+    std::unique_ptr<TYPEREAL[]> outsamples(new TYPEREAL[m_demodulator->GetInputBufferLimit()]);
+
+    // Continuously demodulate the queued I/Q samples until the data transfer has stopped
+    while (true)
+    {
+
+      // Wait for there to be a packet of samples available for processing
+      std::unique_lock<std::mutex> lock(m_samplequeuelock);
+      m_samplecv.wait(lock, [&]() -> bool
+                      { return ((m_samplequeue.size() > 0) || m_stopped.load() == true); });
+      if (m_stopped.load() == true)
+        break;
+
+      // Pop off the topmost packet of samples from the queue<> and release the lock
+      std::unique_ptr<TYPECPX[]> insamples(std::move(m_samplequeue.front()));
+      m_samplequeue.pop();
+      lock.unlock();
+
+      // If the packet of samples is null, the writer has indicated there was a problem
+      if (!insamples)
+      {
+
+        m_dts = STREAM_TIME_BASE; // Reset the current decode time stamp
+        m_driftcontroller.reset(); // Reset the clock drift controller
+
+        // Queue a STREAMCHANGE packet that has no data
+        std::unique_ptr<demux_packet_t> streamchange = std::make_unique<demux_packet_t>();
+        streamchange->streamid = DEMUX_SPECIALID_STREAMCHANGE;
+        queue_packet(std::move(streamchange));
+
+        continue;
+      }
+
+      // Process the I/Q data
+      int audiopackets = 0;
+      {
+        perfcounters::stagetimer timer(*counters(), perfcounters::stage::demodulate);
+        audiopackets = m_demodulator->ProcessData(m_demodulator->GetInputBufferLimit(),
+                                                  insamples.get(), outsamples.get());
+      }
+
+      // Steer the resampler ratio to compensate for the drift between the device clock
+      // and the clock that the audio is being consumed with
+      size_t depth = 0;
+      {
+        std::unique_lock<std::mutex> queuelock(m_queuelock);
+        depth = m_queue.size();
+      }
+
+      // The queue depth only follows the consumer clock if the stream is read in real time
+      bool const controlled = realtimeconsumer();
+      if (!controlled)
+        m_driftcontroller.reset();
+
+      double const correction =
+          (controlled) ? m_driftcontroller.update(depth, MAX_PACKET_QUEUE) : 1.0;
+      counters()->clockdrift(controlled, m_driftcontroller.ppm());
+
+      // Resample the audio data into a new packet; the output rate can be higher than the
+      // demodulator rate and is steered by the drift correction, so the buffer has to be
+      // sized from the resampling ratio with a margin for the fractional phase
+      TYPEREAL const rate =
+          static_cast<TYPEREAL>((m_demodulator->GetOutputRate() / m_pcmsamplerate) * correction);
+      size_t const maxframes = static_cast<size_t>(std::ceil(audiopackets / rate)) + 2;
+
+      std::unique_ptr<demux_packet_t> packet = std::make_unique<demux_packet_t>();
+      packet->data = std::unique_ptr<uint8_t[]>(new uint8_t[maxframes * sizeof(TYPEMONO16)]);
+      {
+        perfcounters::stagetimer timer(*counters(), perfcounters::stage::resample);
+        audiopackets = m_resampler->Resample(audiopackets, rate, outsamples.get(),
+                                             reinterpret_cast<TYPEMONO16*>(packet->data.get()),
+                                             m_pcmgain);
+      }
+
+      // Calculate the proper duration for the packet
+      double duration = (audiopackets / static_cast<double>(m_pcmsamplerate)) * STREAM_TIME_BASE;
+      counters()->addsignaltime(audiopackets / static_cast<double>(m_pcmsamplerate));
+
+      // Set up the demultiplexer packet with the proper size, duration and dts
+      packet->streamid = STREAM_ID_AUDIO;
+      packet->size = audiopackets * sizeof(TYPEMONO16);
+      packet->duration = duration;
+      packet->dts = packet->pts = m_dts;
+
+      // Increment the decode time stamp value based on the calculated duration
+      m_dts += duration;
+
+      // Provide a copy of the audio to the recording sink, if one is attached
+      std::shared_ptr<recordingsink> recording = recorder();
+      if (recording)
+        recording->writepcm(reinterpret_cast<int16_t const*>(packet->data.get()), audiopackets, 1,
+                            static_cast<int>(m_pcmsamplerate));
+
+      queue_packet(std::move(packet));
+
+      // Publish the signal status as of the samples that were just demodulated
+      publishstatus();
+    }
+  }
+
+  catch (...)
+  {
+
+    // Store the exception for the demultiplexer and stop the data transfer
+    std::unique_lock<std::mutex> lock(m_queuelock);
+    m_dspworker_exception = std::current_exception();
+    m_device->cancel_async();
+  }
+}
+
 //---------------------------------------------------------------------------
 // wxstream::enumproperties
 //
@@ -354,6 +478,20 @@ std::string wxstream::generate_mux_name(struct channelprops const& channelprops)
   return std::string(buf);
 }
 
+//---------------------------------------------------------------------------
+// wxstream::iqsamples
+//
+// Gets the fan-out of the raw I/Q samples read from the device
+//
+// Arguments:
+//
+//	NONE
+
+std::shared_ptr<iqfanout> const& wxstream::iqsamples(void) const
+{
+  return m_iqfanout;
+}
+
 //---------------------------------------------------------------------------
 // wxstream::length
 //
@@ -396,6 +534,42 @@ long long wxstream::position(void) const
   return -1;
 }
 
+//---------------------------------------------------------------------------
+// wxstream::queue_packet (private)
+//
+// Queues a demux packet
+//
+// Arguments:
+//
+//	packet		- Demux packet to be queued
+
+void wxstream::queue_packet(std::unique_ptr<demux_packet_t> packet)
+{
+  std::unique_lock<std::mutex> lock(m_queuelock);
+  m_queue.emplace(std::move(packet));
+  counters()->packetqueued(m_queue.size());
+
+  // If the queue size has exceeded the maximum, the packets aren't
+  // being processed quickly enough by the demux read function
+  if (m_queue.size() > MAX_PACKET_QUEUE)
+  {
+
+    counters()->packetsdropped(m_queue.size());
+    m_queue = demux_queue_t(); // Replace the queue<>
+    m_driftcontroller.reset(); // Reset the clock drift controller
+
+    // Push a DEMUX_SPECIALID_STREAMCHANGE packet into the new queue
+    std::unique_ptr<demux_packet_t> streamchange = std::make_unique<demux_packet_t>();
+    streamchange->streamid = DEMUX_SPECIALID_STREAMCHANGE;
+    m_queue.emplace(std::move(streamchange));
+
+    // Reset the decode time stamp
+    m_dts = STREAM_TIME_BASE;
+  }
+
+  m_cv.notify_all(); // Notify queue was updated
+}
+
 //---------------------------------------------------------------------------
 // wxstream::read
 //
@@ -440,6 +614,22 @@ long long wxstream::seek(long long /*position*/, int /*whence*/)
   return -1;
 }
 
+//---------------------------------------------------------------------------
+// wxstream::seektime
+//
+// Seeks the demultiplexer to a specific time
+//
+// Arguments:
+//
+//	time		- Time to seek to, in milliseconds
+//	backwards	- Flag to seek backwards from the time
+//	startpts	- On success, receives the time stamp of the seek position
+
+bool wxstream::seektime(double /*time*/, bool /*backwards*/, double& /*startpts*/)
+{
+  return false;
+}
+
 //---------------------------------------------------------------------------
 // wxstream::servicename
 //
@@ -475,6 +665,34 @@ void wxstream::signalquality(int& quality, int& snr) const
   snr = std::max(0, std::min(100, static_cast<int>(100.0 * demodsnr)));
 }
 
+//---------------------------------------------------------------------------
+// wxstream::stopped
+//
+// Gets a flag indicating if the stream has stopped
+//
+// Arguments:
+//
+//	NONE
+
+bool wxstream::stopped(void) const
+{
+  return m_stopped.load();
+}
+
+//---------------------------------------------------------------------------
+// wxstream::streamtimes
+//
+// Gets the time properties of the stream
+//
+// Arguments:
+//
+//	times		- Structure to receive the stream time properties
+
+bool wxstream::streamtimes(struct streamtimeprops& /*times*/) const
+{
+  return false;
+}
+
 //---------------------------------------------------------------------------
 // wxstream::transfer (private)
 //
@@ -497,6 +715,9 @@ void wxstream::transfer(scalar_condition<bool>& started)
   // Asynchronous read callback function for the RTL-SDR device
   auto read_callback_func = [&](uint8_t const* buffer, size_t count) -> void
   {
+    // Hand the raw samples to any other consumers attached to the device first
+    m_iqfanout->write(buffer, count);
+
     std::unique_ptr<TYPECPX[]> samples; // Array of I/Q samples to return
 
     // If the proper amount of data was returned by the callback, convert it into
@@ -525,20 +746,25 @@ void wxstream::transfer(scalar_condition<bool>& started)
 
     // Push the converted samples into the queue<> for processing.  If there is insufficient space
     // left in the queue<>, the samples aren't being processed quickly enough to keep up with the rate
-    std::unique_lock<std::mutex> lock(m_queuelock);
-    if (m_queue.size() < MAX_SAMPLE_QUEUE)
-      m_queue.emplace(std::move(samples));
+    std::unique_lock<std::mutex> lock(m_samplequeuelock);
+    if (!samples)
+      counters()->buffersdropped(1);
+    if (m_samplequeue.size() < MAX_SAMPLE_QUEUE)
+      m_samplequeue.emplace(std::move(samples));
     else
     {
 
-      m_queue = sample_queue_t(); // Replace the queue<>
-      m_queue.push(nullptr); // Push a resync packet (null)
+      counters()->buffersdropped(m_samplequeue.size());
+      m_samplequeue = sample_queue_t(); // Replace the queue<>
+      m_samplequeue.push(nullptr); // Push a resync packet (null)
       if (samples)
-        m_queue.emplace(std::move(samples)); // Push samples
+        m_samplequeue.emplace(std::move(samples)); // Push samples
     }
 
-    // Notify any threads waiting on the lock that the queue<> has been updated
-    m_cv.notify_all();
+    counters()->bufferreceived(m_samplequeue.size());
+
+    // Notify the demodulator thread that the queue<> has been updated
+    m_samplecv.notify_all();
   };
 
   // Begin streaming from the device and inform the caller that the thread is running
@@ -556,7 +782,16 @@ void wxstream::transfer(scalar_condition<bool>& started)
   }
 
   m_stopped.store(true); // Thread is stopped
-  m_cv.notify_all(); // Unblock any waiters
+
+  // Unblock the demodulator thread; the lock must be held to ensure that the
+  // demodulator can't miss the notification while it's checking the queue
+  std::unique_lock<std::mutex> lock(m_samplequeuelock);
+  m_samplecv.notify_all();
+  lock.unlock();
+
+  // Unblock any demultiplexer waiters, for the same reason this requires the queue lock
+  std::unique_lock<std::mutex> queuelock(m_queuelock);
+  m_cv.notify_all();
 }
 
 //---------------------------------------------------------------------------
@@ -26,6 +26,7 @@
 
 #include "dsp_fm/demodulator.h"
 #include "dsp_fm/fractresampler.h"
+#include "driftcontroller.h"
 #include "props.h"
 #include "pvrstream.h"
 #include "rtldevice.h"
@@ -104,6 +105,11 @@ public:
   void enumproperties(
       std::function<void(struct streamprops const& props)> const& callback) override;
 
+  // iqsamples
+  //
+  // Gets the fan-out of the raw I/Q samples read from the device
+  std::shared_ptr<iqfanout> const& iqsamples(void) const override;
+
   // length
   //
   // Gets the length of the stream
@@ -134,6 +140,11 @@ public:
   // Sets the stream pointer to a specific position
   long long seek(long long position, int whence) override;
 
+  // seektime
+  //
+  // Seeks the demultiplexer to a specific time
+  bool seektime(double time, bool backwards, double& startpts) override;
+
   // servicename
   //
   // Gets the service name associated with the stream
@@ -144,10 +155,25 @@ public:
   // Gets the signal quality as percentages
   void signalquality(int& quality, int& snr) const override;
 
+  // stopped
+  //
+  // Gets a flag indicating if the stream has stopped
+  bool stopped(void) const override;
+
+  // streamtimes
+  //
+  // Gets the time properties of the stream
+  bool streamtimes(struct streamtimeprops& times) const override;
+
 private:
   wxstream(wxstream const&) = delete;
   wxstream& operator=(wxstream const&) = delete;
 
+  // MAX_PACKET_QUEUE
+  //
+  // Maximum number of queued demux packets
+  static size_t const MAX_PACKET_QUEUE;
+
   // MAX_SAMPLE_QUEUE
   //
   // Maximum number of queued sample sets from device
@@ -168,6 +194,25 @@ private:
   //-----------------------------------------------------------------------
   // Private Type Declarations
 
+  // demux_packet_t
+  //
+  // Defines the conents of a queued demux packet
+  struct demux_packet_t
+  {
+
+    int streamid = 0;
+    int size = 0;
+    double duration = 0;
+    double dts = 0;
+    double pts = 0;
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  // demux_queue_t
+  //
+  // Defines the type of the demux queue
+  using demux_queue_t = std::queue<std::unique_ptr<demux_packet_t>>;
+
   // sample_queue_item_t
   //
   // Defines the type of a single sample_queue_t entry
@@ -181,11 +226,21 @@ private:
   //-----------------------------------------------------------------------
   // Private Member Functions
 
+  // dspworker
+  //
+  // Worker thread procedure used to demodulate the queued I/Q samples
+  void dspworker(void);
+
   // generate_mux_name
   //
   // Generates the mux name to associate with the stream
   std::string generate_mux_name(struct channelprops const& channelprops) const;
 
+  // queue_packet
+  //
+  // Queues a demux packet
+  void queue_packet(std::unique_ptr<demux_packet_t> packet);
+
   // transfer
   //
   // Worker thread procedure used to transfer data into the ring buffer
@@ -195,6 +250,7 @@ private:
   // Member Variables
 
   std::unique_ptr<rtldevice> m_device; // RTL-SDR device instance
+  std::shared_ptr<iqfanout> const m_iqfanout; // I/Q sample fan-out
   std::unique_ptr<CDemodulator> m_demodulator; // CuteSDR demodulator instance
   std::unique_ptr<CFractResampler> m_resampler; // CuteSDR resampler instance
 
@@ -203,13 +259,22 @@ private:
   TYPEREAL const m_pcmgain; // Output gain
   double m_dts{STREAM_TIME_BASE}; // Current decode time stamp
 
-  // STREAM CONTROL
+  // DEMUX QUEUE
   //
-  sample_queue_t m_queue; // queue<> of prepared samples
+  demux_queue_t m_queue; // queue<> of demux objects
   mutable std::mutex m_queuelock; // Synchronization object
   std::condition_variable m_cv; // Transfer event condvar
+
+  // STREAM CONTROL
+  //
+  sample_queue_t m_samplequeue; // queue<> of prepared samples
+  mutable std::mutex m_samplequeuelock; // Synchronization object
+  std::condition_variable m_samplecv; // Sample queue event condvar
+  driftcontroller m_driftcontroller; // Clock drift controller
   std::thread m_worker; // Data transfer thread
   std::exception_ptr m_worker_exception; // Exception on worker thread
+  std::thread m_dspworker; // Demodulator thread
+  std::exception_ptr m_dspworker_exception; // Exception on demodulator thread
   scalar_condition<bool> m_stop{false}; // Condition to stop data transfer
   std::atomic<bool> m_stopped{false}; // Data transfer stopped flag
 };